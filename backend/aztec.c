@@ -39,6 +39,7 @@
 #include "common.h"
 #include "aztec.h"
 #include "reedsol.h"
+#include "bitstream.h"
 
 #define AZTEC_MAX_CAPACITY  19968 /* ISO/IEC 24778:2008 5.3 Table 1 Maximum Symbol Bit Capacity */
 #define AZTEC_BIN_CAPACITY  17940 /* Above less 169 * 12 = 2028 bits (169 = 10% of 1664 + 3) */
@@ -91,16 +92,32 @@ static char az_get_next_mode(const char encode_mode[], const int src_len, int i)
     }
 }
 
-static int az_bin_append_posn(const int arg, const int length, char *binary, const int bin_posn) {
+static int az_bits_append_posn(const int arg, const int length, uint64_t binary[], const int bin_posn) {
 
     if (bin_posn + length > AZTEC_BIN_CAPACITY) {
         return 0; /* Fail */
     }
-    return bin_append_posn(arg, length, binary, bin_posn);
+    return bits_append_posn(arg, length, binary, bin_posn);
 }
 
-static int aztec_text_process(const unsigned char source[], int src_len, int bp, char binary_string[], const int gs1,
-            const int eci, int *data_length, const int debug_print) {
+/* FAST_MODE: mode for a character that can be encoded in more than one mode (CR, full stop, comma and space), used
+   instead of looking ahead. Stays in the current mode if it can encode the character, otherwise uses Punct (which the
+   shift pass will turn into P/S where it's shorter) or, for space, Upper */
+static char az_fast_mode(const unsigned char chr, const char current_mode) {
+    if (chr == ' ') {
+        return current_mode == 'P' ? 'U' : current_mode;
+    }
+    if (chr == 13) {
+        return current_mode == 'M' ? 'M' : 'P';
+    }
+    return current_mode == 'D' ? 'D' : 'P'; /* Full stop or comma */
+}
+
+/* If `fast` set, the mode of each ambiguous character is decided by `az_fast_mode()` rather than by counting runs
+   and looking ahead to the next mode. This is linear in the input length and costs at most a shift plus a latch to
+   and from a mode (15 bits) more per ambiguous character */
+static int aztec_text_process(const unsigned char source[], int src_len, int bp, uint64_t binary_string[],
+            const int gs1, const int eci, const int fast, int *data_length, const int debug_print) {
 
     int i, j;
     char current_mode;
@@ -140,6 +157,12 @@ static int aztec_text_process(const unsigned char source[], int src_len, int bp,
         } else if ((source[i] == ':') && (source[i + 1] == ' ')) {
             encode_mode[i + 1] = 'P';
 
+        // Combinations (. SP) and (, SP) always in Punct mode if FAST_MODE
+        } else if (fast && ((source[i] == '.') || (source[i] == ',')) && (source[i + 1] == ' ')
+                && (encode_mode[i] == 'X')) {
+            encode_mode[i] = 'P';
+            encode_mode[i + 1] = 'P';
+
         // Combinations (. SP) and (, SP) sometimes use fewer bits in Digit mode
         } else if (((source[i] == '.') || (source[i] == ',')) && (source[i + 1] == ' ') && (encode_mode[i] == 'X')) {
             count = az_count_doubles(source, i, src_len);
@@ -232,8 +255,14 @@ static int aztec_text_process(const unsigned char source[], int src_len, int bp,
 
     current_mode = 'U';
     for (i = 0; i < reduced_length; i++) {
+        // If FAST_MODE resolve without looking ahead
+        if (fast) {
+            if (reduced_encode_mode[i] == 'X') {
+                reduced_encode_mode[i] = az_fast_mode(reduced_source[i], current_mode);
+            }
+
         // Resolve Carriage Return (CR) which can be Punct or Mixed mode
-        if (reduced_source[i] == 13) {
+        } else if (reduced_source[i] == 13) {
             count = az_count_chr(reduced_source, i, reduced_length, 13);
             next_mode = az_get_next_mode(reduced_encode_mode, reduced_length, i);
 
@@ -460,47 +489,47 @@ static int aztec_text_process(const unsigned char source[], int src_len, int bp,
     }
 
     if (gs1) {
-        bp = bin_append_posn(0, 5, binary_string, bp); // P/S
-        bp = bin_append_posn(0, 5, binary_string, bp); // FLG(n)
-        bp = bin_append_posn(0, 3, binary_string, bp); // FLG(0)
+        bp = bits_append_posn(0, 5, binary_string, bp); // P/S
+        bp = bits_append_posn(0, 5, binary_string, bp); // FLG(n)
+        bp = bits_append_posn(0, 3, binary_string, bp); // FLG(0)
     }
 
     if (eci != 0) {
-        bp = bin_append_posn(0, 5, binary_string, bp); // P/S
-        bp = bin_append_posn(0, 5, binary_string, bp); // FLG(n)
+        bp = bits_append_posn(0, 5, binary_string, bp); // P/S
+        bp = bits_append_posn(0, 5, binary_string, bp); // FLG(n)
         if (eci < 10) {
-            bp = bin_append_posn(1, 3, binary_string, bp); // FLG(1)
-            bp = bin_append_posn(2 + eci, 4, binary_string, bp);
+            bp = bits_append_posn(1, 3, binary_string, bp); // FLG(1)
+            bp = bits_append_posn(2 + eci, 4, binary_string, bp);
         } else if (eci <= 99) {
-            bp = bin_append_posn(2, 3, binary_string, bp); // FLG(2)
-            bp = bin_append_posn(2 + (eci / 10), 4, binary_string, bp);
-            bp = bin_append_posn(2 + (eci % 10), 4, binary_string, bp);
+            bp = bits_append_posn(2, 3, binary_string, bp); // FLG(2)
+            bp = bits_append_posn(2 + (eci / 10), 4, binary_string, bp);
+            bp = bits_append_posn(2 + (eci % 10), 4, binary_string, bp);
         } else if (eci <= 999) {
-            bp = bin_append_posn(3, 3, binary_string, bp); // FLG(3)
-            bp = bin_append_posn(2 + (eci / 100), 4, binary_string, bp);
-            bp = bin_append_posn(2 + ((eci % 100) / 10), 4, binary_string, bp);
-            bp = bin_append_posn(2 + (eci % 10), 4, binary_string, bp);
+            bp = bits_append_posn(3, 3, binary_string, bp); // FLG(3)
+            bp = bits_append_posn(2 + (eci / 100), 4, binary_string, bp);
+            bp = bits_append_posn(2 + ((eci % 100) / 10), 4, binary_string, bp);
+            bp = bits_append_posn(2 + (eci % 10), 4, binary_string, bp);
         } else if (eci <= 9999) {
-            bp = bin_append_posn(4, 3, binary_string, bp); // FLG(4)
-            bp = bin_append_posn(2 + (eci / 1000), 4, binary_string, bp);
-            bp = bin_append_posn(2 + ((eci % 1000) / 100), 4, binary_string, bp);
-            bp = bin_append_posn(2 + ((eci % 100) / 10), 4, binary_string, bp);
-            bp = bin_append_posn(2 + (eci % 10), 4, binary_string, bp);
+            bp = bits_append_posn(4, 3, binary_string, bp); // FLG(4)
+            bp = bits_append_posn(2 + (eci / 1000), 4, binary_string, bp);
+            bp = bits_append_posn(2 + ((eci % 1000) / 100), 4, binary_string, bp);
+            bp = bits_append_posn(2 + ((eci % 100) / 10), 4, binary_string, bp);
+            bp = bits_append_posn(2 + (eci % 10), 4, binary_string, bp);
         } else if (eci <= 99999) {
-            bp = bin_append_posn(5, 3, binary_string, bp); // FLG(5)
-            bp = bin_append_posn(2 + (eci / 10000), 4, binary_string, bp);
-            bp = bin_append_posn(2 + ((eci % 10000) / 1000), 4, binary_string, bp);
-            bp = bin_append_posn(2 + ((eci % 1000) / 100), 4, binary_string, bp);
-            bp = bin_append_posn(2 + ((eci % 100) / 10), 4, binary_string, bp);
-            bp = bin_append_posn(2 + (eci % 10), 4, binary_string, bp);
+            bp = bits_append_posn(5, 3, binary_string, bp); // FLG(5)
+            bp = bits_append_posn(2 + (eci / 10000), 4, binary_string, bp);
+            bp = bits_append_posn(2 + ((eci % 10000) / 1000), 4, binary_string, bp);
+            bp = bits_append_posn(2 + ((eci % 1000) / 100), 4, binary_string, bp);
+            bp = bits_append_posn(2 + ((eci % 100) / 10), 4, binary_string, bp);
+            bp = bits_append_posn(2 + (eci % 10), 4, binary_string, bp);
         } else {
-            bp = bin_append_posn(6, 3, binary_string, bp); // FLG(6)
-            bp = bin_append_posn(2 + (eci / 100000), 4, binary_string, bp);
-            bp = bin_append_posn(2 + ((eci % 100000) / 10000), 4, binary_string, bp);
-            bp = bin_append_posn(2 + ((eci % 10000) / 1000), 4, binary_string, bp);
-            bp = bin_append_posn(2 + ((eci % 1000) / 100), 4, binary_string, bp);
-            bp = bin_append_posn(2 + ((eci % 100) / 10), 4, binary_string, bp);
-            bp = bin_append_posn(2 + (eci % 10), 4, binary_string, bp);
+            bp = bits_append_posn(6, 3, binary_string, bp); // FLG(6)
+            bp = bits_append_posn(2 + (eci / 100000), 4, binary_string, bp);
+            bp = bits_append_posn(2 + ((eci % 100000) / 10000), 4, binary_string, bp);
+            bp = bits_append_posn(2 + ((eci % 10000) / 1000), 4, binary_string, bp);
+            bp = bits_append_posn(2 + ((eci % 1000) / 100), 4, binary_string, bp);
+            bp = bits_append_posn(2 + ((eci % 100) / 10), 4, binary_string, bp);
+            bp = bits_append_posn(2 + (eci % 10), 4, binary_string, bp);
         }
     }
 
@@ -516,124 +545,124 @@ static int aztec_text_process(const unsigned char source[], int src_len, int bp,
             if (current_mode == 'U') {
                 switch (reduced_encode_mode[i]) {
                     case 'L':
-                        if (!(bp = az_bin_append_posn(28, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // L/L
+                        if (!(bp = az_bits_append_posn(28, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // L/L
                         break;
                     case 'M':
-                        if (!(bp = az_bin_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // M/L
+                        if (!(bp = az_bits_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // M/L
                         break;
                     case 'P':
-                        if (!(bp = az_bin_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // M/L
-                        if (!(bp = az_bin_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/L
+                        if (!(bp = az_bits_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // M/L
+                        if (!(bp = az_bits_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/L
                         break;
                     case 'p':
-                        if (!(bp = az_bin_append_posn(0, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/S
+                        if (!(bp = az_bits_append_posn(0, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/S
                         break;
                     case 'D':
-                        if (!(bp = az_bin_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // D/L
+                        if (!(bp = az_bits_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // D/L
                         break;
                     case 'B':
-                        if (!(bp = az_bin_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // B/S
+                        if (!(bp = az_bits_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // B/S
                         break;
                 }
             } else if (current_mode == 'L') {
                 switch (reduced_encode_mode[i]) {
                     case 'U':
-                        if (!(bp = az_bin_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // D/L
-                        if (!(bp = az_bin_append_posn(14, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
+                        if (!(bp = az_bits_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // D/L
+                        if (!(bp = az_bits_append_posn(14, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
                         break;
                     case 'u':
-                        if (!(bp = az_bin_append_posn(28, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/S
+                        if (!(bp = az_bits_append_posn(28, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/S
                         break;
                     case 'M':
-                        if (!(bp = az_bin_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // M/L
+                        if (!(bp = az_bits_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // M/L
                         break;
                     case 'P':
-                        if (!(bp = az_bin_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // M/L
-                        if (!(bp = az_bin_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/L
+                        if (!(bp = az_bits_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // M/L
+                        if (!(bp = az_bits_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/L
                         break;
                     case 'p':
-                        if (!(bp = az_bin_append_posn(0, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/S
+                        if (!(bp = az_bits_append_posn(0, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/S
                         break;
                     case 'D':
-                        if (!(bp = az_bin_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // D/L
+                        if (!(bp = az_bits_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // D/L
                         break;
                     case 'B':
-                        if (!(bp = az_bin_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // B/S
+                        if (!(bp = az_bits_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // B/S
                         break;
                 }
             } else if (current_mode == 'M') {
                 switch (reduced_encode_mode[i]) {
                     case 'U':
-                        if (!(bp = az_bin_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
+                        if (!(bp = az_bits_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
                         break;
                     case 'L':
-                        if (!(bp = az_bin_append_posn(28, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // L/L
+                        if (!(bp = az_bits_append_posn(28, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // L/L
                         break;
                     case 'P':
-                        if (!(bp = az_bin_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/L
+                        if (!(bp = az_bits_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/L
                         break;
                     case 'p':
-                        if (!(bp = az_bin_append_posn(0, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/S
+                        if (!(bp = az_bits_append_posn(0, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/S
                         break;
                     case 'D':
-                        if (!(bp = az_bin_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
-                        if (!(bp = az_bin_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // D/L
+                        if (!(bp = az_bits_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
+                        if (!(bp = az_bits_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // D/L
                         break;
                     case 'B':
-                        if (!(bp = az_bin_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // B/S
+                        if (!(bp = az_bits_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // B/S
                         break;
                 }
             } else if (current_mode == 'P') {
                 switch (reduced_encode_mode[i]) {
                     case 'U':
-                        if (!(bp = az_bin_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
+                        if (!(bp = az_bits_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
                         break;
                     case 'L':
-                        if (!(bp = az_bin_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
-                        if (!(bp = az_bin_append_posn(28, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // L/L
+                        if (!(bp = az_bits_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
+                        if (!(bp = az_bits_append_posn(28, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // L/L
                         break;
                     case 'M':
-                        if (!(bp = az_bin_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
-                        if (!(bp = az_bin_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // M/L
+                        if (!(bp = az_bits_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
+                        if (!(bp = az_bits_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // M/L
                         break;
                     case 'D':
-                        if (!(bp = az_bin_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
-                        if (!(bp = az_bin_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // D/L
+                        if (!(bp = az_bits_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
+                        if (!(bp = az_bits_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // D/L
                         break;
                     case 'B':
-                        if (!(bp = az_bin_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
+                        if (!(bp = az_bits_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
                         current_mode = 'U';
-                        if (!(bp = az_bin_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // B/S
+                        if (!(bp = az_bits_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // B/S
                         break;
                 }
             } else if (current_mode == 'D') {
                 switch (reduced_encode_mode[i]) {
                     case 'U':
-                        if (!(bp = az_bin_append_posn(14, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
+                        if (!(bp = az_bits_append_posn(14, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
                         break;
                     case 'u':
-                        if (!(bp = az_bin_append_posn(15, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/S
+                        if (!(bp = az_bits_append_posn(15, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/S
                         break;
                     case 'L':
-                        if (!(bp = az_bin_append_posn(14, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
-                        if (!(bp = az_bin_append_posn(28, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // L/L
+                        if (!(bp = az_bits_append_posn(14, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
+                        if (!(bp = az_bits_append_posn(28, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // L/L
                         break;
                     case 'M':
-                        if (!(bp = az_bin_append_posn(14, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
-                        if (!(bp = az_bin_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // M/L
+                        if (!(bp = az_bits_append_posn(14, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
+                        if (!(bp = az_bits_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // M/L
                         break;
                     case 'P':
-                        if (!(bp = az_bin_append_posn(14, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
-                        if (!(bp = az_bin_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // M/L
-                        if (!(bp = az_bin_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/L
+                        if (!(bp = az_bits_append_posn(14, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
+                        if (!(bp = az_bits_append_posn(29, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // M/L
+                        if (!(bp = az_bits_append_posn(30, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/L
                         break;
                     case 'p':
-                        if (!(bp = az_bin_append_posn(0, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/S
+                        if (!(bp = az_bits_append_posn(0, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // P/S
                         break;
                     case 'B':
-                        if (!(bp = az_bin_append_posn(14, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
+                        if (!(bp = az_bits_append_posn(14, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // U/L
                         current_mode = 'U';
-                        if (!(bp = az_bin_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // B/S
+                        if (!(bp = az_bits_append_posn(31, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // B/S
                         break;
                 }
             }
@@ -648,11 +677,11 @@ static int aztec_text_process(const unsigned char source[], int src_len, int bp,
 
                 if (count > 31) {
                     /* Put 00000 followed by 11-bit number of bytes less 31 */
-                    if (!(bp = az_bin_append_posn(0, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG;
-                    if (!(bp = az_bin_append_posn(count - 31, 11, binary_string, bp))) return ZINT_ERROR_TOO_LONG;
+                    if (!(bp = az_bits_append_posn(0, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG;
+                    if (!(bp = az_bits_append_posn(count - 31, 11, binary_string, bp))) return ZINT_ERROR_TOO_LONG;
                 } else {
                     /* Put 5-bit number of bytes */
-                    if (!(bp = az_bin_append_posn(count, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG;
+                    if (!(bp = az_bits_append_posn(count, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG;
                 }
                 byte_mode = 1;
             }
@@ -665,68 +694,69 @@ static int aztec_text_process(const unsigned char source[], int src_len, int bp,
 
         if ((reduced_encode_mode[i] == 'U') || (reduced_encode_mode[i] == 'u')) {
             if (reduced_source[i] == ' ') {
-                if (!(bp = az_bin_append_posn(1, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // SP
+                if (!(bp = az_bits_append_posn(1, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // SP
             } else {
-                if (!(bp = az_bin_append_posn(AztecSymbolChar[(int) reduced_source[i]], 5, binary_string, bp)))
+                if (!(bp = az_bits_append_posn(AztecSymbolChar[(int) reduced_source[i]], 5, binary_string, bp)))
                     return ZINT_ERROR_TOO_LONG;
             }
         } else if (reduced_encode_mode[i] == 'L') {
             if (reduced_source[i] == ' ') {
-                if (!(bp = az_bin_append_posn(1, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // SP
+                if (!(bp = az_bits_append_posn(1, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // SP
             } else {
-                if (!(bp = az_bin_append_posn(AztecSymbolChar[(int) reduced_source[i]], 5, binary_string, bp)))
+                if (!(bp = az_bits_append_posn(AztecSymbolChar[(int) reduced_source[i]], 5, binary_string, bp)))
                     return ZINT_ERROR_TOO_LONG;
             }
         } else if (reduced_encode_mode[i] == 'M') {
             if (reduced_source[i] == ' ') {
-                if (!(bp = az_bin_append_posn(1, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // SP
+                if (!(bp = az_bits_append_posn(1, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // SP
             } else if (reduced_source[i] == 13) {
-                if (!(bp = az_bin_append_posn(14, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // CR
+                if (!(bp = az_bits_append_posn(14, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // CR
             } else {
-                if (!(bp = az_bin_append_posn(AztecSymbolChar[(int) reduced_source[i]], 5, binary_string, bp)))
+                if (!(bp = az_bits_append_posn(AztecSymbolChar[(int) reduced_source[i]], 5, binary_string, bp)))
                     return ZINT_ERROR_TOO_LONG;
             }
         } else if ((reduced_encode_mode[i] == 'P') || (reduced_encode_mode[i] == 'p')) {
             if (gs1 && (reduced_source[i] == '[')) {
-                if (!(bp = az_bin_append_posn(0, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // FLG(n)
-                if (!(bp = az_bin_append_posn(0, 3, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // FLG(0) = FNC1
+                if (!(bp = az_bits_append_posn(0, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // FLG(n)
+                if (!(bp = az_bits_append_posn(0, 3, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // FLG(0) = FNC1
             } else if (reduced_source[i] == 13) {
-                if (!(bp = az_bin_append_posn(1, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // CR
+                if (!(bp = az_bits_append_posn(1, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // CR
             } else if (reduced_source[i] == 'a') {
-                if (!(bp = az_bin_append_posn(2, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // CR LF
+                if (!(bp = az_bits_append_posn(2, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // CR LF
             } else if (reduced_source[i] == 'b') {
-                if (!(bp = az_bin_append_posn(3, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // . SP
+                if (!(bp = az_bits_append_posn(3, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // . SP
             } else if (reduced_source[i] == 'c') {
-                if (!(bp = az_bin_append_posn(4, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // , SP
+                if (!(bp = az_bits_append_posn(4, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // , SP
             } else if (reduced_source[i] == 'd') {
-                if (!(bp = az_bin_append_posn(5, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // : SP
+                if (!(bp = az_bits_append_posn(5, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // : SP
             } else if (reduced_source[i] == ',') {
-                if (!(bp = az_bin_append_posn(17, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // Comma
+                if (!(bp = az_bits_append_posn(17, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // Comma
             } else if (reduced_source[i] == '.') {
-                if (!(bp = az_bin_append_posn(19, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // Full stop
+                if (!(bp = az_bits_append_posn(19, 5, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // Full stop
             } else {
-                if (!(bp = az_bin_append_posn(AztecSymbolChar[(int) reduced_source[i]], 5, binary_string, bp)))
+                if (!(bp = az_bits_append_posn(AztecSymbolChar[(int) reduced_source[i]], 5, binary_string, bp)))
                     return ZINT_ERROR_TOO_LONG;
             }
         } else if (reduced_encode_mode[i] == 'D') {
             if (reduced_source[i] == ' ') {
-                if (!(bp = az_bin_append_posn(1, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // SP
+                if (!(bp = az_bits_append_posn(1, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // SP
             } else if (reduced_source[i] == ',') {
-                if (!(bp = az_bin_append_posn(12, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // Comma
+                if (!(bp = az_bits_append_posn(12, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // Comma
             } else if (reduced_source[i] == '.') {
-                if (!(bp = az_bin_append_posn(13, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // Full stop
+                if (!(bp = az_bits_append_posn(13, 4, binary_string, bp))) return ZINT_ERROR_TOO_LONG; // Full stop
             } else {
-                if (!(bp = az_bin_append_posn(AztecSymbolChar[(int) reduced_source[i]], 4, binary_string, bp)))
+                if (!(bp = az_bits_append_posn(AztecSymbolChar[(int) reduced_source[i]], 4, binary_string, bp)))
                     return ZINT_ERROR_TOO_LONG;
             }
         } else if (reduced_encode_mode[i] == 'B') {
-            if (!(bp = az_bin_append_posn(reduced_source[i], 8, binary_string, bp))) return ZINT_ERROR_TOO_LONG;
+            if (!(bp = az_bits_append_posn(reduced_source[i], 8, binary_string, bp))) return ZINT_ERROR_TOO_LONG;
         }
     }
 
     if (debug_print) {
         printf("Binary String:\n");
-        printf("%.*s\n", bp, binary_string);
+        bits_print(binary_string, 0, bp);
+        putchar('\n');
     }
 
     *data_length = bp;
@@ -745,7 +775,7 @@ static int az_avoidReferenceGrid(int output) {
 }
 
 /* Calculate the position of the bits in the grid (non-compact) */
-static void az_populate_map(short AztecMap[], const int layers) {
+static void az_populate_map(short *AztecMap, const int layers) {
     int layer, n, i;
     int x, y;
     const int offset = AztecOffset[layers - 1];
@@ -819,17 +849,150 @@ static void az_populate_map(short AztecMap[], const int layers) {
     }
 }
 
+/* Module positions (row << 8 | column) of full-range symbols, built on first use for each layer count and then
+   shared (protected by `cache_lock()`): the module of each data bit in `bit_pattern` order, then of the 40
+   descriptor bits, then the fixed dark modules, the number of which is kept in `az_map_dark_counts` */
+static const unsigned short *az_map_cache[32];
+static int az_map_dark_counts[32];
+
+/* Number of data bit positions in a full-range symbol of `layers` layers */
+#define AZ_MAP_DATA_BITS(layers) ((112 * (layers)) + (16 * (layers) * (layers)))
+
+/* Build module positions for `layers` (as above) - returns NULL on malloc() failure */
+static unsigned short *az_build_map(const int layers, int *p_dark_count) {
+    const int offset = AztecOffset[layers - 1];
+    const int end_offset = 151 - offset;
+    const int fixed = AZ_MAP_DATA_BITS(layers) + 40;
+    short *AztecMap;
+    unsigned short *posns;
+    int x, y, dark_count = 0;
+
+    if (!(AztecMap = (short *) z_calloc(AZTEC_MAP_SIZE, sizeof(short)))) {
+        return NULL;
+    }
+    az_populate_map(AztecMap, layers);
+
+    for (y = offset; y < end_offset; y++) {
+        for (x = offset; x < end_offset; x++) {
+            if (AztecMap[y * 151 + x] == 1) {
+                dark_count++;
+            }
+        }
+    }
+    if (!(posns = (unsigned short *) z_malloc(sizeof(unsigned short) * (fixed + dark_count)))) {
+        z_free(AztecMap);
+        return NULL;
+    }
+
+    dark_count = 0;
+    for (y = offset; y < end_offset; y++) {
+        for (x = offset; x < end_offset; x++) {
+            const int map = AztecMap[y * 151 + x];
+            const unsigned short posn = (unsigned short) (((y - offset) << 8) | (x - offset));
+            if (map == 1) {
+                posns[fixed + dark_count++] = posn;
+            } else if (map >= 20000) {
+                posns[fixed - 40 + map - 20000] = posn;
+            } else if (map >= 2) {
+                posns[map - 2] = posn;
+            }
+        }
+    }
+    z_free(AztecMap);
+    *p_dark_count = dark_count;
+
+    return posns;
+}
+
+/* Get module positions for `layers`, building them if not cached - returns NULL on malloc() failure */
+static const unsigned short *az_get_map(const int layers, int *p_dark_count) {
+    const unsigned short *posns;
+    unsigned short *new_posns;
+    int dark_count;
+
+    cache_lock();
+    posns = az_map_cache[layers - 1];
+    *p_dark_count = az_map_dark_counts[layers - 1];
+    cache_unlock();
+    if (posns) {
+        return posns;
+    }
+
+    if (!(new_posns = az_build_map(layers, &dark_count))) {
+        return NULL;
+    }
+    cache_lock();
+    if (!(posns = az_map_cache[layers - 1])) { /* Another thread may have beaten us to it */
+        az_map_dark_counts[layers - 1] = dark_count;
+        posns = az_map_cache[layers - 1] = new_posns;
+        new_posns = NULL;
+    }
+    *p_dark_count = az_map_dark_counts[layers - 1];
+    cache_unlock();
+    z_free(new_posns);
+
+    return posns;
+}
+
+/* Split `data_length` bits of `binary_string` into `codeword_size` codewords in `adjusted_string`, stuffing and
+   padding as required, returning the adjusted length */
+static int az_bitstuff(const uint64_t binary_string[], const int data_length, const int codeword_size,
+            uint64_t adjusted_string[], const int debug_print) {
+    const int b1 = codeword_size - 1;
+    const unsigned int b1_ones = (1 << b1) - 1;
+    int i = 0;
+    int adjusted_length = 0;
+    int remainder, padbits;
+
+    while (i < data_length) {
+        unsigned int first;
+        if (data_length - i <= b1) { /* Last (partial) codeword, completed by padding */
+            adjusted_length = bits_append_posn(bits_peek(binary_string, i, data_length - i), data_length - i,
+                                                adjusted_string, adjusted_length);
+            break;
+        }
+        /* 7.3.1.2 "whenever the first B-1 bits ... are all “0”s, then a dummy “1” is inserted..."
+         * "Similarly a message codeword that starts with B-1 “1”s has a dummy “0” inserted..." */
+        first = bits_peek(binary_string, i, b1);
+        if (first == 0 || first == b1_ones) {
+            adjusted_length = bits_append_posn((first << 1) | (first == 0), codeword_size, adjusted_string,
+                                                adjusted_length);
+            i += b1;
+        } else {
+            adjusted_length = bits_append_posn(bits_peek(binary_string, i, codeword_size), codeword_size,
+                                                adjusted_string, adjusted_length);
+            i += codeword_size;
+        }
+    }
+
+    /* Add padding */
+    remainder = adjusted_length % codeword_size;
+
+    padbits = codeword_size - remainder;
+    if (padbits == codeword_size) {
+        padbits = 0;
+    }
+    if (debug_print) printf("Remainder: %d  Pad bits: %d\n", remainder, padbits);
+
+    adjusted_length = bits_pad_posn(1, padbits, adjusted_string, adjusted_length);
+
+    /* Last codeword can't be all 1s either */
+    if (bits_peek(adjusted_string, adjusted_length - codeword_size, codeword_size) == (b1_ones << 1) + 1) {
+        (void) bits_pad_posn(0, 1, adjusted_string, adjusted_length - 1);
+    }
+
+    return adjusted_length;
+}
+
 INTERNAL int aztec(struct zint_symbol *symbol, unsigned char source[], int length) {
-    int x, y, i, j, p, data_blocks, ecc_blocks, layers, total_bits;
-    char bit_pattern[AZTEC_MAP_POSN_MAX + 1]; /* Note AZTEC_MAP_POSN_MAX > AZTEC_BIN_CAPACITY */
-    /* To lessen stack usage, share binary_string buffer with bit_pattern, as accessed separately */
-    char *binary_string = bit_pattern;
+    int x, y, i, data_blocks, ecc_blocks, layers, total_bits;
+    char bit_pattern[AZTEC_MAP_POSN_MAX + 1];
+    uint64_t binary_string[BITS_WORDS(AZTEC_BIN_CAPACITY)];
     char descriptor[42];
-    char adjusted_string[AZTEC_MAX_CAPACITY];
-    short AztecMap[AZTEC_MAP_SIZE];
+    uint64_t adjusted_string[BITS_WORDS(AZTEC_MAX_CAPACITY)];
     unsigned char desc_data[4], desc_ecc[6];
     int error_number, compact, data_length, data_maxsize, codeword_size, adjusted_length;
-    int remainder, padbits, count, gs1, adjustment_size;
+    int gs1, adjustment_size;
     int reader = 0;
     int comp_loop = 4;
     int bp = 0;
@@ -878,8 +1041,8 @@ INTERNAL int aztec(struct zint_symbol *symbol, unsigned char source[], int lengt
             return ZINT_ERROR_INVALID_OPTION;
         }
 
-        bp = bin_append_posn(29, 5, binary_string, bp); // M/L
-        bp = bin_append_posn(29, 5, binary_string, bp); // U/L
+        bp = bits_append_posn(29, 5, binary_string, bp); // M/L
+        bp = bits_append_posn(29, 5, binary_string, bp); // U/L
 
         sa_len = 0;
         if (id_len) { /* ID has a space on either side */
@@ -895,12 +1058,13 @@ INTERNAL int aztec(struct zint_symbol *symbol, unsigned char source[], int lengt
                     symbol->structapp.count, symbol->structapp.count, symbol->structapp.id, sa_src);
         }
 
-        (void) aztec_text_process(sa_src, sa_len, bp, binary_string, 0 /*gs1*/, 0 /*eci*/, &bp, debug_print);
+        (void) aztec_text_process(sa_src, sa_len, bp, binary_string, 0 /*gs1*/, 0 /*eci*/, 0 /*fast*/, &bp,
+                    debug_print);
         /* Will be in U/L due to uppercase A-Z index/count indicators at end */
     }
 
-    error_number = aztec_text_process(source, length, bp, binary_string, gs1, symbol->eci, &data_length,
-                    debug_print);
+    error_number = aztec_text_process(source, length, bp, binary_string, gs1, symbol->eci,
+                    symbol->input_mode & FAST_MODE, &data_length, debug_print);
 
     if (error_number != 0) {
         strcpy(symbol->errtxt, "502: Input too long or too many extended ASCII characters");
@@ -1012,62 +1176,13 @@ INTERNAL int aztec(struct zint_symbol *symbol, unsigned char source[], int lengt
                 codeword_size = 12;
             }
 
-            j = 0;
-            count = 0;
-            for (i = 0; i < data_length; i++) {
-                if ((j + 1) % codeword_size == 0) {
-                    // Last bit of codeword
-                    /* 7.3.1.2 "whenever the first B-1 bits ... are all “0”s, then a dummy “1” is inserted..."
-                     * "Similarly a message codeword that starts with B-1 “1”s has a dummy “0” inserted..." */
-
-                    if (count == 0 || count == (codeword_size - 1)) {
-                        // Codeword of B-1 '0's or B-1 '1's
-                        adjusted_string[j] = count == 0 ? '1' : '0';
-                        j++;
-                        count = binary_string[i] == '1' ? 1 : 0;
-                    } else {
-                        count = 0;
-                    }
-
-                } else if (binary_string[i] == '1') { /* Skip B so only counting B-1 */
-                    count++;
-                }
-
-                adjusted_string[j] = binary_string[i];
-                j++;
-            }
-            adjusted_length = j;
+            adjusted_length = az_bitstuff(binary_string, data_length, codeword_size, adjusted_string, debug_print);
             adjustment_size = adjusted_length - data_length;
 
-            /* Add padding */
-            remainder = adjusted_length % codeword_size;
-
-            padbits = codeword_size - remainder;
-            if (padbits == codeword_size) {
-                padbits = 0;
-            }
-            if (debug_print) printf("Remainder: %d  Pad bits: %d\n", remainder, padbits);
-
-            for (i = 0; i < padbits; i++) {
-                adjusted_string[adjusted_length++] = '1';
-            }
-
-            count = 0;
-            for (i = (adjusted_length - codeword_size); i < adjusted_length; i++) {
-                if (adjusted_string[i] == '1') {
-                    count++;
-                }
-            }
-            if (count == codeword_size) {
-                adjusted_string[adjusted_length - 1] = '0';
-            }
-
             if (debug_print) {
                 printf("Codewords:\n");
                 for (i = 0; i < (adjusted_length / codeword_size); i++) {
-                    for (j = 0; j < codeword_size; j++) {
-                        printf("%c", adjusted_string[(i * codeword_size) + j]);
-                    }
+                    bits_print(adjusted_string, i * codeword_size, codeword_size);
                     printf(" ");
                 }
                 printf("\n");
@@ -1105,52 +1220,7 @@ INTERNAL int aztec(struct zint_symbol *symbol, unsigned char source[], int lengt
             codeword_size = 12;
         }
 
-        j = 0;
-        count = 0;
-        for (i = 0; i < data_length; i++) {
-
-            if ((j + 1) % codeword_size == 0) {
-                // Last bit of codeword
-
-                if (count == 0 || count == (codeword_size - 1)) {
-                    // Codeword of B-1 '0's or B-1 '1's
-                    adjusted_string[j] = count == 0 ? '1' : '0';
-                    j++;
-                    count = binary_string[i] == '1' ? 1 : 0;
-                } else {
-                    count = 0;
-                }
-
-            } else if (binary_string[i] == '1') { /* Skip B so only counting B-1 */
-                count++;
-            }
-
-            adjusted_string[j] = binary_string[i];
-            j++;
-        }
-        adjusted_length = j;
-
-        remainder = adjusted_length % codeword_size;
-
-        padbits = codeword_size - remainder;
-        if (padbits == codeword_size) {
-            padbits = 0;
-        }
-        if (debug_print) printf("Remainder: %d  Pad bits: %d\n", remainder, padbits);
-
-        for (i = 0; i < padbits; i++) {
-            adjusted_string[adjusted_length++] = '1';
-        }
-
-        count = 0;
-        for (i = (adjusted_length - codeword_size); i < adjusted_length; i++) {
-            if (adjusted_string[i] == '1') {
-                count++;
-            }
-        }
-        if (count == codeword_size) {
-            adjusted_string[adjusted_length - 1] = '0';
-        }
+        adjusted_length = az_bitstuff(binary_string, data_length, codeword_size, adjusted_string, debug_print);
 
         /* Check if the data actually fits into the selected symbol size */
         if (compact) {
@@ -1167,7 +1237,8 @@ INTERNAL int aztec(struct zint_symbol *symbol, unsigned char source[], int lengt
         if (debug_print) {
             printf("Codewords:\n");
             for (i = 0; i < (adjusted_length / codeword_size); i++) {
-                printf("%.*s ", codeword_size, adjusted_string + i * codeword_size);
+                bits_print(adjusted_string, i * codeword_size, codeword_size);
+                printf(" ");
             }
             printf("\n");
         }
@@ -1206,11 +1277,7 @@ INTERNAL int aztec(struct zint_symbol *symbol, unsigned char source[], int lengt
 
     /* Split into codewords and calculate reed-solomon error correction codes */
     for (i = 0; i < data_blocks; i++) {
-        for (p = 0; p < codeword_size; p++) {
-            if (adjusted_string[i * codeword_size + p] == '1') {
-                data_part[i] += 0x01 << (codeword_size - (p + 1));
-            }
-        }
+        data_part[i] = bits_peek(adjusted_string, i * codeword_size, codeword_size);
     }
 
     switch (codeword_size) {
@@ -1246,15 +1313,17 @@ INTERNAL int aztec(struct zint_symbol *symbol, unsigned char source[], int lengt
     }
 
     for (i = (ecc_blocks - 1); i >= 0; i--) {
-        adjusted_length = bin_append_posn(ecc_part[i], codeword_size, adjusted_string, adjusted_length);
+        adjusted_length = bits_append_posn(ecc_part[i], codeword_size, adjusted_string, adjusted_length);
     }
 
     /* Invert the data so that actual data is on the outside and reed-solomon on the inside */
-    memset(bit_pattern, '0', AZTEC_MAP_POSN_MAX + 1);
+    if (compact) { /* Full-range placement only reads data bits up to `total_bits` */
+        memset(bit_pattern, '0', 2000 - 2);
+    }
 
     total_bits = (data_blocks + ecc_blocks) * codeword_size;
     for (i = 0; i < total_bits; i++) {
-        bit_pattern[i] = adjusted_string[total_bits - i - 1];
+        bit_pattern[i] = '0' + bits_is_set(adjusted_string, total_bits - i - 1);
     }
 
     /* Now add the symbol descriptor */
@@ -1395,11 +1464,9 @@ INTERNAL int aztec(struct zint_symbol *symbol, unsigned char source[], int lengt
         }
     }
 
-    /* Merge descriptor with the rest of the symbol */
+    /* Merge descriptor with the rest of the symbol (full-range placement reads it directly) */
     if (compact) {
         memcpy(bit_pattern + 2000 - 2, descriptor, 40);
-    } else {
-        memcpy(bit_pattern + 20000 - 2, descriptor, 40);
     }
 
     /* Plot all of the data into the symbol in pre-defined spiral pattern */
@@ -1422,20 +1489,30 @@ INTERNAL int aztec(struct zint_symbol *symbol, unsigned char source[], int lengt
         symbol->rows = 27 - (2 * offset);
         symbol->width = 27 - (2 * offset);
     } else {
-        int offset = AztecOffset[layers - 1];
-        int end_offset = 151 - offset;
-        az_populate_map(AztecMap, layers);
-        for (y = offset; y < end_offset; y++) {
-            int y_map = y * 151;
-            for (x = offset; x < end_offset; x++) {
-                int map = AztecMap[y_map + x];
-                if (map == 1) {
-                    set_module(symbol, y - offset, x - offset);
-                } else if (map >= 2 && bit_pattern[map - 2] == '1') {
-                    set_module(symbol, y - offset, x - offset);
-                }
+        const int offset = AztecOffset[layers - 1];
+        const int data_bits = AZ_MAP_DATA_BITS(layers);
+        const unsigned short *posns;
+        int dark_count;
+        if (!(posns = az_get_map(layers, &dark_count))) {
+            strcpy(symbol->errtxt, "704: Insufficient memory for placement map");
+            return ZINT_ERROR_MEMORY;
+        }
+        /* Only data bits up to `total_bits` can be set, the rest being padding */
+        for (i = 0; i < total_bits; i++) {
+            if (bit_pattern[i] == '1') {
+                set_module(symbol, posns[i] >> 8, posns[i] & 0xFF);
             }
-            symbol->row_height[y - offset] = 1;
+        }
+        for (i = 0; i < 40; i++) {
+            if (descriptor[i] == '1') {
+                set_module(symbol, posns[data_bits + i] >> 8, posns[data_bits + i] & 0xFF);
+            }
+        }
+        for (i = data_bits + 40; i < data_bits + 40 + dark_count; i++) {
+            set_module(symbol, posns[i] >> 8, posns[i] & 0xFF);
+        }
+        for (y = 0; y < 151 - (2 * offset); y++) {
+            symbol->row_height[y] = 1;
         }
         symbol->height = 151 - (2 * offset);
         symbol->rows = 151 - (2 * offset);
@@ -0,0 +1,251 @@
+/*  batch.c - parallel batch encoding
+
+    libzint - the open source barcode library
+    Copyright (C) 2021 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include "common.h"
+#include "batch.h"
+
+#ifndef ZINT_NO_THREADS
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#endif
+
+/* Shared state of a batch run. `next`, `abort` and `error_number` are protected by `mutex` if threaded */
+struct batch_state {
+    struct zint_symbol *tmpl;
+    const unsigned char *const *sources;
+    const int *lengths;
+    int count;
+    zint_batch_callback callback;
+    void *user_data;
+    int next;           /* Index of next input to be encoded */
+    int abort;          /* Set if callback returns non-zero or a worker fails */
+    int error_number;   /* ZINT_ERROR_MEMORY if a worker couldn't allocate its symbol */
+#ifndef ZINT_NO_THREADS
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+#else
+    pthread_mutex_t mutex;
+#endif
+#endif
+    int threaded;
+};
+
+static void batch_lock(struct batch_state *state) {
+#ifndef ZINT_NO_THREADS
+    if (state->threaded) {
+#ifdef _WIN32
+        EnterCriticalSection(&state->mutex);
+#else
+        pthread_mutex_lock(&state->mutex);
+#endif
+    }
+#else
+    (void) state;
+#endif
+}
+
+static void batch_unlock(struct batch_state *state) {
+#ifndef ZINT_NO_THREADS
+    if (state->threaded) {
+#ifdef _WIN32
+        LeaveCriticalSection(&state->mutex);
+#else
+        pthread_mutex_unlock(&state->mutex);
+#endif
+    }
+#else
+    (void) state;
+#endif
+}
+
+/* Reset `symbol` (which must have no outputs, i.e. be freshly created or cleared) to the input settings of `tmpl` */
+static void batch_reset_symbol(struct zint_symbol *symbol, const struct zint_symbol *tmpl) {
+    void *const scratch = symbol->scratch; /* Keep own scratch arena */
+    int i;
+
+    memcpy(symbol, tmpl, sizeof(*symbol));
+    symbol->scratch = scratch;
+    symbol->matrix = NULL; /* Not shareable between workers, so use own `encoded_data` */
+    symbol->matrix_size = 0;
+    symbol->matrix_stride = 0;
+    symbol->fgcolor = symbol->fgcolour;
+    symbol->bgcolor = symbol->bgcolour;
+
+    /* Clear any output copied from template */
+    for (i = 0; i < tmpl->rows; i++) {
+        memset(symbol->encoded_data[i], 0, sizeof(symbol->encoded_data[0]));
+    }
+    symbol->rows = 0;
+    symbol->width = 0;
+    memset(symbol->row_height, 0, sizeof(symbol->row_height));
+    memset(symbol->text, 0, sizeof(symbol->text));
+    symbol->errtxt[0] = '\0';
+    symbol->bitmap = NULL;
+    symbol->bitmap_width = 0;
+    symbol->bitmap_height = 0;
+    symbol->alphamap = NULL;
+    symbol->bitmap_byte_length = 0;
+    symbol->vector = NULL;
+    symbol->memfile = NULL;
+    symbol->memfile_size = 0;
+    symbol->bitmap_stride = 0;
+}
+
+/* Worker - repeatedly take the next unencoded input, encode it using its own symbol and pass to callback */
+static void batch_worker(struct batch_state *state) {
+    struct zint_symbol *symbol = (struct zint_symbol *) z_calloc(1, sizeof(*symbol));
+
+    if (!symbol) {
+        batch_lock(state);
+        state->error_number = ZINT_ERROR_MEMORY;
+        state->abort = 1;
+        batch_unlock(state);
+        return;
+    }
+
+    for (;;) {
+        int index, error_number;
+
+        batch_lock(state);
+        index = state->abort ? state->count : state->next++;
+        batch_unlock(state);
+        if (index >= state->count) {
+            break;
+        }
+
+        batch_reset_symbol(symbol, state->tmpl);
+        error_number = ZBarcode_Encode(symbol, state->sources[index], state->lengths ? state->lengths[index] : 0);
+
+        if (state->callback && state->callback(symbol, index, error_number, state->user_data)) {
+            batch_lock(state);
+            state->abort = 1;
+            batch_unlock(state);
+        }
+        /* Free any outputs created by callback, ready for reset */
+        ZBarcode_Clear(symbol);
+    }
+
+    scratch_free(symbol);
+    z_free(symbol);
+}
+
+#ifndef ZINT_NO_THREADS
+#ifdef _WIN32
+static DWORD WINAPI batch_thread(LPVOID arg) {
+    batch_worker((struct batch_state *) arg);
+    return 0;
+}
+#else
+static void *batch_thread(void *arg) {
+    batch_worker((struct batch_state *) arg);
+    return NULL;
+}
+#endif
+#endif
+
+/* Encode `count` inputs in parallel using up to `threads` threads (including the calling thread), see
+   `ZBarcode_Encode_Batch()` in "zint.h". Returns 0 or ZINT_ERROR_MEMORY */
+INTERNAL int batch_encode(struct zint_symbol *symbol, const unsigned char *const sources[], const int lengths[],
+                const int count, int threads, zint_batch_callback callback, void *user_data) {
+    struct batch_state state;
+
+    memset(&state, 0, sizeof(state));
+    state.tmpl = symbol;
+    state.sources = sources;
+    state.lengths = lengths;
+    state.count = count;
+    state.callback = callback;
+    state.user_data = user_data;
+
+    if (threads > count) {
+        threads = count;
+    }
+    if (threads > ZINT_BATCH_MAX_THREADS) {
+        threads = ZINT_BATCH_MAX_THREADS;
+    }
+
+#ifndef ZINT_NO_THREADS
+    if (threads > 1) {
+        int i, started = 0;
+#ifdef _WIN32
+        HANDLE handles[ZINT_BATCH_MAX_THREADS];
+
+        InitializeCriticalSection(&state.mutex);
+        state.threaded = 1;
+        for (i = 0; i < threads - 1; i++) {
+            if (!(handles[started] = CreateThread(NULL, 0, batch_thread, &state, 0, NULL))) {
+                break; /* Carry on with those started (the calling thread always participates) */
+            }
+            started++;
+        }
+        batch_worker(&state);
+        for (i = 0; i < started; i++) {
+            WaitForSingleObject(handles[i], INFINITE);
+            CloseHandle(handles[i]);
+        }
+        DeleteCriticalSection(&state.mutex);
+#else
+        pthread_t tids[ZINT_BATCH_MAX_THREADS];
+
+        if (pthread_mutex_init(&state.mutex, NULL) == 0) {
+            state.threaded = 1;
+            for (i = 0; i < threads - 1; i++) {
+                if (pthread_create(&tids[started], NULL, batch_thread, &state) != 0) {
+                    break; /* Carry on with those started (the calling thread always participates) */
+                }
+                started++;
+            }
+            batch_worker(&state);
+            for (i = 0; i < started; i++) {
+                pthread_join(tids[i], NULL);
+            }
+            pthread_mutex_destroy(&state.mutex);
+        } else {
+            batch_worker(&state);
+        }
+#endif
+    } else {
+        batch_worker(&state);
+    }
+#else
+    batch_worker(&state);
+#endif
+
+    if (state.error_number) {
+        strcpy(symbol->errtxt, "228: Insufficient memory for batch symbol");
+        return state.error_number;
+    }
+    return 0;
+}
@@ -0,0 +1,542 @@
+/* zint_bench.c - Benchmark encoding, raster and vector phases over a fixed corpus */
+
+/*
+    libzint - the open source barcode library
+    Copyright (C) 2021 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+/* vim: set ts=4 sw=4 et : */
+
+/* Times ZBarcode_Encode(), ZBarcode_Buffer() and ZBarcode_Buffer_Vector() separately for each case of a built-in
+ * corpus, reporting min/percentiles/max/mean per phase as JSON, along with allocation counts where available
+ * (glibc). A previous JSON report can be given with "-c" to compare against, the exit status being 2 if any phase
+ * median regressed by more than the threshold ("-t", default 10%).
+ *
+ * The corpus is fixed (pseudo-random data is generated from a fixed seed) so that reports from different builds
+ * are comparable. One case per line is output so that reports can be diffed. */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L /* For clock_gettime() */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#ifndef _MSC_VER
+#include <getopt.h>
+#include <zint.h>
+#else
+#include "../../getopt/getopt.h"
+#include "zint.h"
+#if _MSC_VER != 1200 /* VC6 */
+#pragma warning(disable: 4996) /* function or variable may be unsafe */
+#endif
+#endif /* _MSC_VER */
+
+#define BENCH_LITERAL   0 /* Use data as is */
+#define BENCH_REPEAT    1 /* Repeat data to length bytes */
+#define BENCH_RANDOM    2 /* Pseudo-random bytes of length bytes */
+
+struct bench_case {
+    const char *name;
+    int symbology;
+    int input_mode;
+    int option_1;
+    int option_2;
+    int gen;
+    int length;
+    const char *data;
+    const char *primary; /* Linear component of composites */
+};
+
+#define BENCH_TEXT "The quick brown fox jumps over the lazy dog. "
+#define BENCH_KANJI "\347\202\271\345\217\243" /* 点口 (UTF-8), in Shift JIS and GB 2312 */
+#define BENCH_GS1 "[01]09501101530003[3103]000123[10]ABC123[17]211231[21]1234567890"
+
+static const struct bench_case cases[] = {
+    /* name, symbology, input_mode, option_1, option_2, gen, length, data[, primary] */
+    { "code128_small", BARCODE_CODE128, UNICODE_MODE, -1, 0, BENCH_LITERAL, 0, "ABC123", NULL },
+    { "code128_medium", BARCODE_CODE128, UNICODE_MODE, -1, 0, BENCH_REPEAT, 50, BENCH_TEXT, NULL },
+    { "code128_binary", BARCODE_CODE128, DATA_MODE, -1, 0, BENCH_RANDOM, 30, NULL, NULL },
+    { "gs1_128", BARCODE_GS1_128, GS1_MODE, -1, 0, BENCH_LITERAL, 0, BENCH_GS1, NULL },
+    { "ean13", BARCODE_EANX, UNICODE_MODE, -1, 0, BENCH_LITERAL, 0, "501234567890", NULL },
+    { "dbar_exp", BARCODE_DBAR_EXP, GS1_MODE, -1, 0, BENCH_LITERAL, 0, BENCH_GS1, NULL },
+    { "pdf417_small", BARCODE_PDF417, UNICODE_MODE, -1, 0, BENCH_LITERAL, 0, "ABC123", NULL },
+    { "pdf417_medium", BARCODE_PDF417, UNICODE_MODE, -1, 0, BENCH_REPEAT, 200, BENCH_TEXT, NULL },
+    { "pdf417_max_numeric", BARCODE_PDF417, UNICODE_MODE, 0, 0, BENCH_REPEAT, 2700, "0123456789", NULL },
+    { "pdf417_binary", BARCODE_PDF417, DATA_MODE, -1, 0, BENCH_RANDOM, 1000, NULL, NULL },
+    { "maxicode_small", BARCODE_MAXICODE, UNICODE_MODE, 4, 0, BENCH_LITERAL, 0, "ABC123", NULL },
+    { "maxicode_max", BARCODE_MAXICODE, UNICODE_MODE, 4, 0, BENCH_REPEAT, 90, "ABCDEFGHIJ", NULL },
+    { "qr_small", BARCODE_QRCODE, UNICODE_MODE, -1, 0, BENCH_LITERAL, 0, "12345", NULL },
+    { "qr_medium", BARCODE_QRCODE, UNICODE_MODE, -1, 0, BENCH_REPEAT, 200, BENCH_TEXT, NULL },
+    { "qr_max_numeric", BARCODE_QRCODE, UNICODE_MODE, 1, 0, BENCH_REPEAT, 7089, "0123456789", NULL },
+    { "qr_kanji", BARCODE_QRCODE, UNICODE_MODE, 1, 0, BENCH_REPEAT, 3000, BENCH_KANJI, NULL },
+    { "qr_binary", BARCODE_QRCODE, DATA_MODE, 1, 0, BENCH_RANDOM, 2900, NULL, NULL },
+    { "qr_gs1", BARCODE_QRCODE, GS1_MODE, -1, 0, BENCH_LITERAL, 0, BENCH_GS1, NULL },
+    { "microqr_small", BARCODE_MICROQR, UNICODE_MODE, -1, 0, BENCH_LITERAL, 0, "12345", NULL },
+    { "microqr_max", BARCODE_MICROQR, UNICODE_MODE, 1, 0, BENCH_REPEAT, 35, "0123456789", NULL },
+    { "rmqr_small", BARCODE_RMQR, UNICODE_MODE, -1, 0, BENCH_LITERAL, 0, "12345", NULL },
+    { "rmqr_medium", BARCODE_RMQR, UNICODE_MODE, -1, 0, BENCH_REPEAT, 100, BENCH_TEXT, NULL },
+    { "datamatrix_small", BARCODE_DATAMATRIX, UNICODE_MODE, -1, 0, BENCH_LITERAL, 0, "ABC123", NULL },
+    { "datamatrix_medium", BARCODE_DATAMATRIX, UNICODE_MODE, -1, 0, BENCH_REPEAT, 200, BENCH_TEXT, NULL },
+    { "datamatrix_max_numeric", BARCODE_DATAMATRIX, UNICODE_MODE, -1, 0, BENCH_REPEAT, 3116, "0123456789", NULL },
+    { "datamatrix_binary", BARCODE_DATAMATRIX, DATA_MODE, -1, 0, BENCH_RANDOM, 1500, NULL, NULL },
+    { "datamatrix_gs1", BARCODE_DATAMATRIX, GS1_MODE, -1, 0, BENCH_LITERAL, 0, BENCH_GS1, NULL },
+    { "aztec_small", BARCODE_AZTEC, UNICODE_MODE, -1, 0, BENCH_LITERAL, 0, "ABC123", NULL },
+    { "aztec_medium", BARCODE_AZTEC, UNICODE_MODE, -1, 0, BENCH_REPEAT, 200, BENCH_TEXT, NULL },
+    { "aztec_max_numeric", BARCODE_AZTEC, UNICODE_MODE, 1, 0, BENCH_REPEAT, 3000, "0123456789", NULL },
+    { "aztec_binary", BARCODE_AZTEC, DATA_MODE, 1, 0, BENCH_RANDOM, 1500, NULL, NULL },
+    { "aztec_gs1", BARCODE_AZTEC, GS1_MODE, -1, 0, BENCH_LITERAL, 0, BENCH_GS1, NULL },
+    { "hanxin_small", BARCODE_HANXIN, UNICODE_MODE, -1, 0, BENCH_LITERAL, 0, "12345", NULL },
+    { "hanxin_medium", BARCODE_HANXIN, UNICODE_MODE, -1, 0, BENCH_REPEAT, 200, BENCH_TEXT, NULL },
+    { "hanxin_max_numeric", BARCODE_HANXIN, UNICODE_MODE, 1, 0, BENCH_REPEAT, 7827, "0123456789", NULL },
+    { "hanxin_hanzi", BARCODE_HANXIN, UNICODE_MODE, 1, 0, BENCH_REPEAT, 3000, BENCH_KANJI, NULL },
+    { "hanxin_binary", BARCODE_HANXIN, DATA_MODE, 1, 0, BENCH_RANDOM, 3000, NULL, NULL },
+    { "gridmatrix_small", BARCODE_GRIDMATRIX, UNICODE_MODE, -1, 0, BENCH_LITERAL, 0, "12345", NULL },
+    { "gridmatrix_medium", BARCODE_GRIDMATRIX, UNICODE_MODE, -1, 0, BENCH_REPEAT, 200, BENCH_TEXT, NULL },
+    { "gridmatrix_max_numeric", BARCODE_GRIDMATRIX, UNICODE_MODE, 1, 0, BENCH_REPEAT, 2500, "0123456789", NULL },
+    { "gridmatrix_hanzi", BARCODE_GRIDMATRIX, UNICODE_MODE, 1, 0, BENCH_REPEAT, 1500, BENCH_KANJI, NULL },
+    { "gridmatrix_binary", BARCODE_GRIDMATRIX, DATA_MODE, 1, 0, BENCH_RANDOM, 1000, NULL, NULL },
+    { "dotcode_small", BARCODE_DOTCODE, UNICODE_MODE, -1, 0, BENCH_LITERAL, 0, "ABC123", NULL },
+    { "dotcode_medium", BARCODE_DOTCODE, UNICODE_MODE, -1, 0, BENCH_REPEAT, 200, BENCH_TEXT, NULL },
+    { "dotcode_binary", BARCODE_DOTCODE, DATA_MODE, -1, 0, BENCH_RANDOM, 300, NULL, NULL },
+    { "dotcode_gs1", BARCODE_DOTCODE, GS1_MODE, -1, 0, BENCH_LITERAL, 0, BENCH_GS1, NULL },
+    { "code1_medium", BARCODE_CODEONE, UNICODE_MODE, -1, 0, BENCH_REPEAT, 200, BENCH_TEXT, NULL },
+    { "ultra_medium", BARCODE_ULTRA, UNICODE_MODE, -1, 0, BENCH_REPEAT, 200, BENCH_TEXT, NULL },
+    { "composite_cc_a", BARCODE_GS1_128_CC, GS1_MODE, 1, 0, BENCH_LITERAL, 0, "[21]A12345678", "[01]09501101530003" },
+    { "composite_cc_c", BARCODE_GS1_128_CC, GS1_MODE, 3, 0, BENCH_LITERAL, 0, BENCH_GS1 "[91]" BENCH_TEXT BENCH_TEXT, "[01]09501101530003" },
+};
+
+#define BENCH_PHASES    3 /* Encode, raster, vector */
+
+static const char *const phase_names[BENCH_PHASES] = { "encode", "raster", "vector" };
+
+struct bench_result {
+    double min, p50, p90, p99, max, mean; /* Microseconds */
+    long allocs; /* Per iteration, -1 if not counted */
+};
+
+#if defined(__GLIBC__) && !defined(ZINT_BENCH_NO_ALLOC_COUNT)
+/* Count allocations by interposing the allocation functions, which the (shared) library will resolve to */
+#define BENCH_ALLOC_COUNT
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static long bench_allocs;
+
+void *malloc(size_t size) {
+    bench_allocs++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    bench_allocs++;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    bench_allocs++;
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+/* Monotonic time in microseconds */
+static double bench_now(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&count);
+    return (double) count.QuadPart * 1000000.0 / (double) freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+#endif
+}
+
+/* Generate the input of a case, returning its length */
+static int bench_data(const struct bench_case *bc, unsigned char *buf) {
+    int i;
+
+    if (bc->gen == BENCH_LITERAL) {
+        const int length = (int) strlen(bc->data);
+        memcpy(buf, bc->data, length);
+        return length;
+    }
+    if (bc->gen == BENCH_REPEAT) {
+        const int data_len = (int) strlen(bc->data);
+        for (i = 0; i < bc->length; i++) {
+            buf[i] = (unsigned char) bc->data[i % data_len];
+        }
+    } else {
+        unsigned long seed = 20210901; /* Fixed so corpus reproducible */
+        for (i = 0; i < bc->length; i++) {
+            seed = (seed * 1103515245 + 12345) & 0x7FFFFFFF;
+            buf[i] = (unsigned char) (seed >> 16);
+        }
+    }
+    return bc->length;
+}
+
+static int bench_cmp_double(const void *a, const void *b) {
+    const double da = *(const double *) a, db = *(const double *) b;
+    return da < db ? -1 : da > db;
+}
+
+/* Nearest-rank percentile of sorted samples */
+static double bench_percentile(const double *sorted, const int n, const int percent) {
+    int rank = (percent * n + 99) / 100;
+    if (rank < 1) {
+        rank = 1;
+    }
+    return sorted[rank - 1];
+}
+
+static void bench_stats(double *samples, const int n, const long allocs, struct bench_result *result) {
+    double sum = 0.0;
+    int i;
+
+    qsort(samples, n, sizeof(double), bench_cmp_double);
+    for (i = 0; i < n; i++) {
+        sum += samples[i];
+    }
+    result->min = samples[0];
+    result->p50 = bench_percentile(samples, n, 50);
+    result->p90 = bench_percentile(samples, n, 90);
+    result->p99 = bench_percentile(samples, n, 99);
+    result->max = samples[n - 1];
+    result->mean = sum / n;
+    result->allocs = allocs;
+}
+
+/* Run a case, returning 0 on success, else error message in `errtxt` */
+static int bench_run(const struct bench_case *bc, const unsigned char *data, const int length, const int iterations,
+            const int warmup, struct bench_result results[BENCH_PHASES], int *p_rows, int *p_width,
+            char errtxt[128]) {
+    double *samples[BENCH_PHASES];
+    long allocs[BENCH_PHASES] = { 0, 0, 0 };
+    int i, p;
+    int ret = 0;
+
+    for (p = 0; p < BENCH_PHASES; p++) {
+        if (!(samples[p] = (double *) malloc(sizeof(double) * iterations))) {
+            strcpy(errtxt, "Insufficient memory for samples");
+            while (--p >= 0) {
+                free(samples[p]);
+            }
+            return 1;
+        }
+    }
+
+    for (i = -warmup; i < iterations && ret == 0; i++) {
+        struct zint_symbol *symbol = ZBarcode_Create();
+        double start, times[BENCH_PHASES];
+#ifdef BENCH_ALLOC_COUNT
+        long allocs_before[BENCH_PHASES], allocs_after[BENCH_PHASES];
+#endif
+
+        if (!symbol) {
+            strcpy(errtxt, "Insufficient memory for symbol");
+            ret = 1;
+            break;
+        }
+        symbol->symbology = bc->symbology;
+        symbol->input_mode = bc->input_mode;
+        symbol->option_1 = bc->option_1;
+        symbol->option_2 = bc->option_2;
+        if (bc->primary) {
+            strcpy(symbol->primary, bc->primary);
+        }
+
+        for (p = 0; p < BENCH_PHASES && ret < ZINT_ERROR; p++) {
+#ifdef BENCH_ALLOC_COUNT
+            allocs_before[p] = bench_allocs;
+#endif
+            start = bench_now();
+            if (p == 0) {
+                ret = ZBarcode_Encode(symbol, data, length);
+            } else if (p == 1) {
+                ret = ZBarcode_Buffer(symbol, 0 /*rotate_angle*/);
+            } else {
+                ret = ZBarcode_Buffer_Vector(symbol, 0 /*rotate_angle*/);
+            }
+            times[p] = bench_now() - start;
+#ifdef BENCH_ALLOC_COUNT
+            allocs_after[p] = bench_allocs;
+#endif
+        }
+        if (ret >= ZINT_ERROR) {
+            sprintf(errtxt, "%s failed: %.100s", phase_names[p - 1], symbol->errtxt);
+        } else {
+            ret = 0; /* Ignore warnings */
+            if (i >= 0) {
+                for (p = 0; p < BENCH_PHASES; p++) {
+                    samples[p][i] = times[p];
+#ifdef BENCH_ALLOC_COUNT
+                    allocs[p] += allocs_after[p] - allocs_before[p];
+#endif
+                }
+            }
+            *p_rows = symbol->rows;
+            *p_width = symbol->width;
+        }
+        ZBarcode_Delete(symbol);
+    }
+
+    if (ret == 0) {
+        for (p = 0; p < BENCH_PHASES; p++) {
+#ifdef BENCH_ALLOC_COUNT
+            bench_stats(samples[p], iterations, allocs[p] / iterations, &results[p]);
+#else
+            (void)allocs;
+            bench_stats(samples[p], iterations, -1, &results[p]);
+#endif
+        }
+    }
+    for (p = 0; p < BENCH_PHASES; p++) {
+        free(samples[p]);
+    }
+
+    return ret;
+}
+
+/* Output a case's results as a single-line JSON object */
+static void bench_print_case(FILE *fp, const struct bench_case *bc, const int length, const int rows,
+            const int width, const struct bench_result results[BENCH_PHASES], const int last) {
+    char name[32];
+    int p;
+
+    ZBarcode_BarcodeName(bc->symbology, name);
+    fprintf(fp, "    {\"name\": \"%s\", \"symbology\": \"%s\", \"length\": %d, \"rows\": %d, \"width\": %d", bc->name,
+            name, length, rows, width);
+    for (p = 0; p < BENCH_PHASES; p++) {
+        const struct bench_result *r = &results[p];
+        fprintf(fp, ", \"%s\": {\"min\": %.2f, \"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f, \"max\": %.2f,"
+                " \"mean\": %.2f, \"allocs\": %ld}", phase_names[p], r->min, r->p50, r->p90, r->p99, r->max, r->mean,
+                r->allocs);
+    }
+    fprintf(fp, "}%s\n", last ? "" : ",");
+}
+
+/* Find the median of `phase` for case `name` in JSON report `baseline`, returning 0 if not found */
+static int bench_baseline_p50(const char *baseline, const char *name, const char *phase, double *p_p50) {
+    char key[64], phase_key[32];
+    const char *line, *end;
+
+    sprintf(key, "{\"name\": \"%.40s\",", name);
+    if (!(line = strstr(baseline, key))) {
+        return 0;
+    }
+    if (!(end = strchr(line, '\n'))) {
+        end = line + strlen(line);
+    }
+    sprintf(phase_key, "\"%.16s\": {", phase);
+    if (!(line = strstr(line, phase_key)) || line > end || !(line = strstr(line, "\"p50\": ")) || line > end) {
+        return 0;
+    }
+    return sscanf(line + 7, "%lf", p_p50) == 1;
+}
+
+/* Read whole of file into malloc'd buffer */
+static char *bench_read_file(const char *filename) {
+    FILE *fp = fopen(filename, "rb");
+    char *buf;
+    long size;
+
+    if (!fp) {
+        return NULL;
+    }
+    if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0
+            || !(buf = (char *) malloc(size + 1))) {
+        fclose(fp);
+        return NULL;
+    }
+    if (fread(buf, 1, size, fp) != (size_t) size) {
+        free(buf);
+        fclose(fp);
+        return NULL;
+    }
+    buf[size] = '\0';
+    fclose(fp);
+    return buf;
+}
+
+static void usage(void) {
+    printf("Usage: zint_bench [-n ITERATIONS] [-w WARMUP] [-f FILTER] [-o OUTFILE] [-c BASELINE [-t PERCENT]] [-l]\n"
+           "  -n ITERATIONS  Timed iterations per case (default 100)\n"
+           "  -w WARMUP      Untimed iterations per case (default 3)\n"
+           "  -f FILTER      Only run cases whose name contains FILTER\n"
+           "  -o OUTFILE     Write JSON report to OUTFILE (default stdout)\n"
+           "  -c BASELINE    Compare medians against previous JSON report BASELINE\n"
+           "  -t PERCENT     Regression threshold for -c (default 10)\n"
+           "  -l             List cases and exit\n"
+           "Exit status 1 on error, 2 if any median regressed more than threshold\n");
+}
+
+int main(int argc, char **argv) {
+    int iterations = 100, warmup = 3;
+    const char *filter = NULL, *outfile = NULL, *baseline_file = NULL;
+    double threshold = 10.0;
+    char *baseline = NULL;
+    FILE *fp = stdout;
+    unsigned char *data;
+    int data_size = 0;
+    int i, opt, regressions = 0;
+    const int cases_size = (int) (sizeof(cases) / sizeof(cases[0]));
+
+    while ((opt = getopt(argc, argv, "c:f:hln:o:t:w:")) != -1) {
+        switch (opt) {
+            case 'c':
+                baseline_file = optarg;
+                break;
+            case 'f':
+                filter = optarg;
+                break;
+            case 'l':
+                for (i = 0; i < cases_size; i++) {
+                    printf("%s\n", cases[i].name);
+                }
+                return 0;
+                break;
+            case 'n':
+                iterations = atoi(optarg);
+                if (iterations < 1) {
+                    fprintf(stderr, "Invalid iterations \"%s\"\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'o':
+                outfile = optarg;
+                break;
+            case 't':
+                threshold = atof(optarg);
+                break;
+            case 'w':
+                warmup = atoi(optarg);
+                if (warmup < 0) {
+                    fprintf(stderr, "Invalid warmup \"%s\"\n", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                usage();
+                return opt == 'h' ? 0 : 1;
+                break;
+        }
+    }
+
+    if (baseline_file && !(baseline = bench_read_file(baseline_file))) {
+        fprintf(stderr, "Could not read baseline \"%s\"\n", baseline_file);
+        return 1;
+    }
+    for (i = 0; i < cases_size; i++) {
+        const int size = cases[i].gen == BENCH_LITERAL ? (int) strlen(cases[i].data) : cases[i].length;
+        if (size > data_size) {
+            data_size = size;
+        }
+    }
+    if (!(data = (unsigned char *) malloc(data_size))) {
+        fprintf(stderr, "Insufficient memory\n");
+        free(baseline);
+        return 1;
+    }
+    if (outfile && !(fp = fopen(outfile, "w"))) {
+        fprintf(stderr, "Could not open output file \"%s\"\n", outfile);
+        free(data);
+        free(baseline);
+        return 1;
+    }
+
+    fprintf(fp, "{\n  \"zint_version\": %d,\n  \"iterations\": %d,\n  \"units\": \"us\",\n"
+            "  \"allocs_counted\": %s,\n  \"cases\": [\n", ZBarcode_Version(), iterations,
+#ifdef BENCH_ALLOC_COUNT
+            "true"
+#else
+            "false"
+#endif
+            );
+
+    for (i = 0; i < cases_size; i++) {
+        const struct bench_case *bc = &cases[i];
+        struct bench_result results[BENCH_PHASES];
+        char errtxt[128];
+        int length, rows = 0, width = 0, j, p;
+
+        if (filter && !strstr(bc->name, filter)) {
+            continue;
+        }
+        length = bench_data(bc, data);
+        if (bench_run(bc, data, length, iterations, warmup, results, &rows, &width, errtxt)) {
+            fprintf(stderr, "%s: %s\n", bc->name, errtxt);
+            if (fp != stdout) {
+                fclose(fp);
+            }
+            free(data);
+            free(baseline);
+            return 1;
+        }
+        /* Whether last case to be run */
+        for (j = i + 1; j < cases_size && filter && !strstr(cases[j].name, filter); j++);
+        bench_print_case(fp, bc, length, rows, width, results, j == cases_size);
+
+        if (baseline) {
+            for (p = 0; p < BENCH_PHASES; p++) {
+                double p50;
+                if (bench_baseline_p50(baseline, bc->name, phase_names[p], &p50) && p50 > 0.0) {
+                    const double change = (results[p].p50 - p50) * 100.0 / p50;
+                    const int regressed = change > threshold;
+                    fprintf(stderr, "%-24s %-6s %10.2f -> %10.2f us %+7.1f%%%s\n", bc->name, phase_names[p], p50,
+                            results[p].p50, change, regressed ? "  REGRESSION" : "");
+                    regressions += regressed;
+                }
+            }
+        }
+    }
+
+    fprintf(fp, "  ]\n}\n");
+
+    if (fp != stdout) {
+        fclose(fp);
+    }
+    free(data);
+    free(baseline);
+
+    if (regressions) {
+        fprintf(stderr, "%d regression%s above %g%%\n", regressions, regressions == 1 ? "" : "s", threshold);
+        return 2;
+    }
+    return 0;
+}
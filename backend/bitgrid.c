@@ -0,0 +1,184 @@
+/*  bitgrid.c - bit-packed module lines for mask penalty evaluation
+
+    libzint - the open source barcode library
+    Copyright (C) 2021 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+/* vim: set ts=4 sw=4 et : */
+
+/* Matrix symbologies evaluate each of their data masks by scanning every row and column of the masked symbol for
+ * runs, blocks and finder-like patterns. Doing this a module (byte) at a time is the main cost of encoding large
+ * symbols, so here the lines are packed 64 modules to a word and each test is done with shifts and masks on whole
+ * words, the results being tallied by population count. */
+
+#include <string.h>
+#include "common.h"
+#include "bitgrid.h"
+
+/* Modules `k` (1 to 63) ahead of/behind each module of word `w` of `line` */
+#define BG_AHEAD(line, w, k) (((line)[w] >> (k)) | ((line)[(w) + 1] << (64 - (k))))
+#define BG_BEHIND(line, w, k) (((line)[w] << (k)) | ((line)[(w) - 1] >> (64 - (k))))
+
+/* Population count (Hacker's Delight 5-2) */
+static int bg_popcount(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555);
+    x = (x & 0x3333333333333333) + ((x >> 2) & 0x3333333333333333);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0F;
+    return (int) ((x * 0x0101010101010101) >> 56);
+}
+
+/* Mask of the module positions of word `w` that are less than `limit` */
+static uint64_t bg_limit_mask(const int w, const int limit) {
+    const int start = (w - 1) << 6;
+
+    if (limit >= start + 64) {
+        return ~((uint64_t) 0);
+    }
+    if (limit <= start) {
+        return 0;
+    }
+    return (((uint64_t) 1) << (limit - start)) - 1;
+}
+
+/* Pack bit `lane` of each byte of `rows` x `cols` `grid` into row lines (`rows` * BITGRID_LINE_WORDS(cols)
+   words) and column lines (`cols` * BITGRID_LINE_WORDS(rows) words) */
+INTERNAL void bitgrid_pack(const unsigned char grid[], const int rows, const int cols, const int lane,
+                uint64_t row_lines[], uint64_t col_lines[]) {
+    const int row_words = BITGRID_LINE_WORDS(cols);
+    const int col_words = BITGRID_LINE_WORDS(rows);
+    int x, y;
+
+    memset(row_lines, 0, sizeof(uint64_t) * row_words * rows);
+    memset(col_lines, 0, sizeof(uint64_t) * col_words * cols);
+
+    for (y = 0; y < rows; y++) {
+        const unsigned char *row = grid + y * cols;
+        uint64_t *row_line = row_lines + y * row_words + 1;
+        uint64_t *col_line = col_lines + (y >> 6) + 1;
+        const int col_shift = y & 63;
+        uint64_t word = 0;
+
+        for (x = 0; x < cols; x++) {
+            const uint64_t bit = (row[x] >> lane) & 1;
+            word |= bit << (x & 63);
+            col_line[x * col_words] |= bit << col_shift;
+            if ((x & 63) == 63) {
+                row_line[x >> 6] = word;
+                word = 0;
+            }
+        }
+        if (cols & 63) {
+            row_line[cols >> 6] = word;
+        }
+    }
+}
+
+/* Number of dark modules in line */
+INTERNAL int bitgrid_count(const uint64_t line[], const int length) {
+    const int words = BITGRID_LINE_WORDS(length) - 1;
+    int w;
+    int count = 0;
+
+    for (w = 1; w < words; w++) {
+        count += bg_popcount(line[w]);
+    }
+
+    return count;
+}
+
+/* For runs of `min_run` or more modules of the same colour, return the sum of their lengths less
+   `min_run - 1`, and place the number of such runs in `p_runs` */
+INTERNAL int bitgrid_runs(const uint64_t line[], const int length, const int min_run, int *p_runs) {
+    const int words = BITGRID_LINE_WORDS(length) - 1;
+    const int limit = length - min_run + 1; /* Positions at which a run of `min_run` can start */
+    int w, k;
+    int sum = 0, runs = 0;
+    uint64_t prev = 0;
+
+    for (w = 1; w < words; w++) {
+        /* Bit set if module and the next `min_run - 1` modules all the same colour */
+        uint64_t same = ~(line[w] ^ BG_AHEAD(line, w, 1));
+        for (k = 1; k < min_run - 1; k++) {
+            same &= ~(BG_AHEAD(line, w, k) ^ BG_AHEAD(line, w, k + 1));
+        }
+        same &= bg_limit_mask(w, limit);
+
+        sum += bg_popcount(same);
+        runs += bg_popcount(same & ~((same << 1) | (prev >> 63))); /* Starts of runs */
+        prev = same;
+    }
+
+    *p_runs = runs;
+    return sum;
+}
+
+/* Number of 2x2 blocks of the same colour spanning adjacent lines `line_a` and `line_b` */
+INTERNAL int bitgrid_blocks(const uint64_t line_a[], const uint64_t line_b[], const int length) {
+    const int words = BITGRID_LINE_WORDS(length) - 1;
+    int w;
+    int count = 0;
+
+    for (w = 1; w < words; w++) {
+        const uint64_t a1 = BG_AHEAD(line_a, w, 1);
+        const uint64_t b1 = BG_AHEAD(line_b, w, 1);
+        const uint64_t same = ~(line_a[w] ^ line_b[w]) & ~(line_a[w] ^ a1) & ~(line_b[w] ^ b1);
+
+        count += bg_popcount(same & bg_limit_mask(w, length - 1));
+    }
+
+    return count;
+}
+
+/* Number of occurrences of `pattern` (`pattern_len` modules, first module most significant bit, 1 dark) that
+   are preceded or followed by `light` light modules (the edges of the line counting as light) */
+INTERNAL int bitgrid_patterns(const uint64_t line[], const int length, const unsigned int pattern,
+                const int pattern_len, const int light) {
+    const int words = BITGRID_LINE_WORDS(length) - 1;
+    int w, k;
+    int count = 0;
+
+    for (w = 1; w < words; w++) {
+        uint64_t match = (pattern >> (pattern_len - 1)) & 1 ? line[w] : ~line[w];
+        uint64_t before = 0, after = 0;
+
+        for (k = 1; k < pattern_len && match; k++) {
+            const uint64_t ahead = BG_AHEAD(line, w, k);
+            match &= (pattern >> (pattern_len - 1 - k)) & 1 ? ahead : ~ahead;
+        }
+        match &= bg_limit_mask(w, length - pattern_len + 1);
+        if (!match) {
+            continue;
+        }
+        for (k = 1; k <= light; k++) {
+            before |= BG_BEHIND(line, w, k);
+            after |= BG_AHEAD(line, w, pattern_len + k - 1);
+        }
+        count += bg_popcount(match & (~before | ~after));
+    }
+
+    return count;
+}
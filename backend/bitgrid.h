@@ -0,0 +1,74 @@
+/*  bitgrid.h - bit-packed module lines for mask penalty evaluation
+
+    libzint - the open source barcode library
+    Copyright (C) 2021 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+/* vim: set ts=4 sw=4 et : */
+#ifndef __BITGRID_H
+#define __BITGRID_H
+
+#ifndef _MSC_VER
+#include <stdint.h>
+#else
+#include "ms_stdint.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* A line (row or column) of `length` modules is stored LSB first in 64-bit words, module `i` at bit `i & 63` of
+   word `(i >> 6) + 1`, with a leading and trailing zero word so that look-behinds/aheads of up to 64 modules
+   need no bounds checks (modules outside the line read as light) */
+#define BITGRID_LINE_WORDS(length) ((((length) + 63) >> 6) + 2)
+
+/* Pack bit `lane` of each byte of `rows` x `cols` `grid` into row lines (`rows` * BITGRID_LINE_WORDS(cols)
+   words) and column lines (`cols` * BITGRID_LINE_WORDS(rows) words) */
+INTERNAL void bitgrid_pack(const unsigned char grid[], const int rows, const int cols, const int lane,
+                uint64_t row_lines[], uint64_t col_lines[]);
+
+/* Number of dark modules in line */
+INTERNAL int bitgrid_count(const uint64_t line[], const int length);
+
+/* For runs of `min_run` or more modules of the same colour, return the sum of their lengths less
+   `min_run - 1`, and place the number of such runs in `p_runs` */
+INTERNAL int bitgrid_runs(const uint64_t line[], const int length, const int min_run, int *p_runs);
+
+/* Number of 2x2 blocks of the same colour spanning adjacent lines `line_a` and `line_b` */
+INTERNAL int bitgrid_blocks(const uint64_t line_a[], const uint64_t line_b[], const int length);
+
+/* Number of occurrences of `pattern` (`pattern_len` modules, first module most significant bit, 1 dark) that
+   are preceded or followed by `light` light modules (the edges of the line counting as light) */
+INTERNAL int bitgrid_patterns(const uint64_t line[], const int length, const unsigned int pattern,
+                const int pattern_len, const int light);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __BITGRID_H */
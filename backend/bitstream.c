@@ -0,0 +1,106 @@
+/*  bitstream.c - 64-bit word-backed bitstream writer/reader
+
+    libzint - the open source barcode library
+    Copyright (C) 2021 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+/* vim: set ts=4 sw=4 et : */
+
+/* Encoders build their data bitstreams field by field before splitting them into codewords. Packing the stream 64
+ * bits to a word (rather than a '0'/'1' character per bit) cuts its size eightfold and lets each field be written
+ * or read whole with shifts and masks on at most 2 words. */
+
+#include <stdio.h>
+#include "common.h"
+#include "bitstream.h"
+
+/* Mask of the `n` (0 to 64) least significant bits */
+#define BITS_MASK(n) ((n) >= 64 ? ~((uint64_t) 0) : (((uint64_t) 1) << (n)) - 1)
+
+/* Append the `length` (0 to 32) least significant bits of `arg` MSB first to `bits` at bit position `bit_posn`,
+   returning the new bit position. Existing bits at the position are overwritten, other bits preserved */
+INTERNAL int bits_append_posn(const unsigned int arg, const int length, uint64_t bits[], const int bit_posn) {
+    uint64_t *const word = bits + (bit_posn >> 6);
+    const int shift = 64 - (bit_posn & 63) - length; /* Negative if straddling into next word */
+    const uint64_t val = (uint64_t) arg & BITS_MASK(length);
+
+    if (length == 0) {
+        return bit_posn;
+    }
+    if (shift >= 0) {
+        word[0] = (word[0] & ~(BITS_MASK(length) << shift)) | (val << shift);
+    } else {
+        word[0] = (word[0] & ~BITS_MASK(length + shift)) | (val >> -shift);
+        word[1] = (word[1] & BITS_MASK(64 + shift)) | (val << (64 + shift));
+    }
+    return bit_posn + length;
+}
+
+/* Return the `length` (0 to 32) bits of `bits` starting at bit position `bit_posn` */
+INTERNAL unsigned int bits_peek(const uint64_t bits[], const int bit_posn, const int length) {
+    const uint64_t *const word = bits + (bit_posn >> 6);
+    const int shift = 64 - (bit_posn & 63) - length;
+
+    if (length == 0) {
+        return 0;
+    }
+    if (shift >= 0) {
+        return (unsigned int) ((word[0] >> shift) & BITS_MASK(length));
+    }
+    return (unsigned int) (((word[0] << -shift) | (word[1] >> (64 + shift))) & BITS_MASK(length));
+}
+
+/* Append `length` (any number of) bits all 0 or all 1 (`value`) to `bits` at bit position `bit_posn`, returning
+   the new bit position */
+INTERNAL int bits_pad_posn(const int value, const int length, uint64_t bits[], const int bit_posn) {
+    int posn = bit_posn;
+    int remaining = length;
+
+    while (remaining > 0) {
+        const int used = posn & 63;
+        const int chunk = remaining < 64 - used ? remaining : 64 - used;
+        const uint64_t mask = BITS_MASK(chunk) << (64 - used - chunk);
+
+        if (value) {
+            bits[posn >> 6] |= mask;
+        } else {
+            bits[posn >> 6] &= ~mask;
+        }
+        posn += chunk;
+        remaining -= chunk;
+    }
+    return posn;
+}
+
+/* Print `length` bits of `bits` starting at bit position `bit_posn` as '0's and '1's (for debugging) */
+INTERNAL void bits_print(const uint64_t bits[], const int bit_posn, const int length) {
+    int i;
+
+    for (i = bit_posn; i < bit_posn + length; i++) {
+        putchar('0' + bits_is_set(bits, i));
+    }
+}
@@ -0,0 +1,70 @@
+/*  bitstream.h - 64-bit word-backed bitstream writer/reader
+
+    libzint - the open source barcode library
+    Copyright (C) 2021 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+/* vim: set ts=4 sw=4 et : */
+#ifndef __BITSTREAM_H
+#define __BITSTREAM_H
+
+#ifndef _MSC_VER
+#include <stdint.h>
+#else
+#include "ms_stdint.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* A bitstream is stored MSB first in 64-bit words, bit `i` at bit `63 - (i & 63)` of word `i >> 6`, so that a
+   field of up to 32 bits spans at most 2 words and can be written or read with a couple of shifts and masks */
+#define BITS_WORDS(length) (((length) + 63) >> 6)
+
+/* Whether bit `bit_posn` of bitstream `bits` is set */
+#define bits_is_set(bits, bit_posn) ((int) (((bits)[(bit_posn) >> 6] >> (63 - ((bit_posn) & 63))) & 1))
+
+/* Append the `length` (0 to 32) least significant bits of `arg` MSB first to `bits` at bit position `bit_posn`,
+   returning the new bit position. Existing bits at the position are overwritten, other bits preserved */
+INTERNAL int bits_append_posn(const unsigned int arg, const int length, uint64_t bits[], const int bit_posn);
+
+/* Return the `length` (0 to 32) bits of `bits` starting at bit position `bit_posn` */
+INTERNAL unsigned int bits_peek(const uint64_t bits[], const int bit_posn, const int length);
+
+/* Append `length` (any number of) bits all 0 or all 1 (`value`) to `bits` at bit position `bit_posn`, returning
+   the new bit position */
+INTERNAL int bits_pad_posn(const int value, const int length, uint64_t bits[], const int bit_posn);
+
+/* Print `length` bits of `bits` starting at bit position `bit_posn` as '0's and '1's (for debugging) */
+INTERNAL void bits_print(const uint64_t bits[], const int bit_posn, const int length);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __BITSTREAM_H */
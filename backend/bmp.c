@@ -34,6 +34,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include "common.h"
+#include "filemem.h"
 #include "bmp.h"        /* Bitmap header structure */
 #ifdef _MSC_VER
 #include <io.h>
@@ -48,7 +49,8 @@ INTERNAL int bmp_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     unsigned int data_offset, data_size, file_size;
     unsigned char *bitmap_file_start, *bmp_posn;
     unsigned char *bitmap;
-    FILE *bmp_file;
+    struct filemem fm;
+    struct filemem *const fmp = &fm;
     bitmap_file_header_t file_header;
     bitmap_info_header_t info_header;
     color_ref_t bg_color_ref;
@@ -88,7 +90,7 @@ INTERNAL int bmp_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     data_offset += colour_count * sizeof(color_ref_t);
     file_size = data_offset + data_size;
 
-    bitmap_file_start = (unsigned char *) malloc(file_size);
+    bitmap_file_start = (unsigned char *) z_malloc(file_size);
     if (bitmap_file_start == NULL) {
         strcpy(symbol->errtxt, "602: Insufficient memory for BMP file buffer");
         return ZINT_ERROR_MEMORY;
@@ -189,27 +191,24 @@ INTERNAL int bmp_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
 #ifdef _MSC_VER
         if (-1 == _setmode(_fileno(stdout), _O_BINARY)) {
             sprintf(symbol->errtxt, "600: Could not set stdout to binary (%d: %.30s)", errno, strerror(errno));
-            free(bitmap_file_start);
+            z_free(bitmap_file_start);
             return ZINT_ERROR_FILE_ACCESS;
         }
 #endif
-        bmp_file = stdout;
-    } else {
-        if (!(bmp_file = fopen(symbol->outfile, "wb"))) {
-            free(bitmap_file_start);
-            sprintf(symbol->errtxt, "601: Could not open output file (%d: %.30s)", errno, strerror(errno));
-            return ZINT_ERROR_FILE_ACCESS;
-        }
+    }
+    if (!fm_open(fmp, symbol, "wb")) {
+        z_free(bitmap_file_start);
+        sprintf(symbol->errtxt, "601: Could not open output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_ACCESS;
     }
 
-    fwrite(bitmap_file_start, file_header.file_size, 1, bmp_file);
+    fm_write(bitmap_file_start, file_header.file_size, 1, fmp);
+    z_free(bitmap_file_start);
 
-    if (output_to_stdout) {
-        fflush(bmp_file);
-    } else {
-        fclose(bmp_file);
+    if (!fm_close(fmp, symbol)) {
+        sprintf(symbol->errtxt, "603: Failure on closing output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_WRITE;
     }
 
-    free(bitmap_file_start);
     return 0;
 }
@@ -37,6 +37,13 @@
 #ifdef _MSC_VER
 #include <malloc.h>
 #endif
+#ifndef ZINT_NO_THREADS
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#endif
 #include "common.h"
 
 /* Converts a character 0-9, A-F to its equivalent integer value */
@@ -189,31 +196,88 @@ INTERNAL int bin_append_posn(const int arg, const int length, char *binary, cons
     return bin_posn + length;
 }
 
+/* Return row `y_coord` of the caller-owned `matrix` if byte `byte` of it is in bounds, otherwise NULL */
+INTERNAL unsigned char *matrix_row(const struct zint_symbol *symbol, const int y_coord, const int byte) {
+    if (y_coord < 0 || y_coord >= 200 || byte < 0 || byte >= symbol->matrix_stride
+            || (y_coord + 1) * symbol->matrix_stride > symbol->matrix_size) {
+        return NULL;
+    }
+    return symbol->matrix + y_coord * symbol->matrix_stride;
+}
+
+/* Versions of the module accessors for a caller-owned `matrix`, where modules out of bounds are ignored (and read as
+   unset), leaving `ZBarcode_Encode()` to report the symbol as too big once its size is known */
+INTERNAL int matrix_module_is_set(const struct zint_symbol *symbol, const int y_coord, const int x_coord) {
+    const unsigned char *const row = matrix_row(symbol, y_coord, x_coord >> 3);
+    return row ? (row[x_coord >> 3] >> (x_coord & 0x07)) & 1 : 0;
+}
+
+INTERNAL void matrix_set_module(struct zint_symbol *symbol, const int y_coord, const int x_coord) {
+    unsigned char *const row = matrix_row(symbol, y_coord, x_coord >> 3);
+    if (row) {
+        row[x_coord >> 3] |= 1 << (x_coord & 0x07);
+    }
+}
+
+INTERNAL int matrix_module_colour_is_set(const struct zint_symbol *symbol, const int y_coord, const int x_coord) {
+    const unsigned char *const row = matrix_row(symbol, y_coord, x_coord);
+    return row ? row[x_coord] : 0;
+}
+
+INTERNAL void matrix_set_module_colour(struct zint_symbol *symbol, const int y_coord, const int x_coord,
+            const int colour) {
+    unsigned char *const row = matrix_row(symbol, y_coord, x_coord);
+    if (row) {
+        row[x_coord] = colour;
+    }
+}
+
 #ifndef COMMON_INLINE
 /* Return true (1) if a module is dark/black, otherwise false (0) */
 INTERNAL int module_is_set(const struct zint_symbol *symbol, const int y_coord, const int x_coord) {
+    if (symbol->matrix) {
+        return matrix_module_is_set(symbol, y_coord, x_coord);
+    }
     return (symbol->encoded_data[y_coord][x_coord >> 3] >> (x_coord & 0x07)) & 1;
 }
 
 /* Set a module to dark/black */
 INTERNAL void set_module(struct zint_symbol *symbol, const int y_coord, const int x_coord) {
-    symbol->encoded_data[y_coord][x_coord >> 3] |= 1 << (x_coord & 0x07);
+    if (symbol->matrix) {
+        matrix_set_module(symbol, y_coord, x_coord);
+    } else {
+        symbol->encoded_data[y_coord][x_coord >> 3] |= 1 << (x_coord & 0x07);
+    }
 }
 
 /* Return true (1-8) if a module is colour, otherwise false (0) */
 INTERNAL int module_colour_is_set(const struct zint_symbol *symbol, const int y_coord, const int x_coord) {
+    if (symbol->matrix) {
+        return matrix_module_colour_is_set(symbol, y_coord, x_coord);
+    }
     return symbol->encoded_data[y_coord][x_coord];
 }
 
 /* Set a module to a colour */
 INTERNAL void set_module_colour(struct zint_symbol *symbol, const int y_coord, const int x_coord, const int colour) {
-    symbol->encoded_data[y_coord][x_coord] = colour;
+    if (symbol->matrix) {
+        matrix_set_module_colour(symbol, y_coord, x_coord, colour);
+    } else {
+        symbol->encoded_data[y_coord][x_coord] = colour;
+    }
 }
 #endif
 
 /* Set a dark/black module to white (i.e. unset) */
 INTERNAL void unset_module(struct zint_symbol *symbol, const int y_coord, const int x_coord) {
-    symbol->encoded_data[y_coord][x_coord >> 3] &= ~(1 << (x_coord & 0x07));
+    if (symbol->matrix) {
+        unsigned char *const row = matrix_row(symbol, y_coord, x_coord >> 3);
+        if (row) {
+            row[x_coord >> 3] &= ~(1 << (x_coord & 0x07));
+        }
+    } else {
+        symbol->encoded_data[y_coord][x_coord >> 3] &= ~(1 << (x_coord & 0x07));
+    }
 }
 
 /* Expands from a width pattern to a bit pattern */
@@ -351,6 +415,146 @@ INTERNAL int is_twodigits(const unsigned char source[], const int length, const
     return 0;
 }
 
+/* Returns the length of the run of positions from `posn` that mode `m` can encode, caching the run's end in `ends`
+   (by parity for modes taking 2 positions at a time) so that each run is only scanned once */
+static int fast_run(const unsigned char classes[], const int length, const struct fast_modes *modes, const int posn,
+            const int m, int ends[]) {
+    const int unit = modes->units ? modes->units[m] : 1;
+    int *p_end = ends + m * 2 + (unit == 2 ? (posn & 1) : 0);
+
+    if (*p_end <= posn) {
+        int i = posn;
+        while (i + unit <= length && modes->char_costs[classes[i] * modes->num_modes + m]) {
+            i += unit;
+        }
+        *p_end = i;
+    }
+
+    return *p_end - posn;
+}
+
+/* Returns the length of the run of positions from `posn` that both modes `cur` and `m` can encode, `m` at no more
+   cost than `cur`, caching the run's end in `pair_ends` as for `fast_run()` */
+static int fast_cheaper_run(const unsigned char classes[], const int length, const struct fast_modes *modes,
+            const int posn, const int cur, const int m, int pair_ends[]) {
+    const int num_modes = modes->num_modes;
+    const int unit = modes->units ? modes->units[m] : 1;
+    int *p_end = pair_ends + (cur * FAST_MODES_MAX + m) * 2 + (unit == 2 ? (posn & 1) : 0);
+
+    if (*p_end <= posn) {
+        int i = posn;
+        while (i + unit <= length) {
+            const unsigned int *costs = modes->char_costs + classes[i] * num_modes;
+            if (!costs[m] || costs[m] > costs[cur]) {
+                break;
+            }
+            i += unit;
+        }
+        *p_end = i;
+    }
+
+    return *p_end - posn;
+}
+
+/* Calculate encoding modes in a single greedy pass, a FAST_MODE alternative to the Project Nayuki-style dynamic
+ * programming `define_mode()`s. At each position the current mode is kept unless the run of characters a cheaper mode
+ * can encode at no more cost saves more than switching to it (and back, if the current mode outlasts it) costs. When
+ * the current mode can't continue the cheapest mode is chosen, unless its run is too short to pay for itself compared
+ * to the cheapest mode that also covers the character following the run. Each run of characters of the same class is
+ * decided on its own, so it can cost at most switching to a mode and back more than the optimal encodation (given the
+ * costs passed in) */
+INTERNAL void fast_define_mode(char mode[], const unsigned char classes[], const int length,
+            const struct fast_modes *modes) {
+    const int num_modes = modes->num_modes;
+    int ends[FAST_MODES_MAX * 2] = {0};
+    int pair_ends[FAST_MODES_MAX * FAST_MODES_MAX * 2] = {0};
+    int runs[FAST_MODES_MAX];
+    unsigned int *const sums = modes->sums;
+    int i, j, m, cur = -1;
+
+    assert(num_modes <= FAST_MODES_MAX);
+
+    /* sums[i * num_modes + m] is the cost of encoding in mode m from position i to the end of its run (or beyond), so
+       the cost of a run of length `run` is sums[i * num_modes + m] - sums[(i + run) * num_modes + m] */
+    memset(sums + length * num_modes, 0, 2 * num_modes * sizeof(unsigned int));
+    for (i = length - 1; i >= 0; i--) {
+        const unsigned int *costs = modes->char_costs + classes[i] * num_modes;
+        for (m = 0; m < num_modes; m++) {
+            const int unit = modes->units ? modes->units[m] : 1;
+            sums[i * num_modes + m] = costs[m] * unit + sums[(i + unit) * num_modes + m];
+        }
+    }
+
+    for (i = 0; i < length; i += j) {
+        const unsigned int *costs = modes->char_costs + classes[i] * num_modes;
+        const unsigned int *run_sums = sums + i * num_modes;
+        /* Costs of switching from the current mode (or of starting) */
+        const unsigned int *from_costs = cur == -1 || !modes->switch_costs ? modes->head_costs
+                                            : modes->switch_costs + cur * num_modes;
+        int next;
+
+        for (m = 0; m < num_modes; m++) {
+            runs[m] = costs[m] ? fast_run(classes, length, modes, i, m, ends) : 0;
+        }
+
+        if (cur != -1 && runs[cur]) {
+            /* Switch to a cheaper mode only if it saves more than switching there and back costs */
+            long best_gain = 0;
+            next = cur;
+            for (m = 0; m < num_modes; m++) {
+                if (m != cur && runs[m] && costs[m] < costs[cur]) {
+                    const int run = fast_cheaper_run(classes, length, modes, i, cur, m, pair_ends);
+                    const unsigned int *end_sums = run_sums + run * num_modes;
+                    const unsigned int back_cost = run == runs[cur] || i + run >= length ? 0
+                                                    : modes->switch_costs ? modes->switch_costs[m * num_modes + cur]
+                                                    : modes->head_costs[cur];
+                    const long gain = (long) (run_sums[cur] - end_sums[cur]) - (long) (run_sums[m] - end_sums[m])
+                                        - from_costs[m] - back_cost;
+                    if (gain > best_gain) {
+                        best_gain = gain;
+                        next = m;
+                    }
+                }
+            }
+        } else {
+            /* Cheapest mode, unless its run doesn't pay for switching to it compared to the cheapest mode that also
+               covers the character following the run */
+            int run, wider = -1;
+            next = -1;
+            for (m = 0; m < num_modes; m++) {
+                if (runs[m] && (next == -1 || costs[m] < costs[next])) {
+                    next = m;
+                }
+            }
+            if (next == -1) { /* Can only happen if a mode taking 2 positions is given a single final position */
+                next = cur == -1 ? 0 : cur;
+                runs[next] = 1;
+            }
+            run = runs[next];
+            if (i + run < length) {
+                for (m = 0; m < num_modes; m++) {
+                    if (m != next && runs[m] > run && (wider == -1 || costs[m] < costs[wider])) {
+                        wider = m;
+                    }
+                }
+                if (wider != -1) {
+                    const unsigned int *end_sums = run_sums + run * num_modes;
+                    const unsigned int via_cost = modes->switch_costs ? modes->switch_costs[next * num_modes + wider]
+                                                    : modes->head_costs[wider];
+                    if ((long) (run_sums[wider] - end_sums[wider]) + from_costs[wider]
+                            <= (long) (run_sums[next] - end_sums[next]) + from_costs[next] + via_cost) {
+                        next = wider;
+                    }
+                }
+            }
+        }
+
+        cur = next;
+        j = modes->units && modes->units[cur] == 2 && i + 1 < length ? 2 : 1;
+        memset(mode + i, modes->mode_types[cur], j);
+    }
+}
+
 /* State machine to decode UTF-8 to Unicode codepoints (state 0 means done, state 12 means error) */
 INTERNAL unsigned int decode_utf8(unsigned int *state, unsigned int *codep, const unsigned char byte) {
     /*
@@ -553,6 +757,253 @@ INTERNAL int colour_to_blue(const int colour) {
     return return_val;
 }
 
+/* Allocator hooks, set by `ZBarcode_SetAllocator()` */
+static void *(*z_malloc_func)(size_t size) = malloc;
+static void *(*z_realloc_func)(void *ptr, size_t size) = realloc;
+static void (*z_free_func)(void *ptr) = free;
+static int z_allocated = 0; /* Set on first allocation, after which the hooks are fixed */
+
+/* Set allocator hooks (all non-NULL), or the defaults (all NULL). Returns 0 on success, or 1 if memory has already
+   been allocated through different hooks (which could then be freed by a function other than the one that allocated
+   it) */
+INTERNAL int z_set_allocator(void *(*malloc_func)(size_t size), void *(*realloc_func)(void *ptr, size_t size),
+            void (*free_func)(void *ptr)) {
+    int ret = 0;
+
+    if (!malloc_func) {
+        malloc_func = malloc;
+        realloc_func = realloc;
+        free_func = free;
+    }
+    cache_lock();
+    if (malloc_func != z_malloc_func || realloc_func != z_realloc_func || free_func != z_free_func) {
+        if (cache_load_int(&z_allocated)) {
+            ret = 1;
+        } else {
+            z_malloc_func = malloc_func;
+            z_realloc_func = realloc_func;
+            z_free_func = free_func;
+        }
+    }
+    cache_unlock();
+
+    return ret;
+}
+
+/* Note that an allocation is being made, fixing the allocator hooks */
+static void z_set_allocated(void) {
+    if (!cache_load_int(&z_allocated)) {
+        cache_store_int(&z_allocated, 1);
+    }
+}
+
+/* `malloc()` via allocator hooks */
+INTERNAL void *z_malloc(const size_t size) {
+    z_set_allocated();
+    return (*z_malloc_func)(size ? size : 1);
+}
+
+/* `calloc()` via allocator hooks */
+INTERNAL void *z_calloc(const size_t nmemb, const size_t size) {
+    void *ptr;
+
+    if (size && nmemb > (size_t) -1 / size) {
+        return NULL;
+    }
+    if ((ptr = z_malloc(nmemb * size))) {
+        memset(ptr, 0, nmemb * size);
+    }
+    return ptr;
+}
+
+/* `realloc()` via allocator hooks */
+INTERNAL void *z_realloc(void *ptr, const size_t size) {
+    z_set_allocated();
+    return (*z_realloc_func)(ptr, size ? size : 1);
+}
+
+/* `free()` via allocator hooks */
+INTERNAL void z_free(void *ptr) {
+    if (ptr) {
+        (*z_free_func)(ptr);
+    }
+}
+
+/* Scratch arena block, allocated with data following the (aligned) header */
+struct scratch_block {
+    struct scratch_block *next;
+    size_t size;
+    size_t used;
+};
+
+#define SCRATCH_ALIGN       16
+#define SCRATCH_HDR         ((sizeof(struct scratch_block) + SCRATCH_ALIGN - 1) & ~(size_t) (SCRATCH_ALIGN - 1))
+#define SCRATCH_MIN_BLOCK   4096
+
+/* Allocate `size` bytes (aligned to 16) of uninitialized memory from the symbol's scratch arena, valid until the
+   next `scratch_reset()` (i.e. for the duration of the current encode). Returns NULL on failure, setting
+   `symbol->errtxt` */
+INTERNAL void *scratch_alloc(struct zint_symbol *symbol, const size_t size) {
+    struct scratch_block *block = (struct scratch_block *) symbol->scratch;
+    const size_t aligned = (size + SCRATCH_ALIGN - 1) & ~(size_t) (SCRATCH_ALIGN - 1);
+    void *ptr;
+
+    if (aligned < size) { /* Overflow */
+        strcpy(symbol->errtxt, "249: Insufficient memory for scratch buffer");
+        return NULL;
+    }
+    if (!block || block->size - block->used < aligned) {
+        size_t block_size = block ? block->size * 2 : SCRATCH_MIN_BLOCK;
+        if (block_size < aligned) {
+            block_size = aligned;
+        }
+        if (block_size > (size_t) -1 - SCRATCH_HDR
+                || !(block = (struct scratch_block *) z_malloc(SCRATCH_HDR + block_size))) {
+            strcpy(symbol->errtxt, "249: Insufficient memory for scratch buffer");
+            return NULL;
+        }
+        block->next = (struct scratch_block *) symbol->scratch;
+        block->size = block_size;
+        block->used = 0;
+        symbol->scratch = block;
+    }
+    ptr = (unsigned char *) block + SCRATCH_HDR + block->used;
+    block->used += aligned;
+
+    return ptr;
+}
+
+/* Release all scratch allocations, keeping the memory for reuse. If the last encode needed more than one block,
+   they are coalesced into a single block of the combined size, so that in the steady state an encode makes no
+   heap calls for scratch */
+INTERNAL void scratch_reset(struct zint_symbol *symbol) {
+    struct scratch_block *block = (struct scratch_block *) symbol->scratch;
+
+    if (!block) {
+        return;
+    }
+    if (block->next) {
+        size_t total = 0;
+        struct scratch_block *next;
+        for (; block; block = next) {
+            next = block->next;
+            total += block->size;
+            z_free(block);
+        }
+        if ((block = (struct scratch_block *) z_malloc(SCRATCH_HDR + total))) {
+            block->next = NULL;
+            block->size = total;
+        }
+        symbol->scratch = block;
+    }
+    if (block) {
+        block->used = 0;
+    }
+}
+
+/* Free the scratch arena */
+INTERNAL void scratch_free(struct zint_symbol *symbol) {
+    struct scratch_block *block = (struct scratch_block *) symbol->scratch;
+    struct scratch_block *next;
+
+    for (; block; block = next) {
+        next = block->next;
+        z_free(block);
+    }
+    symbol->scratch = NULL;
+}
+
+#ifndef ZINT_NO_THREADS
+#ifdef _WIN32
+static SRWLOCK cache_srwlock = SRWLOCK_INIT;
+#else
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+#endif
+
+/* Take the process-wide lock protecting caches shared between threads (a no-op if ZINT_NO_THREADS). Only to be
+   held briefly, and not to be taken recursively */
+INTERNAL void cache_lock(void) {
+#ifndef ZINT_NO_THREADS
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&cache_srwlock);
+#else
+    pthread_mutex_lock(&cache_mutex);
+#endif
+#endif
+}
+
+/* Release the lock taken by `cache_lock()` */
+INTERNAL void cache_unlock(void) {
+#ifndef ZINT_NO_THREADS
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&cache_srwlock);
+#else
+    pthread_mutex_unlock(&cache_mutex);
+#endif
+#endif
+}
+
+/* Read a cache pointer published by `cache_store_ptr()` without taking the lock - whatever it points to is fully
+   visible to the caller (acquire semantics) */
+INTERNAL void *cache_load_ptr(void *const *p_ptr) {
+#if defined(ZINT_NO_THREADS)
+    return *p_ptr;
+#elif defined(_WIN32)
+    return InterlockedCompareExchangePointer((PVOID volatile *) p_ptr, NULL, NULL);
+#elif defined(__GNUC__)
+    return __atomic_load_n(p_ptr, __ATOMIC_ACQUIRE);
+#else
+    void *ptr;
+    cache_lock();
+    ptr = *p_ptr;
+    cache_unlock();
+    return ptr;
+#endif
+}
+
+/* Publish a cache pointer for `cache_load_ptr()` (release semantics). To be called with `cache_lock()` held */
+INTERNAL void cache_store_ptr(void **p_ptr, void *ptr) {
+#if defined(ZINT_NO_THREADS)
+    *p_ptr = ptr;
+#elif defined(_WIN32)
+    InterlockedExchangePointer((PVOID volatile *) p_ptr, ptr);
+#elif defined(__GNUC__)
+    __atomic_store_n(p_ptr, ptr, __ATOMIC_RELEASE);
+#else
+    *p_ptr = ptr;
+#endif
+}
+
+/* Read an int flag set by `cache_store_int()` without taking the lock (acquire semantics). Unlike
+   `cache_load_ptr()`, never takes the lock itself, so may be called with or without `cache_lock()` held (as by
+   `z_malloc()`) */
+INTERNAL int cache_load_int(const int *p_val) {
+#if defined(ZINT_NO_THREADS)
+    return *p_val;
+#elif defined(_WIN32)
+    return (int) InterlockedCompareExchange((LONG volatile *) p_val, 0, 0);
+#elif defined(__GNUC__)
+    return __atomic_load_n(p_val, __ATOMIC_ACQUIRE);
+#else
+    return *((volatile const int *) p_val); /* Assumes aligned int access is atomic */
+#endif
+}
+
+/* Set an int flag for `cache_load_int()` (release semantics). Never takes the lock itself, so may be called with
+   or without `cache_lock()` held */
+INTERNAL void cache_store_int(int *p_val, const int val) {
+#if defined(ZINT_NO_THREADS)
+    *p_val = val;
+#elif defined(_WIN32)
+    InterlockedExchange((LONG volatile *) p_val, (LONG) val);
+#elif defined(__GNUC__)
+    __atomic_store_n(p_val, val, __ATOMIC_RELEASE);
+#else
+    *((volatile int *) p_val) = val; /* Assumes aligned int access is atomic */
+#endif
+}
+
 #ifdef ZINT_TEST
 /* Dumps hex-formatted codewords in symbol->errtxt (for use in testing) */
 void debug_test_codeword_dump(struct zint_symbol *symbol, const unsigned char *codewords, const int length) {
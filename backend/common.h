@@ -123,20 +123,45 @@
 
 #define COMMON_INLINE   1
 
+/* The module accessors go to the caller-owned `matrix` if any, otherwise to `encoded_data` */
 #ifdef COMMON_INLINE
 /* Return true (1) if a module is dark/black, otherwise false (0) */
-#  define module_is_set(s, y, x) (((s)->encoded_data[(y)][(x) >> 3] >> ((x) & 0x07)) & 1)
+#  define module_is_set(s, y, x) ((s)->matrix ? matrix_module_is_set((s), (y), (x)) \
+                                    : ((s)->encoded_data[(y)][(x) >> 3] >> ((x) & 0x07)) & 1)
 
 /* Set a module to dark/black */
-#  define set_module(s, y, x) do { (s)->encoded_data[(y)][(x) >> 3] |= 1 << ((x) & 0x07); } while (0)
+#  define set_module(s, y, x) do { \
+        if ((s)->matrix) { matrix_set_module((s), (y), (x)); } \
+        else { (s)->encoded_data[(y)][(x) >> 3] |= 1 << ((x) & 0x07); } \
+    } while (0)
 
 /* Return true (1-8) if a module is colour, otherwise false (0) */
-#  define module_colour_is_set(s, y, x) ((s)->encoded_data[(y)][(x)])
+#  define module_colour_is_set(s, y, x) ((s)->matrix ? matrix_module_colour_is_set((s), (y), (x)) \
+                                            : (s)->encoded_data[(y)][(x)])
 
 /* Set a module to a colour */
-#  define set_module_colour(s, y, x, c) do { (s)->encoded_data[(y)][(x)] = (c); } while (0)
+#  define set_module_colour(s, y, x, c) do { \
+        if ((s)->matrix) { matrix_set_module_colour((s), (y), (x), (c)); } \
+        else { (s)->encoded_data[(y)][(x)] = (c); } \
+    } while (0)
 #endif
 
+/* Mode costs for `fast_define_mode()` (FAST_MODE), in the same units as the encoder's own `define_mode()` */
+#define FAST_MODES_MAX  8
+struct fast_modes {
+    int num_modes;
+    const char *mode_types;             /* Mode character for each mode */
+    const unsigned int *head_costs;     /* Cost of starting in each mode */
+    const unsigned int *switch_costs;   /* `num_modes` x `num_modes` costs of switching from mode k to mode j, or NULL
+                                           if same as `head_costs` */
+    const unsigned int *char_costs;     /* Cost of a character of each class in each mode (class x `num_modes`), zero
+                                           if the mode can't encode the class */
+    const char *units;                  /* Positions (1 or 2) each mode encodes at a time, NULL if all 1 */
+    unsigned int *sums;                 /* Work space of `FAST_SUMS_SIZE()` entries, from `scratch_alloc()` as can be
+                                           too big for the stack */
+};
+#define FAST_SUMS_SIZE(length, num_modes) (((length) + 2) * (num_modes))
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -154,6 +179,13 @@ extern "C" {
 
     INTERNAL int bin_append_posn(const int arg, const int length, char *binary, const int bin_posn);
 
+    INTERNAL unsigned char *matrix_row(const struct zint_symbol *symbol, const int y_coord, const int byte);
+    INTERNAL int matrix_module_is_set(const struct zint_symbol *symbol, const int y_coord, const int x_coord);
+    INTERNAL void matrix_set_module(struct zint_symbol *symbol, const int y_coord, const int x_coord);
+    INTERNAL int matrix_module_colour_is_set(const struct zint_symbol *symbol, const int y_coord, const int x_coord);
+    INTERNAL void matrix_set_module_colour(struct zint_symbol *symbol, const int y_coord, const int x_coord,
+                    const int colour);
+
     #ifndef COMMON_INLINE
     INTERNAL int module_is_set(const struct zint_symbol *symbol, const int y_coord, const int x_coord);
     INTERNAL void set_module(struct zint_symbol *symbol, const int y_coord, const int x_coord);
@@ -173,6 +205,9 @@ extern "C" {
 
     INTERNAL int is_twodigits(const unsigned char source[], const int length, const int position);
 
+    INTERNAL void fast_define_mode(char mode[], const unsigned char classes[], const int length,
+                    const struct fast_modes *modes);
+
     INTERNAL unsigned int decode_utf8(unsigned int *state, unsigned int *codep, const unsigned char byte);
     INTERNAL int is_valid_utf8(const unsigned char source[], const int length);
     INTERNAL int utf8_to_unicode(struct zint_symbol *symbol, const unsigned char source[], unsigned int vals[],
@@ -187,6 +222,24 @@ extern "C" {
     INTERNAL int colour_to_green(const int colour);
     INTERNAL int colour_to_blue(const int colour);
 
+    INTERNAL int z_set_allocator(void *(*malloc_func)(size_t size), void *(*realloc_func)(void *ptr, size_t size),
+                    void (*free_func)(void *ptr));
+    INTERNAL void *z_malloc(const size_t size);
+    INTERNAL void *z_calloc(const size_t nmemb, const size_t size);
+    INTERNAL void *z_realloc(void *ptr, const size_t size);
+    INTERNAL void z_free(void *ptr);
+
+    INTERNAL void *scratch_alloc(struct zint_symbol *symbol, const size_t size);
+    INTERNAL void scratch_reset(struct zint_symbol *symbol);
+    INTERNAL void scratch_free(struct zint_symbol *symbol);
+
+    INTERNAL void cache_lock(void);
+    INTERNAL void cache_unlock(void);
+    INTERNAL void *cache_load_ptr(void *const *p_ptr);
+    INTERNAL void cache_store_ptr(void **p_ptr, void *ptr);
+    INTERNAL int cache_load_int(const int *p_val);
+    INTERNAL void cache_store_int(int *p_val, const int val);
+
     #ifdef ZINT_TEST
     INTERNAL void debug_test_codeword_dump(struct zint_symbol *symbol, const unsigned char *codewords,
                     const int length);
@@ -56,6 +56,7 @@
 #include <malloc.h>
 #endif
 #include "common.h"
+#include "bitstream.h"
 #include "pdf417.h"
 #include "gs1.h"
 #include "general_field.h"
@@ -115,9 +116,9 @@ static int encode928(const UINT bitString[], UINT codeWords[], const int bitLng)
 }
 
 /* CC-A 2D component */
-static void cc_a(struct zint_symbol *symbol, const char source[], const int cc_width) {
-    int i, segment, bitlen, cwCnt, variant, rows;
-    int k, offset, j, total, rsCodeWords[8] = {0};
+static void cc_a(struct zint_symbol *symbol, const uint64_t source[], const int bitlen, const int cc_width) {
+    int i, segment, cwCnt, variant, rows;
+    int k, offset, dataCodeWords[28], rsCodeWords[8];
     int LeftRAPStart, RightRAPStart, CentreRAPStart, StartCluster;
     int LeftRAP, RightRAP, CentreRAP, Cluster;
     int loop;
@@ -129,18 +130,14 @@ static void cc_a(struct zint_symbol *symbol, const char source[], const int cc_w
 
     variant = 0;
 
-    bitlen = (int) strlen(source);
-
     for (segment = 0; segment < 13; segment++) {
         const int strpos = segment * 16;
+        int seglen;
         if (strpos >= bitlen) {
             break;
         }
-        for (i = 0; i < 16 && strpos + i < bitlen; i++) {
-            if (source[strpos + i] == '1') {
-                bitStr[segment] |= (0x8000 >> i);
-            }
-        }
+        seglen = bitlen - strpos < 16 ? bitlen - strpos : 16;
+        bitStr[segment] = bits_peek(source, strpos, seglen) << (16 - seglen);
     }
 
     /* encode codeWords from bitStr */
@@ -202,23 +199,11 @@ static void cc_a(struct zint_symbol *symbol, const char source[], const int cc_w
     /* Reed-Solomon error correction */
 
     for (i = 0; i < cwCnt; i++) {
-        total = (codeWords[i] + rsCodeWords[k - 1]) % 929;
-        for (j = k - 1; j >= 0; j--) {
-            if (j == 0) {
-                rsCodeWords[j] = (929 - (total * ccaCoeffs[offset + j]) % 929) % 929;
-            } else {
-                rsCodeWords[j] = (rsCodeWords[j - 1] + 929 - (total * ccaCoeffs[offset + j]) % 929) % 929;
-            }
-        }
-    }
-
-    for (j = 0; j < k; j++) {
-        if (rsCodeWords[j] != 0) {
-            rsCodeWords[j] = 929 - rsCodeWords[j];
-        }
+        dataCodeWords[i] = codeWords[i];
     }
+    pdf_rs_code(dataCodeWords, cwCnt, ccaCoeffs + offset, k, rsCodeWords);
 
-    for (i = k - 1; i >= 0; i--) {
+    for (i = 0; i < k; i++) {
         codeWords[cwCnt] = rsCodeWords[i];
         cwCnt++;
     }
@@ -301,8 +286,8 @@ static void cc_a(struct zint_symbol *symbol, const char source[], const int cc_w
 }
 
 /* CC-B 2D component */
-static void cc_b(struct zint_symbol *symbol, const char source[], const int cc_width) {
-    const int length = (int) strlen(source) / 8;
+static void cc_b(struct zint_symbol *symbol, const uint64_t source[], const int bitlen, const int cc_width) {
+    const int length = bitlen / 8;
     int i;
 #ifndef _MSC_VER
     unsigned char data_string[length + 3];
@@ -310,8 +295,7 @@ static void cc_b(struct zint_symbol *symbol, const char source[], const int cc_w
     unsigned char *data_string = (unsigned char *) _alloca(length + 3);
 #endif
     int chainemc[180], mclength;
-    int k, j, p, longueur, mccorrection[50] = {0}, offset;
-    int total;
+    int k, longueur, offset;
     char pattern[580];
     int variant, LeftRAPStart, CentreRAPStart, RightRAPStart, StartCluster;
     int LeftRAP, CentreRAP, RightRAP, Cluster, loop;
@@ -320,14 +304,7 @@ static void cc_b(struct zint_symbol *symbol, const char source[], const int cc_w
     const int debug_print = symbol->debug & ZINT_DEBUG_PRINT;
 
     for (i = 0; i < length; i++) {
-        const int binloc = i * 8;
-
-        data_string[i] = 0;
-        for (p = 0; p < 8; p++) {
-            if (source[binloc + p] == '1') {
-                data_string[i] |= (0x80 >> p);
-            }
-        }
+        data_string[i] = (unsigned char) bits_peek(source, i * 8, 8);
     }
 
     mclength = 0;
@@ -424,28 +401,9 @@ static void cc_b(struct zint_symbol *symbol, const char source[], const int cc_w
     }
 
     /* Reed-Solomon error correction */
-    longueur = mclength;
-    for (i = 0; i < longueur; i++) {
-        total = (chainemc[i] + mccorrection[k - 1]) % 929;
-        for (j = k - 1; j >= 0; j--) {
-            if (j == 0) {
-                mccorrection[j] = (929 - (total * pdf_Microcoeffs[offset + j]) % 929) % 929;
-            } else {
-                mccorrection[j] = (mccorrection[j - 1] + 929 - (total * pdf_Microcoeffs[offset + j]) % 929) % 929;
-            }
-        }
-    }
-
-    for (j = 0; j < k; j++) {
-        if (mccorrection[j] != 0) {
-            mccorrection[j] = 929 - mccorrection[j];
-        }
-    }
     /* we add these codes to the string */
-    for (i = k - 1; i >= 0; i--) {
-        chainemc[mclength] = mccorrection[i];
-        mclength++;
-    }
+    pdf_rs_code(chainemc, mclength, pdf_Microcoeffs + offset, k, chainemc + mclength);
+    mclength += k;
 
     /* Now get the RAP (Row Address Pattern) start values */
     LeftRAPStart = pdf_RAPTable[variant];
@@ -526,30 +484,24 @@ static void cc_b(struct zint_symbol *symbol, const char source[], const int cc_w
 }
 
 /* CC-C 2D component - byte compressed PDF417 */
-static void cc_c(struct zint_symbol *symbol, const char source[], const int cc_width, const int ecc_level) {
-    const int length = (int) strlen(source) / 8;
-    int i, p;
+static void cc_c(struct zint_symbol *symbol, const uint64_t source[], const int bitlen, const int cc_width,
+            const int ecc_level) {
+    const int length = bitlen / 8;
+    int i;
 #ifndef _MSC_VER
     unsigned char data_string[length + 4];
 #else
     unsigned char *data_string = (unsigned char *) _alloca(length + 4);
 #endif
     int chainemc[1000], mclength, k;
-    int offset, longueur, loop, total, j, mccorrection[520] = {0};
+    int offset, loop, j;
     int c1, c2, c3, dummy[35];
     char pattern[580];
     int bp = 0;
     const int debug_print = symbol->debug & ZINT_DEBUG_PRINT;
 
     for (i = 0; i < length; i++) {
-        const int binloc = i * 8;
-
-        data_string[i] = 0;
-        for (p = 0; p < 8; p++) {
-            if (source[binloc + p] == '1') {
-                data_string[i] |= (0x80 >> p);
-            }
-        }
+        data_string[i] = (unsigned char) bits_peek(source, i * 8, 8);
     }
 
     mclength = 0;
@@ -596,28 +548,9 @@ static void cc_c(struct zint_symbol *symbol, const char source[], const int cc_w
             break;
     }
 
-    longueur = mclength;
-    for (i = 0; i < longueur; i++) {
-        total = (chainemc[i] + mccorrection[k - 1]) % 929;
-        for (j = k - 1; j >= 0; j--) {
-            if (j == 0) {
-                mccorrection[j] = (929 - (total * pdf_coefrs[offset + j]) % 929) % 929;
-            } else {
-                mccorrection[j] = (mccorrection[j - 1] + 929 - (total * pdf_coefrs[offset + j]) % 929) % 929;
-            }
-        }
-    }
-
-    for (j = 0; j < k; j++) {
-        if (mccorrection[j] != 0) {
-            mccorrection[j] = 929 - mccorrection[j];
-        }
-    }
     /* we add these codes to the string */
-    for (i = k - 1; i >= 0; i--) {
-        chainemc[mclength] = mccorrection[i];
-        mclength++;
-    }
+    pdf_rs_code(chainemc, mclength, pdf_coefrs + offset, k, chainemc + mclength);
+    mclength += k;
 
     /* 818 - The CW string is finished */
     symbol->rows = mclength / cc_width;
@@ -866,7 +799,8 @@ static int calc_padding_ccc(const int binary_length, int *cc_width, const int li
 
 /* Handles all data encodation from section 5 of ISO/IEC 24723 */
 static int cc_binary_string(struct zint_symbol *symbol, const unsigned char source[], const int source_len,
-            char binary_string[], const int cc_mode, int *cc_width, int *ecc, const int linear_width) {
+            uint64_t binary_string[], int *p_bitlen, const int cc_mode, int *cc_width, int *ecc,
+            const int linear_width) {
     int encoding_method, read_posn, alpha_pad;
     int i, j, ai_crop, ai_crop_posn, fnc1_latch;
     int ai90_mode, remainder;
@@ -902,29 +836,29 @@ static int cc_binary_string(struct zint_symbol *symbol, const unsigned char sour
     }
 
     if (encoding_method == 1) {
-        binary_string[bp++] = '0';
+        bp = bits_append_posn(0, 1, binary_string, bp);
         if (debug_print) printf("CC-%c Encodation Method: 0\n", 'A' + (cc_mode - 1));
 
     } else if (encoding_method == 2) {
         /* Encoding Method field "10" - date and lot number */
 
-        bp = bin_append_posn(2, 2, binary_string, bp); /* "10" */
+        bp = bits_append_posn(2, 2, binary_string, bp); /* "10" */
 
         if (source[1] == '0') {
             /* No date data */
-            bp = bin_append_posn(3, 2, binary_string, bp); /* "11" */
+            bp = bits_append_posn(3, 2, binary_string, bp); /* "11" */
             read_posn = 2;
         } else {
             /* Production Date (11) or Expiration Date (17) */
 
-            bp = bin_append_posn(dbar_date(source, 2), 16, binary_string, bp);
+            bp = bits_append_posn(dbar_date(source, 2), 16, binary_string, bp);
 
             if (source[1] == '1') {
                 /* Production Date AI 11 */
-                binary_string[bp++] = '0';
+                bp = bits_append_posn(0, 1, binary_string, bp);
             } else {
                 /* Expiration Date AI 17 */
-                binary_string[bp++] = '1';
+                bp = bits_append_posn(1, 1, binary_string, bp);
             }
             read_posn = 8;
 
@@ -940,7 +874,7 @@ static int cc_binary_string(struct zint_symbol *symbol, const unsigned char sour
                 /* So still need FNC1 character but can't do single FNC1 in numeric mode, so insert alphanumeric latch
                    "0000" and alphanumeric FNC1 "01111" (this implementation detail taken from BWIPP
                    https://github.com/bwipp/postscriptbarcode Copyright (c) 2004-2019 Terry Burton) */
-                bp = bin_append_posn(15, 9, binary_string, bp); /* "000001111" */
+                bp = bits_append_posn(15, 9, binary_string, bp); /* "000001111" */
                 /* Note an alphanumeric FNC1 is also a numeric latch, so now in numeric mode */
             }
         }
@@ -1018,7 +952,7 @@ static int cc_binary_string(struct zint_symbol *symbol, const unsigned char sour
             int numeric_value;
             int table3_letter;
             /* Encodation method "11" can be used */
-            bp = bin_append_posn(3, 2, binary_string, bp); /* "11" */
+            bp = bits_append_posn(3, 2, binary_string, bp); /* "11" */
 
             numeric -= test1;
             alpha--;
@@ -1028,17 +962,17 @@ static int cc_binary_string(struct zint_symbol *symbol, const unsigned char sour
 
             if (alphanum == 0 && alpha > numeric) {
                 /* Alpha mode */
-                bp = bin_append_posn(3, 2, binary_string, bp); /* "11" */
+                bp = bits_append_posn(3, 2, binary_string, bp); /* "11" */
                 ai90_mode = 2;
             } else if (alphanum == 0 && alpha == 0) {
                 /* Numeric mode */
-                bp = bin_append_posn(2, 2, binary_string, bp); /* "10" */
+                bp = bits_append_posn(2, 2, binary_string, bp); /* "10" */
                 ai90_mode = 3;
             } else {
                 /* Note if first 4 are digits then it would be shorter to go into NUMERIC mode first; not
                    implemented */
                 /* Alphanumeric mode */
-                binary_string[bp++] = '0';
+                bp = bits_append_posn(0, 1, binary_string, bp);
                 ai90_mode = 1;
                 mode = ALPHANUMERIC;
             }
@@ -1060,12 +994,12 @@ static int cc_binary_string(struct zint_symbol *symbol, const unsigned char sour
             }
 
             switch (ai_crop) {
-                case 0: binary_string[bp++] = '0';
+                case 0: bp = bits_append_posn(0, 1, binary_string, bp);
                     break;
-                case 1: bp = bin_append_posn(2, 2, binary_string, bp); /* "10" */
+                case 1: bp = bits_append_posn(2, 2, binary_string, bp); /* "10" */
                     ai_crop_posn = next_ai_posn + 1;
                     break;
-                case 3: bp = bin_append_posn(3, 2, binary_string, bp); /* "11" */
+                case 3: bp = bits_append_posn(3, 2, binary_string, bp); /* "11" */
                     ai_crop_posn = next_ai_posn + 1;
                     break;
             }
@@ -1089,18 +1023,18 @@ static int cc_binary_string(struct zint_symbol *symbol, const unsigned char sour
             if (table3_letter != -1) {
                 /* Encoding can be done according to 5.3.2 c) 2) */
                 /* five bit binary string representing value before letter */
-                bp = bin_append_posn(numeric_value, 5, binary_string, bp);
+                bp = bits_append_posn(numeric_value, 5, binary_string, bp);
 
                 /* followed by four bit representation of letter from Table 3 */
-                bp = bin_append_posn(table3_letter, 4, binary_string, bp);
+                bp = bits_append_posn(table3_letter, 4, binary_string, bp);
             } else {
                 /* Encoding is done according to 5.3.2 c) 3) */
-                bp = bin_append_posn(31, 5, binary_string, bp);
+                bp = bits_append_posn(31, 5, binary_string, bp);
                 /* ten bit representation of number */
-                bp = bin_append_posn(numeric_value, 10, binary_string, bp);
+                bp = bits_append_posn(numeric_value, 10, binary_string, bp);
 
                 /* five bit representation of ASCII character */
-                bp = bin_append_posn(ninety[test1] - 65, 5, binary_string, bp);
+                bp = bits_append_posn(ninety[test1] - 65, 5, binary_string, bp);
             }
 
             read_posn = test1 + 3;
@@ -1110,13 +1044,13 @@ static int cc_binary_string(struct zint_symbol *symbol, const unsigned char sour
                 /* Alpha encodation (section 5.3.3) */
                 do {
                     if ((source[read_posn] >= 'A') && (source[read_posn] <= 'Z')) {
-                        bp = bin_append_posn(source[read_posn] - 65, 5, binary_string, bp);
+                        bp = bits_append_posn(source[read_posn] - 65, 5, binary_string, bp);
 
                     } else if ((source[read_posn] >= '0') && (source[read_posn] <= '9')) {
-                        bp = bin_append_posn(source[read_posn] + 4, 6, binary_string, bp);
+                        bp = bits_append_posn(source[read_posn] + 4, 6, binary_string, bp);
 
                     } else if (source[read_posn] == '[') {
-                        bp = bin_append_posn(31, 5, binary_string, bp);
+                        bp = bits_append_posn(31, 5, binary_string, bp);
                     }
 
                     read_posn++;
@@ -1125,12 +1059,14 @@ static int cc_binary_string(struct zint_symbol *symbol, const unsigned char sour
             }
 
             if (debug_print) {
-                printf("CC-%c Encodation Method: 11, Compaction Field: %.*s, Binary: %.*s (%d)\n",
-                        'A' + (cc_mode - 1), read_posn, source, bp, binary_string, bp);
+                printf("CC-%c Encodation Method: 11, Compaction Field: %.*s, Binary: ",
+                        'A' + (cc_mode - 1), read_posn, source);
+                bits_print(binary_string, 0, bp);
+                printf(" (%d)\n", bp);
             }
         } else {
             /* Use general field encodation instead */
-            binary_string[bp++] = '0';
+            bp = bits_append_posn(0, 1, binary_string, bp);
             read_posn = 0;
             if (debug_print) printf("CC-%c Encodation Method: 0\n", 'A' + (cc_mode - 1));
         }
@@ -1199,14 +1135,14 @@ static int cc_binary_string(struct zint_symbol *symbol, const unsigned char sour
         if ((remainder >= 4) && (remainder <= 6)) {
             /* ISO/IEC 24723:2010 5.4.1 c) 2) "If four to six bits remain, add 1 to the digit value and encode the
                result in the next four bits. ..." */
-            bp = bin_append_posn(ctoi(last_digit) + 1, 4, binary_string, bp);
+            bp = bits_append_posn(ctoi(last_digit) + 1, 4, binary_string, bp);
             if (remainder > 4) {
                 /* "... The fifth and sixth bits, if present, shall be “0”s." (Covered by adding truncated
                    alphanumeric latch below but do explicitly anyway) */
-                bp = bin_append_posn(0, remainder - 4, binary_string, bp);
+                bp = bits_append_posn(0, remainder - 4, binary_string, bp);
             }
         } else {
-            bp = bin_append_posn((11 * ctoi(last_digit)) + 18, 7, binary_string, bp);
+            bp = bits_append_posn((11 * ctoi(last_digit)) + 18, 7, binary_string, bp);
             /* This may push the symbol up to the next size */
         }
     }
@@ -1231,23 +1167,25 @@ static int cc_binary_string(struct zint_symbol *symbol, const unsigned char sour
     if (bp < target_bitsize) {
         /* Now add padding to binary string */
         if (alpha_pad == 1) {
-            bp = bin_append_posn(31, 5, binary_string, bp); /* "11111" */
+            bp = bits_append_posn(31, 5, binary_string, bp); /* "11111" */
             /* Extra FNC1 character required after Alpha encodation (section 5.3.3) */
         }
 
         if (mode == NUMERIC) {
-            bp = bin_append_posn(0, 4, binary_string, bp); /* "0000" */
+            bp = bits_append_posn(0, 4, binary_string, bp); /* "0000" */
         }
 
         while (bp < target_bitsize) {
-            bp = bin_append_posn(4, 5, binary_string, bp); /* "00100" */
+            bp = bits_append_posn(4, 5, binary_string, bp); /* "00100" */
         }
     }
-    binary_string[target_bitsize] = '\0';
+    *p_bitlen = target_bitsize;
 
     if (debug_print) {
         printf("ECC: %d, CC width %d\n", *ecc, *cc_width);
-        printf("Binary: %s (%d)\n", binary_string, target_bitsize);
+        printf("Binary: ");
+        bits_print(binary_string, 0, target_bitsize);
+        printf(" (%d)\n", target_bitsize);
     }
 
     return 0;
@@ -1282,10 +1220,11 @@ INTERNAL int composite(struct zint_symbol *symbol, unsigned char source[], int l
     /* Allow for 8 bits + 5-bit latch per char + 1000 bits overhead/padding */
     const unsigned int bs = 13 * length + 1000 + 1;
 #ifndef _MSC_VER
-    char binary_string[bs];
+    uint64_t binary_string[BITS_WORDS(bs)];
 #else
-    char *binary_string = (char *) _alloca(bs);
+    uint64_t *binary_string = (uint64_t *) _alloca(sizeof(uint64_t) * BITS_WORDS(bs));
 #endif
+    int bitlen = 0;
     unsigned int pri_len;
     struct zint_symbol *linear;
     int top_shift, bottom_shift;
@@ -1393,7 +1332,8 @@ INTERNAL int composite(struct zint_symbol *symbol, unsigned char source[], int l
     }
 
     if (cc_mode == 1) {
-        i = cc_binary_string(symbol, source, length, binary_string, cc_mode, &cc_width, &ecc_level, linear_width);
+        i = cc_binary_string(symbol, source, length, binary_string, &bitlen, cc_mode, &cc_width, &ecc_level,
+                linear_width);
         if (i == ZINT_ERROR_TOO_LONG) {
             symbol->errtxt[0] = '\0'; /* Unset error text */
             cc_mode = 2;
@@ -1404,7 +1344,8 @@ INTERNAL int composite(struct zint_symbol *symbol, unsigned char source[], int l
 
     if (cc_mode == 2) {
         /* If the data didn't fit into CC-A it is recalculated for CC-B */
-        i = cc_binary_string(symbol, source, length, binary_string, cc_mode, &cc_width, &ecc_level, linear_width);
+        i = cc_binary_string(symbol, source, length, binary_string, &bitlen, cc_mode, &cc_width, &ecc_level,
+                linear_width);
         if (i == ZINT_ERROR_TOO_LONG) {
             if (symbol->symbology != BARCODE_GS1_128_CC) {
                 return ZINT_ERROR_TOO_LONG;
@@ -1418,7 +1359,8 @@ INTERNAL int composite(struct zint_symbol *symbol, unsigned char source[], int l
 
     if (cc_mode == 3) {
         /* If the data didn't fit in CC-B (and linear part is GS1-128) it is recalculated for CC-C */
-        i = cc_binary_string(symbol, source, length, binary_string, cc_mode, &cc_width, &ecc_level, linear_width);
+        i = cc_binary_string(symbol, source, length, binary_string, &bitlen, cc_mode, &cc_width, &ecc_level,
+                linear_width);
         if (i != 0) {
             return i;
         }
@@ -1426,11 +1368,11 @@ INTERNAL int composite(struct zint_symbol *symbol, unsigned char source[], int l
 
     switch (cc_mode) {
             /* Note that ecc_level is only relevant to CC-C */
-        case 1: cc_a(symbol, binary_string, cc_width);
+        case 1: cc_a(symbol, binary_string, bitlen, cc_width);
             break;
-        case 2: cc_b(symbol, binary_string, cc_width);
+        case 2: cc_b(symbol, binary_string, bitlen, cc_width);
             break;
-        case 3: cc_c(symbol, binary_string, cc_width, ecc_level);
+        case 3: cc_c(symbol, binary_string, bitlen, cc_width, ecc_level);
             break;
     }
 
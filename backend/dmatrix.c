@@ -169,6 +169,102 @@ static void dm_placement(int *array, const int NR, const int NC) {
         array[NR * NC - 1] = array[NR * NC - NC - 2] = 1;
 }
 
+/* Module maps, built on first use for each symbol size, giving for every module of the symbol (row by row from the
+   top) the index into the codeword lookup (`DM_CW_OFFSET` + codeword position, or `DM_CW_LIGHT`/`DM_CW_DARK` for
+   fixed modules) shifted left 3, ORed with the bit no. */
+#define DM_CW_LIGHT     0   /* Lookup entry 0 is always 0x00 */
+#define DM_CW_DARK      1   /* Lookup entry 1 is always 0xFF */
+#define DM_CW_OFFSET    2   /* Codewords start at lookup entry 2 */
+
+static const unsigned short *dm_map_cache[DMSIZESCOUNT];
+
+/* Build module map for `symbolsize` (as above) - returns NULL on malloc() failure */
+static unsigned short *dm_build_map(const int symbolsize) {
+    const int H = dm_matrixH[symbolsize];
+    const int W = dm_matrixW[symbolsize];
+    const int FH = dm_matrixFH[symbolsize];
+    const int FW = dm_matrixFW[symbolsize];
+    const int NC = W - 2 * (W / FW);
+    const int NR = H - 2 * (H / FH);
+    unsigned short *map;
+    int x, y, *places;
+
+    if (!(places = (int *) z_calloc(NC * NR, sizeof(int)))) {
+        return NULL;
+    }
+    if (!(map = (unsigned short *) z_calloc(H * W, sizeof(unsigned short)))) { /* All DM_CW_LIGHT */
+        z_free(places);
+        return NULL;
+    }
+    dm_placement(places, NR, NC);
+
+    /* Finder and clock patterns */
+    for (y = 0; y < H; y += FH) {
+        for (x = 0; x < W; x++)
+            map[((H - y) - 1) * W + x] = DM_CW_DARK << 3;
+        for (x = 0; x < W; x += 2)
+            map[y * W + x] = DM_CW_DARK << 3;
+    }
+    for (x = 0; x < W; x += FW) {
+        for (y = 0; y < H; y++)
+            map[((H - y) - 1) * W + x] = DM_CW_DARK << 3;
+        for (y = 0; y < H; y += 2)
+            map[((H - y) - 1) * W + x + FW - 1] = DM_CW_DARK << 3;
+    }
+#ifdef DM_DEBUG
+    // Print position matrix as in standard
+    for (y = NR - 1; y >= 0; y--) {
+        for (x = 0; x < NC; x++) {
+            const int v = places[(NR - y - 1) * NC + x];
+            if (x != 0) fprintf(stderr, "|");
+            fprintf(stderr, "%3d.%2d", (v >> 3), 8 - (v & 7));
+        }
+        fprintf(stderr, "\n");
+    }
+#endif
+    /* Data regions - `places` has codeword positions from 1, with 1 for the fixed dark corner module */
+    for (y = 0; y < NR; y++) {
+        const int row = H - (1 + y + 2 * (y / (FH - 2))) - 1;
+        for (x = 0; x < NC; x++) {
+            const int v = places[(NR - y - 1) * NC + x];
+            if (v == 1) {
+                map[row * W + 1 + x + 2 * (x / (FW - 2))] = DM_CW_DARK << 3;
+            } else if (v > 7) {
+                map[row * W + 1 + x + 2 * (x / (FW - 2))] = (unsigned short) (v + ((DM_CW_OFFSET - 1) << 3));
+            }
+        }
+    }
+    z_free(places);
+
+    return map;
+}
+
+/* Get module map for `symbolsize`, building it if not cached - returns NULL on malloc() failure */
+static const unsigned short *dm_get_map(const int symbolsize) {
+    const unsigned short *map;
+    unsigned short *new_map;
+
+    cache_lock();
+    map = dm_map_cache[symbolsize];
+    cache_unlock();
+    if (map) {
+        return map;
+    }
+
+    if (!(new_map = dm_build_map(symbolsize))) {
+        return NULL;
+    }
+    cache_lock();
+    if (!(map = dm_map_cache[symbolsize])) { /* Another thread may have beaten us to it */
+        map = dm_map_cache[symbolsize] = new_map;
+        new_map = NULL;
+    }
+    cache_unlock();
+    z_free(new_map);
+
+    return map;
+}
+
 /* calculate and append ecc code, and if necessary interleave */
 static void dm_ecc(unsigned char *binary, const int bytes, const int datablock, const int rsblock, const int skew) {
     int blocks = (bytes + 2) / datablock, b;
@@ -986,7 +1082,7 @@ static int dm_define_mode(struct zint_symbol *symbol, char modes[], const unsign
     int current_mode;
     int mode_end, mode_len;
 
-    struct dm_edge *edges = (struct dm_edge *) calloc((length + 1) * DM_NUM_MODES, sizeof(struct dm_edge));
+    struct dm_edge *edges = (struct dm_edge *) z_calloc((length + 1) * DM_NUM_MODES, sizeof(struct dm_edge));
     if (!edges) {
         return 0;
     }
@@ -1046,7 +1142,7 @@ static int dm_define_mode(struct zint_symbol *symbol, char modes[], const unsign
     }
     assert(mode_end == 0);
 
-    free(edges);
+    z_free(edges);
 
     return 1;
 }
@@ -1793,11 +1889,12 @@ static void dm_add_tail(unsigned char target[], int tp, const int tail_length) {
 
 static int dm_ecc200(struct zint_symbol *symbol, const unsigned char source[], int length) {
     int i, skew = 0;
-    unsigned char binary[2200];
+    unsigned char cw[DM_CW_OFFSET + 2200]; /* Codeword lookup for placement, preceded by fixed entries */
+    unsigned char *const binary = cw + DM_CW_OFFSET;
     int binlen;
     int symbolsize;
     int taillength, error_number;
-    int H, W, FH, FW, datablock, bytes, rsblock;
+    int H, W, datablock, bytes, rsblock;
     const int debug_print = symbol->debug & ZINT_DEBUG_PRINT;
 
     /* `length` may be decremented by 2 if macro character is used */
@@ -1820,8 +1917,6 @@ static int dm_ecc200(struct zint_symbol *symbol, const unsigned char source[], i
 
     H = dm_matrixH[symbolsize];
     W = dm_matrixW[symbolsize];
-    FH = dm_matrixFH[symbolsize];
-    FW = dm_matrixFW[symbolsize];
     bytes = dm_matrixbytes[symbolsize];
     datablock = dm_matrixdatablock[symbolsize];
     rsblock = dm_matrixrsblock[symbolsize];
@@ -1854,49 +1949,40 @@ static int dm_ecc200(struct zint_symbol *symbol, const unsigned char source[], i
     }
 #endif
     { // placement
-        const int NC = W - 2 * (W / FW);
-        const int NR = H - 2 * (H / FH);
-        int x, y, *places;
-        if (!(places = (int *) calloc(NC * NR, sizeof(int)))) {
+        const unsigned short *map, *m;
+        int x, y, b;
+        if (!(map = dm_get_map(symbolsize))) {
             strcpy(symbol->errtxt, "718: Insufficient memory for placement array");
             return ZINT_ERROR_MEMORY;
         }
-        dm_placement(places, NR, NC);
-        for (y = 0; y < H; y += FH) {
-            for (x = 0; x < W; x++)
-                set_module(symbol, (H - y) - 1, x);
-            for (x = 0; x < W; x += 2)
-                set_module(symbol, y, x);
-        }
-        for (x = 0; x < W; x += FW) {
-            for (y = 0; y < H; y++)
-                set_module(symbol, (H - y) - 1, x);
-            for (y = 0; y < H; y += 2)
-                set_module(symbol, (H - y) - 1, x + FW - 1);
-        }
-#ifdef DM_DEBUG
-        // Print position matrix as in standard
-        for (y = NR - 1; y >= 0; y--) {
-            for (x = 0; x < NC; x++) {
-                const int v = places[(NR - y - 1) * NC + x];
-                if (x != 0) fprintf(stderr, "|");
-                fprintf(stderr, "%3d.%2d", (v >> 3), 8 - (v & 7));
+        /* Set 8 modules at a time from their codeword bits, with fixed modules given by the 2 lookup entries
+           preceding the codewords */
+        cw[DM_CW_LIGHT] = 0x00;
+        cw[DM_CW_DARK] = 0xFF;
+        /* If too big for a caller-owned `matrix` place nothing, leaving `ZBarcode_Encode()` to report it */
+        for (y = 0, m = map; y < H && (!symbol->matrix || matrix_row(symbol, H - 1, (W - 1) >> 3)); y++) {
+            unsigned char *const row = symbol->matrix ? matrix_row(symbol, y, 0) : symbol->encoded_data[y];
+            for (x = 0; x + 8 <= W; x += 8, m += 8) {
+                row[x >> 3] = (unsigned char) (((cw[m[0] >> 3] >> (m[0] & 7)) & 1)
+                                                | (((cw[m[1] >> 3] >> (m[1] & 7)) & 1) << 1)
+                                                | (((cw[m[2] >> 3] >> (m[2] & 7)) & 1) << 2)
+                                                | (((cw[m[3] >> 3] >> (m[3] & 7)) & 1) << 3)
+                                                | (((cw[m[4] >> 3] >> (m[4] & 7)) & 1) << 4)
+                                                | (((cw[m[5] >> 3] >> (m[5] & 7)) & 1) << 5)
+                                                | (((cw[m[6] >> 3] >> (m[6] & 7)) & 1) << 6)
+                                                | (((cw[m[7] >> 3] >> (m[7] & 7)) & 1) << 7));
             }
-            fprintf(stderr, "\n");
-        }
-#endif
-        for (y = 0; y < NR; y++) {
-            for (x = 0; x < NC; x++) {
-                const int v = places[(NR - y - 1) * NC + x];
-                if (v == 1 || (v > 7 && (binary[(v >> 3) - 1] & (1 << (v & 7))))) {
-                    set_module(symbol, H - (1 + y + 2 * (y / (FH - 2))) - 1, 1 + x + 2 * (x / (FW - 2)));
+            if (x < W) {
+                unsigned char byte = 0;
+                for (b = 0; x + b < W; b++, m++) {
+                    byte |= ((cw[*m >> 3] >> (*m & 7)) & 1) << b;
                 }
+                row[x >> 3] = byte;
             }
         }
         for (y = 0; y < H; y++) {
             symbol->row_height[y] = 1;
         }
-        free(places);
     }
 
     symbol->height = H;
@@ -1387,15 +1387,18 @@ INTERNAL int dotcode(struct zint_symbol *symbol, unsigned char source[], int len
     /* Allow 4 codewords per input + 2 (FNC) + 4 (ECI) + 2 (special char 1st position) + 4 (Structured Append) */
     const int codeword_array_len = length * 4 + 2 + 4 + 2 + 4;
 
-#ifndef _MSC_VER
-    unsigned char codeword_array[codeword_array_len];
-#else
-    unsigned char *codeword_array = (unsigned char *) _alloca(codeword_array_len);
+    unsigned char *codeword_array;
+#ifdef _MSC_VER
     char *dot_stream;
     char *dot_array;
     unsigned char *masked_codeword_array;
 #endif /* _MSC_VER */
 
+    /* Up to 70K for max input, so from the scratch arena rather than the stack */
+    if (!(codeword_array = (unsigned char *) scratch_alloc(symbol, codeword_array_len))) {
+        return ZINT_ERROR_MEMORY;
+    }
+
     if (symbol->eci > 811799) {
         strcpy(symbol->errtxt, "525: Invalid ECI");
         return ZINT_ERROR_INVALID_OPTION;
@@ -44,50 +44,11 @@
 #endif
 #include "common.h"
 #include "emf.h"
+#include "filemem.h"
 
 /* Multiply truncating to 3 decimal places (avoids rounding differences on various platforms) */
 #define mul3dpf(m, arg) stripf(roundf(m * arg * 1000.0) / 1000.0f)
 
-static int count_rectangles(struct zint_symbol *symbol) {
-    int rectangles = 0;
-    struct zint_vector_rect *rect;
-
-    rect = symbol->vector->rectangles;
-    while (rect) {
-        rectangles++;
-        rect = rect->next;
-    }
-
-    return rectangles;
-}
-
-static int count_circles(struct zint_symbol *symbol) {
-    int circles = 0;
-    struct zint_vector_circle *circ;
-
-    circ = symbol->vector->circles;
-    while (circ) {
-        circles++;
-        circ = circ->next;
-    }
-
-    /* Hack for MaxiCode */
-    return symbol->symbology == BARCODE_MAXICODE ? circles * 2 : circles;
-}
-
-static int count_hexagons(struct zint_symbol *symbol) {
-    int hexagons = 0;
-    struct zint_vector_hexagon *hex;
-
-    hex = symbol->vector->hexagons;
-    while (hex) {
-        hexagons++;
-        hex = hex->next;
-    }
-
-    return hexagons;
-}
-
 static int count_strings(struct zint_symbol *symbol, float *fsize, float *fsize2, int *halign, int *halign1,
             int *halign2) {
     int strings = 0;
@@ -167,7 +128,8 @@ static int utfle_length(unsigned char *input, int length) {
 
 INTERNAL int emf_plot(struct zint_symbol *symbol, int rotate_angle) {
     int i;
-    FILE *emf_file;
+    struct filemem fm;
+    struct filemem *const fmp = &fm;
     int fgred, fggrn, fgblu, bgred, bggrn, bgblu;
     int error_number = 0;
     int rectangle_count, this_rectangle;
@@ -227,11 +189,10 @@ INTERNAL int emf_plot(struct zint_symbol *symbol, int rotate_angle) {
     float current_fsize;
     int current_halign;
 
-#ifdef _MSC_VER
+    unsigned char *records; /* Single allocation for the rectangle, hexagon and circle records */
     emr_rectangle_t *rectangle;
     emr_ellipse_t *circle;
     emr_polygon_t *hexagon;
-#endif
 
     if (symbol->vector == NULL) {
         strcpy(symbol->errtxt, "643: Vector header NULL");
@@ -251,21 +212,24 @@ INTERNAL int emf_plot(struct zint_symbol *symbol, int rotate_angle) {
         }
     }
 
-    rectangle_count = count_rectangles(symbol);
-    circle_count = count_circles(symbol);
-    hexagon_count = count_hexagons(symbol);
+    rectangle_count = symbol->vector->rectangle_count;
+    circle_count = symbol->vector->circle_count;
+    if (symbol->symbology == BARCODE_MAXICODE) { /* Hack for MaxiCode */
+        circle_count *= 2;
+    }
+    hexagon_count = symbol->vector->hexagon_count;
     string_count = count_strings(symbol, &fsize, &fsize2, &halign, &halign1, &halign2);
 
-#ifndef _MSC_VER
-    // Avoid sanitize runtime error by making always non-zero
-    emr_rectangle_t rectangle[rectangle_count ? rectangle_count : 1];
-    emr_ellipse_t circle[circle_count ? circle_count : 1];
-    emr_polygon_t hexagon[hexagon_count ? hexagon_count : 1];
-#else
-    rectangle = (emr_rectangle_t *) _alloca(rectangle_count * sizeof(emr_rectangle_t));
-    circle = (emr_ellipse_t *) _alloca(circle_count * sizeof(emr_ellipse_t));
-    hexagon = (emr_polygon_t *) _alloca(hexagon_count * sizeof(emr_polygon_t));
-#endif
+    /* On the heap rather than the stack as can be large (e.g. 40K+ rectangles for big QR/Data Matrix) */
+    if (!(records = (unsigned char *) z_malloc(sizeof(emr_rectangle_t) * rectangle_count
+                                                + sizeof(emr_polygon_t) * hexagon_count
+                                                + sizeof(emr_ellipse_t) * circle_count + 1))) {
+        strcpy(symbol->errtxt, "639: Insufficient memory for EMF record buffer");
+        return ZINT_ERROR_MEMORY;
+    }
+    rectangle = (emr_rectangle_t *) records;
+    hexagon = (emr_polygon_t *) (rectangle + rectangle_count);
+    circle = (emr_ellipse_t *) (hexagon + hexagon_count);
 
     // Calculate how many coloured rectangles
     if (symbol->symbology == BARCODE_ULTRA) {
@@ -627,10 +591,11 @@ INTERNAL int emf_plot(struct zint_symbol *symbol, int rotate_angle) {
             assert(str->length > 0);
             utfle_len = utfle_length(str->text, str->length);
             bumped_len = bump_up(utfle_len) * 2;
-            if (!(this_string[this_text] = (unsigned char *) malloc(bumped_len))) {
+            if (!(this_string[this_text] = (unsigned char *) z_malloc(bumped_len))) {
                 for (i = 0; i < this_text; i++) {
-                    free(this_string[i]);
+                    z_free(this_string[i]);
                 }
+                z_free(records);
                 strcpy(symbol->errtxt, "641: Insufficient memory for EMF string buffer");
                 return ZINT_ERROR_MEMORY;
             }
@@ -687,63 +652,69 @@ INTERNAL int emf_plot(struct zint_symbol *symbol, int rotate_angle) {
     if (output_to_stdout) {
 #ifdef _MSC_VER
         if (-1 == _setmode(_fileno(stdout), _O_BINARY)) {
+            for (i = 0; i < string_count; i++) {
+                z_free(this_string[i]);
+            }
+            z_free(records);
             sprintf(symbol->errtxt, "642: Could not set stdout to binary (%d: %.30s)", errno, strerror(errno));
             return ZINT_ERROR_FILE_ACCESS;
         }
 #endif
-        emf_file = stdout;
-    } else {
-        if (!(emf_file = fopen(symbol->outfile, "wb"))) {
-            sprintf(symbol->errtxt, "640: Could not open output file (%d: %.30s)", errno, strerror(errno));
-            return ZINT_ERROR_FILE_ACCESS;
+    }
+    if (!fm_open(fmp, symbol, "wb")) {
+        for (i = 0; i < string_count; i++) {
+            z_free(this_string[i]);
         }
+        z_free(records);
+        sprintf(symbol->errtxt, "640: Could not open output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_ACCESS;
     }
 
-    fwrite(&emr_header, sizeof(emr_header_t), 1, emf_file);
+    fm_write(&emr_header, sizeof(emr_header_t), 1, fmp);
 
-    fwrite(&emr_mapmode, sizeof(emr_mapmode_t), 1, emf_file);
+    fm_write(&emr_mapmode, sizeof(emr_mapmode_t), 1, fmp);
 
     if (rotate_angle) {
-        fwrite(&emr_setworldtransform, sizeof(emr_setworldtransform_t), 1, emf_file);
+        fm_write(&emr_setworldtransform, sizeof(emr_setworldtransform_t), 1, fmp);
     }
 
-    fwrite(&emr_createbrushindirect_bg, sizeof(emr_createbrushindirect_t), 1, emf_file);
+    fm_write(&emr_createbrushindirect_bg, sizeof(emr_createbrushindirect_t), 1, fmp);
 
     if (symbol->symbology == BARCODE_ULTRA) {
         for (i = 0; i < 9; i++) {
             if (rectangle_bycolour[i]) {
-                fwrite(&emr_createbrushindirect_colour[i], sizeof(emr_createbrushindirect_t), 1, emf_file);
+                fm_write(&emr_createbrushindirect_colour[i], sizeof(emr_createbrushindirect_t), 1, fmp);
             }
         }
     } else {
-        fwrite(&emr_createbrushindirect_fg, sizeof(emr_createbrushindirect_t), 1, emf_file);
+        fm_write(&emr_createbrushindirect_fg, sizeof(emr_createbrushindirect_t), 1, fmp);
     }
 
-    fwrite(&emr_createpen, sizeof(emr_createpen_t), 1, emf_file);
+    fm_write(&emr_createpen, sizeof(emr_createpen_t), 1, fmp);
 
     if (symbol->vector->strings) {
-        fwrite(&emr_extcreatefontindirectw, sizeof(emr_extcreatefontindirectw_t), 1, emf_file);
+        fm_write(&emr_extcreatefontindirectw, sizeof(emr_extcreatefontindirectw_t), 1, fmp);
         if (fsize2) {
-            fwrite(&emr_extcreatefontindirectw2, sizeof(emr_extcreatefontindirectw_t), 1, emf_file);
+            fm_write(&emr_extcreatefontindirectw2, sizeof(emr_extcreatefontindirectw_t), 1, fmp);
         }
     }
 
-    fwrite(&emr_selectobject_bgbrush, sizeof(emr_selectobject_t), 1, emf_file);
-    fwrite(&emr_selectobject_pen, sizeof(emr_selectobject_t), 1, emf_file);
+    fm_write(&emr_selectobject_bgbrush, sizeof(emr_selectobject_t), 1, fmp);
+    fm_write(&emr_selectobject_pen, sizeof(emr_selectobject_t), 1, fmp);
     if (draw_background) {
-        fwrite(&background, sizeof(emr_rectangle_t), 1, emf_file);
+        fm_write(&background, sizeof(emr_rectangle_t), 1, fmp);
     }
 
     if (symbol->symbology == BARCODE_ULTRA) {
         for (i = 0; i < 9; i++) {
             if (rectangle_bycolour[i]) {
-                fwrite(&emr_selectobject_colour[i], sizeof(emr_selectobject_t), 1, emf_file);
+                fm_write(&emr_selectobject_colour[i], sizeof(emr_selectobject_t), 1, fmp);
 
                 rect = symbol->vector->rectangles;
                 this_rectangle = 0;
                 while (rect) {
                     if ((i == 0 && rect->colour == -1) || rect->colour == i) {
-                        fwrite(&rectangle[this_rectangle], sizeof(emr_rectangle_t), 1, emf_file);
+                        fm_write(&rectangle[this_rectangle], sizeof(emr_rectangle_t), 1, fmp);
                     }
                     this_rectangle++;
                     rect = rect->next;
@@ -751,42 +722,40 @@ INTERNAL int emf_plot(struct zint_symbol *symbol, int rotate_angle) {
             }
         }
     } else {
-        fwrite(&emr_selectobject_fgbrush, sizeof(emr_selectobject_t), 1, emf_file);
+        fm_write(&emr_selectobject_fgbrush, sizeof(emr_selectobject_t), 1, fmp);
 
         // Rectangles
-        for (i = 0; i < rectangle_count; i++) {
-            fwrite(&rectangle[i], sizeof(emr_rectangle_t), 1, emf_file);
+        if (rectangle_count) {
+            fm_write(rectangle, sizeof(emr_rectangle_t), rectangle_count, fmp);
         }
     }
 
     // Hexagons
-    for (i = 0; i < hexagon_count; i++) {
-        fwrite(&hexagon[i], sizeof(emr_polygon_t), 1, emf_file);
+    if (hexagon_count) {
+        fm_write(hexagon, sizeof(emr_polygon_t), hexagon_count, fmp);
     }
 
     // Circles
     if (symbol->symbology == BARCODE_MAXICODE) {
         // Bullseye needed
         for (i = 0; i < circle_count; i++) {
-            fwrite(&circle[i], sizeof(emr_ellipse_t), 1, emf_file);
+            fm_write(&circle[i], sizeof(emr_ellipse_t), 1, fmp);
             if (i < circle_count - 1) {
                 if (i % 2) {
-                    fwrite(&emr_selectobject_fgbrush, sizeof(emr_selectobject_t), 1, emf_file);
+                    fm_write(&emr_selectobject_fgbrush, sizeof(emr_selectobject_t), 1, fmp);
                 } else {
-                    fwrite(&emr_selectobject_bgbrush, sizeof(emr_selectobject_t), 1, emf_file);
+                    fm_write(&emr_selectobject_bgbrush, sizeof(emr_selectobject_t), 1, fmp);
                 }
             }
         }
-    } else {
-        for (i = 0; i < circle_count; i++) {
-            fwrite(&circle[i], sizeof(emr_ellipse_t), 1, emf_file);
-        }
+    } else if (circle_count) {
+        fm_write(circle, sizeof(emr_ellipse_t), circle_count, fmp);
     }
 
     // Text
     if (string_count > 0) {
-        fwrite(&emr_selectobject_font, sizeof(emr_selectobject_t), 1, emf_file);
-        fwrite(&emr_settextcolor, sizeof(emr_settextcolor_t), 1, emf_file);
+        fm_write(&emr_selectobject_font, sizeof(emr_selectobject_t), 1, fmp);
+        fm_write(&emr_settextcolor, sizeof(emr_settextcolor_t), 1, fmp);
     }
 
     current_fsize = fsize;
@@ -794,29 +763,30 @@ INTERNAL int emf_plot(struct zint_symbol *symbol, int rotate_angle) {
     for (i = 0; i < string_count; i++) {
         if (text_fsizes[i] != current_fsize) {
             current_fsize = text_fsizes[i];
-            fwrite(&emr_selectobject_font2, sizeof(emr_selectobject_t), 1, emf_file);
+            fm_write(&emr_selectobject_font2, sizeof(emr_selectobject_t), 1, fmp);
         }
         if (text_haligns[i] != current_halign) {
             current_halign = text_haligns[i];
             if (current_halign == 0) {
-                fwrite(&emr_settextalign, sizeof(emr_settextalign_t), 1, emf_file);
+                fm_write(&emr_settextalign, sizeof(emr_settextalign_t), 1, fmp);
             } else if (current_halign == 1) {
-                fwrite(&emr_settextalign1, sizeof(emr_settextalign_t), 1, emf_file);
+                fm_write(&emr_settextalign1, sizeof(emr_settextalign_t), 1, fmp);
             } else {
-                fwrite(&emr_settextalign2, sizeof(emr_settextalign_t), 1, emf_file);
+                fm_write(&emr_settextalign2, sizeof(emr_settextalign_t), 1, fmp);
             }
         }
-        fwrite(&text[i], sizeof(emr_exttextoutw_t), 1, emf_file);
-        fwrite(this_string[i], bump_up(text[i].w_emr_text.chars) * 2, 1, emf_file);
-        free(this_string[i]);
+        fm_write(&text[i], sizeof(emr_exttextoutw_t), 1, fmp);
+        fm_write(this_string[i], bump_up(text[i].w_emr_text.chars) * 2, 1, fmp);
+        z_free(this_string[i]);
     }
 
-    fwrite(&emr_eof, sizeof(emr_eof_t), 1, emf_file);
+    fm_write(&emr_eof, sizeof(emr_eof_t), 1, fmp);
 
-    if (output_to_stdout) {
-        fflush(emf_file);
-    } else {
-        fclose(emf_file);
+    z_free(records);
+
+    if (!fm_close(fmp, symbol)) {
+        sprintf(symbol->errtxt, "644: Failure on closing output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_WRITE;
     }
     return error_number;
 }
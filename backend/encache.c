@@ -0,0 +1,354 @@
+/*  encache.c - encode result cache
+
+    libzint - the open source barcode library
+    Copyright (C) 2021 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+
+
+#include "common.h"
+#include "encache.h"
+
+/* Cached encode result. Allocated as one block, followed by `rows` row heights, `rows` rows of `row_bytes` bytes of
+   modules, and `length` bytes of source data */
+struct encache_entry {
+    struct encache_entry *prev;     /* Least recently used list, most recently used first */
+    struct encache_entry *next;
+    struct encache_entry *chain;    /* Next entry in same hash bucket */
+    unsigned int hash;
+    int length;                     /* Length of source data */
+    struct encache_settings key;    /* Settings before encoding */
+    struct encache_settings settings; /* Settings after encoding */
+    int error_number;
+    int rows;
+    int width;
+    int row_bytes;                  /* (`width` + 7) / 8, or `width` for Ultracode (colour, a byte per module) */
+    unsigned char text[128];
+    char errtxt[100];
+};
+
+/* Cache state, protected by `cache_lock()`, except `encache_enabled`, which is read without the lock via
+   `cache_load_int()` as a hint only (`encache_max` decides once locked) */
+static int encache_enabled;
+static int encache_max;
+static int encache_count;
+static struct encache_entry **encache_buckets;
+static unsigned int encache_mask;   /* Number of buckets - 1 */
+static struct encache_entry *encache_first;
+static struct encache_entry *encache_last;
+static unsigned int encache_hits;
+static unsigned int encache_misses;
+static unsigned int encache_evictions;
+
+/* Copy the settings of `symbol` that are encode inputs into `settings` */
+static void encache_settings_get(const struct zint_symbol *symbol, struct encache_settings *settings) {
+    memset(settings, 0, sizeof(*settings)); /* Zero any padding as hashed and compared bytewise */
+    settings->symbology = symbol->symbology;
+    settings->height = symbol->height;
+    settings->scale = symbol->scale;
+    settings->whitespace_width = symbol->whitespace_width;
+    settings->whitespace_height = symbol->whitespace_height;
+    settings->border_width = symbol->border_width;
+    settings->output_options = symbol->output_options;
+    memcpy(settings->primary, symbol->primary, sizeof(settings->primary));
+    settings->option_1 = symbol->option_1;
+    settings->option_2 = symbol->option_2;
+    settings->option_3 = symbol->option_3;
+    settings->show_hrt = symbol->show_hrt;
+    settings->input_mode = symbol->input_mode;
+    settings->eci = symbol->eci;
+    settings->dot_size = symbol->dot_size;
+    settings->guard_descent = symbol->guard_descent;
+    settings->structapp = symbol->structapp;
+    settings->warn_level = symbol->warn_level;
+}
+
+/* Copy `settings` back into `symbol` */
+static void encache_settings_set(struct zint_symbol *symbol, const struct encache_settings *settings) {
+    symbol->symbology = settings->symbology;
+    symbol->height = settings->height;
+    symbol->scale = settings->scale;
+    symbol->whitespace_width = settings->whitespace_width;
+    symbol->whitespace_height = settings->whitespace_height;
+    symbol->border_width = settings->border_width;
+    symbol->output_options = settings->output_options;
+    memcpy(symbol->primary, settings->primary, sizeof(symbol->primary));
+    symbol->option_1 = settings->option_1;
+    symbol->option_2 = settings->option_2;
+    symbol->option_3 = settings->option_3;
+    symbol->show_hrt = settings->show_hrt;
+    symbol->input_mode = settings->input_mode;
+    symbol->eci = settings->eci;
+    symbol->dot_size = settings->dot_size;
+    symbol->guard_descent = settings->guard_descent;
+    symbol->structapp = settings->structapp;
+    symbol->warn_level = settings->warn_level;
+}
+
+/* FNV-1a hash of `size` bytes of `data`, continuing from `hash` */
+static unsigned int encache_hash(unsigned int hash, const unsigned char *data, const int size) {
+    int i;
+
+    for (i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619;
+    }
+    return hash;
+}
+
+/* Row heights, modules and source data following `entry` */
+static float *encache_row_heights(const struct encache_entry *entry) {
+    return (float *) (entry + 1);
+}
+
+static unsigned char *encache_modules(const struct encache_entry *entry) {
+    return (unsigned char *) (encache_row_heights(entry) + entry->rows);
+}
+
+static unsigned char *encache_source(const struct encache_entry *entry) {
+    return encache_modules(entry) + entry->rows * entry->row_bytes;
+}
+
+/* Remove `entry` from the used list (lock held) */
+static void encache_unlist(struct encache_entry *entry) {
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        encache_first = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        encache_last = entry->prev;
+    }
+}
+
+/* Add `entry` to the front of the used list (lock held) */
+static void encache_list(struct encache_entry *entry) {
+    entry->prev = NULL;
+    entry->next = encache_first;
+    if (encache_first) {
+        encache_first->prev = entry;
+    } else {
+        encache_last = entry;
+    }
+    encache_first = entry;
+}
+
+/* Find entry matching key (lock held) - returns NULL if none */
+static struct encache_entry *encache_find(const unsigned int hash, const struct encache_settings *key,
+            const unsigned char source[], const int length) {
+    struct encache_entry *entry;
+
+    for (entry = encache_buckets[hash & encache_mask]; entry; entry = entry->chain) {
+        if (entry->hash == hash && entry->length == length && memcmp(&entry->key, key, sizeof(*key)) == 0
+                && memcmp(encache_source(entry), source, length) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* Look up encode of `source` with the settings of `symbol`, restoring it into `symbol` if found */
+INTERNAL int encache_get(struct zint_symbol *symbol, const unsigned char source[], const int length,
+                struct encache_settings *settings, int *p_error_number) {
+    struct encache_entry *entry;
+    unsigned int hash;
+
+    /* Stacked symbols and debug output aren't cached */
+    if (!cache_load_int(&encache_enabled) || symbol->rows != 0 || symbol->debug) {
+        return -1;
+    }
+
+    encache_settings_get(symbol, settings);
+    hash = encache_hash(encache_hash(2166136261u, (const unsigned char *) settings, (int) sizeof(*settings)),
+                        source, length);
+
+    cache_lock();
+    if (!encache_max) {
+        cache_unlock();
+        return -1;
+    }
+    /* Treat as a miss if too big for a caller-owned `matrix`, so that the encode reports it */
+    if (!(entry = encache_find(hash, settings, source, length))
+            || (symbol->matrix && !matrix_row(symbol, entry->rows - 1, entry->row_bytes - 1))) {
+        encache_misses++;
+        cache_unlock();
+        return 0;
+    }
+    encache_hits++;
+    if (entry != encache_first) {
+        encache_unlist(entry);
+        encache_list(entry);
+    }
+
+    /* Copy out while locked, as may be evicted once unlocked */
+    {
+        const int row_bytes = entry->row_bytes;
+        const unsigned char *modules = encache_modules(entry);
+        int i;
+
+        encache_settings_set(symbol, &entry->settings);
+        if (symbol->matrix) {
+            memset(symbol->matrix, 0, symbol->matrix_size);
+            for (i = 0; i < entry->rows; i++, modules += row_bytes) {
+                memcpy(matrix_row(symbol, i, 0), modules, row_bytes);
+            }
+        } else {
+            for (i = 0; i < entry->rows; i++, modules += row_bytes) {
+                memcpy(symbol->encoded_data[i], modules, row_bytes);
+                memset(symbol->encoded_data[i] + row_bytes, 0, sizeof(symbol->encoded_data[0]) - row_bytes);
+            }
+        }
+        memcpy(symbol->row_height, encache_row_heights(entry), sizeof(float) * entry->rows);
+        symbol->rows = entry->rows;
+        symbol->width = entry->width;
+        memcpy(symbol->text, entry->text, sizeof(symbol->text));
+        if (entry->error_number) {
+            strcpy(symbol->errtxt, entry->errtxt);
+        }
+        *p_error_number = entry->error_number;
+    }
+    cache_unlock();
+
+    return 1;
+}
+
+/* Add encode of `source` with the key `settings` and result `error_number` (errors aren't cached) */
+INTERNAL void encache_put(const struct zint_symbol *symbol, const unsigned char source[], const int length,
+                const struct encache_settings *settings, const int error_number) {
+    /* Ultracode modules are colour, a byte each */
+    const int row_bytes = symbol->symbology == BARCODE_ULTRA ? symbol->width : (symbol->width + 7) / 8;
+    struct encache_entry *entry, *evicted = NULL;
+    unsigned char *modules;
+    int i;
+
+    if (error_number >= ZINT_ERROR || symbol->rows <= 0 || symbol->rows > 200 || row_bytes > 144) {
+        return;
+    }
+    if (!(entry = (struct encache_entry *) z_malloc(sizeof(struct encache_entry) + sizeof(float) * symbol->rows
+                                                    + row_bytes * symbol->rows + length))) {
+        return; /* Not an error, just not cached */
+    }
+    entry->hash = encache_hash(encache_hash(2166136261u, (const unsigned char *) settings, (int) sizeof(*settings)),
+                                source, length);
+    entry->length = length;
+    entry->key = *settings;
+    encache_settings_get(symbol, &entry->settings);
+    entry->error_number = error_number;
+    entry->rows = symbol->rows;
+    entry->width = symbol->width;
+    entry->row_bytes = row_bytes;
+    memcpy(entry->text, symbol->text, sizeof(entry->text));
+    memcpy(entry->errtxt, symbol->errtxt, sizeof(entry->errtxt));
+    memcpy(encache_row_heights(entry), symbol->row_height, sizeof(float) * symbol->rows);
+    for (i = 0, modules = encache_modules(entry); i < symbol->rows; i++, modules += row_bytes) {
+        memcpy(modules, symbol->matrix ? matrix_row(symbol, i, 0) : symbol->encoded_data[i], row_bytes);
+    }
+    memcpy(encache_source(entry), source, length);
+
+    cache_lock();
+    if (!encache_max || encache_find(entry->hash, settings, source, length)) { /* Disabled or beaten to it */
+        cache_unlock();
+        z_free(entry);
+        return;
+    }
+    entry->chain = encache_buckets[entry->hash & encache_mask];
+    encache_buckets[entry->hash & encache_mask] = entry;
+    encache_list(entry);
+    encache_count++;
+
+    /* Evict least recently used, freeing after unlocking */
+    while (encache_count > encache_max) {
+        struct encache_entry *last = encache_last;
+        struct encache_entry **p_chain = &encache_buckets[last->hash & encache_mask];
+        while (*p_chain != last) {
+            p_chain = &(*p_chain)->chain;
+        }
+        *p_chain = last->chain;
+        encache_unlist(last);
+        last->next = evicted;
+        evicted = last;
+        encache_count--;
+        encache_evictions++;
+    }
+    cache_unlock();
+
+    while (evicted) {
+        entry = evicted->next;
+        z_free(evicted);
+        evicted = entry;
+    }
+}
+
+/* Set maximum number of entries, clearing the cache and its statistics */
+INTERNAL int encache_set_size(const int max_entries) {
+    struct encache_entry **buckets = NULL, **old_buckets;
+    struct encache_entry *entry, *next;
+    unsigned int num_buckets = 16;
+    int error_number = 0;
+
+    if (max_entries > 0) {
+        while (num_buckets < (unsigned int) max_entries) {
+            num_buckets <<= 1;
+        }
+        if (!(buckets = (struct encache_entry **) z_calloc(num_buckets, sizeof(struct encache_entry *)))) {
+            error_number = ZINT_ERROR_MEMORY;
+        }
+    }
+
+    cache_lock();
+    entry = encache_first;
+    old_buckets = encache_buckets;
+    encache_buckets = buckets;
+    encache_mask = num_buckets - 1;
+    encache_max = buckets ? max_entries : 0;
+    cache_store_int(&encache_enabled, encache_max != 0);
+    encache_count = 0;
+    encache_first = encache_last = NULL;
+    encache_hits = encache_misses = encache_evictions = 0;
+    cache_unlock();
+
+    for (; entry; entry = next) {
+        next = entry->next;
+        z_free(entry);
+    }
+    z_free(old_buckets);
+
+    return error_number;
+}
+
+/* Fill `stats` with the current statistics */
+INTERNAL void encache_stats(struct zint_cache_stats *stats) {
+    cache_lock();
+    stats->max_entries = encache_max;
+    stats->entries = encache_count;
+    stats->hits = encache_hits;
+    stats->misses = encache_misses;
+    stats->evictions = encache_evictions;
+    cache_unlock();
+}
+
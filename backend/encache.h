@@ -0,0 +1,87 @@
+/*  encache.h - encode result cache
+
+    libzint - the open source barcode library
+    Copyright (C) 2021 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+
+
+#ifndef Z_ENCACHE_H
+#define Z_ENCACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Maximum number of entries settable by `ZBarcode_SetCacheSize()` */
+#define ZINT_CACHE_MAX_ENTRIES 1000000
+
+/* Symbol settings that are inputs to (and may be adjusted by) `ZBarcode_Encode()`. Part of the cache key before
+   encoding, and restored from the cache afterwards */
+struct encache_settings {
+    int symbology;
+    float height;
+    float scale;
+    int whitespace_width;
+    int whitespace_height;
+    int border_width;
+    int output_options;
+    char primary[128];
+    int option_1;
+    int option_2;
+    int option_3;
+    int show_hrt;
+    int input_mode;
+    int eci;
+    float dot_size;
+    float guard_descent;
+    struct zint_structapp structapp;
+    int warn_level;
+};
+
+/* Look up encode of `source` with the settings of `symbol`, and if found restore it into `symbol`, setting
+   `*p_error_number` to its result. Returns 1 if found, 0 if not found (with `settings` set as the key for
+   `encache_put()`), or -1 if the cache is disabled or `symbol` can't be cached */
+INTERNAL int encache_get(struct zint_symbol *symbol, const unsigned char source[], const int length,
+                struct encache_settings *settings, int *p_error_number);
+
+/* Add encode of `source` with the key `settings` (from `encache_get()`) and result `error_number` */
+INTERNAL void encache_put(const struct zint_symbol *symbol, const unsigned char source[], const int length,
+                const struct encache_settings *settings, const int error_number);
+
+/* Set maximum number of entries, clearing the cache and its statistics. Returns 0 on success, or
+   ZINT_ERROR_MEMORY if the hash table can't be allocated (in which case the cache is disabled) */
+INTERNAL int encache_set_size(const int max_entries);
+
+/* Fill `stats` with the current statistics */
+INTERNAL void encache_stats(struct zint_cache_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* Z_ENCACHE_H */
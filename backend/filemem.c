@@ -0,0 +1,449 @@
+/*  filemem.c - write to file/memory abstraction
+
+    libzint - the open source barcode library
+    Copyright (C) 2021 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#ifndef _MSC_VER
+#include <stdint.h>
+#else
+#include "ms_stdint.h"
+#endif
+#include "common.h"
+#include "filemem.h"
+
+#define FM_PAGE_SIZE 0x8000 /* 32K */
+
+#ifndef va_copy
+#ifdef __va_copy
+#define va_copy(dest, src) __va_copy(dest, src)
+#else
+#define va_copy(dest, src) ((dest) = (src))
+#endif
+#endif
+
+#if defined(_MSC_VER) && _MSC_VER < 1900 /* MSVC 2015 */
+#define vsnprintf _vsnprintf
+#endif
+
+/* Helper to set `err` only if not already set, returning 0 always */
+static int fm_seterr(struct filemem *fmp, const int err) {
+    if (!fmp->err) {
+        fmp->err = err;
+    }
+    return 0;
+}
+
+/* Helper to ensure memory buffer has room for `size` more bytes at `mempos`, returning 0 on failure */
+static int fm_mem_expand(struct filemem *fmp, const size_t size) {
+    size_t new_size;
+    unsigned char *new_mem;
+
+    if (fmp->err) {
+        return 0;
+    }
+    if (size > (size_t) 0x7FFFFFFF - fmp->mempos) { /* Restrict to signed int (`symbol->memfile_size`) */
+        return fm_seterr(fmp, EFBIG);
+    }
+    if (fmp->mempos + size <= fmp->memsize) {
+        return 1;
+    }
+    new_size = fmp->memsize ? fmp->memsize : FM_PAGE_SIZE;
+    while (new_size < fmp->mempos + size) {
+        new_size = new_size > (size_t) 0x3FFFFFFF ? (size_t) 0x7FFFFFFF : new_size * 2;
+    }
+    if (!(new_mem = (unsigned char *) z_realloc(fmp->mem, new_size))) {
+        return fm_seterr(fmp, ENOMEM);
+    }
+    fmp->mem = new_mem;
+    fmp->memsize = new_size;
+    return 1;
+}
+
+/* `fopen()` equivalent - returns 1 on success, 0 on failure with `fmp->err` set. `mode` as `fopen()` */
+INTERNAL int fm_open(struct filemem *fmp, struct zint_symbol *symbol, const char *mode) {
+    memset(fmp, 0, sizeof(*fmp));
+    if (symbol->output_options & BARCODE_MEMORY_FILE) {
+        if (symbol->memfile) {
+            z_free(symbol->memfile);
+            symbol->memfile = NULL;
+        }
+        symbol->memfile_size = 0;
+        fmp->flags = BARCODE_MEMORY_FILE;
+        return fm_mem_expand(fmp, FM_PAGE_SIZE);
+    }
+    if (symbol->output_options & BARCODE_STDOUT) {
+        fmp->fp = stdout;
+        fmp->flags = BARCODE_STDOUT;
+        return 1;
+    }
+    if (!(fmp->fp = fopen(symbol->outfile, mode))) {
+        return fm_seterr(fmp, errno);
+    }
+    return 1;
+}
+
+/* `fwrite()` equivalent - returns no. of `nitems` written */
+INTERNAL size_t fm_write(const void *ptr, size_t size, size_t nitems, struct filemem *fmp) {
+    if (fmp->flags & BARCODE_MEMORY_FILE) {
+        const size_t tot_size = size * nitems;
+        if (size == 0 || nitems == 0) {
+            return 0;
+        }
+        if (tot_size / size != nitems) { /* Overflow */
+            return fm_seterr(fmp, ENOMEM);
+        }
+        if (!fm_mem_expand(fmp, tot_size)) {
+            return 0;
+        }
+        memcpy(fmp->mem + fmp->mempos, ptr, tot_size);
+        fmp->mempos += tot_size;
+        if (fmp->mempos > fmp->memend) {
+            fmp->memend = fmp->mempos;
+        }
+        return nitems;
+    }
+    if (fwrite(ptr, size, nitems, fmp->fp) != nitems) {
+        fm_seterr(fmp, errno);
+        return 0;
+    }
+    return nitems;
+}
+
+/* `fputc()` equivalent - returns `ch` or EOF on error */
+INTERNAL int fm_putc(int ch, struct filemem *fmp) {
+    if (fmp->flags & BARCODE_MEMORY_FILE) {
+        if (!fm_mem_expand(fmp, 1)) {
+            return EOF;
+        }
+        fmp->mem[fmp->mempos++] = (unsigned char) ch;
+        if (fmp->mempos > fmp->memend) {
+            fmp->memend = fmp->mempos;
+        }
+        return ch;
+    }
+    if (fputc(ch, fmp->fp) == EOF) {
+        fm_seterr(fmp, errno);
+        return EOF;
+    }
+    return ch;
+}
+
+/* `fputs()` equivalent - returns non-negative on success, EOF on error */
+INTERNAL int fm_puts(const char *str, struct filemem *fmp) {
+    if (fmp->flags & BARCODE_MEMORY_FILE) {
+        const size_t len = strlen(str);
+        if (len && fm_write(str, 1, len, fmp) != len) {
+            return EOF;
+        }
+        return 1;
+    }
+    if (fputs(str, fmp->fp) == EOF) {
+        fm_seterr(fmp, errno);
+        return EOF;
+    }
+    return 1;
+}
+
+/* `fprintf()` equivalent - returns no. of chars written, or -1 on error */
+INTERNAL int fm_printf(struct filemem *fmp, const char *format, ...) {
+    va_list ap;
+    int ret;
+
+    va_start(ap, format);
+    if (fmp->flags & BARCODE_MEMORY_FILE) {
+        va_list cpy;
+        size_t size = fmp->memsize > fmp->mempos ? fmp->memsize - fmp->mempos : 0;
+
+        if (fmp->err) {
+            va_end(ap);
+            return -1;
+        }
+
+        va_copy(cpy, ap);
+        /* Note not all `vsnprintf()` implementations (e.g. MSVC before 2015) return the required size, in which case
+           try doubling until fits */
+        ret = size ? vsnprintf((char *) fmp->mem + fmp->mempos, size, format, cpy) : -1;
+        va_end(cpy);
+        while (ret < 0 || (size_t) ret >= size) {
+            if (!fm_mem_expand(fmp, ret < 0 ? size * 2 + FM_PAGE_SIZE : (size_t) ret + 1)) {
+                va_end(ap);
+                return -1;
+            }
+            size = fmp->memsize - fmp->mempos;
+            va_copy(cpy, ap);
+            ret = vsnprintf((char *) fmp->mem + fmp->mempos, size, format, cpy);
+            va_end(cpy);
+            if (ret < 0 && size > (size_t) 0x3FFFFFFF) {
+                va_end(ap);
+                return fm_seterr(fmp, ENOMEM) - 1;
+            }
+        }
+        fmp->mempos += ret;
+        if (fmp->mempos > fmp->memend) {
+            fmp->memend = fmp->mempos;
+        }
+    } else {
+        if ((ret = vfprintf(fmp->fp, format, ap)) < 0) {
+            fm_seterr(fmp, errno);
+        }
+    }
+    va_end(ap);
+    return ret;
+}
+
+/* Format float `arg` to `dp` (0-6) decimal places into `buf`, which must have room for `FM_FTOA_MAX` chars, with
+   the same result as `sprintf(buf, "%.*f", dp, arg)` in the "C" locale but without consulting the locale (so
+   callers needn't `setlocale()`, which isn't thread-safe). If `dp` negative, formats to `-dp` places and then
+   removes any trailing zeroes (and the point if none left). Returns pointer past end (not NUL-terminated) */
+INTERNAL char *fm_ftoa(const float arg, const int dp, char *buf) {
+    static const double pow10s[7] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+    const int places = dp < 0 ? -dp : dp;
+    char digits[FM_FTOA_MAX];
+    char *const e = digits + sizeof(digits);
+    char *b = e;
+    double scaled, frac;
+    uint64_t val;
+    uint32_t bits;
+    int i;
+
+    /* As float significand is 24 bits and 10^6 < 2^20, this is exact, so rounding below is as exact as `printf()` */
+    scaled = arg * pow10s[places];
+    if (!(scaled < 18446744073709551616.0 && scaled > -18446744073709551616.0)) { /* Inf, NaN or >= 2^64 */
+        /* "%.0f" doesn't use the decimal point, and if finite `arg` must be integral here */
+        int len = sprintf(buf, "%.0f", arg);
+        if (arg - arg == 0.0f && dp > 0) { /* Finite */
+            buf[len++] = '.';
+            for (i = 0; i < dp; i++) {
+                buf[len++] = '0';
+            }
+        }
+        return buf + len;
+    }
+    memcpy(&bits, &arg, sizeof(bits)); /* Sign bit, to match `printf()` on -0 */
+    if (bits & 0x80000000) {
+        scaled = -scaled;
+    }
+    val = (uint64_t) scaled;
+    frac = scaled - (double) val;
+    if (frac > 0.5 || (frac == 0.5 && (val & 1))) { /* Round half to even */
+        val++;
+    }
+
+    for (i = 0; i < places; i++) {
+        const char digit = (char) ('0' + val % 10);
+        val /= 10;
+        if (dp < 0 && b == e && digit == '0') { /* Strip trailing zero */
+            continue;
+        }
+        *--b = digit;
+    }
+    if (b != e) {
+        *--b = '.';
+    }
+    do {
+        *--b = (char) ('0' + val % 10);
+        val /= 10;
+    } while (val);
+    if (bits & 0x80000000) {
+        *--b = '-';
+    }
+
+    memcpy(buf, b, e - b);
+    return buf + (e - b);
+}
+
+/* Output `prefix` (if non-NULL) followed by float `arg` formatted by `fm_ftoa()`. Returns 1 on success, 0 on
+   error */
+INTERNAL int fm_putsf(const char *prefix, const int dp, const float arg, struct filemem *fmp) {
+    char buf[FM_FTOA_MAX];
+    size_t len;
+
+    if (prefix && *prefix && fm_puts(prefix, fmp) == EOF) {
+        return 0;
+    }
+    len = fm_ftoa(arg, dp, buf) - buf;
+
+    return fm_write(buf, 1, len, fmp) == len;
+}
+
+/* `fseek()` equivalent - returns 0 on success, -1 on error */
+INTERNAL int fm_seek(struct filemem *fmp, long offset, int whence) {
+    if (fmp->flags & BARCODE_MEMORY_FILE) {
+        const long start = whence == SEEK_SET ? 0 : whence == SEEK_CUR ? (long) fmp->mempos : (long) fmp->memend;
+        if (offset < -start || (size_t) (start + offset) > fmp->memend) {
+            return fm_seterr(fmp, EINVAL) - 1;
+        }
+        fmp->mempos = (size_t) (start + offset);
+        return 0;
+    }
+    if (fseek(fmp->fp, offset, whence) != 0) {
+        return fm_seterr(fmp, errno) - 1;
+    }
+    return 0;
+}
+
+/* `ftell()` equivalent - returns current position or -1 on error */
+INTERNAL long fm_tell(struct filemem *fmp) {
+    long ret;
+    if (fmp->flags & BARCODE_MEMORY_FILE) {
+        return (long) fmp->mempos;
+    }
+    if ((ret = ftell(fmp->fp)) == -1) {
+        fm_seterr(fmp, errno);
+    }
+    return ret;
+}
+
+/* Returns `fmp->err` if any error has occurred, else 0 */
+INTERNAL int fm_error(const struct filemem *fmp) {
+    if (!fmp->err && fmp->fp && ferror(fmp->fp)) {
+        return EIO;
+    }
+    return fmp->err;
+}
+
+/* `fclose()` equivalent (flushes if stdout) - returns 1 on success, 0 on failure with `fmp->err` set. If memory
+   file, transfers buffer to `symbol->memfile` and `symbol->memfile_size` */
+INTERNAL int fm_close(struct filemem *fmp, struct zint_symbol *symbol) {
+    if (fmp->flags & BARCODE_MEMORY_FILE) {
+        if (fmp->err) {
+            if (fmp->mem) {
+                z_free(fmp->mem);
+                fmp->mem = NULL;
+            }
+            return 0;
+        }
+        /* Shrink to fit, ignoring failure */
+        if (fmp->memend && fmp->memend < fmp->memsize) {
+            unsigned char *new_mem = (unsigned char *) z_realloc(fmp->mem, fmp->memend);
+            if (new_mem) {
+                fmp->mem = new_mem;
+            }
+        }
+        symbol->memfile = fmp->mem;
+        symbol->memfile_size = (int) fmp->memend;
+        fmp->mem = NULL;
+        return 1;
+    }
+    if (fmp->fp == NULL) {
+        return fm_seterr(fmp, EBADF);
+    }
+    if (ferror(fmp->fp)) {
+        fm_seterr(fmp, EIO);
+    }
+    if (fmp->flags & BARCODE_STDOUT) {
+        if (fflush(fmp->fp) != 0) {
+            fm_seterr(fmp, errno);
+        }
+    } else if (fclose(fmp->fp) != 0) {
+        fm_seterr(fmp, errno);
+    }
+    fmp->fp = NULL;
+    return fmp->err ? 0 : 1;
+}
+
+/* Allocate text buffer with initial `size` - returns 1 on success, 0 on failure */
+INTERNAL int fm_tb_init(struct fm_textbuf *tb, const size_t size) {
+    tb->err = 0;
+    if (!(tb->buf = (char *) z_malloc(size ? size : 1))) {
+        tb->p = tb->end = NULL;
+        tb->err = 1;
+        return 0;
+    }
+    tb->p = tb->buf;
+    tb->end = tb->buf + (size ? size : 1);
+    return 1;
+}
+
+/* Ensure room for `size` more chars, growing if necessary - returns 1 on success, 0 on failure (sticky) */
+INTERNAL int fm_tb_reserve(struct fm_textbuf *tb, const size_t size) {
+    size_t used, new_size;
+    char *new_buf;
+
+    if (tb->err) {
+        return 0;
+    }
+    if ((size_t) (tb->end - tb->p) >= size) {
+        return 1;
+    }
+    used = tb->p - tb->buf;
+    new_size = (tb->end - tb->buf) * 2;
+    if (new_size < used + size) {
+        new_size = used + size;
+    }
+    if (!(new_buf = (char *) z_realloc(tb->buf, new_size))) {
+        tb->err = 1;
+        return 0;
+    }
+    tb->buf = new_buf;
+    tb->p = new_buf + used;
+    tb->end = new_buf + new_size;
+    return 1;
+}
+
+/* Append NUL-terminated `str` */
+INTERNAL void fm_tb_puts(struct fm_textbuf *tb, const char *str) {
+    const size_t len = strlen(str);
+    if (fm_tb_reserve(tb, len)) {
+        memcpy(tb->p, str, len);
+        tb->p += len;
+    }
+}
+
+/* Append `prefix` (if non-NULL) followed by float `arg` formatted by `fm_ftoa()` */
+INTERNAL void fm_tb_putsf(struct fm_textbuf *tb, const char *prefix, const int dp, const float arg) {
+    if (prefix && *prefix) {
+        fm_tb_puts(tb, prefix);
+    }
+    if (fm_tb_reserve(tb, FM_FTOA_MAX)) {
+        tb->p = fm_ftoa(arg, dp, tb->p);
+    }
+}
+
+/* Write contents to `fmp` and free - returns 1 on success, 0 on failure (including any earlier failure to
+   allocate, with `fmp->err` set to ENOMEM) */
+INTERNAL int fm_tb_flush(struct fm_textbuf *tb, struct filemem *fmp) {
+    const size_t len = tb->err ? 0 : (size_t) (tb->p - tb->buf);
+    const int ret = !tb->err && (!len || fm_write(tb->buf, 1, len, fmp) == len);
+
+    if (tb->err) {
+        fm_seterr(fmp, ENOMEM);
+    }
+    fm_tb_free(tb);
+    return ret;
+}
+
+/* Free without writing */
+INTERNAL void fm_tb_free(struct fm_textbuf *tb) {
+    z_free(tb->buf);
+    tb->buf = tb->p = tb->end = NULL;
+}
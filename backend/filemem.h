@@ -0,0 +1,124 @@
+/*  filemem.h - write to file/memory abstraction
+
+    libzint - the open source barcode library
+    Copyright (C) 2021 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+
+#ifndef Z_FILEMEM_H
+#define Z_FILEMEM_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Raster/vector output sink, either a file (`symbol->outfile` or stdout) or a growable memory buffer
+   (if `BARCODE_MEMORY_FILE` set in `symbol->output_options`) */
+struct filemem {
+    FILE *fp;           /* File pointer (NULL if memory) */
+    unsigned char *mem; /* Memory buffer (NULL if file) */
+    size_t memsize;     /* Allocated size of `mem` */
+    size_t mempos;      /* Current write position in `mem` */
+    size_t memend;      /* High-water mark of `mem`, i.e. its used size */
+    int flags;          /* BARCODE_MEMORY_FILE or BARCODE_STDOUT if set, else 0 */
+    int err;            /* `errno` of first error (sticky) */
+};
+
+/* `fopen()` equivalent - returns 1 on success, 0 on failure with `fmp->err` set. `mode` as `fopen()` */
+INTERNAL int fm_open(struct filemem *fmp, struct zint_symbol *symbol, const char *mode);
+
+/* `fwrite()` equivalent - returns no. of `nitems` written */
+INTERNAL size_t fm_write(const void *ptr, size_t size, size_t nitems, struct filemem *fmp);
+
+/* `fputc()` equivalent - returns `ch` or EOF on error */
+INTERNAL int fm_putc(int ch, struct filemem *fmp);
+
+/* `fputs()` equivalent - returns non-negative on success, EOF on error */
+INTERNAL int fm_puts(const char *str, struct filemem *fmp);
+
+/* `fprintf()` equivalent - returns no. of chars written, or -1 on error */
+INTERNAL int fm_printf(struct filemem *fmp, const char *format, ...);
+
+#define FM_FTOA_MAX 48  /* Max chars output by `fm_ftoa()` ("-" + 39 digits (FLT_MAX) + "." + 6 dp, rounded up) */
+
+/* Format float `arg` to `dp` (0-6) decimal places into `buf`, which must have room for `FM_FTOA_MAX` chars, with
+   the same result as `sprintf(buf, "%.*f", dp, arg)` in the "C" locale but without consulting the locale (so
+   callers needn't `setlocale()`, which isn't thread-safe). If `dp` negative, formats to `-dp` places and then
+   removes any trailing zeroes (and the point if none left). Returns pointer past end (not NUL-terminated) */
+INTERNAL char *fm_ftoa(const float arg, const int dp, char *buf);
+
+/* Output `prefix` (if non-NULL) followed by float `arg` formatted by `fm_ftoa()`. Returns 1 on success, 0 on
+   error */
+INTERNAL int fm_putsf(const char *prefix, const int dp, const float arg, struct filemem *fmp);
+
+/* `fseek()` equivalent - returns 0 on success, -1 on error */
+INTERNAL int fm_seek(struct filemem *fmp, long offset, int whence);
+
+/* `ftell()` equivalent - returns current position or -1 on error */
+INTERNAL long fm_tell(struct filemem *fmp);
+
+/* Returns `fmp->err` if any error has occurred, else 0 */
+INTERNAL int fm_error(const struct filemem *fmp);
+
+/* `fclose()` equivalent (flushes if stdout) - returns 1 on success, 0 on failure with `fmp->err` set. If memory
+   file, transfers buffer to `symbol->memfile` and `symbol->memfile_size` */
+INTERNAL int fm_close(struct filemem *fmp, struct zint_symbol *symbol);
+
+/* Growable text buffer, for formatting output in memory before sending it to a `filemem` in one go */
+struct fm_textbuf {
+    char *buf;          /* Start of allocation */
+    char *p;            /* Current position */
+    char *end;          /* End of allocation */
+    int err;            /* Set if allocation failed (sticky, further output ignored) */
+};
+
+/* Allocate text buffer with initial `size` - returns 1 on success, 0 on failure */
+INTERNAL int fm_tb_init(struct fm_textbuf *tb, const size_t size);
+
+/* Ensure room for `size` more chars, growing if necessary - returns 1 on success, 0 on failure (sticky) */
+INTERNAL int fm_tb_reserve(struct fm_textbuf *tb, const size_t size);
+
+/* Append NUL-terminated `str` */
+INTERNAL void fm_tb_puts(struct fm_textbuf *tb, const char *str);
+
+/* Append `prefix` (if non-NULL) followed by float `arg` formatted by `fm_ftoa()` */
+INTERNAL void fm_tb_putsf(struct fm_textbuf *tb, const char *prefix, const int dp, const float arg);
+
+/* Write contents to `fmp` and free - returns 1 on success, 0 on failure (including any earlier failure to
+   allocate, with `fmp->err` set to ENOMEM) */
+INTERNAL int fm_tb_flush(struct fm_textbuf *tb, struct filemem *fmp);
+
+/* Free without writing */
+INTERNAL void fm_tb_free(struct fm_textbuf *tb);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* Z_FILEMEM_H */
@@ -32,6 +32,7 @@
 /* vim: set ts=4 sw=4 et : */
 
 #include "common.h"
+#include "bitstream.h"
 #include "general_field.h"
 
 static const char alphanum_puncs[] = "*,-./";
@@ -95,7 +96,7 @@ static int general_field_next_none(const char *general_field, int i, const int g
 /* Attempts to apply encoding rules from sections 7.2.5.5.1 to 7.2.5.5.3
  * of ISO/IEC 24724:2011 (same as sections 5.4.1 to 5.4.3 of ISO/IEC 24723:2010) */
 INTERNAL int general_field_encode(const char *general_field, const int general_field_len, int *p_mode,
-                char *p_last_digit, char binary_string[], int *p_bp) {
+                char *p_last_digit, uint64_t binary_string[], int *p_bp) {
     int i, d1, d2;
     int mode = *p_mode;
     char last_digit = '\0'; /* Set to odd remaining digit at end if any */
@@ -111,18 +112,18 @@ INTERNAL int general_field_encode(const char *general_field, const int general_f
                 if (i < general_field_len - 1) { /* If at least 2 characters remain */
                     if (type != NUMERIC || general_field_type(general_field, i + 1) != NUMERIC) {
                         /* 7.2.5.5.1/5.4.1 a) */
-                        bp = bin_append_posn(0, 4, binary_string, bp); /* Alphanumeric latch "0000" */
+                        bp = bits_append_posn(0, 4, binary_string, bp); /* Alphanumeric latch "0000" */
                         mode = ALPHANUMERIC;
                     } else {
                         d1 = general_field[i] == '[' ? 10 : ctoi(general_field[i]);
                         d2 = general_field[i + 1] == '[' ? 10 : ctoi(general_field[i + 1]);
-                        bp = bin_append_posn((11 * d1) + d2 + 8, 7, binary_string, bp);
+                        bp = bits_append_posn((11 * d1) + d2 + 8, 7, binary_string, bp);
                         i += 2;
                     }
                 } else { /* If 1 character remains */
                     if (type != NUMERIC) {
                         /* 7.2.5.5.1/5.4.1 b) */
-                        bp = bin_append_posn(0, 4, binary_string, bp); /* Alphanumeric latch "0000" */
+                        bp = bits_append_posn(0, 4, binary_string, bp); /* Alphanumeric latch "0000" */
                         mode = ALPHANUMERIC;
                     } else {
                         /* Ending with single digit.
@@ -135,37 +136,37 @@ INTERNAL int general_field_encode(const char *general_field, const int general_f
             case ALPHANUMERIC:
                 if (general_field[i] == '[') {
                     /* 7.2.5.5.2/5.4.2 a) */
-                    bp = bin_append_posn(15, 5, binary_string, bp); /* "01111" */
+                    bp = bits_append_posn(15, 5, binary_string, bp); /* "01111" */
                     mode = NUMERIC;
                     i++;
                 } else if (type == ISOIEC) {
                     /* 7.2.5.5.2/5.4.2 b) */
-                    bp = bin_append_posn(4, 5, binary_string, bp); /* ISO/IEC 646 latch "00100" */
+                    bp = bits_append_posn(4, 5, binary_string, bp); /* ISO/IEC 646 latch "00100" */
                     mode = ISOIEC;
                 } else if (general_field_next(general_field, i, general_field_len, 6, NUMERIC, 0)) {
                     /* 7.2.5.5.2/5.4.2 c) */
-                    bp = bin_append_posn(0, 3, binary_string, bp); /* Numeric latch "000" */
+                    bp = bits_append_posn(0, 3, binary_string, bp); /* Numeric latch "000" */
                     mode = NUMERIC;
                 } else if (general_field_next_terminate(general_field, i, general_field_len, 4,
                             5 /*Can limit to 5 max due to above*/, NUMERIC)) {
                     /* 7.2.5.5.2/5.4.2 d) */
-                    bp = bin_append_posn(0, 3, binary_string, bp); /* Numeric latch "000" */
+                    bp = bits_append_posn(0, 3, binary_string, bp); /* Numeric latch "000" */
                     mode = NUMERIC;
                 } else if ((general_field[i] >= '0') && (general_field[i] <= '9')) {
-                    bp = bin_append_posn(general_field[i] - 43, 5, binary_string, bp);
+                    bp = bits_append_posn(general_field[i] - 43, 5, binary_string, bp);
                     i++;
                 } else if ((general_field[i] >= 'A') && (general_field[i] <= 'Z')) {
-                    bp = bin_append_posn(general_field[i] - 33, 6, binary_string, bp);
+                    bp = bits_append_posn(general_field[i] - 33, 6, binary_string, bp);
                     i++;
                 } else {
-                    bp = bin_append_posn(posn(alphanum_puncs, general_field[i]) + 58, 6, binary_string, bp);
+                    bp = bits_append_posn(posn(alphanum_puncs, general_field[i]) + 58, 6, binary_string, bp);
                     i++;
                 }
                 break;
             case ISOIEC:
                 if (general_field[i] == '[') {
                     /* 7.2.5.5.3/5.4.3 a) */
-                    bp = bin_append_posn(15, 5, binary_string, bp); /* "01111" */
+                    bp = bits_append_posn(15, 5, binary_string, bp); /* "01111" */
                     mode = NUMERIC;
                     i++;
                 } else {
@@ -173,25 +174,25 @@ INTERNAL int general_field_encode(const char *general_field, const int general_f
                     if (next_10_not_isoiec && general_field_next(general_field, i, general_field_len, 4,
                                                 NUMERIC, 0)) {
                         /* 7.2.5.5.3/5.4.3 b) */
-                        bp = bin_append_posn(0, 3, binary_string, bp); /* Numeric latch "000" */
+                        bp = bits_append_posn(0, 3, binary_string, bp); /* Numeric latch "000" */
                         mode = NUMERIC;
                     } else if (next_10_not_isoiec && general_field_next(general_field, i, general_field_len, 5,
                                                         ALPHANUMERIC, NUMERIC)) {
                         /* 7.2.5.5.3/5.4.3 c) */
                         /* Note this rule can produce longer bitstreams if most of the alphanumerics are numeric */
-                        bp = bin_append_posn(4, 5, binary_string, bp); /* Alphanumeric latch "00100" */
+                        bp = bits_append_posn(4, 5, binary_string, bp); /* Alphanumeric latch "00100" */
                         mode = ALPHANUMERIC;
                     } else if ((general_field[i] >= '0') && (general_field[i] <= '9')) {
-                        bp = bin_append_posn(general_field[i] - 43, 5, binary_string, bp);
+                        bp = bits_append_posn(general_field[i] - 43, 5, binary_string, bp);
                         i++;
                     } else if ((general_field[i] >= 'A') && (general_field[i] <= 'Z')) {
-                        bp = bin_append_posn(general_field[i] - 1, 7, binary_string, bp);
+                        bp = bits_append_posn(general_field[i] - 1, 7, binary_string, bp);
                         i++;
                     } else if ((general_field[i] >= 'a') && (general_field[i] <= 'z')) {
-                        bp = bin_append_posn(general_field[i] - 7, 7, binary_string, bp);
+                        bp = bits_append_posn(general_field[i] - 7, 7, binary_string, bp);
                         i++;
                     } else {
-                        bp = bin_append_posn(posn(isoiec_puncs, general_field[i]) + 232, 8, binary_string, bp);
+                        bp = bits_append_posn(posn(isoiec_puncs, general_field[i]) + 232, 8, binary_string, bp);
                         i++;
                     }
                 }
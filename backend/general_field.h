@@ -41,7 +41,7 @@ extern "C" {
 #endif /* __cplusplus */
 
 INTERNAL int general_field_encode(const char *general_field, const int general_field_len, int *p_mode,
-                char *p_last_digit, char binary_string[], int *p_bp);
+                char *p_last_digit, uint64_t binary_string[], int *p_bp);
 
 #ifdef __cplusplus
 }
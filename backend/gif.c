@@ -33,7 +33,13 @@
 
 #include <errno.h>
 #include <stdio.h>
+#ifndef _MSC_VER
+#include <stdint.h>
+#else
+#include "ms_stdint.h"
+#endif
 #include "common.h"
+#include "filemem.h"
 #include <math.h>
 #ifdef _MSC_VER
 #include <io.h>
@@ -41,166 +47,51 @@
 #include <malloc.h>
 #endif
 
-/* Limit initial LZW buffer size to this in expectation that compressed data will fit for typical scalings */
-#define GIF_LZW_PAGE_SIZE   0x100000 /* Megabyte */
-
 typedef struct s_statestruct {
-    unsigned char *pOut;
-    unsigned char *pIn;
+    struct filemem *fmp;
+    const unsigned char *pIn;
     unsigned int InLen;
-    unsigned int OutLength;
-    unsigned int OutPosCur;
-    unsigned int OutByteCountPos;
-    unsigned short ClearCode;
-    unsigned short FreeCode;
-    char fByteCountByteSet;
-    unsigned char OutBitsFree;
-    unsigned short NodeAxon[4096];
-    unsigned short NodeNext[4096];
-    unsigned char NodePix[4096];
+    unsigned int OutBits;
+    int OutBitsCount;
+    unsigned char Block[256]; /* Current data sub-block, Block[0] being its byte count */
+    unsigned char PaletteIndex[256]; /* Palette index of each colour code (0 if not present) */
     unsigned char colourCode[10];
     unsigned char colourPaletteIndex[10];
     int colourCount;
 } statestruct;
 
-/* Transform a Pixel to a lzw colourmap index and move to next pixel.
- * All colour values are listed in colourCode with corresponding palette index
- */
-static unsigned char NextPaletteIndex(statestruct *pState)
-{
-    unsigned char pixelColour;
-    int colourIndex;
-    pixelColour = *(pState->pIn);
-    (pState->pIn)++;
-    (pState->InLen)--;
-    for (colourIndex = 0; colourIndex < pState->colourCount; colourIndex++) {
-        if (pixelColour == pState->colourCode[colourIndex])
-            return pState->colourPaletteIndex[colourIndex];
-
+/* Add a byte to the current data sub-block, writing the sub-block out once full */
+static void AddByteToBlock(statestruct *pState, const unsigned char Byte) {
+    pState->Block[++pState->Block[0]] = Byte;
+    if (pState->Block[0] == 255) {
+        fm_write(pState->Block, 256, 1, pState->fmp);
+        pState->Block[0] = 0;
     }
-    return 0; /* Not reached */
 }
 
-
-static int BufferNextByte(statestruct *pState) {
-    (pState->OutPosCur)++;
-    /* Check if this position is a byte count position
-     * fg_f_bytecountbyte_set indicates, if byte count position bytes should be
-     * inserted in general.
-     * If this is true, and the distance to the last byte count position is 256
-     * (e.g. 255 bytes in between), a byte count byte is inserted, and the value
-     * of the last one is set to 255.
-     * */
-    if (pState->fByteCountByteSet && (pState->OutByteCountPos + 256 == pState->OutPosCur)) {
-        (pState->pOut)[pState->OutByteCountPos] = 255;
-        pState->OutByteCountPos = pState->OutPosCur;
-        (pState->OutPosCur)++;
-    }
-    if (pState->OutPosCur >= pState->OutLength) {
-        unsigned char *pOut;
-        pState->OutLength += GIF_LZW_PAGE_SIZE;
-        /* Note pState->pOut not free()d by realloc() on failure */
-        if (!(pOut = (unsigned char *) realloc(pState->pOut, pState->OutLength))) {
-            return 1;
-        }
-        pState->pOut = pOut;
+/* Add a `CodeBits`-bit code to the output, least significant bit first */
+static void AddCodeToBuffer(statestruct *pState, const unsigned short CodeIn, const unsigned char CodeBits) {
+    pState->OutBits |= (unsigned int) CodeIn << pState->OutBitsCount;
+    pState->OutBitsCount += CodeBits;
+    while (pState->OutBitsCount >= 8) {
+        AddByteToBlock(pState, (unsigned char) pState->OutBits);
+        pState->OutBits >>= 8;
+        pState->OutBitsCount -= 8;
     }
-
-    (pState->pOut)[pState->OutPosCur] = 0x00;
-    return 0;
-}
-
-static int AddCodeToBuffer(statestruct *pState, unsigned short CodeIn, unsigned char CodeBits) {
-    /* Check, if we may fill up the current byte completely */
-    if (CodeBits >= pState->OutBitsFree) {
-        (pState->pOut)[pState->OutPosCur] |= (unsigned char) (CodeIn << (8 - pState->OutBitsFree));
-        if (BufferNextByte(pState))
-            return -1;
-        CodeIn = (unsigned short) (CodeIn >> pState->OutBitsFree);
-        CodeBits -= pState->OutBitsFree;
-        pState->OutBitsFree = 8;
-        /* Write a full byte if there are at least 8 code bits left */
-        if (CodeBits >= pState->OutBitsFree) {
-            (pState->pOut)[pState->OutPosCur] = (unsigned char) CodeIn;
-            if (BufferNextByte(pState))
-                return -1;
-            CodeIn = (unsigned short) (CodeIn >> 8);
-            CodeBits -= 8;
-        }
-    }
-    /* The remaining bits of CodeIn fit in the current byte. */
-    if (CodeBits > 0) {
-        (pState->pOut)[pState->OutPosCur] |= (unsigned char) (CodeIn << (8 - pState->OutBitsFree));
-        pState->OutBitsFree -= CodeBits;
-    }
-    return 0;
-}
-
-static void FlushStringTable(statestruct *pState) {
-    unsigned short Pos;
-    for (Pos = 0; Pos < pState->ClearCode; Pos++) {
-        (pState->NodeAxon)[Pos] = 0;
-    }
-}
-
-static unsigned short FindPixelOutlet(statestruct *pState, unsigned short HeadNode, unsigned char Byte) {
-    unsigned short Outlet;
-
-    Outlet = (pState->NodeAxon)[HeadNode];
-    while (Outlet) {
-        if ((pState->NodePix)[Outlet] == Byte)
-            return Outlet;
-        Outlet = (pState->NodeNext)[Outlet];
-    }
-    return 0;
-}
-
-static int NextCode(statestruct *pState, unsigned char *pPixelValueCur, unsigned char CodeBits) {
-    unsigned short UpNode;
-    unsigned short DownNode;
-    /* start with the root node for last pixel chain */
-    UpNode = *pPixelValueCur;
-    if ((pState->InLen) == 0)
-        return AddCodeToBuffer(pState, UpNode, CodeBits);
-
-    *pPixelValueCur = NextPaletteIndex(pState);
-    /* Follow the string table and the data stream to the end of the longest string that has a code */
-    while (0 != (DownNode = FindPixelOutlet(pState, UpNode, *pPixelValueCur))) {
-        UpNode = DownNode;
-        if ((pState->InLen) == 0)
-            return AddCodeToBuffer(pState, UpNode, CodeBits);
-
-        *pPixelValueCur = NextPaletteIndex(pState);
-    }
-    /* Submit 'UpNode' which is the code of the longest string */
-    if (AddCodeToBuffer(pState, UpNode, CodeBits))
-        return -1;
-    /* ... and extend the string by appending 'PixelValueCur' */
-    /* Create a successor node for 'PixelValueCur' whose code is 'freecode' */
-    (pState->NodePix)[pState->FreeCode] = *pPixelValueCur;
-    (pState->NodeAxon)[pState->FreeCode] = (pState->NodeNext)[pState->FreeCode] = 0;
-    /* ...and link it to the end of the chain emanating from fg_axon[UpNode]. */
-    DownNode = (pState->NodeAxon)[UpNode];
-    if (!DownNode) {
-        (pState->NodeAxon)[UpNode] = pState->FreeCode;
-    } else {
-        while ((pState->NodeNext)[DownNode]) {
-            DownNode = (pState->NodeNext)[DownNode];
-        }
-        (pState->NodeNext)[DownNode] = pState->FreeCode;
-    }
-    return 1;
 }
 
+/* Compress the pixels as LZW codes, streaming them out in data sub-blocks. As there are at most 10 colours, the
+   string table is indexed directly by prefix code and pixel rather than searched */
 static int gif_lzw(statestruct *pState, int paletteBitSize) {
-    unsigned char PixelValueCur;
+    unsigned int Prefix; /* Code of the current string */
     unsigned char CodeBits;
-    unsigned short Pos;
+    unsigned short ClearCode;
+    unsigned short FreeCode;
+    size_t NodeChildSize;
+    unsigned short *NodeChild;
+    const unsigned char *pIn = pState->pIn;
+    const unsigned char *const pInEnd = pIn + pState->InLen;
 
-    // > Get first data byte
-    if (pState->InLen == 0)
-        return 0;
-    PixelValueCur = NextPaletteIndex(pState);
     /* Number of bits per data item (=pixel)
      * We need at least a value of 2, otherwise the cc and eoi code consumes
      * the whole string table
@@ -208,73 +99,72 @@ static int gif_lzw(statestruct *pState, int paletteBitSize) {
     if (paletteBitSize == 1)
         paletteBitSize = 2;
 
-    /* initial size of compression codes */
-    CodeBits = paletteBitSize + 1;
-    pState->ClearCode = (1 << paletteBitSize);
-    pState->FreeCode = pState->ClearCode + 2;
-    pState->OutBitsFree = 8;
-    pState->OutPosCur = -1;
-    pState->fByteCountByteSet = 0;
-
-    if (BufferNextByte(pState))
+    /* Each code has a child slot for each palette index */
+    NodeChildSize = sizeof(unsigned short) * (0x1000 << paletteBitSize);
+    if (!(NodeChild = (unsigned short *) z_calloc(1, NodeChildSize))) {
         return 0;
+    }
 
-    for (Pos = 0; Pos < pState->ClearCode; Pos++)
-        (pState->NodePix)[Pos] = (unsigned char) Pos;
-
-    FlushStringTable(pState);
+    /* initial size of compression codes */
+    CodeBits = paletteBitSize + 1;
+    ClearCode = (unsigned short) (1 << paletteBitSize);
+    FreeCode = ClearCode + 2;
+    pState->OutBits = 0;
+    pState->OutBitsCount = 0;
+    pState->Block[0] = 0;
 
     /* Write what the GIF specification calls the "code size". */
-    (pState->pOut)[pState->OutPosCur] = paletteBitSize;
-    /* Reserve first bytecount byte */
-    if (BufferNextByte(pState))
-        return 0;
-    pState->OutByteCountPos = pState->OutPosCur;
-    if (BufferNextByte(pState))
-        return 0;
-    pState->fByteCountByteSet = 1;
+    fm_putc(paletteBitSize, pState->fmp);
     /* Submit one 'ClearCode' as the first code */
-    if (AddCodeToBuffer(pState, pState->ClearCode, CodeBits))
-        return 0;
-
-    for (;;) {
-        int Res;
-        /* generate and save the next code, which may consist of multiple input pixels. */
-        Res = NextCode(pState, &PixelValueCur, CodeBits);
-        if (Res < 0)
-            return 0;
-        //* Check for end of data stream */
-        if (!Res) {
-            /* submit 'eoi' as the last item of the code stream */
-            if (AddCodeToBuffer(pState, (unsigned short) (pState->ClearCode + 1), CodeBits))
-                return 0;
-            pState->fByteCountByteSet = 0;
-            if (pState->OutBitsFree < 8) {
-                if (BufferNextByte(pState))
-                    return 0;
+    AddCodeToBuffer(pState, ClearCode, CodeBits);
+
+    if (pIn < pInEnd) {
+        const unsigned char *const PaletteIndex = pState->PaletteIndex;
+        Prefix = PaletteIndex[*pIn++];
+        while (pIn < pInEnd) {
+            const unsigned int Pixel = PaletteIndex[*pIn++];
+            unsigned short *const pChild = NodeChild + ((Pixel << 12) | Prefix);
+
+            /* Follow the string table to the end of the longest string that has a code */
+            if (*pChild) {
+                Prefix = *pChild;
+                continue;
             }
-            // > Update last bytecount byte;
-            if (pState->OutByteCountPos < pState->OutPosCur) {
-                (pState->pOut)[pState->OutByteCountPos]
-                    = (unsigned char) (pState->OutPosCur - pState->OutByteCountPos - 1);
+
+            /* Submit 'Prefix' which is the code of the longest string */
+            AddCodeToBuffer(pState, (unsigned short) Prefix, CodeBits);
+            /* ... and extend the string by appending 'Pixel', giving it code 'FreeCode' */
+            *pChild = FreeCode;
+            /* Check for currently last code */
+            if (FreeCode == (1U << CodeBits))
+                CodeBits++;
+            FreeCode++;
+            /* Check for full stringtable */
+            if (FreeCode == 0xfff) {
+                memset(NodeChild, 0, NodeChildSize);
+                AddCodeToBuffer(pState, ClearCode, CodeBits);
+
+                CodeBits = (unsigned char) (1 + paletteBitSize);
+                FreeCode = (unsigned short) (ClearCode + 2);
             }
-            pState->OutPosCur++;
-            return pState->OutPosCur;
-        }
-        /* Check for currently last code */
-        if (pState->FreeCode == (1U << CodeBits))
-            CodeBits++;
-        pState->FreeCode++;
-        /* Check for full stringtable */
-        if (pState->FreeCode == 0xfff) {
-            FlushStringTable(pState);
-            if (AddCodeToBuffer(pState, pState->ClearCode, CodeBits))
-                return 0;
-
-            CodeBits = (unsigned char) (1 + paletteBitSize);
-            pState->FreeCode = (unsigned short) (pState->ClearCode + 2);
+            Prefix = Pixel;
         }
+        AddCodeToBuffer(pState, (unsigned short) Prefix, CodeBits);
+    }
+    z_free(NodeChild);
+
+    /* submit 'eoi' as the last item of the code stream */
+    AddCodeToBuffer(pState, (unsigned short) (ClearCode + 1), CodeBits);
+    if (pState->OutBitsCount) {
+        AddByteToBlock(pState, (unsigned char) pState->OutBits);
     }
+    if (pState->Block[0]) {
+        fm_write(pState->Block, pState->Block[0] + 1, 1, pState->fmp);
+    }
+    /* Block terminator */
+    fm_putc(0, pState->fmp);
+
+    return 1;
 }
 
 /*
@@ -282,13 +172,14 @@ static int gif_lzw(statestruct *pState, int paletteBitSize) {
  */
 INTERNAL int gif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf) {
     unsigned char outbuf[10];
-    FILE *gif_file;
+    struct filemem fm;
+    struct filemem *const fmp = &fm;
     unsigned short usTemp;
-    int byte_out;
     int colourCount;
     unsigned char paletteRGB[10][3];
     int paletteCount, paletteCountCur, paletteIndex;
     unsigned int pixelIndex;
+    unsigned int firstPos[256];
     int paletteBitSize;
     int paletteSize;
     statestruct State;
@@ -307,12 +198,6 @@ INTERNAL int gif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     unsigned char pixelColour;
     unsigned int bitmapSize = symbol->bitmap_height * symbol->bitmap_width;
 
-    /* Allow for overhead of 4 == code size + byte count + overflow byte + zero terminator */
-    unsigned int lzoutbufSize = bitmapSize + 4;
-    if (lzoutbufSize > GIF_LZW_PAGE_SIZE) {
-        lzoutbufSize = GIF_LZW_PAGE_SIZE;
-    }
-
     /*
      * Build a table of the used palette items.
      * Currently, there are the following 10 colour codes:
@@ -344,23 +229,47 @@ INTERNAL int gif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
      *  Thus, there are 4 colour codes and 3 palette entries.
 
      */
+    /* Find the first position of each colour code present, noting that most pixels are '0' or '1' so can skip
+       8 at a time once their first positions are known */
+    for (colourIndex = 0; colourIndex < 256; colourIndex++) {
+        firstPos[colourIndex] = bitmapSize;
+    }
+    for (colourIndex = '0'; colourIndex <= '1'; colourIndex++) {
+        const unsigned char *pFirst = (const unsigned char *) memchr(pixelbuf, colourIndex, bitmapSize);
+        if (pFirst) {
+            firstPos[colourIndex] = (unsigned int) (pFirst - pixelbuf);
+        }
+    }
+    for (pixelIndex = 0; pixelIndex < bitmapSize; pixelIndex++) {
+        if ((pixelIndex & 7) == 0 && pixelIndex + 8 <= bitmapSize) {
+            uint64_t pixels;
+            memcpy(&pixels, pixelbuf + pixelIndex, 8);
+            if ((pixels & 0xFEFEFEFEFEFEFEFE) == 0x3030303030303030) { /* All '0' or '1' */
+                pixelIndex += 7;
+                continue;
+            }
+        }
+        if (firstPos[pixelbuf[pixelIndex]] > pixelIndex) {
+            firstPos[pixelbuf[pixelIndex]] = pixelIndex;
+        }
+    }
+
     colourCount = 0;
     paletteCount = 0;
-    /* loop over all pixels */
-    for (pixelIndex = 0; pixelIndex < bitmapSize; pixelIndex++) {
-        fFound = 0;
-        /* get pixel colour code */
-        pixelColour = pixelbuf[pixelIndex];
-        /* look, if colour code is already in colour list */
-        for (colourIndex = 0; colourIndex < colourCount; colourIndex++) {
-            if ((State.colourCode)[colourIndex] == pixelColour) {
-                fFound = 1;
-                break;
+    memset(State.PaletteIndex, 0, sizeof(State.PaletteIndex));
+    /* loop over the colour codes present in order of first position */
+    for (;;) {
+        unsigned int firstPosMin = bitmapSize;
+        for (colourIndex = 0; colourIndex < 256; colourIndex++) {
+            if (firstPos[colourIndex] < firstPosMin) {
+                firstPosMin = firstPos[colourIndex];
             }
         }
-        /* If colour is already present, go to next colour code */
-        if (fFound)
-            continue;
+        if (firstPosMin == bitmapSize)
+            break;
+        /* get pixel colour code */
+        pixelColour = pixelbuf[firstPosMin];
+        firstPos[pixelColour] = bitmapSize;
 
         /* Colour code not present - add colour code */
         /* Get RGB value */
@@ -430,6 +339,7 @@ INTERNAL int gif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
         /* Add palette index to current colour code */
         (State.colourCode)[colourCount] = pixelColour;
         (State.colourPaletteIndex)[colourCount] = paletteIndex;
+        State.PaletteIndex[pixelColour] = (unsigned char) paletteIndex;
         colourCount++;
     }
     State.colourCount = colourCount;
@@ -475,12 +385,10 @@ INTERNAL int gif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
             return ZINT_ERROR_FILE_ACCESS;
         }
 #endif
-        gif_file = stdout;
-    } else {
-        if (!(gif_file = fopen(symbol->outfile, "wb"))) {
-            sprintf(symbol->errtxt, "611: Could not open output file (%d: %.30s)", errno, strerror(errno));
-            return ZINT_ERROR_FILE_ACCESS;
-        }
+    }
+    if (!fm_open(fmp, symbol, "wb")) {
+        sprintf(symbol->errtxt, "611: Could not open output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_ACCESS;
     }
 
     /* GIF signature (6) */
@@ -488,7 +396,7 @@ INTERNAL int gif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     if (transparent_index != -1)
         outbuf[4] = '9';
 
-    fwrite(outbuf, 6, 1, gif_file);
+    fm_write(outbuf, 6, 1, fmp);
     /* Screen Descriptor (7) */
     /* Screen Width */
     usTemp = (unsigned short) symbol->bitmap_width;
@@ -523,12 +431,12 @@ INTERNAL int gif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     outbuf[5] = backgroundColourIndex;
     /* Byte 7 must be 0x00  */
     outbuf[6] = 0x00;
-    fwrite(outbuf, 7, 1, gif_file);
+    fm_write(outbuf, 7, 1, fmp);
     /* Global Color Table (paletteSize*3) */
-    fwrite(paletteRGB, 3*paletteCount, 1, gif_file);
+    fm_write(paletteRGB, 3*paletteCount, 1, fmp);
     /* add unused palette items to fill palette size */
     for (paletteIndex = paletteCount; paletteIndex < paletteSize; paletteIndex++) {
-        fwrite(RGBUnused, 3, 1, gif_file);
+        fm_write(RGBUnused, 3, 1, fmp);
     }
 
     /* Graphic control extension (8) */
@@ -556,7 +464,7 @@ INTERNAL int gif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
         outbuf[6] = (unsigned char) transparent_index;
         /* Block Terminator */
         outbuf[7] = 0;
-        fwrite(outbuf, 8, 1, gif_file);
+        fm_write(outbuf, 8, 1, fmp);
     }
     /* Image Descriptor */
     /* Image separator character = ',' */
@@ -579,39 +487,25 @@ INTERNAL int gif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
      * There is no local color table if its most significant bit is reset.
      */
     outbuf[9] = 0x00;
-    fwrite(outbuf, 10, 1, gif_file);
+    fm_write(outbuf, 10, 1, fmp);
 
     /* prepare state array */
+    State.fmp = fmp;
     State.pIn = pixelbuf;
     State.InLen = bitmapSize;
-    if (!(State.pOut = (unsigned char *) malloc(lzoutbufSize))) {
-        if (!output_to_stdout) {
-            fclose(gif_file);
-        }
-        strcpy(symbol->errtxt, "614: Insufficient memory for LZW buffer");
-        return ZINT_ERROR_MEMORY;
-    }
-    State.OutLength = lzoutbufSize;
 
     /* call lzw encoding */
-    byte_out = gif_lzw(&State, paletteBitSize);
-    if (byte_out <= 0) {
-        free(State.pOut);
-        if (!output_to_stdout) {
-            fclose(gif_file);
-        }
-        strcpy(symbol->errtxt, "613: Insufficient memory for LZW buffer");
+    if (!gif_lzw(&State, paletteBitSize)) {
+        (void) fm_close(fmp, symbol);
+        strcpy(symbol->errtxt, "613: Insufficient memory for LZW string table");
         return ZINT_ERROR_MEMORY;
     }
-    fwrite((const char *) State.pOut, byte_out, 1, gif_file);
-    free(State.pOut);
 
     /* GIF terminator */
-    fputc('\x3b', gif_file);
-    if (output_to_stdout) {
-        fflush(gif_file);
-    } else {
-        fclose(gif_file);
+    fm_putc('\x3b', fmp);
+    if (!fm_close(fmp, symbol)) {
+        sprintf(symbol->errtxt, "615: Failure on closing output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_WRITE;
     }
 
     return 0;
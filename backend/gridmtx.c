@@ -39,6 +39,7 @@
 #endif
 #include "common.h"
 #include "reedsol.h"
+#include "bitstream.h"
 #include "gridmtx.h"
 #include "gb2312.h"
 #include "eci.h"
@@ -127,29 +128,29 @@ static int in_numeral(const unsigned int gbdata[], const int length, const int i
 
 #define GM_NUM_MODES 6
 
+/* Must be in same order as GM_H etc */
+static const char gm_mode_types[] = { GM_CHINESE, GM_NUMBER, GM_LOWER, GM_UPPER, GM_MIXED, GM_BYTE, '\0' };
+
+/* Initial mode costs */
+static const unsigned int gm_head_costs[GM_NUM_MODES] = {
+/*  H            N (+pad prefix)    L            U            M            B (+byte count) */
+    4 * GM_MULT, (4 + 2) * GM_MULT, 4 * GM_MULT, 4 * GM_MULT, 4 * GM_MULT, (4 + 9) * GM_MULT
+};
+
+/* Cost of switching modes from k to j - see AIMD014 Rev. 1.63 Table 9 – Type conversion codes */
+static const unsigned int gm_switch_costs[GM_NUM_MODES][GM_NUM_MODES] = {
+    /*      H             N                   L             U             M             B  */
+    /*H*/ {            0, (13 + 2) * GM_MULT, 13 * GM_MULT, 13 * GM_MULT, 13 * GM_MULT, (13 + 9) * GM_MULT },
+    /*N*/ { 10 * GM_MULT,                  0, 10 * GM_MULT, 10 * GM_MULT, 10 * GM_MULT, (10 + 9) * GM_MULT },
+    /*L*/ {  5 * GM_MULT,  (5 + 2) * GM_MULT,            0,  5 * GM_MULT,  7 * GM_MULT,  (7 + 9) * GM_MULT },
+    /*U*/ {  5 * GM_MULT,  (5 + 2) * GM_MULT,  5 * GM_MULT,            0,  7 * GM_MULT,  (7 + 9) * GM_MULT },
+    /*M*/ { 10 * GM_MULT, (10 + 2) * GM_MULT, 10 * GM_MULT, 10 * GM_MULT,            0, (10 + 9) * GM_MULT },
+    /*B*/ {  4 * GM_MULT,  (4 + 2) * GM_MULT,  4 * GM_MULT,  4 * GM_MULT,  4 * GM_MULT,                  0 },
+};
+
 /* Calculate optimized encoding modes. Adapted from Project Nayuki */
 /* Copyright (c) Project Nayuki. (MIT License) See qr.c for detailed notice */
 static void define_mode(char *mode, const unsigned int gbdata[], const int length, const int debug) {
-    /* Must be in same order as GM_H etc */
-    static const char mode_types[] = { GM_CHINESE, GM_NUMBER, GM_LOWER, GM_UPPER, GM_MIXED, GM_BYTE, '\0' };
-
-    /* Initial mode costs */
-    static const unsigned int head_costs[GM_NUM_MODES] = {
-    /*  H            N (+pad prefix)    L            U            M            B (+byte count) */
-        4 * GM_MULT, (4 + 2) * GM_MULT, 4 * GM_MULT, 4 * GM_MULT, 4 * GM_MULT, (4 + 9) * GM_MULT
-    };
-
-    /* Cost of switching modes from k to j - see AIMD014 Rev. 1.63 Table 9 – Type conversion codes */
-    static const unsigned int switch_costs[GM_NUM_MODES][GM_NUM_MODES] = {
-        /*      H             N                   L             U             M             B  */
-        /*H*/ {            0, (13 + 2) * GM_MULT, 13 * GM_MULT, 13 * GM_MULT, 13 * GM_MULT, (13 + 9) * GM_MULT },
-        /*N*/ { 10 * GM_MULT,                  0, 10 * GM_MULT, 10 * GM_MULT, 10 * GM_MULT, (10 + 9) * GM_MULT },
-        /*L*/ {  5 * GM_MULT,  (5 + 2) * GM_MULT,            0,  5 * GM_MULT,  7 * GM_MULT,  (7 + 9) * GM_MULT },
-        /*U*/ {  5 * GM_MULT,  (5 + 2) * GM_MULT,  5 * GM_MULT,            0,  7 * GM_MULT,  (7 + 9) * GM_MULT },
-        /*M*/ { 10 * GM_MULT, (10 + 2) * GM_MULT, 10 * GM_MULT, 10 * GM_MULT,            0, (10 + 9) * GM_MULT },
-        /*B*/ {  4 * GM_MULT,  (4 + 2) * GM_MULT,  4 * GM_MULT,  4 * GM_MULT,  4 * GM_MULT,                  0 },
-    };
-
     /* Final end-of-data cost - see AIMD014 Rev. 1.63 Table 9 – Type conversion codes */
     static const unsigned int eod_costs[GM_NUM_MODES] = {
     /*  H             N             L            U            M             B  */
@@ -171,12 +172,12 @@ static void define_mode(char *mode, const unsigned int gbdata[], const int lengt
 #endif
 
     /* char_modes[i * GM_NUM_MODES + j] represents the mode to encode the code point at index i such that the final
-     * segment ends in mode_types[j] and the total number of bits is minimized over all possible choices */
+     * segment ends in gm_mode_types[j] and the total number of bits is minimized over all possible choices */
     memset(char_modes, 0, length * GM_NUM_MODES);
 
     /* At the beginning of each iteration of the loop below, prev_costs[j] is the minimum number of 1/6 (1/XX_MULT)
-     * bits needed to encode the entire string prefix of length i, and end in mode_types[j] */
-    memcpy(prev_costs, head_costs, GM_NUM_MODES * sizeof(unsigned int));
+     * bits needed to encode the entire string prefix of length i, and end in gm_mode_types[j] */
+    memcpy(prev_costs, gm_head_costs, GM_NUM_MODES * sizeof(unsigned int));
 
     /* Calculate costs using dynamic programming */
     for (i = 0, cm_i = 0; i < length; i++, cm_i += GM_NUM_MODES) {
@@ -212,7 +213,7 @@ static void define_mode(char *mode, const unsigned int gbdata[], const int lengt
 
         /* Byte mode can encode anything */
         if (byte_count == 512 || (double_byte && byte_count == 511)) {
-            cur_costs[GM_B] = head_costs[GM_B];
+            cur_costs[GM_B] = gm_head_costs[GM_B];
             if (double_byte && byte_count == 511) {
                 cur_costs[GM_B] += 48; /* 8 * GM_MULT */
                 double_byte = 0; /* Splitting double-byte so mark as single */
@@ -262,10 +263,10 @@ static void define_mode(char *mode, const unsigned int gbdata[], const int lengt
         for (j = 0; j < GM_NUM_MODES; j++) { /* To mode */
             for (k = 0; k < GM_NUM_MODES; k++) { /* From mode */
                 if (j != k && char_modes[cm_i + k]) {
-                    const unsigned int new_cost = cur_costs[k] + switch_costs[k][j];
+                    const unsigned int new_cost = cur_costs[k] + gm_switch_costs[k][j];
                     if (!char_modes[cm_i + j] || new_cost < cur_costs[j]) {
                         cur_costs[j] = new_cost;
-                        char_modes[cm_i + j] = mode_types[k];
+                        char_modes[cm_i + j] = gm_mode_types[k];
                     }
                 }
             }
@@ -276,17 +277,17 @@ static void define_mode(char *mode, const unsigned int gbdata[], const int lengt
 
     /* Find optimal ending mode */
     min_cost = prev_costs[0];
-    cur_mode = mode_types[0];
+    cur_mode = gm_mode_types[0];
     for (i = 1; i < GM_NUM_MODES; i++) {
         if (prev_costs[i] < min_cost) {
             min_cost = prev_costs[i];
-            cur_mode = mode_types[i];
+            cur_mode = gm_mode_types[i];
         }
     }
 
     /* Get optimal mode for each code point by tracing backwards */
     for (i = length - 1, cm_i = i * GM_NUM_MODES; i >= 0; i--, cm_i -= GM_NUM_MODES) {
-        j = posn(mode_types, cur_mode);
+        j = posn(gm_mode_types, cur_mode);
         cur_mode = char_modes[cm_i + j];
         mode[i] = cur_mode;
     }
@@ -296,15 +297,61 @@ static void define_mode(char *mode, const unsigned int gbdata[], const int lengt
     }
 }
 
+/* Calculate encoding modes in a single greedy pass (FAST_MODE) using `fast_define_mode()`. Numeral mode is only
+ * used for digits (not its non-digit or EOL characters) and costed at 3 digits per 10 bits, and Hanzi digit pairs and
+ * EOL are ignored, so each run of characters of the same class costs at most a mode change there and back (2 type
+ * conversion codes plus a prefix) more than `define_mode()` */
+static void define_mode_fast(char *mode, const unsigned int gbdata[], const int length, unsigned int fast_sums[],
+            const int debug) {
+    /* Costs of each class of character in each mode */
+    static const unsigned int char_costs[7 * GM_NUM_MODES] = {
+    /*  H   N   L   U   M   B */
+        78, 20,  0,  0, 36, 48, /* Digit: 13 * GM_MULT, (10 / 3) * GM_MULT, 6 * GM_MULT, 8 * GM_MULT */
+        78,  0, 30, 30, 36, 48, /* Space: 5 * GM_MULT */
+        78,  0, 30,  0, 36, 48, /* Lower case */
+        78,  0,  0, 30, 36, 48, /* Upper case */
+        78,  0, 78, 78, 96, 48, /* Control: (7 + 6) * GM_MULT, (10 + 6) * GM_MULT */
+        78,  0,  0,  0,  0, 48, /* Other byte */
+        78,  0,  0,  0,  0, 96, /* Double-byte: 16 * GM_MULT */
+    };
+    struct fast_modes modes;
+    int i;
+#ifndef _MSC_VER
+    unsigned char classes[length + 1];
+#else
+    unsigned char *classes = (unsigned char *) _alloca(length + 1);
+#endif
+
+    for (i = 0; i < length; i++) {
+        const unsigned int glyph = gbdata[i];
+        classes[i] = glyph > 0xFF ? 6 : glyph >= '0' && glyph <= '9' ? 0 : glyph == ' ' ? 1
+                        : glyph >= 'a' && glyph <= 'z' ? 2 : glyph >= 'A' && glyph <= 'Z' ? 3 : glyph < 0x7F ? 4 : 5;
+    }
+
+    modes.num_modes = GM_NUM_MODES;
+    modes.mode_types = gm_mode_types;
+    modes.head_costs = gm_head_costs;
+    modes.switch_costs = gm_switch_costs[0];
+    modes.char_costs = char_costs;
+    modes.units = NULL;
+    modes.sums = fast_sums;
+
+    fast_define_mode(mode, classes, length, &modes);
+
+    if (debug & ZINT_DEBUG_PRINT) {
+        printf("  Mode: %.*s\n", length, mode);
+    }
+}
+
 /* Add the length indicator for byte encoded blocks */
-static void add_byte_count(char binary[], const int byte_count_posn, const int byte_count) {
+static void add_byte_count(uint64_t binary[], const int byte_count_posn, const int byte_count) {
     /* AIMD014 6.3.7: "Let L be the number of bytes of input data to be encoded in the 8-bit binary data set.
      * First output (L-1) as a 9-bit binary prefix to record the number of bytes..." */
-    bin_append_posn(byte_count - 1, 9, binary, byte_count_posn);
+    bits_append_posn(byte_count - 1, 9, binary, byte_count_posn);
 }
 
 /* Add a control character to the data stream */
-static int add_shift_char(char binary[], int bp, int shifty, int debug) {
+static int add_shift_char(uint64_t binary[], int bp, int shifty, int debug) {
     int i;
     int glyph = 0;
 
@@ -323,13 +370,14 @@ static int add_shift_char(char binary[], int bp, int shifty, int debug) {
         printf("SHIFT [%d] ", glyph);
     }
 
-    bp = bin_append_posn(glyph, 6, binary, bp);
+    bp = bits_append_posn(glyph, 6, binary, bp);
 
     return bp;
 }
 
-static int gm_encode(unsigned int gbdata[], const int length, char binary[], const int reader,
-            const struct zint_structapp *p_structapp, const int eci, int *bin_len, int debug) {
+static int gm_encode(unsigned int gbdata[], const int length, uint64_t binary[], const int reader,
+            const struct zint_structapp *p_structapp, const int eci, unsigned int fast_sums[], int *bin_len,
+            int debug) {
     /* Create a binary stream representation of the input data.
        7 sets are defined - Chinese characters, Numerals, Lower case letters, Upper case letters,
        Mixed numerals and latters, Control characters and 8-bit binary data */
@@ -349,7 +397,6 @@ static int gm_encode(unsigned int gbdata[], const int length, char binary[], con
     char *mode = (char *) _alloca(length);
 #endif
 
-    *binary = '\0';
     bp = 0;
 
     sp = 0;
@@ -357,32 +404,36 @@ static int gm_encode(unsigned int gbdata[], const int length, char binary[], con
     number_pad_posn = 0;
 
     if (reader && (!p_structapp || p_structapp->index == 1)) { /* Appears only in 1st symbol if Structured Append */
-        bp = bin_append_posn(10, 4, binary, bp); /* FNC3 - Reader Initialisation */
+        bp = bits_append_posn(10, 4, binary, bp); /* FNC3 - Reader Initialisation */
     }
 
     if (p_structapp) {
-        bp = bin_append_posn(9, 4, binary, bp); /* FNC2 - Structured Append */
-        bp = bin_append_posn(to_int((const unsigned char *) p_structapp->id, (int) strlen(p_structapp->id)), 8,
+        bp = bits_append_posn(9, 4, binary, bp); /* FNC2 - Structured Append */
+        bp = bits_append_posn(to_int((const unsigned char *) p_structapp->id, (int) strlen(p_structapp->id)), 8,
                 binary, bp); /* File signature */
-        bp = bin_append_posn(p_structapp->count - 1, 4, binary, bp);
-        bp = bin_append_posn(p_structapp->index - 1, 4, binary, bp);
+        bp = bits_append_posn(p_structapp->count - 1, 4, binary, bp);
+        bp = bits_append_posn(p_structapp->index - 1, 4, binary, bp);
     }
 
     if (eci != 0) {
         /* ECI assignment according to Table 8 */
-        bp = bin_append_posn(12, 4, binary, bp); /* ECI */
+        bp = bits_append_posn(12, 4, binary, bp); /* ECI */
         if (eci <= 1023) {
-            bp = bin_append_posn(eci, 11, binary, bp);
+            bp = bits_append_posn(eci, 11, binary, bp);
         } else if (eci <= 32767) {
-            bp = bin_append_posn(2, 2, binary, bp);
-            bp = bin_append_posn(eci, 15, binary, bp);
+            bp = bits_append_posn(2, 2, binary, bp);
+            bp = bits_append_posn(eci, 15, binary, bp);
         } else {
-            bp = bin_append_posn(3, 2, binary, bp);
-            bp = bin_append_posn(eci, 20, binary, bp);
+            bp = bits_append_posn(3, 2, binary, bp);
+            bp = bits_append_posn(eci, 20, binary, bp);
         }
     }
 
-    define_mode(mode, gbdata, length, debug);
+    if (fast_sums) {
+        define_mode_fast(mode, gbdata, length, fast_sums, debug);
+    } else {
+        define_mode(mode, gbdata, length, debug);
+    }
 
     do {
         const int next_mode = mode[sp];
@@ -391,87 +442,79 @@ static int gm_encode(unsigned int gbdata[], const int length, char binary[], con
             switch (current_mode) {
                 case 0:
                     switch (next_mode) {
-                        case GM_CHINESE: bp = bin_append_posn(1, 4, binary, bp);
+                        case GM_CHINESE: bp = bits_append_posn(1, 4, binary, bp);
                             break;
-                        case GM_NUMBER: bp = bin_append_posn(2, 4, binary, bp);
+                        case GM_NUMBER: bp = bits_append_posn(2, 4, binary, bp);
                             break;
-                        case GM_LOWER: bp = bin_append_posn(3, 4, binary, bp);
+                        case GM_LOWER: bp = bits_append_posn(3, 4, binary, bp);
                             break;
-                        case GM_UPPER: bp = bin_append_posn(4, 4, binary, bp);
+                        case GM_UPPER: bp = bits_append_posn(4, 4, binary, bp);
                             break;
-                        case GM_MIXED: bp = bin_append_posn(5, 4, binary, bp);
+                        case GM_MIXED: bp = bits_append_posn(5, 4, binary, bp);
                             break;
-                        case GM_BYTE: bp = bin_append_posn(6, 4, binary, bp);
+                        case GM_BYTE: bp = bits_append_posn(6, 4, binary, bp);
                             break;
                     }
                     break;
                 case GM_CHINESE:
                     switch (next_mode) {
-                        case GM_NUMBER: bp = bin_append_posn(8161, 13, binary, bp);
+                        case GM_NUMBER: bp = bits_append_posn(8161, 13, binary, bp);
                             break;
-                        case GM_LOWER: bp = bin_append_posn(8162, 13, binary, bp);
+                        case GM_LOWER: bp = bits_append_posn(8162, 13, binary, bp);
                             break;
-                        case GM_UPPER: bp = bin_append_posn(8163, 13, binary, bp);
+                        case GM_UPPER: bp = bits_append_posn(8163, 13, binary, bp);
                             break;
-                        case GM_MIXED: bp = bin_append_posn(8164, 13, binary, bp);
+                        case GM_MIXED: bp = bits_append_posn(8164, 13, binary, bp);
                             break;
-                        case GM_BYTE: bp = bin_append_posn(8165, 13, binary, bp);
+                        case GM_BYTE: bp = bits_append_posn(8165, 13, binary, bp);
                             break;
                     }
                     break;
                 case GM_NUMBER:
                     /* add numeric block padding value */
-                    switch (p) {
-                        case 1: binary[number_pad_posn] = '1';
-                            binary[number_pad_posn + 1] = '0';
-                            break; // 2 pad digits
-                        case 2: binary[number_pad_posn] = '0';
-                            binary[number_pad_posn + 1] = '1';
-                            break; // 1 pad digits
-                        case 3: binary[number_pad_posn] = '0';
-                            binary[number_pad_posn + 1] = '0';
-                            break; // 0 pad digits
+                    if (p >= 1 && p <= 3) {
+                        bits_append_posn(3 - p, 2, binary, number_pad_posn); /* 10 = 2 pad digits, 01 = 1, 00 = 0 */
                     }
                     switch (next_mode) {
-                        case GM_CHINESE: bp = bin_append_posn(1019, 10, binary, bp);
+                        case GM_CHINESE: bp = bits_append_posn(1019, 10, binary, bp);
                             break;
-                        case GM_LOWER: bp = bin_append_posn(1020, 10, binary, bp);
+                        case GM_LOWER: bp = bits_append_posn(1020, 10, binary, bp);
                             break;
-                        case GM_UPPER: bp = bin_append_posn(1021, 10, binary, bp);
+                        case GM_UPPER: bp = bits_append_posn(1021, 10, binary, bp);
                             break;
-                        case GM_MIXED: bp = bin_append_posn(1022, 10, binary, bp);
+                        case GM_MIXED: bp = bits_append_posn(1022, 10, binary, bp);
                             break;
-                        case GM_BYTE: bp = bin_append_posn(1023, 10, binary, bp);
+                        case GM_BYTE: bp = bits_append_posn(1023, 10, binary, bp);
                             break;
                     }
                     break;
                 case GM_LOWER:
                 case GM_UPPER:
                     switch (next_mode) {
-                        case GM_CHINESE: bp = bin_append_posn(28, 5, binary, bp);
+                        case GM_CHINESE: bp = bits_append_posn(28, 5, binary, bp);
                             break;
-                        case GM_NUMBER: bp = bin_append_posn(29, 5, binary, bp);
+                        case GM_NUMBER: bp = bits_append_posn(29, 5, binary, bp);
                             break;
                         case GM_LOWER:
-                        case GM_UPPER: bp = bin_append_posn(30, 5, binary, bp);
+                        case GM_UPPER: bp = bits_append_posn(30, 5, binary, bp);
                             break;
-                        case GM_MIXED: bp = bin_append_posn(124, 7, binary, bp);
+                        case GM_MIXED: bp = bits_append_posn(124, 7, binary, bp);
                             break;
-                        case GM_BYTE: bp = bin_append_posn(126, 7, binary, bp);
+                        case GM_BYTE: bp = bits_append_posn(126, 7, binary, bp);
                             break;
                     }
                     break;
                 case GM_MIXED:
                     switch (next_mode) {
-                        case GM_CHINESE: bp = bin_append_posn(1009, 10, binary, bp);
+                        case GM_CHINESE: bp = bits_append_posn(1009, 10, binary, bp);
                             break;
-                        case GM_NUMBER: bp = bin_append_posn(1010, 10, binary, bp);
+                        case GM_NUMBER: bp = bits_append_posn(1010, 10, binary, bp);
                             break;
-                        case GM_LOWER: bp = bin_append_posn(1011, 10, binary, bp);
+                        case GM_LOWER: bp = bits_append_posn(1011, 10, binary, bp);
                             break;
-                        case GM_UPPER: bp = bin_append_posn(1012, 10, binary, bp);
+                        case GM_UPPER: bp = bits_append_posn(1012, 10, binary, bp);
                             break;
-                        case GM_BYTE: bp = bin_append_posn(1015, 10, binary, bp);
+                        case GM_BYTE: bp = bits_append_posn(1015, 10, binary, bp);
                             break;
                     }
                     break;
@@ -480,15 +523,15 @@ static int gm_encode(unsigned int gbdata[], const int length, char binary[], con
                     add_byte_count(binary, byte_count_posn, byte_count);
                     byte_count = 0;
                     switch (next_mode) {
-                        case GM_CHINESE: bp = bin_append_posn(1, 4, binary, bp);
+                        case GM_CHINESE: bp = bits_append_posn(1, 4, binary, bp);
                             break;
-                        case GM_NUMBER: bp = bin_append_posn(2, 4, binary, bp);
+                        case GM_NUMBER: bp = bits_append_posn(2, 4, binary, bp);
                             break;
-                        case GM_LOWER: bp = bin_append_posn(3, 4, binary, bp);
+                        case GM_LOWER: bp = bits_append_posn(3, 4, binary, bp);
                             break;
-                        case GM_UPPER: bp = bin_append_posn(4, 4, binary, bp);
+                        case GM_UPPER: bp = bits_append_posn(4, 4, binary, bp);
                             break;
-                        case GM_MIXED: bp = bin_append_posn(5, 4, binary, bp);
+                        case GM_MIXED: bp = bits_append_posn(5, 4, binary, bp);
                             break;
                     }
                     break;
@@ -558,7 +601,7 @@ static int gm_encode(unsigned int gbdata[], const int length, char binary[], con
                     printf("[%d] ", (int) glyph);
                 }
 
-                bp = bin_append_posn(glyph, 13, binary, bp);
+                bp = bits_append_posn(glyph, 13, binary, bp);
                 sp++;
                 break;
 
@@ -566,7 +609,7 @@ static int gm_encode(unsigned int gbdata[], const int length, char binary[], con
                 if (last_mode != current_mode) {
                     /* Reserve a space for numeric digit padding value (2 bits) */
                     number_pad_posn = bp;
-                    bp = bin_append_posn(0, 2, binary, bp);
+                    bp = bits_append_posn(0, 2, binary, bp);
                 }
                 p = 0;
                 ppos = -1;
@@ -623,7 +666,7 @@ static int gm_encode(unsigned int gbdata[], const int length, char binary[], con
                         printf("[%d] ", (int) glyph);
                     }
 
-                    bp = bin_append_posn(glyph, 10, binary, bp);
+                    bp = bits_append_posn(glyph, 10, binary, bp);
                 }
 
                 glyph = (100 * (numbuf[0] - '0')) + (10 * (numbuf[1] - '0')) + (numbuf[2] - '0');
@@ -631,34 +674,34 @@ static int gm_encode(unsigned int gbdata[], const int length, char binary[], con
                     printf("[%d] ", (int) glyph);
                 }
 
-                bp = bin_append_posn(glyph, 10, binary, bp);
+                bp = bits_append_posn(glyph, 10, binary, bp);
                 break;
 
             case GM_BYTE:
                 if (last_mode != current_mode) {
                     /* Reserve space for byte block length indicator (9 bits) */
                     byte_count_posn = bp;
-                    bp = bin_append_posn(0, 9, binary, bp);
+                    bp = bits_append_posn(0, 9, binary, bp);
                 }
                 glyph = gbdata[sp];
                 if (byte_count == 512 || (glyph > 0xFF && byte_count == 511)) {
                     /* Maximum byte block size is 512 bytes. If longer is needed then start a new block */
                     if (glyph > 0xFF && byte_count == 511) { /* Split double-byte */
-                        bp = bin_append_posn(glyph >> 8, 8, binary, bp);
+                        bp = bits_append_posn(glyph >> 8, 8, binary, bp);
                         glyph &= 0xFF;
                         byte_count++;
                     }
                     add_byte_count(binary, byte_count_posn, byte_count);
-                    bp = bin_append_posn(7, 4, binary, bp);
+                    bp = bits_append_posn(7, 4, binary, bp);
                     byte_count_posn = bp;
-                    bp = bin_append_posn(0, 9, binary, bp);
+                    bp = bits_append_posn(0, 9, binary, bp);
                     byte_count = 0;
                 }
 
                 if (debug & ZINT_DEBUG_PRINT) {
                     printf("[%d] ", (int) glyph);
                 }
-                bp = bin_append_posn(glyph, glyph > 0xFF ? 16 : 8, binary, bp);
+                bp = bits_append_posn(glyph, glyph > 0xFF ? 16 : 8, binary, bp);
                 sp++;
                 byte_count++;
                 if (glyph > 0xFF) {
@@ -685,10 +728,10 @@ static int gm_encode(unsigned int gbdata[], const int length, char binary[], con
                         printf("[%d] ", (int) glyph);
                     }
 
-                    bp = bin_append_posn(glyph, 6, binary, bp);
+                    bp = bits_append_posn(glyph, 6, binary, bp);
                 } else {
                     /* Shift Mode character */
-                    bp = bin_append_posn(1014, 10, binary, bp); /* shift indicator */
+                    bp = bits_append_posn(1014, 10, binary, bp); /* shift indicator */
                     bp = add_shift_char(binary, bp, gbdata[sp], debug);
                 }
 
@@ -710,10 +753,10 @@ static int gm_encode(unsigned int gbdata[], const int length, char binary[], con
                         printf("[%d] ", (int) glyph);
                     }
 
-                    bp = bin_append_posn(glyph, 5, binary, bp);
+                    bp = bits_append_posn(glyph, 5, binary, bp);
                 } else {
                     /* Shift Mode character */
-                    bp = bin_append_posn(125, 7, binary, bp); /* shift indicator */
+                    bp = bits_append_posn(125, 7, binary, bp); /* shift indicator */
                     bp = add_shift_char(binary, bp, gbdata[sp], debug);
                 }
 
@@ -735,10 +778,10 @@ static int gm_encode(unsigned int gbdata[], const int length, char binary[], con
                         printf("[%d] ", (int) glyph);
                     }
 
-                    bp = bin_append_posn(glyph, 5, binary, bp);
+                    bp = bits_append_posn(glyph, 5, binary, bp);
                 } else {
                     /* Shift Mode character */
-                    bp = bin_append_posn(125, 7, binary, bp); /* shift indicator */
+                    bp = bits_append_posn(125, 7, binary, bp); /* shift indicator */
                     bp = add_shift_char(binary, bp, gbdata[sp], debug);
                 }
 
@@ -753,16 +796,8 @@ static int gm_encode(unsigned int gbdata[], const int length, char binary[], con
 
     if (current_mode == GM_NUMBER) {
         /* add numeric block padding value */
-        switch (p) {
-            case 1: binary[number_pad_posn] = '1';
-                binary[number_pad_posn + 1] = '0';
-                break; // 2 pad digits
-            case 2: binary[number_pad_posn] = '0';
-                binary[number_pad_posn + 1] = '1';
-                break; // 1 pad digit
-            case 3: binary[number_pad_posn] = '0';
-                binary[number_pad_posn + 1] = '0';
-                break; // 0 pad digits
+        if (p >= 1 && p <= 3) {
+            bits_append_posn(3 - p, 2, binary, number_pad_posn); /* 10 = 2 pad digits, 01 = 1, 00 = 0 */
         }
     }
 
@@ -773,41 +808,42 @@ static int gm_encode(unsigned int gbdata[], const int length, char binary[], con
 
     /* Add "end of data" character */
     switch (current_mode) {
-        case GM_CHINESE: bp = bin_append_posn(8160, 13, binary, bp);
+        case GM_CHINESE: bp = bits_append_posn(8160, 13, binary, bp);
             break;
-        case GM_NUMBER: bp = bin_append_posn(1018, 10, binary, bp);
+        case GM_NUMBER: bp = bits_append_posn(1018, 10, binary, bp);
             break;
         case GM_LOWER:
-        case GM_UPPER: bp = bin_append_posn(27, 5, binary, bp);
+        case GM_UPPER: bp = bits_append_posn(27, 5, binary, bp);
             break;
-        case GM_MIXED: bp = bin_append_posn(1008, 10, binary, bp);
+        case GM_MIXED: bp = bits_append_posn(1008, 10, binary, bp);
             break;
-        case GM_BYTE: bp = bin_append_posn(0, 4, binary, bp);
+        case GM_BYTE: bp = bits_append_posn(0, 4, binary, bp);
             break;
     }
 
     /* Add padding bits if required */
     p = 7 - (bp % 7);
     if (p % 7) {
-        bp = bin_append_posn(0, p, binary, bp);
+        bp = bits_append_posn(0, p, binary, bp);
     }
 
     if (bp > 9191) {
         return ZINT_ERROR_TOO_LONG;
     }
-    binary[bp] = '\0';
     *bin_len = bp;
 
     if (debug & ZINT_DEBUG_PRINT) {
-        printf("\nBinary (%d): %s\n", bp, binary);
+        printf("\nBinary (%d): ", bp);
+        bits_print(binary, 0, bp);
+        putchar('\n');
     }
 
     return 0;
 }
 
-static void gm_add_ecc(const char binary[], const int data_posn, const int layers, const int ecc_level,
+static void gm_add_ecc(const uint64_t binary[], const int data_posn, const int layers, const int ecc_level,
             unsigned char word[]) {
-    int data_cw, i, j, wp, p;
+    int data_cw, i, j, wp;
     int n1, b1, n2, b2, e1, b3, e2;
     int block_size, ecc_size;
     unsigned char data[1320], block[130];
@@ -822,11 +858,7 @@ static void gm_add_ecc(const char binary[], const int data_posn, const int layer
 
     /* Convert from binary stream to 7-bit codewords */
     for (i = 0; i < data_posn; i++) {
-        for (p = 0; p < 7; p++) {
-            if (binary[i * 7 + p] == '1') {
-                data[i] += (0x40 >> p);
-            }
-        }
+        data[i] = (unsigned char) bits_peek(binary, i * 7, 7);
     }
 
     /* Add padding codewords */
@@ -1015,11 +1047,12 @@ INTERNAL int gridmatrix(struct zint_symbol *symbol, unsigned char source[], int
     int auto_layers, min_layers, layers, auto_ecc_level, min_ecc_level, ecc_level;
     int x, y, i;
     int full_multibyte;
-    char binary[9300];
+    uint64_t binary[BITS_WORDS(9304)];
     int data_cw, input_latch = 0;
     unsigned char word[1460] = {0};
     int data_max, reader = 0;
     const struct zint_structapp *p_structapp = NULL;
+    unsigned int *fast_sums = NULL;
     int size_squared;
     int bin_len;
     const int eci_length = get_eci_length(symbol->eci, source, length);
@@ -1096,7 +1129,14 @@ INTERNAL int gridmatrix(struct zint_symbol *symbol, unsigned char source[], int
         return ZINT_ERROR_INVALID_OPTION;
     }
 
-    error_number = gm_encode(gbdata, length, binary, reader, p_structapp, symbol->eci, &bin_len, symbol->debug);
+    /* FAST_MODE work space */
+    if ((symbol->input_mode & FAST_MODE) && !(fast_sums = (unsigned int *) scratch_alloc(symbol,
+                                                    sizeof(unsigned int) * FAST_SUMS_SIZE(length, GM_NUM_MODES)))) {
+        return ZINT_ERROR_MEMORY;
+    }
+
+    error_number = gm_encode(gbdata, length, binary, reader, p_structapp, symbol->eci, fast_sums, &bin_len,
+                    symbol->debug);
     if (error_number != 0) {
         strcpy(symbol->errtxt, "531: Input data too long");
         return error_number;
@@ -39,6 +39,8 @@
 #endif
 #include "common.h"
 #include "reedsol.h"
+#include "bitgrid.h"
+#include "bitstream.h"
 #include "hanxin.h"
 #include "gb2312.h"
 #include "gb18030.h"
@@ -339,30 +341,30 @@ static int in_fourbyte(const unsigned int gbdata[], const int length, const int
 
 #define HX_NUM_MODES 7
 
+/* Must be in same order as HX_N etc */
+static const char hx_mode_types[] = { 'n', 't', 'b', '1', '2', 'd', 'f', '\0' };
+
+/* Initial mode costs */
+static const unsigned int hx_head_costs[HX_NUM_MODES] = {
+/*  N            T            B                   1            2            D            F */
+    4 * HX_MULT, 4 * HX_MULT, (4 + 13) * HX_MULT, 4 * HX_MULT, 4 * HX_MULT, 4 * HX_MULT, 0
+};
+
+/* Cost of switching modes from k to j */
+static const unsigned int hx_switch_costs[HX_NUM_MODES][HX_NUM_MODES] = {
+    /*      N                   T                   B                        1                   2                   D                   F */
+    /*N*/ {                  0, (10 + 4) * HX_MULT, (10 + 4 + 13) * HX_MULT, (10 + 4) * HX_MULT, (10 + 4) * HX_MULT, (10 + 4) * HX_MULT, 10 * HX_MULT },
+    /*T*/ {  (6 + 4) * HX_MULT,                  0,  (6 + 4 + 13) * HX_MULT,  (6 + 4) * HX_MULT,  (6 + 4) * HX_MULT,  (6 + 4) * HX_MULT,  6 * HX_MULT },
+    /*B*/ {        4 * HX_MULT,        4 * HX_MULT,                       0,        4 * HX_MULT,        4 * HX_MULT,        4 * HX_MULT,  0 },
+    /*1*/ { (12 + 4) * HX_MULT, (12 + 4) * HX_MULT, (12 + 4 + 13) * HX_MULT,                  0,       12 * HX_MULT, (12 + 4) * HX_MULT, 12 * HX_MULT },
+    /*2*/ { (12 + 4) * HX_MULT, (12 + 4) * HX_MULT, (12 + 4 + 13) * HX_MULT,       12 * HX_MULT,                  0, (12 + 4) * HX_MULT, 12 * HX_MULT },
+    /*D*/ { (15 + 4) * HX_MULT, (15 + 4) * HX_MULT, (15 + 4 + 13) * HX_MULT, (15 + 4) * HX_MULT, (15 + 4) * HX_MULT,                  0, 15 * HX_MULT },
+    /*F*/ {        4 * HX_MULT,        4 * HX_MULT,      (4 + 13) * HX_MULT,        4 * HX_MULT,        4 * HX_MULT,        4 * HX_MULT,  0 },
+};
+
 /* Calculate optimized encoding modes. Adapted from Project Nayuki */
 /* Copyright (c) Project Nayuki. (MIT License) See qr.c for detailed notice */
 static void hx_define_mode(char *mode, const unsigned int gbdata[], const int length, const int debug) {
-    /* Must be in same order as HX_N etc */
-    static const char mode_types[] = { 'n', 't', 'b', '1', '2', 'd', 'f', '\0' };
-
-    /* Initial mode costs */
-    static const unsigned int head_costs[HX_NUM_MODES] = {
-    /*  N            T            B                   1            2            D            F */
-        4 * HX_MULT, 4 * HX_MULT, (4 + 13) * HX_MULT, 4 * HX_MULT, 4 * HX_MULT, 4 * HX_MULT, 0
-    };
-
-    /* Cost of switching modes from k to j */
-    static const unsigned int switch_costs[HX_NUM_MODES][HX_NUM_MODES] = {
-        /*      N                   T                   B                        1                   2                   D                   F */
-        /*N*/ {                  0, (10 + 4) * HX_MULT, (10 + 4 + 13) * HX_MULT, (10 + 4) * HX_MULT, (10 + 4) * HX_MULT, (10 + 4) * HX_MULT, 10 * HX_MULT },
-        /*T*/ {  (6 + 4) * HX_MULT,                  0,  (6 + 4 + 13) * HX_MULT,  (6 + 4) * HX_MULT,  (6 + 4) * HX_MULT,  (6 + 4) * HX_MULT,  6 * HX_MULT },
-        /*B*/ {        4 * HX_MULT,        4 * HX_MULT,                       0,        4 * HX_MULT,        4 * HX_MULT,        4 * HX_MULT,  0 },
-        /*1*/ { (12 + 4) * HX_MULT, (12 + 4) * HX_MULT, (12 + 4 + 13) * HX_MULT,                  0,       12 * HX_MULT, (12 + 4) * HX_MULT, 12 * HX_MULT },
-        /*2*/ { (12 + 4) * HX_MULT, (12 + 4) * HX_MULT, (12 + 4 + 13) * HX_MULT,       12 * HX_MULT,                  0, (12 + 4) * HX_MULT, 12 * HX_MULT },
-        /*D*/ { (15 + 4) * HX_MULT, (15 + 4) * HX_MULT, (15 + 4 + 13) * HX_MULT, (15 + 4) * HX_MULT, (15 + 4) * HX_MULT,                  0, 15 * HX_MULT },
-        /*F*/ {        4 * HX_MULT,        4 * HX_MULT,      (4 + 13) * HX_MULT,        4 * HX_MULT,        4 * HX_MULT,        4 * HX_MULT,  0 },
-    };
-
     /* Final end-of-data costs */
     static const unsigned int eod_costs[HX_NUM_MODES] = {
     /*  N             T            B  1             2             D             F */
@@ -384,12 +386,12 @@ static void hx_define_mode(char *mode, const unsigned int gbdata[], const int le
 #endif
 
     /* char_modes[i * HX_NUM_MODES + j] represents the mode to encode the code point at index i such that the final
-     * segment ends in mode_types[j] and the total number of bits is minimized over all possible choices */
+     * segment ends in hx_mode_types[j] and the total number of bits is minimized over all possible choices */
     memset(char_modes, 0, length * HX_NUM_MODES);
 
     /* At the beginning of each iteration of the loop below, prev_costs[j] is the minimum number of 1/6 (1/XX_MULT)
-     * bits needed to encode the entire string prefix of length i, and end in mode_types[j] */
-    memcpy(prev_costs, head_costs, HX_NUM_MODES * sizeof(unsigned int));
+     * bits needed to encode the entire string prefix of length i, and end in hx_mode_types[j] */
+    memcpy(prev_costs, hx_head_costs, HX_NUM_MODES * sizeof(unsigned int));
 
     /* Calculate costs using dynamic programming */
     for (i = 0, cm_i = 0; i < length; i++, cm_i += HX_NUM_MODES) {
@@ -450,10 +452,10 @@ static void hx_define_mode(char *mode, const unsigned int gbdata[], const int le
         for (j = 0; j < HX_NUM_MODES; j++) { /* To mode */
             for (k = 0; k < HX_NUM_MODES; k++) { /* From mode */
                 if (j != k && char_modes[cm_i + k]) {
-                    const unsigned int new_cost = cur_costs[k] + switch_costs[k][j];
+                    const unsigned int new_cost = cur_costs[k] + hx_switch_costs[k][j];
                     if (!char_modes[cm_i + j] || new_cost < cur_costs[j]) {
                         cur_costs[j] = new_cost;
-                        char_modes[cm_i + j] = mode_types[k];
+                        char_modes[cm_i + j] = hx_mode_types[k];
                     }
                 }
             }
@@ -464,17 +466,17 @@ static void hx_define_mode(char *mode, const unsigned int gbdata[], const int le
 
     /* Find optimal ending mode */
     min_cost = prev_costs[0];
-    cur_mode = mode_types[0];
+    cur_mode = hx_mode_types[0];
     for (i = 1; i < HX_NUM_MODES; i++) {
         if (prev_costs[i] < min_cost) {
             min_cost = prev_costs[i];
-            cur_mode = mode_types[i];
+            cur_mode = hx_mode_types[i];
         }
     }
 
     /* Get optimal mode for each code point by tracing backwards */
     for (i = length - 1, cm_i = i * HX_NUM_MODES; i >= 0; i--, cm_i -= HX_NUM_MODES) {
-        j = posn(mode_types, cur_mode);
+        j = posn(hx_mode_types, cur_mode);
         cur_mode = char_modes[cm_i + j];
         mode[i] = cur_mode;
     }
@@ -484,9 +486,85 @@ static void hx_define_mode(char *mode, const unsigned int gbdata[], const int le
     }
 }
 
-/* Convert input data to binary stream */
-static void calculate_binary(char binary[], const char mode[], unsigned int source[], const int length, const int eci,
-            int *bin_len, const int debug) {
+/* FAST_MODE modes are as above but with Text split into its 2 submodes, so that submode changes are costed */
+#define HX_FAST_NUM_MODES 8
+
+static const char hx_fast_mode_types[] = { 'n', 't', 't', 'b', '1', '2', 'd', 'f', '\0' };
+
+static const unsigned int hx_fast_head_costs[HX_FAST_NUM_MODES] = {
+/*  N            T1           T2                 B                   1            2            D            F */
+    4 * HX_MULT, 4 * HX_MULT, (4 + 6) * HX_MULT, (4 + 13) * HX_MULT, 4 * HX_MULT, 4 * HX_MULT, 4 * HX_MULT, 0
+};
+
+static const unsigned int hx_fast_switch_costs[HX_FAST_NUM_MODES][HX_FAST_NUM_MODES] = {
+    /*      N                   T1                  T2                      B                        1                   2                   D                   F */
+    /*N*/ {                  0, (10 + 4) * HX_MULT, (10 + 4 + 6) * HX_MULT, (10 + 4 + 13) * HX_MULT, (10 + 4) * HX_MULT, (10 + 4) * HX_MULT, (10 + 4) * HX_MULT, 10 * HX_MULT },
+    /*T1*/ { (6 + 4) * HX_MULT,                  0,            6 * HX_MULT,  (6 + 4 + 13) * HX_MULT,  (6 + 4) * HX_MULT,  (6 + 4) * HX_MULT,  (6 + 4) * HX_MULT,  6 * HX_MULT },
+    /*T2*/ { (6 + 4) * HX_MULT,        6 * HX_MULT,                      0,  (6 + 4 + 13) * HX_MULT,  (6 + 4) * HX_MULT,  (6 + 4) * HX_MULT,  (6 + 4) * HX_MULT,  6 * HX_MULT },
+    /*B*/ {        4 * HX_MULT,        4 * HX_MULT,      (4 + 6) * HX_MULT,                       0,        4 * HX_MULT,        4 * HX_MULT,        4 * HX_MULT,  0 },
+    /*1*/ { (12 + 4) * HX_MULT, (12 + 4) * HX_MULT, (12 + 4 + 6) * HX_MULT, (12 + 4 + 13) * HX_MULT,                  0,       12 * HX_MULT, (12 + 4) * HX_MULT, 12 * HX_MULT },
+    /*2*/ { (12 + 4) * HX_MULT, (12 + 4) * HX_MULT, (12 + 4 + 6) * HX_MULT, (12 + 4 + 13) * HX_MULT,       12 * HX_MULT,                  0, (12 + 4) * HX_MULT, 12 * HX_MULT },
+    /*D*/ { (15 + 4) * HX_MULT, (15 + 4) * HX_MULT, (15 + 4 + 6) * HX_MULT, (15 + 4 + 13) * HX_MULT, (15 + 4) * HX_MULT, (15 + 4) * HX_MULT,                  0, 15 * HX_MULT },
+    /*F*/ {        4 * HX_MULT,        4 * HX_MULT,      (4 + 6) * HX_MULT,      (4 + 13) * HX_MULT,        4 * HX_MULT,        4 * HX_MULT,        4 * HX_MULT,  0 },
+};
+
+/* Calculate encoding modes in a single greedy pass (FAST_MODE) using `fast_define_mode()`. Numeric is costed at its
+ * best rate (3 digits per 10 bits), so each run of characters of the same class can cost at most a mode change there
+ * and back (including any Text submode change) more than `hx_define_mode()` */
+static void hx_define_mode_fast(char *mode, const unsigned int gbdata[], const int length, unsigned int fast_sums[],
+            const int debug) {
+    /* Costs of each class of character in each mode */
+    static const unsigned int char_costs[9 * HX_FAST_NUM_MODES] = {
+    /*  N  T1  T2   B   1   2   D   F */
+        20, 36,  0, 48,  0,  0,  0,  0, /* Numeric: (10 / 3) * HX_MULT, 6 * HX_MULT, 8 * HX_MULT */
+         0, 36,  0, 48,  0,  0,  0,  0, /* Text 1 */
+         0,  0, 36, 48,  0,  0,  0,  0, /* Text 2 */
+         0,  0,  0, 48,  0,  0,  0,  0, /* Other byte */
+         0,  0,  0, 96, 72,  0, 90,  0, /* Region One: 16 * HX_MULT, 12 * HX_MULT, 15 * HX_MULT */
+         0,  0,  0, 96,  0, 72, 90,  0, /* Region Two */
+         0,  0,  0, 96,  0,  0, 90,  0, /* Other double-byte */
+         0,  0,  0, 96,  0,  0,  0, 75, /* Start of four-byte: ((4 + 21) / 2) * HX_MULT */
+         0,  0,  0, 96,  0,  0,  0,  0, /* Other */
+    };
+    static const char units[HX_FAST_NUM_MODES] = { 1, 1, 1, 1, 1, 1, 1, 2 };
+    struct fast_modes modes;
+    int i;
+#ifndef _MSC_VER
+    unsigned char classes[length + 1];
+#else
+    unsigned char *classes = (unsigned char *) _alloca(length + 1);
+#endif
+
+    for (i = 0; i < length; i++) {
+        const unsigned int glyph = gbdata[i];
+        if (glyph <= 0xFF) {
+            classes[i] = glyph >= '0' && glyph <= '9' ? 0 : lookup_text1(glyph) != -1 ? 1
+                            : lookup_text2(glyph) != -1 ? 2 : 3;
+        } else if (isDoubleByte(glyph)) {
+            classes[i] = isRegion1(glyph) ? 4 : isRegion2(glyph) ? 5 : 6;
+        } else {
+            classes[i] = i + 1 < length && isFourByte(glyph, gbdata[i + 1]) ? 7 : 8;
+        }
+    }
+
+    modes.num_modes = HX_FAST_NUM_MODES;
+    modes.mode_types = hx_fast_mode_types;
+    modes.head_costs = hx_fast_head_costs;
+    modes.switch_costs = hx_fast_switch_costs[0];
+    modes.char_costs = char_costs;
+    modes.units = units;
+    modes.sums = fast_sums;
+
+    fast_define_mode(mode, classes, length, &modes);
+
+    if (debug & ZINT_DEBUG_PRINT) {
+        printf("  Mode: %.*s\n", length, mode);
+    }
+}
+
+/* Convert input data to bitstream (`binary` must be zeroed on entry) */
+static void calculate_binary(uint64_t binary[], const char mode[], unsigned int source[], const int length,
+            const int eci, int *bin_len, const int debug) {
     int position = 0;
     int i, count, encoding_value;
     int first_byte, second_byte;
@@ -497,15 +575,15 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
 
     if (eci != 0) {
         /* Encoding ECI assignment number, according to Table 5 */
-        bp = bin_append_posn(8, 4, binary, bp); // ECI
+        bp = bits_append_posn(8, 4, binary, bp); // ECI
         if (eci <= 127) {
-            bp = bin_append_posn(eci, 8, binary, bp);
+            bp = bits_append_posn(eci, 8, binary, bp);
         } else if (eci <= 16383) {
-            bp = bin_append_posn(2, 2, binary, bp);
-            bp = bin_append_posn(eci, 14, binary, bp);
+            bp = bits_append_posn(2, 2, binary, bp);
+            bp = bits_append_posn(eci, 14, binary, bp);
         } else {
-            bp = bin_append_posn(6, 3, binary, bp);
-            bp = bin_append_posn(eci, 21, binary, bp);
+            bp = bits_append_posn(6, 3, binary, bp);
+            bp = bits_append_posn(eci, 21, binary, bp);
         }
     }
 
@@ -523,7 +601,7 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
             case 'n':
                 /* Numeric mode */
                 /* Mode indicator */
-                bp = bin_append_posn(1, 4, binary, bp);
+                bp = bits_append_posn(1, 4, binary, bp);
 
                 if (debug & ZINT_DEBUG_PRINT) {
                     printf("Numeric\n");
@@ -549,7 +627,7 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
                         }
                     }
 
-                    bp = bin_append_posn(encoding_value, 10, binary, bp);
+                    bp = bits_append_posn(encoding_value, 10, binary, bp);
 
                     if (debug & ZINT_DEBUG_PRINT) {
                         printf("0x%3x (%d)", encoding_value, encoding_value);
@@ -561,13 +639,13 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
                 /* Mode terminator depends on number of characters in last group (Table 2) */
                 switch (count) {
                     case 1:
-                        bp = bin_append_posn(1021, 10, binary, bp);
+                        bp = bits_append_posn(1021, 10, binary, bp);
                         break;
                     case 2:
-                        bp = bin_append_posn(1022, 10, binary, bp);
+                        bp = bits_append_posn(1022, 10, binary, bp);
                         break;
                     case 3:
-                        bp = bin_append_posn(1023, 10, binary, bp);
+                        bp = bits_append_posn(1023, 10, binary, bp);
                         break;
                 }
 
@@ -579,7 +657,7 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
             case 't':
                 /* Text mode */
                 /* Mode indicator */
-                bp = bin_append_posn(2, 4, binary, bp);
+                bp = bits_append_posn(2, 4, binary, bp);
 
                 if (debug & ZINT_DEBUG_PRINT) {
                     printf("Text\n");
@@ -593,7 +671,7 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
 
                     if (getsubmode(source[i + position]) != submode) {
                         /* Change submode */
-                        bp = bin_append_posn(62, 6, binary, bp);
+                        bp = bits_append_posn(62, 6, binary, bp);
                         submode = getsubmode(source[i + position]);
                         if (debug & ZINT_DEBUG_PRINT) {
                             printf("SWITCH ");
@@ -606,7 +684,7 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
                         encoding_value = lookup_text2(source[i + position]);
                     }
 
-                    bp = bin_append_posn(encoding_value, 6, binary, bp);
+                    bp = bits_append_posn(encoding_value, 6, binary, bp);
 
                     if (debug & ZINT_DEBUG_PRINT) {
                         printf("%.2x [ASC %.2x] ", encoding_value, source[i + position]);
@@ -615,7 +693,7 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
                 }
 
                 /* Terminator */
-                bp = bin_append_posn(63, 6, binary, bp);
+                bp = bits_append_posn(63, 6, binary, bp);
 
                 if (debug & ZINT_DEBUG_PRINT) {
                     printf("\n");
@@ -624,10 +702,10 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
             case 'b':
                 /* Binary Mode */
                 /* Mode indicator */
-                bp = bin_append_posn(3, 4, binary, bp);
+                bp = bits_append_posn(3, 4, binary, bp);
 
                 /* Count indicator */
-                bp = bin_append_posn(block_length + double_byte, 13, binary, bp);
+                bp = bits_append_posn(block_length + double_byte, 13, binary, bp);
 
                 if (debug & ZINT_DEBUG_PRINT) {
                     printf("Binary (length %d)\n", block_length + double_byte);
@@ -638,7 +716,7 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
                 while (i < block_length) {
 
                     /* 8-bit bytes with no conversion */
-                    bp = bin_append_posn(source[i + position], source[i + position] > 0xFF ? 16 : 8, binary, bp);
+                    bp = bits_append_posn(source[i + position], source[i + position] > 0xFF ? 16 : 8, binary, bp);
 
                     if (debug & ZINT_DEBUG_PRINT) {
                         printf("%d ", (int) source[i + position]);
@@ -655,7 +733,7 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
                 /* Region 1 encoding */
                 /* Mode indicator */
                 if (position == 0 || mode[position - 1] != '2') { /* Unless previous mode Region 2 */
-                    bp = bin_append_posn(4, 4, binary, bp);
+                    bp = bits_append_posn(4, 4, binary, bp);
                 }
 
                 if (debug & ZINT_DEBUG_PRINT) {
@@ -687,12 +765,12 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
                         printf("%.3x [GB %.4x] ", glyph, source[i + position]);
                     }
 
-                    bp = bin_append_posn(glyph, 12, binary, bp);
+                    bp = bits_append_posn(glyph, 12, binary, bp);
                     i++;
                 }
 
                 /* Terminator */
-                bp = bin_append_posn(position + block_length == length || mode[position + block_length] != '2'
+                bp = bits_append_posn(position + block_length == length || mode[position + block_length] != '2'
                                     ? 4095 : 4094, 12, binary, bp);
 
                 if (debug & ZINT_DEBUG_PRINT) {
@@ -705,7 +783,7 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
                 /* Region 2 encoding */
                 /* Mode indicator */
                 if (position == 0 || mode[position - 1] != '1') { /* Unless previous mode Region 1 */
-                    bp = bin_append_posn(5, 4, binary, bp);
+                    bp = bits_append_posn(5, 4, binary, bp);
                 }
 
                 if (debug & ZINT_DEBUG_PRINT) {
@@ -724,12 +802,12 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
                         printf("%.3x [GB %.4x] ", glyph, source[i + position]);
                     }
 
-                    bp = bin_append_posn(glyph, 12, binary, bp);
+                    bp = bits_append_posn(glyph, 12, binary, bp);
                     i++;
                 }
 
                 /* Terminator */
-                bp = bin_append_posn(position + block_length == length || mode[position + block_length] != '1'
+                bp = bits_append_posn(position + block_length == length || mode[position + block_length] != '1'
                                     ? 4095 : 4094, 12, binary, bp);
 
                 if (debug & ZINT_DEBUG_PRINT) {
@@ -741,7 +819,7 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
             case 'd':
                 /* Double byte encoding */
                 /* Mode indicator */
-                bp = bin_append_posn(6, 4, binary, bp);
+                bp = bits_append_posn(6, 4, binary, bp);
 
                 if (debug & ZINT_DEBUG_PRINT) {
                     printf("Double byte\n");
@@ -763,12 +841,12 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
                         printf("%.4x ", glyph);
                     }
 
-                    bp = bin_append_posn(glyph, 15, binary, bp);
+                    bp = bits_append_posn(glyph, 15, binary, bp);
                     i++;
                 }
 
                 /* Terminator */
-                bp = bin_append_posn(32767, 15, binary, bp);
+                bp = bits_append_posn(32767, 15, binary, bp);
                 /* Terminator sequence of length 12 is a mistake
                    - confirmed by Wang Yi */
 
@@ -787,7 +865,7 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
                 while (i < block_length) {
 
                     /* Mode indicator */
-                    bp = bin_append_posn(7, 4, binary, bp);
+                    bp = bits_append_posn(7, 4, binary, bp);
 
                     first_byte = (source[i + position] & 0xff00) >> 8;
                     second_byte = source[i + position] & 0xff;
@@ -801,7 +879,7 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
                         printf("%d ", glyph);
                     }
 
-                    bp = bin_append_posn(glyph, 21, binary, bp);
+                    bp = bits_append_posn(glyph, 21, binary, bp);
                     i += 2;
                 }
 
@@ -817,9 +895,11 @@ static void calculate_binary(char binary[], const char mode[], unsigned int sour
 
     } while (position < length);
 
-    binary[bp] = '\0';
-
-    if (debug & ZINT_DEBUG_PRINT) printf("Binary (%d): %s\n", bp, binary);
+    if (debug & ZINT_DEBUG_PRINT) {
+        printf("Binary (%d): ", bp);
+        bits_print(binary, 0, bp);
+        putchar('\n');
+    }
 
     *bin_len = bp;
 }
@@ -1112,7 +1192,7 @@ static void hx_add_ecc(unsigned char fullstream[], const unsigned char datastrea
 }
 
 static void hx_set_function_info(unsigned char *grid, const int size, const int version, const int ecc_level,
-            const int bitmask, const int debug) {
+            const int bitmask, const int shift, const int debug) {
     int i, j;
     char function_information[34];
     unsigned char fi_cw[3] = {0};
@@ -1157,23 +1237,23 @@ static void hx_set_function_info(unsigned char *grid, const int size, const int
                 function_information);
     }
 
-    /* Add function information to symbol */
+    /* Add function information to symbol, to bit `shift` of each module (0 for final grid) */
     for (i = 0; i < 9; i++) {
         if (function_information[i] == '1') {
-            grid[(8 * size) + i] = 0x01;
-            grid[((size - 8 - 1) * size) + (size - i - 1)] = 0x01;
+            grid[(8 * size) + i] |= 0x01 << shift;
+            grid[((size - 8 - 1) * size) + (size - i - 1)] |= 0x01 << shift;
         }
         if (function_information[i + 8] == '1') {
-            grid[((8 - i) * size) + 8] = 0x01;
-            grid[((size - 8 - 1 + i) * size) + (size - 8 - 1)] = 0x01;
+            grid[((8 - i) * size) + 8] |= 0x01 << shift;
+            grid[((size - 8 - 1 + i) * size) + (size - 8 - 1)] |= 0x01 << shift;
         }
         if (function_information[i + 17] == '1') {
-            grid[(i * size) + (size - 1 - 8)] = 0x01;
-            grid[((size - 1 - i) * size) + 8] = 0x01;
+            grid[(i * size) + (size - 1 - 8)] |= 0x01 << shift;
+            grid[((size - 1 - i) * size) + 8] |= 0x01 << shift;
         }
         if (function_information[i + 25] == '1') {
-            grid[(8 * size) + (size - 1 - 8 + i)] = 0x01;
-            grid[((size - 1 - 8) * size) + (8 - i)] = 0x01;
+            grid[(8 * size) + (size - 1 - 8 + i)] |= 0x01 << shift;
+            grid[((size - 1 - 8) * size) + (8 - i)] |= 0x01 << shift;
         }
     }
 }
@@ -1192,100 +1272,23 @@ static void make_picket_fence(const unsigned char fullstream[], unsigned char pi
 }
 
 /* Evaluate a bitmask according to table 9 */
-static int hx_evaluate(const unsigned char *local, const int size) {
-    static const unsigned char h1010111[7] = { 1, 0, 1, 0, 1, 1, 1 };
-    static const unsigned char h1110101[7] = { 1, 1, 1, 0, 1, 0, 1 };
-
-    int x, y, r, block;
+static int hx_evaluate(const unsigned char *local, const int size, const int pattern, uint64_t *row_lines,
+            uint64_t *col_lines) {
+    const int line_words = BITGRID_LINE_WORDS(size);
+    int x, y, runs;
     int result = 0;
-    int state;
-    int a, b, afterCount, beforeCount;
 
-    /* Test 1: 1:1:1:1:3 or 3:1:1:1:1 ratio pattern in row/column */
-    /* Vertical */
+    bitgrid_pack(local, size, size, pattern, row_lines, col_lines);
+
+    /* Test 1: 1:1:1:1:3 or 3:1:1:1:1 ratio pattern in row/column, preceded or followed by light area 3 modules
+     * wide */
     for (x = 0; x < size; x++) {
-        for (y = 0; y <= (size - 7); y++) {
-            if (local[y * size + x] && local[(y + 1) * size + x] != local[(y + 5) * size + x] &&
-                    local[(y + 2) * size + x] && !local[(y + 3) * size + x] &&
-                    local[(y + 4) * size + x] && local[(y + 6) * size + x]) {
-                /* Pattern found, check before and after */
-                beforeCount = 0;
-                for (b = (y - 1); b >= (y - 3); b--) {
-                    if (b < 0) { /* Count < edge as whitespace */
-                        beforeCount = 3;
-                        break;
-                    }
-                    if (local[(b * size) + x]) {
-                        break;
-                    }
-                    beforeCount++;
-                }
-                if (beforeCount == 3) {
-                    /* Pattern is preceded by light area 3 modules wide */
-                    result += 50;
-                } else {
-                    afterCount = 0;
-                    for (a = (y + 7); a <= (y + 9); a++) {
-                        if (a >= size) { /* Count > edge as whitespace */
-                            afterCount = 3;
-                            break;
-                        }
-                        if (local[(a * size) + x]) {
-                            break;
-                        }
-                        afterCount++;
-                    }
-                    if (afterCount == 3) {
-                        /* Pattern is followed by light area 3 modules wide */
-                        result += 50;
-                    }
-                }
-                y++; /* Skip to next possible match */
-            }
-        }
+        result += bitgrid_patterns(col_lines + x * line_words, size, 0x57 /*1010111*/, 7, 3) * 50;
+        result += bitgrid_patterns(col_lines + x * line_words, size, 0x75 /*1110101*/, 7, 3) * 50;
     }
-
-    /* Horizontal */
     for (y = 0; y < size; y++) {
-        r = y * size;
-        for (x = 0; x <= (size - 7); x++) {
-            if (memcmp(local + r + x, h1010111, 7) == 0 || memcmp(local + r + x, h1110101, 7) == 0) {
-                /* Pattern found, check before and after */
-                beforeCount = 0;
-                for (b = (x - 1); b >= (x - 3); b--) {
-                    if (b < 0) { /* Count < edge as whitespace */
-                        beforeCount = 3;
-                        break;
-                    }
-                    if (local[r + b]) {
-                        break;
-                    }
-                    beforeCount++;
-                }
-
-                if (beforeCount == 3) {
-                    /* Pattern is preceded by light area 3 modules wide */
-                    result += 50;
-                } else {
-                    afterCount = 0;
-                    for (a = (x + 7); a <= (x + 9); a++) {
-                        if (a >= size) { /* Count > edge as whitespace */
-                            afterCount = 3;
-                            break;
-                        }
-                        if (local[r + a]) {
-                            break;
-                        }
-                        afterCount++;
-                    }
-                    if (afterCount == 3) {
-                        /* Pattern is followed by light area 3 modules wide */
-                        result += 50;
-                    }
-                }
-                x++; /* Skip to next possible match */
-            }
-        }
+        result += bitgrid_patterns(row_lines + y * line_words, size, 0x57 /*1010111*/, 7, 3) * 50;
+        result += bitgrid_patterns(row_lines + y * line_words, size, 0x75 /*1110101*/, 7, 3) * 50;
     }
 
     /* Test 2: Adjacent modules in row/column in same colour */
@@ -1296,45 +1299,12 @@ static int hx_evaluate(const unsigned char *local, const int size) {
     /* Fixed in ISO/IEC 20830 (draft 2019-10-10) section 5.8.3.2 "In Table 12 below, i refers to the modules with
        same color." */
 
-    /* Vertical */
+    /* Penalty is run length * 4 for runs of 3 or more, i.e. ((run length - 2) + 2) * 4 */
     for (x = 0; x < size; x++) {
-        block = 0;
-        state = 0;
-        for (y = 0; y < size; y++) {
-            if (local[(y * size) + x] == state) {
-                block++;
-            } else {
-                if (block >= 3) {
-                    result += block * 4;
-                }
-                block = 1;
-                state = local[(y * size) + x];
-            }
-        }
-        if (block >= 3) {
-            result += block * 4;
-        }
+        result += (bitgrid_runs(col_lines + x * line_words, size, 3, &runs) + runs * 2) * 4;
     }
-
-    /* Horizontal */
     for (y = 0; y < size; y++) {
-        r = y * size;
-        block = 0;
-        state = 0;
-        for (x = 0; x < size; x++) {
-            if (local[r + x] == state) {
-                block++;
-            } else {
-                if (block >= 3) {
-                    result += block * 4;
-                }
-                block = 1;
-                state = local[r + x];
-            }
-        }
-        if (block >= 3) {
-            result += block * 4;
-        }
+        result += (bitgrid_runs(row_lines + y * line_words, size, 3, &runs) + runs * 2) * 4;
     }
 
     return result;
@@ -1351,13 +1321,18 @@ static void hx_apply_bitmask(unsigned char *grid, const int size, const int vers
     int best_pattern;
     int bit;
     const int size_squared = size * size;
+    const int lines_size = BITGRID_LINE_WORDS(size) * size;
 
 #ifndef _MSC_VER
     unsigned char mask[size_squared];
     unsigned char local[size_squared];
+    uint64_t row_lines[lines_size];
+    uint64_t col_lines[lines_size];
 #else
     unsigned char *mask = (unsigned char *) _alloca(size_squared);
     unsigned char *local = (unsigned char *) _alloca(size_squared);
+    uint64_t *row_lines = (uint64_t *) _alloca(lines_size * sizeof(uint64_t));
+    uint64_t *col_lines = (uint64_t *) _alloca(lines_size * sizeof(uint64_t));
 #endif
 
     /* Perform data masking */
@@ -1386,34 +1361,20 @@ static void hx_apply_bitmask(unsigned char *grid, const int size, const int vers
     if (user_mask) {
         best_pattern = user_mask - 1;
     } else {
-        // apply data masks to grid, result in local
-
-        /* Do null pattern 00 separately first */
-        pattern = 0;
+        /* Apply all four data masks at once, each bit of the bytes of local being the masked symbol for that
+           pattern (null pattern 00 in bit 0) */
         for (k = 0; k < size_squared; k++) {
-            local[k] = grid[k] & 0x0f;
+            local[k] = (grid[k] & 0x01 ? 0x0f : 0x00) ^ mask[k];
+        }
+        for (pattern = 0; pattern < 4; pattern++) {
+            /* Set the Structural Info */
+            hx_set_function_info(local, size, version, ecc_level, pattern, pattern /*shift*/, 0 /*debug*/);
         }
-        /* Set the Structural Info */
-        hx_set_function_info(local, size, version, ecc_level, pattern, 0 /*debug*/);
 
         /* Evaluate result */
-        penalty[pattern] = hx_evaluate(local, size);
-
         best_pattern = 0;
-        for (pattern = 1; pattern < 4; pattern++) {
-            bit = 1 << pattern;
-            for (k = 0; k < size_squared; k++) {
-                if (mask[k] & bit) {
-                    local[k] = grid[k] ^ 0x01;
-                } else {
-                    local[k] = grid[k] & 0x0f;
-                }
-            }
-            /* Set the Structural Info */
-            hx_set_function_info(local, size, version, ecc_level, pattern, 0 /*debug*/);
-
-            /* Evaluate result */
-            penalty[pattern] = hx_evaluate(local, size);
+        for (pattern = 0; pattern < 4; pattern++) {
+            penalty[pattern] = hx_evaluate(local, size, pattern, row_lines, col_lines);
             if (penalty[pattern] < penalty[best_pattern]) {
                 best_pattern = pattern;
             }
@@ -1430,19 +1391,15 @@ static void hx_apply_bitmask(unsigned char *grid, const int size, const int vers
 
     /* Apply mask */
     if (best_pattern) { /* If not null mask */
-        if (!user_mask && best_pattern == 3) { /* Reuse last */
-            memcpy(grid, local, size_squared);
-        } else {
-            bit = 1 << best_pattern;
-            for (k = 0; k < size_squared; k++) {
-                if (mask[k] & bit) {
-                    grid[k] ^= 0x01;
-                }
+        bit = 1 << best_pattern;
+        for (k = 0; k < size_squared; k++) {
+            if (mask[k] & bit) {
+                grid[k] ^= 0x01;
             }
         }
     }
     /* Set the Structural Info */
-    hx_set_function_info(grid, size, version, ecc_level, best_pattern, debug);
+    hx_set_function_info(grid, size, version, ecc_level, best_pattern, 0 /*shift*/, debug);
 }
 
 /* Han Xin Code - main */
@@ -1464,7 +1421,7 @@ INTERNAL int hanxin(struct zint_symbol *symbol, unsigned char source[], int leng
 #else
     unsigned int *gbdata = (unsigned int *) _alloca((eci_length + 1) * sizeof(unsigned int));
     char *mode = (char *) _alloca(eci_length);
-    char *binary;
+    uint64_t *binary;
     unsigned char *datastream;
     unsigned char *fullstream;
     unsigned char *picket_fence;
@@ -1501,15 +1458,25 @@ INTERNAL int hanxin(struct zint_symbol *symbol, unsigned char source[], int leng
         }
     }
 
-    hx_define_mode(mode, gbdata, length, symbol->debug);
+    if (symbol->input_mode & FAST_MODE) {
+        unsigned int *fast_sums = (unsigned int *) scratch_alloc(symbol,
+                                                    sizeof(unsigned int) * FAST_SUMS_SIZE(length, HX_FAST_NUM_MODES));
+        if (!fast_sums) {
+            return ZINT_ERROR_MEMORY;
+        }
+        hx_define_mode_fast(mode, gbdata, length, fast_sums, symbol->debug);
+    } else {
+        hx_define_mode(mode, gbdata, length, symbol->debug);
+    }
 
     est_binlen = calculate_binlength(mode, gbdata, length, symbol->eci);
 
 #ifndef _MSC_VER
-    char binary[est_binlen + 1];
+    uint64_t binary[BITS_WORDS(est_binlen)];
 #else
-    binary = (char *) _alloca((est_binlen + 1));
+    binary = (uint64_t *) _alloca(sizeof(uint64_t) * BITS_WORDS(est_binlen));
 #endif
+    memset(binary, 0, sizeof(uint64_t) * BITS_WORDS(est_binlen));
 
     if ((ecc_level <= 0) || (ecc_level >= 5)) {
         ecc_level = 1;
@@ -1607,13 +1574,10 @@ INTERNAL int hanxin(struct zint_symbol *symbol, unsigned char source[], int leng
     grid = (unsigned char *) _alloca(size_squared);
 #endif
 
-    memset(datastream, 0, data_codewords);
-
-    for (i = 0; i < bin_len; i++) {
-        if (binary[i] == '1') {
-            datastream[i >> 3] |= 0x80 >> (i & 0x07);
-        }
+    for (i = 0; i < codewords; i++) {
+        datastream[i] = (unsigned char) bits_peek(binary, i * 8, 8);
     }
+    memset(datastream + codewords, 0, data_codewords - codewords);
 
     if (symbol->debug & ZINT_DEBUG_PRINT) {
         printf("Datastream length: %d\n", data_codewords);
@@ -33,12 +33,12 @@
 #include <assert.h>
 #include <errno.h>
 #include <limits.h>
-#ifdef _MSC_VER
-#include <malloc.h>
-#endif
 #include <stdio.h>
 #include "common.h"
+#include "batch.h"
 #include "eci.h"
+#include "encache.h"
+#include "filemem.h"
 #include "gs1.h"
 #include "zfiletypes.h"
 
@@ -50,7 +50,7 @@ typedef int static_assert_int_at_least_32bits[CHAR_BIT != 8 || sizeof(int) < 4 ?
 struct zint_symbol *ZBarcode_Create(void) {
     struct zint_symbol *symbol;
 
-    symbol = (struct zint_symbol *) calloc(1, sizeof(*symbol));
+    symbol = (struct zint_symbol *) z_calloc(1, sizeof(*symbol));
     if (!symbol) return NULL;
 
     symbol->symbology = BARCODE_CODE128;
@@ -72,6 +72,7 @@ struct zint_symbol *ZBarcode_Create(void) {
     symbol->dot_size = 4.0f / 5.0f;
     symbol->guard_descent = 5.0f;
     symbol->warn_level = WARN_DEFAULT;
+    symbol->bitmap_align = 1;
     symbol->bitmap = NULL;
     symbol->alphamap = NULL;
     symbol->vector = NULL;
@@ -87,8 +88,15 @@ void ZBarcode_Clear(struct zint_symbol *symbol) {
 
     if (!symbol) return;
 
-    for (i = 0; i < symbol->rows; i++) {
-        memset(symbol->encoded_data[i], 0, sizeof(symbol->encoded_data[0]));
+    if (symbol->matrix) {
+        if (symbol->matrix_stride > 0 && symbol->rows > 0) {
+            const int used = symbol->rows * symbol->matrix_stride;
+            memset(symbol->matrix, 0, used < symbol->matrix_size ? used : symbol->matrix_size);
+        }
+    } else {
+        for (i = 0; i < symbol->rows; i++) {
+            memset(symbol->encoded_data[i], 0, sizeof(symbol->encoded_data[0]));
+        }
     }
     symbol->rows = 0;
     symbol->width = 0;
@@ -96,16 +104,22 @@ void ZBarcode_Clear(struct zint_symbol *symbol) {
     memset(symbol->text, 0, sizeof(symbol->text));
     symbol->errtxt[0] = '\0';
     if (symbol->bitmap != NULL) {
-        free(symbol->bitmap);
+        z_free(symbol->bitmap);
         symbol->bitmap = NULL;
     }
     if (symbol->alphamap != NULL) {
-        free(symbol->alphamap);
+        z_free(symbol->alphamap);
         symbol->alphamap = NULL;
     }
     symbol->bitmap_width = 0;
     symbol->bitmap_height = 0;
     symbol->bitmap_byte_length = 0;
+    if (symbol->memfile != NULL) {
+        z_free(symbol->memfile);
+        symbol->memfile = NULL;
+    }
+    symbol->memfile_size = 0;
+    symbol->bitmap_stride = 0;
 
     // If there is a rendered version, ensure its memory is released
     vector_free(symbol);
@@ -116,14 +130,18 @@ void ZBarcode_Delete(struct zint_symbol *symbol) {
     if (!symbol) return;
 
     if (symbol->bitmap != NULL)
-        free(symbol->bitmap);
+        z_free(symbol->bitmap);
     if (symbol->alphamap != NULL)
-        free(symbol->alphamap);
+        z_free(symbol->alphamap);
+    if (symbol->memfile != NULL)
+        z_free(symbol->memfile);
 
     // If there is a rendered version, ensure its memory is released
     vector_free(symbol);
 
-    free(symbol);
+    scratch_free(symbol);
+
+    z_free(symbol);
 }
 
 INTERNAL int eanx(struct zint_symbol *symbol, unsigned char source[], int length); /* EAN system barcodes */
@@ -229,20 +247,16 @@ STATIC_UNLESS_ZINT_TEST int error_tag(struct zint_symbol *symbol, int error_numb
 
 /* Output a hexadecimal representation of the rendered symbol */
 static int dump_plot(struct zint_symbol *symbol) {
-    FILE *f;
+    struct filemem fm;
+    struct filemem *const fmp = &fm;
     int i, r;
     char hex[] = {'0', '1', '2', '3', '4', '5', '6', '7', '8',
         '9', 'A', 'B', 'C', 'D', 'E', 'F'};
     int space = 0;
 
-    if (symbol->output_options & BARCODE_STDOUT) {
-        f = stdout;
-    } else {
-        f = fopen(symbol->outfile, "w");
-        if (!f) {
-            strcpy(symbol->errtxt, "201: Could not open output file");
-            return ZINT_ERROR_FILE_ACCESS;
-        }
+    if (!fm_open(fmp, symbol, "w")) {
+        strcpy(symbol->errtxt, "201: Could not open output file");
+        return ZINT_ERROR_FILE_ACCESS;
     }
 
     for (r = 0; r < symbol->rows; r++) {
@@ -259,28 +273,27 @@ static int dump_plot(struct zint_symbol *symbol) {
                 }
             }
             if (((i + 1) % 4) == 0) {
-                fputc(hex[byt], f);
+                fm_putc(hex[byt], fmp);
                 space++;
                 byt = 0;
             }
             if (space == 2 && i + 1 < symbol->width) {
-                fputc(' ', f);
+                fm_putc(' ', fmp);
                 space = 0;
             }
         }
 
         if ((symbol->width % 4) != 0) {
             byt = byt << (4 - (symbol->width % 4));
-            fputc(hex[byt], f);
+            fm_putc(hex[byt], fmp);
         }
-        fputs("\n", f);
+        fm_putc('\n', fmp);
         space = 0;
     }
 
-    if (symbol->output_options & BARCODE_STDOUT) {
-        fflush(f);
-    } else {
-        fclose(f);
+    if (!fm_close(fmp, symbol)) {
+        sprintf(symbol->errtxt, "219: Failure on closing output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_WRITE;
     }
 
     return 0;
@@ -525,16 +538,12 @@ static int reduced_charset(struct zint_symbol *symbol, unsigned char *source, in
     int error_number = 0;
     unsigned char *preprocessed = source;
 
-    const int eci_length = get_eci_length(symbol->eci, source, length);
-#ifndef _MSC_VER
-    unsigned char preprocessed_buf[eci_length + 1];
-#else
-    unsigned char *preprocessed_buf = (unsigned char *) _alloca(eci_length + 1);
-#endif
-
     if ((symbol->input_mode & 0x07) == UNICODE_MODE && is_eci_convertible(symbol->eci)) {
+        const int eci_length = get_eci_length(symbol->eci, source, length);
         /* Prior check ensures ECI only set for those that support it */
-        preprocessed = preprocessed_buf;
+        if (!(preprocessed = (unsigned char *) scratch_alloc(symbol, eci_length + 1))) {
+            return ZINT_ERROR_MEMORY;
+        }
         error_number = utf8_to_eci(symbol->eci, source, preprocessed, &length);
         if (error_number != 0) {
             if (symbol->eci) {
@@ -569,12 +578,11 @@ STATIC_UNLESS_ZINT_TEST int escape_char_process(struct zint_symbol *symbol, unsi
     int in_posn, out_posn;
     int hex1, hex2;
     int i, unicode;
+    unsigned char *escaped_string;
 
-#ifndef _MSC_VER
-    unsigned char escaped_string[*length + 1];
-#else
-    unsigned char *escaped_string = (unsigned char *) _alloca(*length + 1);
-#endif
+    if (!(escaped_string = (unsigned char *) scratch_alloc(symbol, *length + 1))) {
+        return ZINT_ERROR_MEMORY;
+    }
 
     in_posn = 0;
     out_posn = 0;
@@ -691,14 +699,10 @@ STATIC_UNLESS_ZINT_TEST int escape_char_process(struct zint_symbol *symbol, unsi
     return 0;
 }
 
-/* Encode a barcode. If `length` is 0, `source` must be NUL-terminated. */
-int ZBarcode_Encode(struct zint_symbol *symbol, const unsigned char *source, int length) {
+/* Encode a barcode (uncached) */
+static int encode(struct zint_symbol *symbol, const unsigned char *source, int length) {
     int error_number, warn_number;
-#ifdef _MSC_VER
     unsigned char *local_source;
-#endif
-
-    if (!symbol) return ZINT_ERROR_INVALID_DATA;
 
     if (symbol->debug & ZINT_DEBUG_PRINT) {
         printf("ZBarcode_Encode: symbology: %d, input_mode: 0x%X, ECI: %d, option_1: %d, option_2: %d,"
@@ -871,6 +875,17 @@ int ZBarcode_Encode(struct zint_symbol *symbol, const unsigned char *source, int
         return error_tag(symbol, ZINT_ERROR_TOO_LONG, "770: Too many stacked symbols");
     }
 
+    if (symbol->matrix) {
+        if (symbol->matrix_stride <= 0 || symbol->matrix_size < symbol->matrix_stride) {
+            return error_tag(symbol, ZINT_ERROR_INVALID_OPTION, "771: Invalid matrix size or stride");
+        }
+        /* Zero all but the rows of any symbols stacked on previously */
+        if (symbol->rows * symbol->matrix_stride < symbol->matrix_size) {
+            memset(symbol->matrix + symbol->rows * symbol->matrix_stride, 0,
+                    symbol->matrix_size - symbol->rows * symbol->matrix_stride);
+        }
+    }
+
     if ((symbol->input_mode & 0x07) > 2) {
         symbol->input_mode = DATA_MODE; /* Reset completely TODO: in future, warn/error */
     }
@@ -879,11 +894,13 @@ int ZBarcode_Encode(struct zint_symbol *symbol, const unsigned char *source, int
         return error_tag(symbol, ZINT_ERROR_INVALID_DATA, "245: Invalid UTF-8 in input data");
     }
 
-#ifndef _MSC_VER
-    unsigned char local_source[length + 1];
-#else
-    local_source = (unsigned char *) _alloca(length + 1);
-#endif
+    /* Temporary buffers for this encode come from the symbol's scratch arena (on the heap, unlike VLAs, and after
+       the first few encodes requiring no further heap calls) */
+    scratch_reset(symbol);
+
+    if (!(local_source = (unsigned char *) scratch_alloc(symbol, length + 1))) {
+        return error_tag(symbol, ZINT_ERROR_MEMORY, NULL);
+    }
 
     memcpy(local_source, source, length);
     local_source[length] = '\0';
@@ -905,11 +922,10 @@ int ZBarcode_Encode(struct zint_symbol *symbol, const unsigned char *source, int
             // Reduce input for composite and non-forced symbologies, others (EAN128 and RSS_EXP based) will
             // handle it themselves
             if (is_composite(symbol->symbology) || !check_force_gs1(symbol->symbology)) {
-#ifndef _MSC_VER
-                unsigned char reduced[length + 1];
-#else
-                unsigned char *reduced = (unsigned char *) _alloca(length + 1);
-#endif
+                unsigned char *reduced = (unsigned char *) scratch_alloc(symbol, length + 1);
+                if (!reduced) {
+                    return error_tag(symbol, ZINT_ERROR_MEMORY, NULL);
+                }
                 error_number = gs1_verify(symbol, local_source, length, reduced);
                 if (error_number) {
                     static const char in_2d_comp[] = " in 2D component";
@@ -960,6 +976,43 @@ int ZBarcode_Encode(struct zint_symbol *symbol, const unsigned char *source, int
         if (symbol->height < 0.5f) { /* Absolute minimum */
             (void) set_height(symbol, 0.0f, 50.0f, 0.0f, 1 /*no_errtxt*/);
         }
+        /* Modules outside a caller-owned `matrix` were dropped by the accessors, so fail if any */
+        if (symbol->matrix) {
+            const int row_bytes = symbol->symbology == BARCODE_ULTRA ? symbol->width : (symbol->width + 7) / 8;
+            if (!matrix_row(symbol, symbol->rows - 1, row_bytes - 1)) {
+                sprintf(symbol->errtxt, "772: Matrix buffer too small for symbol (%d rows of %d bytes required)",
+                        symbol->rows, row_bytes);
+                return error_tag(symbol, ZINT_ERROR_INVALID_OPTION, NULL);
+            }
+        }
+    }
+
+    return error_number;
+}
+
+/* Encode a barcode, restoring it from the encode result cache if there. If `length` is 0, `source` must be
+   NUL-terminated. */
+int ZBarcode_Encode(struct zint_symbol *symbol, const unsigned char *source, int length) {
+    struct encache_settings settings;
+    int error_number, cached = -1;
+
+    if (!symbol) return ZINT_ERROR_INVALID_DATA;
+
+    if (source) {
+        if (length <= 0) {
+            length = (int) ustrlen(source);
+        }
+        if (length > 0 && length <= ZINT_MAX_DATA_LEN) {
+            if ((cached = encache_get(symbol, source, length, &settings, &error_number)) == 1) {
+                return error_number;
+            }
+        }
+    }
+
+    error_number = encode(symbol, source, length);
+
+    if (cached == 0) {
+        encache_put(symbol, source, length, &settings, error_number);
     }
 
     return error_number;
@@ -1047,10 +1100,22 @@ int ZBarcode_Print(struct zint_symbol *symbol, int rotate_angle) {
 int ZBarcode_Buffer(struct zint_symbol *symbol, int rotate_angle) {
     int error_number;
 
+    int buffer_options;
+
     if ((error_number = check_output_args(symbol, rotate_angle))) { /* >= ZINT_ERROR only */
         return error_number; /* Already tagged */
     }
 
+    buffer_options = symbol->output_options & (OUT_BUFFER_INTERMEDIATE | OUT_BUFFER_1BPP | OUT_BUFFER_8BPP);
+    if (buffer_options & (buffer_options - 1)) { /* More than one set */
+        return error_tag(symbol, ZINT_ERROR_INVALID_OPTION,
+                        "264: Conflicting buffer output options (more than one of INTERMEDIATE, 1BPP, 8BPP)");
+    }
+    if (symbol->bitmap_align < 0 || symbol->bitmap_align > 64 || (symbol->bitmap_align & (symbol->bitmap_align - 1))) {
+        return error_tag(symbol, ZINT_ERROR_INVALID_OPTION,
+                        "265: Invalid bitmap alignment (powers of 2 from 1 to 64 only)");
+    }
+
     error_number = plot_raster(symbol, rotate_angle, OUT_BUFFER);
     return error_tag(symbol, error_number, NULL);
 }
@@ -1067,6 +1132,28 @@ int ZBarcode_Buffer_Vector(struct zint_symbol *symbol, int rotate_angle) {
     return error_tag(symbol, error_number, NULL);
 }
 
+/* Encode `count` inputs in parallel using up to `threads` threads, passing each encoded symbol to `callback` */
+int ZBarcode_Encode_Batch(struct zint_symbol *symbol, const unsigned char *const sources[], const int lengths[],
+            int count, int threads, zint_batch_callback callback, void *user_data) {
+    int error_number;
+
+    if (!symbol) return ZINT_ERROR_INVALID_DATA;
+    symbol->errtxt[0] = '\0';
+
+    if (count < 0 || (count > 0 && sources == NULL)) {
+        return error_tag(symbol, ZINT_ERROR_INVALID_DATA, "237: Invalid batch sources or count");
+    }
+    if (callback == NULL) {
+        return error_tag(symbol, ZINT_ERROR_INVALID_OPTION, "238: Batch callback NULL");
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    error_number = batch_encode(symbol, sources, lengths, count, threads, callback, user_data);
+    return error_tag(symbol, error_number, NULL);
+}
+
 /* Encode and output a symbol to file `symbol->outfile` */
 int ZBarcode_Encode_and_Print(struct zint_symbol *symbol, const unsigned char *source, int length, int rotate_angle) {
     int error_number;
@@ -1169,7 +1256,7 @@ int ZBarcode_Encode_File(struct zint_symbol *symbol, const char *filename) {
     }
 
     /* Allocate memory */
-    buffer = (unsigned char *) malloc(fileLen);
+    buffer = (unsigned char *) z_malloc(fileLen);
     if (!buffer) {
         if (file_opened) {
             fclose(file);
@@ -1186,7 +1273,7 @@ int ZBarcode_Encode_File(struct zint_symbol *symbol, const char *filename) {
             if (file_opened) {
                 fclose(file);
             }
-            free(buffer);
+            z_free(buffer);
             return error_tag(symbol, ZINT_ERROR_INVALID_DATA, NULL);
         }
         nRead += n;
@@ -1196,7 +1283,7 @@ int ZBarcode_Encode_File(struct zint_symbol *symbol, const char *filename) {
         fclose(file);
     }
     ret = ZBarcode_Encode(symbol, buffer, (int) nRead);
-    free(buffer);
+    z_free(buffer);
     return ret;
 }
 
@@ -1257,6 +1344,39 @@ int ZBarcode_Encode_File_and_Buffer_Vector(struct zint_symbol *symbol, const cha
     return error_number;
 }
 
+/* Set the functions used for all heap memory allocated by Zint (the defaults if all NULL), only possible before Zint
+   has allocated any memory */
+int ZBarcode_SetAllocator(void *(*malloc_func)(size_t size), void *(*realloc_func)(void *ptr, size_t size),
+            void (*free_func)(void *ptr)) {
+
+    if (!malloc_func != !realloc_func || !malloc_func != !free_func) {
+        return ZINT_ERROR_INVALID_OPTION;
+    }
+    if (z_set_allocator(malloc_func, realloc_func, free_func)) {
+        return ZINT_ERROR_INVALID_OPTION;
+    }
+
+    return 0;
+}
+
+/* Set the maximum number of entries of the encode result cache (0 to disable), clearing it */
+int ZBarcode_SetCacheSize(int max_entries) {
+
+    if (max_entries < 0 || max_entries > ZINT_CACHE_MAX_ENTRIES) {
+        return ZINT_ERROR_INVALID_OPTION;
+    }
+
+    return encache_set_size(max_entries);
+}
+
+/* Get the encode result cache statistics */
+void ZBarcode_CacheStats(struct zint_cache_stats *stats) {
+
+    if (!stats) return;
+
+    encache_stats(stats);
+}
+
 /* Checks whether a symbology is supported */
 int ZBarcode_ValidID(int symbol_id) {
 
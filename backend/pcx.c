@@ -35,6 +35,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include "common.h"
+#include "filemem.h"
 #include "pcx.h"        /* PCX header structure */
 #include <math.h>
 #ifdef _MSC_VER
@@ -47,7 +48,8 @@ INTERNAL int pcx_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     int fgred, fggrn, fgblu, bgred, bggrn, bgblu;
     int row, column, i, colour;
     int run_count;
-    FILE *pcx_file;
+    struct filemem fm;
+    struct filemem *const fmp = &fm;
     pcx_header_t header;
     int bytes_per_line = symbol->bitmap_width + (symbol->bitmap_width & 1); // Must be even
     unsigned char previous;
@@ -107,15 +109,13 @@ INTERNAL int pcx_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
             return ZINT_ERROR_FILE_ACCESS;
         }
 #endif
-        pcx_file = stdout;
-    } else {
-        if (!(pcx_file = fopen(symbol->outfile, "wb"))) {
-            sprintf(symbol->errtxt, "621: Could not open output file (%d: %.30s)", errno, strerror(errno));
-            return ZINT_ERROR_FILE_ACCESS;
-        }
+    }
+    if (!fm_open(fmp, symbol, "wb")) {
+        sprintf(symbol->errtxt, "621: Could not open output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_ACCESS;
     }
 
-    fwrite(&header, sizeof(pcx_header_t), 1, pcx_file);
+    fm_write(&header, sizeof(pcx_header_t), 1, fmp);
 
     for (row = 0; row < symbol->bitmap_height; row++) {
         for (colour = 0; colour < 3; colour++) {
@@ -200,9 +200,9 @@ INTERNAL int pcx_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
                 } else {
                     if (run_count > 1 || (previous & 0xc0) == 0xc0) {
                         run_count += 0xc0;
-                        fputc(run_count, pcx_file);
+                        fm_putc(run_count, fmp);
                     }
-                    fputc(previous, pcx_file);
+                    fm_putc(previous, fmp);
                     previous = rle_row[column];
                     run_count = 1;
                 }
@@ -210,16 +210,15 @@ INTERNAL int pcx_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
 
             if (run_count > 1 || (previous & 0xc0) == 0xc0) {
                 run_count += 0xc0;
-                fputc(run_count, pcx_file);
+                fm_putc(run_count, fmp);
             }
-            fputc(previous, pcx_file);
+            fm_putc(previous, fmp);
         }
     }
 
-    if (output_to_stdout) {
-        fflush(pcx_file);
-    } else {
-        fclose(pcx_file);
+    if (!fm_close(fmp, symbol)) {
+        sprintf(symbol->errtxt, "622: Failure on closing output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_WRITE;
     }
 
     return 0;
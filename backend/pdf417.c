@@ -228,6 +228,80 @@ static void pdf_smooth(int liste[2][PDF_MAX_LEN], int *indexliste) {
     pdf_regroupe(liste, indexliste);
 }
 
+/* FAST_MODE: split into blocks and smooth them in a single pass, merging each run into the block before it as it
+   goes rather than with `pdf_regroupe()`. Uses the same length thresholds as `pdf_smooth()` but judges each run
+   against the unsmoothed run following it, so a block can cost at most a latch and return (2 codewords) more */
+static int pdf_fast_blocks(int liste[2][PDF_MAX_LEN], const unsigned char chaine[], const int length) {
+    int indexliste = 0;
+    int i = 0;
+    int mode = pdf_quelmode(chaine[0]);
+
+    while (i < length) {
+        const int start = i;
+        int crnt = mode, last, next, run;
+
+        do {
+            i++;
+        } while (i < length && (mode = pdf_quelmode(chaine[i])) == crnt);
+
+        run = i - start;
+        last = indexliste ? liste[1][indexliste - 1] : FALSE;
+        next = i < length ? mode : FALSE;
+
+        if (crnt == NUM) {
+            if (last == FALSE) {
+                /* first block, and there are others */
+                if ((next == TEX) && (run < 8)) {
+                    crnt = TEX;
+                } else if ((next == BYT) && (run == 1)) {
+                    crnt = BYT;
+                }
+            } else if (next == FALSE) {
+                /* last block */
+                if ((last == TEX) && (run < 7)) {
+                    crnt = TEX;
+                } else if ((last == BYT) && (run == 1)) {
+                    crnt = BYT;
+                }
+            } else {
+                /* not first or last block */
+                if (((last == BYT) && (next == BYT)) && (run < 4)) {
+                    crnt = BYT;
+                } else if (((last == BYT) && (next == TEX)) && (run < 4)) {
+                    crnt = TEX;
+                } else if (((last == TEX) && (next == BYT)) && (run < 5)) {
+                    crnt = TEX;
+                } else if (((last == TEX) && (next == TEX)) && (run < 8)) {
+                    crnt = TEX;
+                }
+            }
+        } else if ((crnt == TEX) && (last != FALSE)) {
+            if (next == FALSE) {
+                /* the last one */
+                if ((last == BYT) && (run == 1)) {
+                    crnt = BYT;
+                }
+            } else {
+                /* not the last one */
+                if (((last == BYT) && (next == BYT)) && (run < 5)) {
+                    crnt = BYT;
+                } else if (((last == BYT) != (next == BYT)) && (run < 3)) {
+                    crnt = BYT;
+                }
+            }
+        }
+
+        if (crnt == last) {
+            liste[0][indexliste - 1] += run;
+        } else {
+            liste[0][indexliste] = run;
+            liste[1][indexliste++] = crnt;
+        }
+    }
+
+    return indexliste;
+}
+
 /* 547 */
 static void pdf_textprocess(int *chainemc, int *mclength, const unsigned char chaine[], int start, const int length,
             const int is_micro) {
@@ -468,25 +542,29 @@ static int pdf_initial(struct zint_symbol *symbol, unsigned char chaine[], const
     int mclength, structapp_cp = 0;
     const int debug_print = symbol->debug & ZINT_DEBUG_PRINT;
 
-    /* 456 */
-    indexliste = 0;
-    indexchaine = 0;
+    if (symbol->input_mode & FAST_MODE) {
+        indexliste = pdf_fast_blocks(liste, chaine, length);
+    } else {
+        /* 456 */
+        indexliste = 0;
+        indexchaine = 0;
 
-    mode = pdf_quelmode(chaine[indexchaine]);
+        mode = pdf_quelmode(chaine[indexchaine]);
 
-    /* 463 */
-    do {
-        liste[1][indexliste] = mode;
-        while ((liste[1][indexliste] == mode) && (indexchaine < length)) {
-            liste[0][indexliste]++;
-            indexchaine++;
-            mode = pdf_quelmode(chaine[indexchaine]);
-        }
-        indexliste++;
-    } while (indexchaine < length);
+        /* 463 */
+        do {
+            liste[1][indexliste] = mode;
+            while ((liste[1][indexliste] == mode) && (indexchaine < length)) {
+                liste[0][indexliste]++;
+                indexchaine++;
+                mode = pdf_quelmode(chaine[indexchaine]);
+            }
+            indexliste++;
+        } while (indexchaine < length);
 
-    /* 474 */
-    pdf_smooth(liste, &indexliste);
+        /* 474 */
+        pdf_smooth(liste, &indexliste);
+    }
 
     if (debug_print) {
         printf("Initial block pattern:\n");
@@ -603,10 +681,42 @@ static int pdf_initial(struct zint_symbol *symbol, unsigned char chaine[], const
     return 0;
 }
 
+/* Reed-Solomon error correction over GF(929), shared by PDF417, MicroPDF417 and CC-A/B/C. Sets `ecc` to the `k`
+   check codewords (k <= 512) of `data` in symbol order, using generator polynomial coefficients `coeffs`.
+   The remainder is held negated and unreduced: a register gains one product (< 929 * 929) per data codeword and
+   shifts out after `k` of them, so stays below 2^32, leaving the feedback term as the only reduction per codeword */
+INTERNAL void pdf_rs_code(const int data[], const int length, const unsigned short coeffs[], const int k,
+                int ecc[]) {
+    unsigned int regs[2][512];
+    unsigned int *reg = regs[0];
+    unsigned int *next = regs[1];
+    int i, j;
+
+    assert(k >= 1 && k <= 512);
+
+    memset(reg, 0, sizeof(unsigned int) * k);
+
+    for (i = 0; i < length; i++) {
+        const unsigned int total = (data[i] + 929 - reg[k - 1] % 929) % 929;
+        unsigned int *tmp;
+        next[0] = total * coeffs[0];
+        for (j = 1; j < k; j++) {
+            next[j] = reg[j - 1] + total * coeffs[j];
+        }
+        tmp = reg;
+        reg = next;
+        next = tmp;
+    }
+
+    for (i = 0; i < k; i++) {
+        ecc[i] = (int) (reg[k - 1 - i] % 929);
+    }
+}
+
 /* 366 */
 static int pdf_enc(struct zint_symbol *symbol, unsigned char chaine[], const int length) {
-    int i, j, longueur, loop, mccorrection[520] = {0}, offset;
-    int total, chainemc[PDF_MAX_LEN], mclength, c1, c2, c3, dummy[35];
+    int i, j, longueur, loop, offset;
+    int chainemc[PDF_MAX_LEN], mclength, c1, c2, c3, dummy[35];
     int rows, cols, ecc, ecc_cws, padding;
     char pattern[580];
     int bp = 0;
@@ -763,18 +873,9 @@ static int pdf_enc(struct zint_symbol *symbol, unsigned char chaine[], const int
             break;
     }
 
-    for (i = 0; i < mclength; i++) {
-        total = (chainemc[i] + mccorrection[ecc_cws - 1]) % 929;
-        for (j = ecc_cws - 1; j > 0; j--) {
-            mccorrection[j] = (mccorrection[j - 1] + 929 - (total * pdf_coefrs[offset + j]) % 929) % 929;
-        }
-        mccorrection[0] = (929 - (total * pdf_coefrs[offset]) % 929) % 929;
-    }
-
     /* we add these codes to the string */
-    for (i = ecc_cws - 1; i >= 0; i--) {
-        chainemc[mclength++] = mccorrection[i] ? 929 - mccorrection[i] : 0;
-    }
+    pdf_rs_code(chainemc, mclength, pdf_coefrs + offset, ecc_cws, chainemc + mclength);
+    mclength += ecc_cws;
 
     if (debug_print) {
         printf("Complete CW string (%d):\n", mclength);
@@ -900,8 +1001,8 @@ INTERNAL int pdf417(struct zint_symbol *symbol, unsigned char source[], int leng
 
 /* like PDF417 only much smaller! */
 INTERNAL int micropdf417(struct zint_symbol *symbol, unsigned char chaine[], int length) {
-    int i, k, j, longueur, mccorrection[50] = {0}, offset;
-    int total, chainemc[PDF_MAX_LEN], mclength, error_number = 0;
+    int i, k, longueur, offset;
+    int chainemc[PDF_MAX_LEN], mclength, error_number = 0;
     char pattern[580];
     int bp = 0;
     int structapp_cws[18] = {0}; /* 3 (Index) + 10 (ID) + 4 (Count) + 1 (Last) */
@@ -1107,27 +1208,9 @@ INTERNAL int micropdf417(struct zint_symbol *symbol, unsigned char chaine[], int
     }
 
     /* Reed-Solomon error correction */
-    longueur = mclength;
-    for (i = 0; i < longueur; i++) {
-        total = (chainemc[i] + mccorrection[k - 1]) % 929;
-        for (j = k - 1; j >= 0; j--) {
-            if (j == 0) {
-                mccorrection[j] = (929 - (total * pdf_Microcoeffs[offset + j]) % 929) % 929;
-            } else {
-                mccorrection[j] = (mccorrection[j - 1] + 929 - (total * pdf_Microcoeffs[offset + j]) % 929) % 929;
-            }
-        }
-    }
-
-    for (j = 0; j < k; j++) {
-        if (mccorrection[j] != 0) {
-            mccorrection[j] = 929 - mccorrection[j];
-        }
-    }
     /* we add these codes to the string */
-    for (i = k - 1; i >= 0; i--) {
-        chainemc[mclength++] = mccorrection[i];
-    }
+    pdf_rs_code(chainemc, mclength, pdf_Microcoeffs + offset, k, chainemc + mclength);
+    mclength += k;
 
     if (debug_print) {
         printf("Encoded Data Stream with ECC (%d):\n", mclength);
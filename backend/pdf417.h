@@ -60,4 +60,7 @@ INTERNAL_DATA_EXTERN const unsigned short pdf_rap_centre[52];
 INTERNAL void pdf_byteprocess(int *chainemc, int *mclength, const unsigned char chaine[], int start, const int length,
                 const int debug);
 
+INTERNAL void pdf_rs_code(const int data[], const int length, const unsigned short coeffs[], const int k,
+                int ecc[]);
+
 #endif /* __PDF417_H */
@@ -41,6 +41,7 @@
 #include <malloc.h>
 #endif
 #include "common.h"
+#include "filemem.h"
 
 #include <png.h>
 #include <zlib.h>
@@ -67,6 +68,17 @@ STATIC_UNLESS_ZINT_TEST void wpng_error_handler(png_structp png_ptr, png_const_c
     longjmp(wpng_error_ptr->jmpbuf, 1);
 }
 
+/* libpng write callback, writing to file or memory via `filemem` */
+static void wpng_write(png_structp png_ptr, png_bytep ptr, png_size_t size) {
+    struct filemem *fmp = (struct filemem *) png_get_io_ptr(png_ptr);
+    (void) fm_write(ptr, 1, size, fmp);
+}
+
+/* libpng flush callback (no-op, flushing done on close) */
+static void wpng_flush(png_structp png_ptr) {
+    (void) png_ptr;
+}
+
 /* Guestimate best compression strategy */
 static int guess_compression_strategy(struct zint_symbol *symbol, unsigned char *pixelbuf) {
     (void)pixelbuf;
@@ -89,7 +101,8 @@ static int guess_compression_strategy(struct zint_symbol *symbol, unsigned char
 
 INTERNAL int png_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf) {
     struct wpng_error_type wpng_error;
-    FILE *outfile;
+    struct filemem fm;
+    struct filemem *const fmp = &fm;
     png_structp png_ptr;
     png_infop info_ptr;
     int i;
@@ -232,21 +245,17 @@ INTERNAL int png_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
             return ZINT_ERROR_FILE_ACCESS;
         }
 #endif
-        outfile = stdout;
-    } else {
-        if (!(outfile = fopen(symbol->outfile, "wb"))) {
-            sprintf(symbol->errtxt, "632: Could not open output file (%d: %.30s)", errno, strerror(errno));
-            return ZINT_ERROR_FILE_ACCESS;
-        }
+    }
+    if (!fm_open(fmp, symbol, "wb")) {
+        sprintf(symbol->errtxt, "632: Could not open output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_ACCESS;
     }
 
     /* Set up error handling routine as proc() above */
     png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, &wpng_error, wpng_error_handler, NULL);
     if (!png_ptr) {
         strcpy(symbol->errtxt, "633: Insufficient memory for PNG write structure buffer");
-        if (!output_to_stdout) {
-            fclose(outfile);
-        }
+        (void) fm_close(fmp, symbol);
         return ZINT_ERROR_MEMORY;
     }
 
@@ -254,23 +263,19 @@ INTERNAL int png_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     if (!info_ptr) {
         png_destroy_write_struct(&png_ptr, NULL);
         strcpy(symbol->errtxt, "634: Insufficient memory for PNG info structure buffer");
-        if (!output_to_stdout) {
-            fclose(outfile);
-        }
+        (void) fm_close(fmp, symbol);
         return ZINT_ERROR_MEMORY;
     }
 
     /* catch jumping here */
     if (setjmp(wpng_error.jmpbuf)) {
         png_destroy_write_struct(&png_ptr, &info_ptr);
-        if (!output_to_stdout) {
-            fclose(outfile);
-        }
+        (void) fm_close(fmp, symbol);
         return ZINT_ERROR_MEMORY;
     }
 
-    /* open output file with libpng */
-    png_init_io(png_ptr, outfile);
+    /* Set our output functions */
+    png_set_write_fn(png_ptr, fmp, wpng_write, wpng_flush);
 
     /* set compression */
     png_set_compression_level(png_ptr, 9);
@@ -338,10 +343,9 @@ INTERNAL int png_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     /* make sure we have disengaged */
     png_destroy_write_struct(&png_ptr, &info_ptr);
 
-    if (output_to_stdout) {
-        fflush(outfile);
-    } else {
-        fclose(outfile);
+    if (!fm_close(fmp, symbol)) {
+        sprintf(symbol->errtxt, "638: Failure on closing output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_WRITE;
     }
 
     return 0;
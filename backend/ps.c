@@ -32,13 +32,13 @@
 /* vim: set ts=4 sw=4 et : */
 
 #include <errno.h>
-#include <locale.h>
 #include <stdio.h>
 #include <math.h>
 #ifdef _MSC_VER
 #include <malloc.h>
 #endif
 #include "common.h"
+#include "filemem.h"
 
 static void colour_to_pscolor(int option, int colour, char *output) {
     *output = '\0';
@@ -132,8 +132,70 @@ STATIC_UNLESS_ZINT_TEST void ps_convert(const unsigned char *string, unsigned ch
     *p = '\0';
 }
 
+/* Output RGB colour setting */
+static void ps_put_rgbcolor(const float red, const float green, const float blue, struct fm_textbuf *const tbp) {
+    fm_tb_putsf(tbp, "", 2, red);
+    fm_tb_putsf(tbp, " ", 2, green);
+    fm_tb_putsf(tbp, " ", 2, blue);
+    fm_tb_puts(tbp, " setrgbcolor\n");
+}
+
+/* Output CMYK colour setting */
+static void ps_put_cmykcolor(const float cyan, const float magenta, const float yellow, const float black,
+            struct fm_textbuf *const tbp) {
+    fm_tb_putsf(tbp, "", 2, cyan);
+    fm_tb_putsf(tbp, " ", 2, magenta);
+    fm_tb_putsf(tbp, " ", 2, yellow);
+    fm_tb_putsf(tbp, " ", 2, black);
+    fm_tb_puts(tbp, " setcmykcolor\n");
+}
+
+/* Output rectangle, flipping `y` */
+static void ps_put_rect(const struct zint_symbol *symbol, const struct zint_vector_rect *rect,
+            struct fm_textbuf *const tbp) {
+    fm_tb_putsf(tbp, "", 2, rect->height);
+    fm_tb_putsf(tbp, " ", 2, (symbol->vector->height - rect->y) - rect->height);
+    fm_tb_putsf(tbp, " TB ", 2, rect->x);
+    fm_tb_putsf(tbp, " ", 2, rect->width);
+    fm_tb_puts(tbp, " TR\nTE\n");
+}
+
+/* Output circle (ring if has width, else disc), flipping `y` */
+static void ps_put_circle(const struct zint_symbol *symbol, const struct zint_vector_circle *circle,
+            const float radius, struct fm_textbuf *const tbp) {
+    if (circle->width) {
+        fm_tb_putsf(tbp, "", 2, circle->x);
+        fm_tb_putsf(tbp, " ", 2, symbol->vector->height - circle->y);
+        fm_tb_putsf(tbp, " ", 3, radius);
+        fm_tb_putsf(tbp, " ", 3, circle->width);
+        fm_tb_puts(tbp, " TC\n");
+    } else {
+        fm_tb_putsf(tbp, "", 2, circle->x);
+        fm_tb_putsf(tbp, " ", 2, symbol->vector->height - circle->y);
+        fm_tb_putsf(tbp, " ", 2, radius);
+        fm_tb_puts(tbp, " TD\n");
+    }
+}
+
+/* Estimated output size, for pre-sizing the text buffer (it will grow if exceeded) */
+static size_t ps_size_estimate(const struct zint_vector *vector, const int ps_len) {
+    /* Co-ordinates within the symbol, so max digits for sign + integer part + point + 2 decimals, plus separator */
+    const float extent = vector->width > vector->height ? vector->width : vector->height;
+    size_t num_len = 5;
+    float f;
+
+    for (f = 10.0f; f <= extent; f *= 10.0f) {
+        num_len++;
+    }
+    return 1024 + vector->rectangle_count * (4 * num_len + 12) + vector->hexagon_count * (12 * num_len + 4)
+            + vector->circle_count * (4 * num_len + 72) + vector->string_count * (3 * num_len + 220 + 2 * ps_len);
+}
+
 INTERNAL int ps_plot(struct zint_symbol *symbol) {
-    FILE *feps;
+    struct filemem fm;
+    struct filemem *const fmp = &fm;
+    struct fm_textbuf tb;
+    struct fm_textbuf *const tbp = &tb;
     int fgred, fggrn, fgblu, bgred, bggrn, bgblu;
     float red_ink, green_ink, blue_ink, red_paper, green_paper, blue_paper;
     float cyan_ink, magenta_ink, yellow_ink, black_ink;
@@ -149,13 +211,11 @@ INTERNAL int ps_plot(struct zint_symbol *symbol) {
     struct zint_vector_hexagon *hex;
     struct zint_vector_circle *circle;
     struct zint_vector_string *string;
-    const char *locale = NULL;
     const char *font;
     int i, len;
     int ps_len = 0;
     int iso_latin1 = 0;
     int have_circles_with_width = 0, have_circles_without_width = 0;
-    const int output_to_stdout = symbol->output_options & BARCODE_STDOUT;
 #ifdef _MSC_VER
     unsigned char *ps_string;
 #endif
@@ -171,17 +231,6 @@ INTERNAL int ps_plot(struct zint_symbol *symbol) {
         }
     }
 
-    if (output_to_stdout) {
-        feps = stdout;
-    } else {
-        if (!(feps = fopen(symbol->outfile, "w"))) {
-            sprintf(symbol->errtxt, "645: Could not open output file (%d: %.30s)", errno, strerror(errno));
-            return ZINT_ERROR_FILE_ACCESS;
-        }
-    }
-
-    locale = setlocale(LC_ALL, "C");
-
     fgred = (16 * ctoi(symbol->fgcolour[0])) + ctoi(symbol->fgcolour[1]);
     fggrn = (16 * ctoi(symbol->fgcolour[2])) + ctoi(symbol->fgcolour[3]);
     fgblu = (16 * ctoi(symbol->fgcolour[4])) + ctoi(symbol->fgcolour[5]);
@@ -273,59 +322,68 @@ INTERNAL int ps_plot(struct zint_symbol *symbol) {
         }
     }
 
+    /* Format everything into one buffer, then write it in one go */
+    if (!fm_tb_init(tbp, ps_size_estimate(symbol->vector, ps_len))) {
+        strcpy(symbol->errtxt, "648: Insufficient memory for EPS output buffer");
+        return ZINT_ERROR_MEMORY;
+    }
+
     /* Start writing the header */
-    fprintf(feps, "%%!PS-Adobe-3.0 EPSF-3.0\n");
+    fm_tb_puts(tbp, "%!PS-Adobe-3.0 EPSF-3.0\n");
+    fm_tb_putsf(tbp, "%%Creator: Zint ", 0, ZINT_VERSION_MAJOR);
+    fm_tb_putsf(tbp, ".", 0, ZINT_VERSION_MINOR);
+    fm_tb_putsf(tbp, ".", 0, ZINT_VERSION_RELEASE);
     if (ZINT_VERSION_BUILD) {
-        fprintf(feps, "%%%%Creator: Zint %d.%d.%d.%d\n",
-                ZINT_VERSION_MAJOR, ZINT_VERSION_MINOR, ZINT_VERSION_RELEASE, ZINT_VERSION_BUILD);
-    } else {
-        fprintf(feps, "%%%%Creator: Zint %d.%d.%d\n", ZINT_VERSION_MAJOR, ZINT_VERSION_MINOR, ZINT_VERSION_RELEASE);
+        fm_tb_putsf(tbp, ".", 0, ZINT_VERSION_BUILD);
     }
-    fprintf(feps, "%%%%Title: Zint Generated Symbol\n");
-    fprintf(feps, "%%%%Pages: 0\n");
-    fprintf(feps, "%%%%BoundingBox: 0 0 %d %d\n",
-            (int) ceilf(symbol->vector->width), (int) ceilf(symbol->vector->height));
-    fprintf(feps, "%%%%EndComments\n");
+    fm_tb_puts(tbp, "\n");
+    fm_tb_puts(tbp, "%%Title: Zint Generated Symbol\n");
+    fm_tb_puts(tbp, "%%Pages: 0\n");
+    fm_tb_putsf(tbp, "%%BoundingBox: 0 0 ", 0, ceilf(symbol->vector->width));
+    fm_tb_putsf(tbp, " ", 0, ceilf(symbol->vector->height));
+    fm_tb_puts(tbp, "\n");
+    fm_tb_puts(tbp, "%%EndComments\n");
 
     /* Definitions */
     if (have_circles_without_width) {
         /* Disc: x y radius TD */
-        fprintf(feps, "/TD { newpath 0 360 arc fill } bind def\n");
+        fm_tb_puts(tbp, "/TD { newpath 0 360 arc fill } bind def\n");
     }
     if (have_circles_with_width) {
         /* Circle (ring): x y radius width TC (adapted from BWIPP renmaxicode.ps) */
-        fprintf(feps, "/TC { newpath 4 1 roll 3 copy 0 360 arc closepath 4 -1 roll add 360 0 arcn closepath fill }"
+        fm_tb_puts(tbp, "/TC { newpath 4 1 roll 3 copy 0 360 arc closepath 4 -1 roll add 360 0 arcn closepath fill }"
                         " bind def\n");
     }
     if (symbol->vector->hexagons) {
-        fprintf(feps, "/TH { 0 setlinewidth moveto lineto lineto lineto lineto lineto closepath fill } bind def\n");
+        fm_tb_puts(tbp, "/TH { 0 setlinewidth moveto lineto lineto lineto lineto lineto closepath fill } bind def\n");
     }
-    fprintf(feps, "/TB { 2 copy } bind def\n");
-    fprintf(feps, "/TR { newpath 4 1 roll exch moveto 1 index 0 rlineto 0 exch rlineto neg 0 rlineto closepath fill }"
+    fm_tb_puts(tbp, "/TB { 2 copy } bind def\n");
+    fm_tb_puts(tbp, "/TR { newpath 4 1 roll exch moveto 1 index 0 rlineto 0 exch rlineto neg 0 rlineto closepath fill }"
                     " bind def\n");
-    fprintf(feps, "/TE { pop pop } bind def\n");
+    fm_tb_puts(tbp, "/TE { pop pop } bind def\n");
 
-    fprintf(feps, "newpath\n");
+    fm_tb_puts(tbp, "newpath\n");
 
     /* Now the actual representation */
 
     // Background
     if (draw_background) {
         if ((symbol->output_options & CMYK_COLOUR) == 0) {
-            fprintf(feps, "%.2f %.2f %.2f setrgbcolor\n", red_paper, green_paper, blue_paper);
+            ps_put_rgbcolor(red_paper, green_paper, blue_paper, tbp);
         } else {
-            fprintf(feps, "%.2f %.2f %.2f %.2f setcmykcolor\n", cyan_paper, magenta_paper, yellow_paper, black_paper);
+            ps_put_cmykcolor(cyan_paper, magenta_paper, yellow_paper, black_paper, tbp);
         }
 
-        fprintf(feps, "%.2f 0.00 TB 0.00 %.2f TR\n", symbol->vector->height, symbol->vector->width);
-        fprintf(feps, "TE\n");
+        fm_tb_putsf(tbp, "", 2, symbol->vector->height);
+        fm_tb_putsf(tbp, " 0.00 TB 0.00 ", 2, symbol->vector->width);
+        fm_tb_puts(tbp, " TR\nTE\n");
     }
 
     if (symbol->symbology != BARCODE_ULTRA) {
         if ((symbol->output_options & CMYK_COLOUR) == 0) {
-            fprintf(feps, "%.2f %.2f %.2f setrgbcolor\n", red_ink, green_ink, blue_ink);
+            ps_put_rgbcolor(red_ink, green_ink, blue_ink, tbp);
         } else {
-            fprintf(feps, "%.2f %.2f %.2f %.2f setcmykcolor\n", cyan_ink, magenta_ink, yellow_ink, black_ink);
+            ps_put_cmykcolor(cyan_ink, magenta_ink, yellow_ink, black_ink, tbp);
         }
     }
 
@@ -338,16 +396,13 @@ INTERNAL int ps_plot(struct zint_symbol *symbol) {
                 if (colour_rect_flag == 0) {
                     // Set foreground colour
                     if ((symbol->output_options & CMYK_COLOUR) == 0) {
-                        fprintf(feps, "%.2f %.2f %.2f setrgbcolor\n", red_ink, green_ink, blue_ink);
+                        ps_put_rgbcolor(red_ink, green_ink, blue_ink, tbp);
                     } else {
-                        fprintf(feps, "%.2f %.2f %.2f %.2f setcmykcolor\n",
-                                cyan_ink, magenta_ink, yellow_ink, black_ink);
+                        ps_put_cmykcolor(cyan_ink, magenta_ink, yellow_ink, black_ink, tbp);
                     }
                     colour_rect_flag = 1;
                 }
-                fprintf(feps, "%.2f %.2f TB %.2f %.2f TR\n",
-                        rect->height, (symbol->vector->height - rect->y) - rect->height, rect->x, rect->width);
-                fprintf(feps, "TE\n");
+                ps_put_rect(symbol, rect, tbp);
             }
             rect = rect->next;
         }
@@ -359,12 +414,11 @@ INTERNAL int ps_plot(struct zint_symbol *symbol) {
                     if (colour_rect_flag == 0) {
                         // Set new colour
                         colour_to_pscolor(symbol->output_options, colour_index, ps_color);
-                        fprintf(feps, "%s\n", ps_color);
+                        fm_tb_puts(tbp, ps_color);
+                        fm_tb_puts(tbp, "\n");
                         colour_rect_flag = 1;
                     }
-                    fprintf(feps, "%.2f %.2f TB %.2f %.2f TR\n",
-                            rect->height, (symbol->vector->height - rect->y) - rect->height, rect->x, rect->width);
-                    fprintf(feps, "TE\n");
+                    ps_put_rect(symbol, rect, tbp);
                 }
                 rect = rect->next;
             }
@@ -372,9 +426,7 @@ INTERNAL int ps_plot(struct zint_symbol *symbol) {
     } else {
         rect = symbol->vector->rectangles;
         while (rect) {
-            fprintf(feps, "%.2f %.2f TB %.2f %.2f TR\n",
-                    rect->height, (symbol->vector->height - rect->y) - rect->height, rect->x, rect->width);
-            fprintf(feps, "TE\n");
+            ps_put_rect(symbol, rect, tbp);
             rect = rect->next;
         }
     }
@@ -416,8 +468,19 @@ INTERNAL int ps_plot(struct zint_symbol *symbol) {
             ex = hex->x + half_radius;
             fx = hex->x - half_radius;
         }
-        fprintf(feps, "%.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f TH\n",
-                ax, ay, bx, by, cx, cy, dx, dy, ex, ey, fx, fy);
+        fm_tb_putsf(tbp, "", 2, ax);
+        fm_tb_putsf(tbp, " ", 2, ay);
+        fm_tb_putsf(tbp, " ", 2, bx);
+        fm_tb_putsf(tbp, " ", 2, by);
+        fm_tb_putsf(tbp, " ", 2, cx);
+        fm_tb_putsf(tbp, " ", 2, cy);
+        fm_tb_putsf(tbp, " ", 2, dx);
+        fm_tb_putsf(tbp, " ", 2, dy);
+        fm_tb_putsf(tbp, " ", 2, ex);
+        fm_tb_putsf(tbp, " ", 2, ey);
+        fm_tb_putsf(tbp, " ", 2, fx);
+        fm_tb_putsf(tbp, " ", 2, fy);
+        fm_tb_puts(tbp, " TH\n");
         hex = hex->next;
     }
 
@@ -432,32 +495,21 @@ INTERNAL int ps_plot(struct zint_symbol *symbol) {
         if (circle->colour) {
             // A 'white' circle
             if ((symbol->output_options & CMYK_COLOUR) == 0) {
-                fprintf(feps, "%.2f %.2f %.2f setrgbcolor\n", red_paper, green_paper, blue_paper);
-            } else {
-                fprintf(feps, "%.2f %.2f %.2f %.2f setcmykcolor\n",
-                        cyan_paper, magenta_paper, yellow_paper, black_paper);
-            }
-            if (circle->width) {
-                fprintf(feps, "%.2f %.2f %.3f %.3f TC\n",
-                        circle->x, (symbol->vector->height - circle->y), radius, circle->width);
+                ps_put_rgbcolor(red_paper, green_paper, blue_paper, tbp);
             } else {
-                fprintf(feps, "%.2f %.2f %.2f TD\n", circle->x, (symbol->vector->height - circle->y), radius);
+                ps_put_cmykcolor(cyan_paper, magenta_paper, yellow_paper, black_paper, tbp);
             }
+            ps_put_circle(symbol, circle, radius, tbp);
             if (circle->next) {
                 if ((symbol->output_options & CMYK_COLOUR) == 0) {
-                    fprintf(feps, "%.2f %.2f %.2f setrgbcolor\n", red_ink, green_ink, blue_ink);
+                    ps_put_rgbcolor(red_ink, green_ink, blue_ink, tbp);
                 } else {
-                    fprintf(feps, "%.2f %.2f %.2f %.2f setcmykcolor\n", cyan_ink, magenta_ink, yellow_ink, black_ink);
+                    ps_put_cmykcolor(cyan_ink, magenta_ink, yellow_ink, black_ink, tbp);
                 }
             }
         } else {
             // A 'black' circle
-            if (circle->width) {
-                fprintf(feps, "%.2f %.2f %.3f %.3f TC\n",
-                        circle->x, (symbol->vector->height - circle->y), radius, circle->width);
-            } else {
-                fprintf(feps, "%.2f %.2f %.2f TD\n", circle->x, (symbol->vector->height - circle->y), radius);
-            }
+            ps_put_circle(symbol, circle, radius, tbp);
         }
         circle = circle->next;
     }
@@ -475,50 +527,71 @@ INTERNAL int ps_plot(struct zint_symbol *symbol) {
         }
         if (iso_latin1) {
             /* Change encoding to ISO 8859-1, see Postscript Language Reference Manual 2nd Edition Example 5.6 */
-            fprintf(feps, "/%s findfont\n", font);
-            fprintf(feps, "dup length dict begin\n");
-            fprintf(feps, "{1 index /FID ne {def} {pop pop} ifelse} forall\n");
-            fprintf(feps, "/Encoding ISOLatin1Encoding def\n");
-            fprintf(feps, "currentdict\n");
-            fprintf(feps, "end\n");
-            fprintf(feps, "/Helvetica-ISOLatin1 exch definefont pop\n");
+            fm_tb_puts(tbp, "/");
+            fm_tb_puts(tbp, font);
+            fm_tb_puts(tbp, " findfont\n");
+            fm_tb_puts(tbp, "dup length dict begin\n");
+            fm_tb_puts(tbp, "{1 index /FID ne {def} {pop pop} ifelse} forall\n");
+            fm_tb_puts(tbp, "/Encoding ISOLatin1Encoding def\n");
+            fm_tb_puts(tbp, "currentdict\n");
+            fm_tb_puts(tbp, "end\n");
+            fm_tb_puts(tbp, "/Helvetica-ISOLatin1 exch definefont pop\n");
             font = "Helvetica-ISOLatin1";
         }
         do {
             ps_convert(string->text, ps_string);
-            fprintf(feps, "matrix currentmatrix\n");
-            fprintf(feps, "/%s findfont\n", font);
-            fprintf(feps, "%.2f scalefont setfont\n", string->fsize);
-            fprintf(feps, " 0 0 moveto %.2f %.2f translate 0.00 rotate 0 0 moveto\n",
-                    string->x, (symbol->vector->height - string->y));
+            fm_tb_puts(tbp, "matrix currentmatrix\n");
+            fm_tb_puts(tbp, "/");
+            fm_tb_puts(tbp, font);
+            fm_tb_puts(tbp, " findfont\n");
+            fm_tb_putsf(tbp, "", 2, string->fsize);
+            fm_tb_puts(tbp, " scalefont setfont\n");
+            fm_tb_putsf(tbp, " 0 0 moveto ", 2, string->x);
+            fm_tb_putsf(tbp, " ", 2, symbol->vector->height - string->y);
+            fm_tb_puts(tbp, " translate 0.00 rotate 0 0 moveto\n");
             if (string->halign == 0 || string->halign == 2) { /* Need width for middle or right align */
-                fprintf(feps, " (%s) stringwidth\n", ps_string);
+                fm_tb_puts(tbp, " (");
+                fm_tb_puts(tbp, (const char *) ps_string);
+                fm_tb_puts(tbp, ") stringwidth\n");
             }
             if (string->rotation != 0) {
-                fprintf(feps, "gsave\n");
-                fprintf(feps, "%d rotate\n", 360 - string->rotation);
+                fm_tb_puts(tbp, "gsave\n");
+                fm_tb_putsf(tbp, "", 0, (float) (360 - string->rotation));
+                fm_tb_puts(tbp, " rotate\n");
             }
             if (string->halign == 0 || string->halign == 2) {
-                fprintf(feps, "pop\n");
-                fprintf(feps, "%s 0 rmoveto\n", string->halign == 2 ? "neg" : "-2 div");
+                fm_tb_puts(tbp, "pop\n");
+                fm_tb_puts(tbp, string->halign == 2 ? "neg 0 rmoveto\n" : "-2 div 0 rmoveto\n");
             }
-            fprintf(feps, " (%s) show\n", ps_string);
+            fm_tb_puts(tbp, " (");
+            fm_tb_puts(tbp, (const char *) ps_string);
+            fm_tb_puts(tbp, ") show\n");
             if (string->rotation != 0) {
-                fprintf(feps, "grestore\n");
+                fm_tb_puts(tbp, "grestore\n");
             }
-            fprintf(feps, "setmatrix\n");
+            fm_tb_puts(tbp, "setmatrix\n");
             string = string->next;
         } while (string);
     }
 
-    if (output_to_stdout) {
-        fflush(feps);
-    } else {
-        fclose(feps);
+    if (tbp->err) {
+        fm_tb_free(tbp);
+        strcpy(symbol->errtxt, "649: Insufficient memory for EPS output buffer");
+        return ZINT_ERROR_MEMORY;
     }
 
-    if (locale)
-        setlocale(LC_ALL, locale);
+    if (!fm_open(fmp, symbol, "w")) {
+        fm_tb_free(tbp);
+        sprintf(symbol->errtxt, "645: Could not open output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_ACCESS;
+    }
+
+    fm_tb_flush(tbp, fmp);
+
+    if (!fm_close(fmp, symbol)) {
+        sprintf(symbol->errtxt, "647: Failure on closing output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_WRITE;
+    }
 
     return error_number;
 }
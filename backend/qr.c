@@ -40,6 +40,8 @@
 #include "sjis.h"
 #include "qr.h"
 #include "reedsol.h"
+#include "bitgrid.h"
+#include "bitstream.h"
 #include <assert.h>
 
 #define LEVEL_L     1
@@ -315,6 +317,58 @@ static void qr_define_mode(char mode[], const unsigned int jisdata[], const int
     }
 }
 
+/* Calculate encoding modes in a single greedy pass (FAST_MODE), in the manner of ISO/IEC 18004:2015 Annex J.2 but
+ * with thresholds derived from the version's head costs. Each run of characters of the same class (digits,
+ * alphanumerics, Kanji or other bytes) costs at most 2 segment headers (mode indicator plus character count
+ * indicator) more than `qr_define_mode()` */
+static void qr_define_mode_fast(char mode[], const unsigned int jisdata[], const int length, const int gs1,
+            const int version, unsigned int fast_sums[], const int debug_print) {
+    unsigned int state[10] = {
+        0 /*N*/, 0 /*A*/, 0 /*B*/, 0 /*K*/, /* Head/switch costs */
+        (unsigned int) version,
+    };
+    const int m1 = version == MICROQR_VERSION;
+    const int m2 = version == MICROQR_VERSION + 1;
+    const unsigned int a_cost = m1 ? QR_MICROQR_MAX : 33; /* (11 / 2) * QR_MULT */
+    const unsigned int b_cost = m1 || m2 ? QR_MICROQR_MAX : 48; /* 8 * QR_MULT */
+    const unsigned int b2_cost = m1 || m2 ? QR_MICROQR_MAX : 96; /* 16 * QR_MULT */
+    const unsigned int k_cost = m1 || m2 ? QR_MICROQR_MAX : 78; /* 13 * QR_MULT */
+    /* Costs of each class of character (numeric, alphanumeric, byte, double-byte) in each mode */
+    const unsigned int char_costs[4 * QR_NUM_MODES] = {
+    /*  N   A       B        K */
+        20, a_cost, b_cost,  0, /* (10 / 3) * QR_MULT */
+        0,  a_cost, b_cost,  0,
+        0,  0,      b_cost,  0,
+        0,  0,      b2_cost, k_cost,
+    };
+    struct fast_modes modes;
+    int i;
+#ifndef _MSC_VER
+    unsigned char classes[length + 1];
+#else
+    unsigned char *classes = (unsigned char *) _alloca(length + 1);
+#endif
+
+    for (i = 0; i < length; i++) {
+        classes[i] = jisdata[i] > 0xFF ? 3 : jisdata[i] >= '0' && jisdata[i] <= '9' ? 0
+                        : is_alpha(jisdata[i], gs1) ? 1 : 2;
+    }
+
+    modes.num_modes = QR_NUM_MODES;
+    modes.mode_types = mode_types;
+    modes.head_costs = qr_head_costs(state);
+    modes.switch_costs = NULL; /* Switch costs same as head costs */
+    modes.char_costs = char_costs;
+    modes.units = NULL;
+    modes.sums = fast_sums;
+
+    fast_define_mode(mode, classes, length, &modes);
+
+    if (debug_print) {
+        printf("  Mode: %.*s\n", length, mode);
+    }
+}
+
 /* Returns mode indicator based on version and mode */
 static int mode_indicator(const int version, const int mode) {
     static const int mode_indicators[6][QR_NUM_MODES] = {
@@ -392,50 +446,50 @@ static int terminator_bits(const int version) {
     return 3 + (version - MICROQR_VERSION) * 2; /* MICROQR (Note not actually using this at the moment) */
 }
 
-/* Convert input data to a binary stream and add padding */
+/* Convert input data to a bitstream and add padding. For MICROQR, which does its own terminating/padding, the
+   bitstream itself is placed in `datastream` (as `uint64_t` words) and its length returned */
 static int qr_binary(unsigned char datastream[], const int version, const int target_codewords, const char mode[],
             const unsigned int jisdata[], const int length, const struct zint_structapp *p_structapp, const int gs1,
             const int eci, const int est_binlen, const int debug_print) {
     int position = 0;
-    int i, j, bp;
+    int i, bp;
     int termbits, padbits, modebits;
     int current_bytes;
     int toggle, percent;
     int percent_count;
 
 #ifndef _MSC_VER
-    char binary[est_binlen + 12];
+    uint64_t binary[BITS_WORDS(est_binlen + 12)];
 #else
-    char *binary= (char *) _alloca(est_binlen + 12);
+    uint64_t *binary = (uint64_t *) _alloca(sizeof(uint64_t) * BITS_WORDS(est_binlen + 12));
 #endif
 
-    *binary = '\0';
     bp = 0;
 
     if (p_structapp) {
-        bp = bin_append_posn(3, 4, binary, bp); /* Structured Append indicator */
-        bp = bin_append_posn(p_structapp->index - 1, 4, binary, bp);
-        bp = bin_append_posn(p_structapp->count - 1, 4, binary, bp);
-        bp = bin_append_posn(to_int((const unsigned char *) p_structapp->id, (int) strlen(p_structapp->id)), 8,
+        bp = bits_append_posn(3, 4, binary, bp); /* Structured Append indicator */
+        bp = bits_append_posn(p_structapp->index - 1, 4, binary, bp);
+        bp = bits_append_posn(p_structapp->count - 1, 4, binary, bp);
+        bp = bits_append_posn(to_int((const unsigned char *) p_structapp->id, (int) strlen(p_structapp->id)), 8,
                 binary, bp); /* Parity */
     }
 
     if (gs1) { /* Not applicable to MICROQR */
         if (version < RMQR_VERSION) {
-            bp = bin_append_posn(5, 4, binary, bp); /* FNC1 */
+            bp = bits_append_posn(5, 4, binary, bp); /* FNC1 */
         } else {
-            bp = bin_append_posn(5, 3, binary, bp);
+            bp = bits_append_posn(5, 3, binary, bp);
         }
     }
 
     if (eci != 0) { /* Not applicable to MICROQR */
-        bp = bin_append_posn(7, 4, binary, bp); /* ECI (Table 4) */
+        bp = bits_append_posn(7, 4, binary, bp); /* ECI (Table 4) */
         if (eci <= 127) {
-            bp = bin_append_posn(eci, 8, binary, bp); /* 000000 to 000127 */
+            bp = bits_append_posn(eci, 8, binary, bp); /* 000000 to 000127 */
         } else if (eci <= 16383) {
-            bp = bin_append_posn(0x8000 + eci, 16, binary, bp); /* 000128 to 016383 */
+            bp = bits_append_posn(0x8000 + eci, 16, binary, bp); /* 000128 to 016383 */
         } else {
-            bp = bin_append_posn(0xC00000 + eci, 24, binary, bp); /* 016384 to 999999 */
+            bp = bits_append_posn(0xC00000 + eci, 24, binary, bp); /* 016384 to 999999 */
         }
     }
 
@@ -457,7 +511,7 @@ static int qr_binary(unsigned char datastream[], const int version, const int ta
 
         /* Mode indicator */
         if (modebits) {
-            bp = bin_append_posn(mode_indicator(version, data_block), modebits, binary, bp);
+            bp = bits_append_posn(mode_indicator(version, data_block), modebits, binary, bp);
         }
 
         switch (data_block) {
@@ -465,7 +519,7 @@ static int qr_binary(unsigned char datastream[], const int version, const int ta
                 /* Kanji mode */
 
                 /* Character count indicator */
-                bp = bin_append_posn(short_data_block_length, cci_bits(version, data_block), binary, bp);
+                bp = bits_append_posn(short_data_block_length, cci_bits(version, data_block), binary, bp);
 
                 if (debug_print) {
                     printf("Kanji block (length %d)\n\t", short_data_block_length);
@@ -484,7 +538,7 @@ static int qr_binary(unsigned char datastream[], const int version, const int ta
 
                     prod = ((jis >> 8) * 0xc0) + (jis & 0xff);
 
-                    bp = bin_append_posn(prod, 13, binary, bp);
+                    bp = bits_append_posn(prod, 13, binary, bp);
 
                     if (debug_print) {
                         printf("0x%04X ", prod);
@@ -500,7 +554,7 @@ static int qr_binary(unsigned char datastream[], const int version, const int ta
                 /* Byte mode */
 
                 /* Character count indicator */
-                bp = bin_append_posn(short_data_block_length + double_byte, cci_bits(version, data_block), binary,
+                bp = bits_append_posn(short_data_block_length + double_byte, cci_bits(version, data_block), binary,
                                     bp);
 
                 if (debug_print) {
@@ -515,7 +569,7 @@ static int qr_binary(unsigned char datastream[], const int version, const int ta
                         byte = 0x1d; /* FNC1 */
                     }
 
-                    bp = bin_append_posn(byte, byte > 0xFF ? 16 : 8, binary, bp);
+                    bp = bits_append_posn(byte, byte > 0xFF ? 16 : 8, binary, bp);
 
                     if (debug_print) {
                         printf("0x%02X(%d) ", byte, (int) byte);
@@ -540,7 +594,7 @@ static int qr_binary(unsigned char datastream[], const int version, const int ta
                 }
 
                 /* Character count indicator */
-                bp = bin_append_posn(short_data_block_length + percent_count, cci_bits(version, data_block), binary,
+                bp = bits_append_posn(short_data_block_length + percent_count, cci_bits(version, data_block), binary,
                                     bp);
 
                 if (debug_print) {
@@ -614,7 +668,7 @@ static int qr_binary(unsigned char datastream[], const int version, const int ta
                         }
                     }
 
-                    bp = bin_append_posn(prod, 1 + (5 * count), binary, bp);
+                    bp = bits_append_posn(prod, 1 + (5 * count), binary, bp);
 
                     if (debug_print) {
                         printf("0x%X ", prod);
@@ -630,7 +684,7 @@ static int qr_binary(unsigned char datastream[], const int version, const int ta
                 /* Numeric mode */
 
                 /* Character count indicator */
-                bp = bin_append_posn(short_data_block_length, cci_bits(version, data_block), binary, bp);
+                bp = bits_append_posn(short_data_block_length, cci_bits(version, data_block), binary, bp);
 
                 if (debug_print) {
                     printf("Number block (length %d)\n\t", short_data_block_length);
@@ -658,7 +712,7 @@ static int qr_binary(unsigned char datastream[], const int version, const int ta
                         }
                     }
 
-                    bp = bin_append_posn(prod, 1 + (3 * count), binary, bp);
+                    bp = bits_append_posn(prod, 1 + (3 * count), binary, bp);
 
                     if (debug_print) {
                         printf("0x%X(%d) ", prod, prod);
@@ -679,7 +733,7 @@ static int qr_binary(unsigned char datastream[], const int version, const int ta
 
     if (version >= MICROQR_VERSION && version < MICROQR_VERSION + 4) {
         /* MICROQR does its own terminating/padding */
-        memcpy(datastream, binary, bp);
+        memcpy(datastream, binary, sizeof(uint64_t) * BITS_WORDS(bp));
         return bp;
     }
 
@@ -692,7 +746,7 @@ static int qr_binary(unsigned char datastream[], const int version, const int ta
     if (termbits || current_bytes < target_codewords) {
         int max_termbits = terminator_bits(version);
         termbits = termbits < max_termbits && current_bytes == target_codewords ? termbits : max_termbits;
-        bp = bin_append_posn(0, termbits, binary, bp);
+        bp = bits_pad_posn(0, termbits, binary, bp);
     }
 
     /* Padding bits */
@@ -702,21 +756,18 @@ static int qr_binary(unsigned char datastream[], const int version, const int ta
     }
     if (padbits) {
         current_bytes = (bp + padbits) / 8;
-        (void) bin_append_posn(0, padbits, binary, bp); /* Last use so not setting bp */
+        (void) bits_pad_posn(0, padbits, binary, bp); /* Last use so not setting bp */
     }
 
-    if (debug_print) printf("Terminated binary (%d): %.*s (padbits %d)\n", bp, bp, binary, padbits);
+    if (debug_print) {
+        printf("Terminated binary (%d): ", bp);
+        bits_print(binary, 0, bp);
+        printf(" (padbits %d)\n", padbits);
+    }
 
     /* Put data into 8-bit codewords */
     for (i = 0; i < current_bytes; i++) {
-        int p;
-        j = i * 8;
-        datastream[i] = 0x00;
-        for (p = 0; p < 8; p++) {
-            if (binary[j + p] == '1') {
-                datastream[i] |= (0x80 >> p);
-            }
-        }
+        datastream[i] = (unsigned char) bits_peek(binary, i * 8, 8);
     }
 
     /* Add pad codewords */
@@ -1046,15 +1097,15 @@ static int write_log(char log[]) {
 }
 #endif
 
-static int evaluate(unsigned char *local, const int size) {
-    static const unsigned char h1011101[7] = { 1, 0, 1, 1, 1, 0, 1 };
-
-    int x, y, r, k, block;
+/* Evaluate penalty of bit `pattern` of the masked symbols in `local`, using `row_lines` and `col_lines` as
+   work space (see bitgrid.h) */
+static int evaluate(const unsigned char *local, const int size, const int pattern, uint64_t *row_lines,
+            uint64_t *col_lines) {
+    const int line_words = BITGRID_LINE_WORDS(size);
+    int x, y, k, runs;
     int result = 0;
-    char state;
     int dark_mods;
     double percentage;
-    int a, b, afterCount, beforeCount;
 #ifdef ZINTLOG
     int result_b = 0;
     char str[15];
@@ -1068,58 +1119,24 @@ static int evaluate(unsigned char *local, const int size) {
     for (y = 0; y < size; y++) {
         strcpy(str, "");
         for (x = 0; x < size; x++) {
-            state = local[(y * size) + x];
-            append_log(state);
+            append_log((local[(y * size) + x] >> pattern) & 1);
         }
         write_log("");
     }
     write_log("");
 #endif
 
+    bitgrid_pack(local, size, size, pattern, row_lines, col_lines);
+
     /* Test 1: Adjacent modules in row/column in same colour */
-    /* Vertical */
+    /* Penalty is run length - 2 for runs of 5 or more, i.e. (run length - 4) + 2 */
+    dark_mods = 0; /* Count dark mods simultaneously (see Test 4 below) */
     for (x = 0; x < size; x++) {
-        block = 0;
-        state = 0;
-        for (y = 0; y < size; y++) {
-            if (local[(y * size) + x] == state) {
-                block++;
-            } else {
-                if (block >= 5) {
-                    result += block - 2;
-                }
-                block = 1;
-                state = local[(y * size) + x];
-            }
-        }
-        if (block >= 5) {
-            result += block - 2;
-        }
+        result += bitgrid_runs(col_lines + x * line_words, size, 5, &runs) + runs * 2;
     }
-
-    /* Horizontal */
-    dark_mods = 0; /* Count dark mods simultaneously (see Test 4 below) */
     for (y = 0; y < size; y++) {
-        r = y * size;
-        block = 0;
-        state = 0;
-        for (x = 0; x < size; x++) {
-            if (local[r + x] == state) {
-                block++;
-            } else {
-                if (block >= 5) {
-                    result += block - 2;
-                }
-                block = 1;
-                state = local[r + x];
-            }
-            if (state) {
-                dark_mods++;
-            }
-        }
-        if (block >= 5) {
-            result += block - 2;
-        }
+        result += bitgrid_runs(row_lines + y * line_words, size, 5, &runs) + runs * 2;
+        dark_mods += bitgrid_count(row_lines + y * line_words, size);
     }
 
 #ifdef ZINTLOG
@@ -1130,15 +1147,8 @@ static int evaluate(unsigned char *local, const int size) {
 #endif
 
     /* Test 2: Block of modules in same color */
-    for (x = 0; x < size - 1; x++) {
-        for (y = 0; y < size - 1; y++) {
-            k = local[(y * size) + x];
-            if (((k == local[((y + 1) * size) + x]) &&
-                    (k == local[(y * size) + (x + 1)])) &&
-                    (k == local[((y + 1) * size) + (x + 1)])) {
-                result += 3;
-            }
-        }
+    for (y = 0; y < size - 1; y++) {
+        result += bitgrid_blocks(row_lines + y * line_words, row_lines + (y + 1) * line_words, size) * 3;
     }
 
 #ifdef ZINTLOG
@@ -1148,91 +1158,12 @@ static int evaluate(unsigned char *local, const int size) {
     write_log(str);
 #endif
 
-    /* Test 3: 1:1:3:1:1 ratio pattern in row/column */
-    /* Vertical */
+    /* Test 3: 1:1:3:1:1 ratio pattern in row/column, preceded or followed by light area 4 modules wide */
     for (x = 0; x < size; x++) {
-        for (y = 0; y <= (size - 7); y++) {
-            if (local[y * size + x] && !local[(y + 1) * size + x] && local[(y + 2) * size + x] &&
-                    local[(y + 3) * size + x] && local[(y + 4) * size + x] &&
-                    !local[(y + 5) * size + x] && local[(y + 6) * size + x]) {
-                /* Pattern found, check before and after */
-                beforeCount = 0;
-                for (b = (y - 1); b >= (y - 4); b--) {
-                    if (b < 0) { /* Count < edge as whitespace */
-                        beforeCount = 4;
-                        break;
-                    }
-                    if (local[(b * size) + x]) {
-                        break;
-                    }
-                    beforeCount++;
-                }
-                if (beforeCount == 4) {
-                    /* Pattern is preceded by light area 4 modules wide */
-                    result += 40;
-                } else {
-                    afterCount = 0;
-                    for (a = (y + 7); a <= (y + 10); a++) {
-                        if (a >= size) { /* Count > edge as whitespace */
-                            afterCount = 4;
-                            break;
-                        }
-                        if (local[(a * size) + x]) {
-                            break;
-                        }
-                        afterCount++;
-                    }
-                    if (afterCount == 4) {
-                        /* Pattern is followed by light area 4 modules wide */
-                        result += 40;
-                    }
-                }
-                y += 3; /* Skip to next possible match */
-            }
-        }
+        result += bitgrid_patterns(col_lines + x * line_words, size, 0x5D /*1011101*/, 7, 4) * 40;
     }
-
-    /* Horizontal */
     for (y = 0; y < size; y++) {
-        r = y * size;
-        for (x = 0; x <= (size - 7); x++) {
-            if (memcmp(local + r + x, h1011101, 7) == 0) {
-                /* Pattern found, check before and after */
-                beforeCount = 0;
-                for (b = (x - 1); b >= (x - 4); b--) {
-                    if (b < 0) { /* Count < edge as whitespace */
-                        beforeCount = 4;
-                        break;
-                    }
-                    if (local[r + b]) {
-                        break;
-                    }
-                    beforeCount++;
-                }
-
-                if (beforeCount == 4) {
-                    /* Pattern is preceded by light area 4 modules wide */
-                    result += 40;
-                } else {
-                    afterCount = 0;
-                    for (a = (x + 7); a <= (x + 10); a++) {
-                        if (a >= size) { /* Count > edge as whitespace */
-                            afterCount = 4;
-                            break;
-                        }
-                        if (local[r + a]) {
-                            break;
-                        }
-                        afterCount++;
-                    }
-                    if (afterCount == 4) {
-                        /* Pattern is followed by light area 4 modules wide */
-                        result += 40;
-                    }
-                }
-                x += 3; /* Skip to next possible match */
-            }
-        }
+        result += bitgrid_patterns(row_lines + y * line_words, size, 0x5D /*1011101*/, 7, 4) * 40;
     }
 
 #ifdef ZINTLOG
@@ -1260,8 +1191,9 @@ static int evaluate(unsigned char *local, const int size) {
     return result;
 }
 
-/* Add format information to grid */
-static void add_format_info(unsigned char *grid, const int size, const int ecc_level, const int pattern) {
+/* Add format information to grid, to bit `shift` of each module (0 for final grid) */
+static void add_format_info(unsigned char *grid, const int size, const int ecc_level, const int pattern,
+            const int shift) {
     int format = pattern;
     unsigned int seq;
     int i;
@@ -1278,42 +1210,46 @@ static void add_format_info(unsigned char *grid, const int size, const int ecc_l
     seq = qr_annex_c[format];
 
     for (i = 0; i < 6; i++) {
-        grid[(i * size) + 8] |= (seq >> i) & 0x01;
+        grid[(i * size) + 8] |= ((seq >> i) & 0x01) << shift;
     }
 
     for (i = 0; i < 8; i++) {
-        grid[(8 * size) + (size - i - 1)] |= (seq >> i) & 0x01;
+        grid[(8 * size) + (size - i - 1)] |= ((seq >> i) & 0x01) << shift;
     }
 
     for (i = 0; i < 6; i++) {
-        grid[(8 * size) + (5 - i)] |= (seq >> (i + 9)) & 0x01;
+        grid[(8 * size) + (5 - i)] |= ((seq >> (i + 9)) & 0x01) << shift;
     }
 
     for (i = 0; i < 7; i++) {
-        grid[(((size - 7) + i) * size) + 8] |= (seq >> (i + 8)) & 0x01;
+        grid[(((size - 7) + i) * size) + 8] |= ((seq >> (i + 8)) & 0x01) << shift;
     }
 
-    grid[(7 * size) + 8] |= (seq >> 6) & 0x01;
-    grid[(8 * size) + 8] |= (seq >> 7) & 0x01;
-    grid[(8 * size) + 7] |= (seq >> 8) & 0x01;
+    grid[(7 * size) + 8] |= ((seq >> 6) & 0x01) << shift;
+    grid[(8 * size) + 8] |= ((seq >> 7) & 0x01) << shift;
+    grid[(8 * size) + 7] |= ((seq >> 8) & 0x01) << shift;
 }
 
-static int apply_bitmask(unsigned char *grid, const int size, const int ecc_level, const int user_mask,
-            const int debug_print) {
+/* Returns the mask pattern applied, or -1 if memory can't be allocated (`symbol->errtxt` set) */
+static int apply_bitmask(struct zint_symbol *symbol, unsigned char *grid, const int size, const int ecc_level,
+            const int user_mask, const int debug_print) {
     int x, y;
     int r, k;
     int bit;
     int pattern, penalty[8];
     int best_pattern;
     int size_squared = size * size;
+    const int lines_size = BITGRID_LINE_WORDS(size) * size;
+    uint64_t *row_lines, *col_lines;
+    unsigned char *mask, *local;
 
-#ifndef _MSC_VER
-    unsigned char mask[size_squared];
-    unsigned char local[size_squared];
-#else
-    unsigned char *mask = (unsigned char *) _alloca(size_squared);
-    unsigned char *local = (unsigned char *) _alloca(size_squared);
-#endif
+    /* Nearly 80K for version 40, so from the scratch arena rather than the stack */
+    if (!(row_lines = (uint64_t *) scratch_alloc(symbol, (sizeof(uint64_t) * lines_size + size_squared) * 2))) {
+        return -1;
+    }
+    col_lines = row_lines + lines_size;
+    mask = (unsigned char *) (col_lines + lines_size);
+    local = mask + size_squared;
 
     /* Perform data masking */
     memset(mask, 0, size_squared);
@@ -1355,22 +1291,19 @@ static int apply_bitmask(unsigned char *grid, const int size, const int ecc_leve
         best_pattern = user_mask - 1;
     } else {
         /* all eight bitmask variants have been encoded in the 8 bits of the bytes
-         * that make up the mask array. select them for evaluation according to the
-         * desired pattern.*/
-        best_pattern = 0;
+         * that make up the mask array. apply them all at once, so that each bit of
+         * the bytes of the local array is the masked symbol for that pattern.*/
+        for (k = 0; k < size_squared; k++) {
+            local[k] = (grid[k] & 0x01 ? 0xff : 0x00) ^ mask[k];
+        }
         for (pattern = 0; pattern < 8; pattern++) {
+            add_format_info(local, size, ecc_level, pattern, pattern /*shift*/);
+        }
 
-            bit = 1 << pattern;
-            for (k = 0; k < size_squared; k++) {
-                if (mask[k] & bit) {
-                    local[k] = grid[k] ^ 0x01;
-                } else {
-                    local[k] = grid[k] & 0x0f;
-                }
-            }
-            add_format_info(local, size, ecc_level, pattern);
+        best_pattern = 0;
+        for (pattern = 0; pattern < 8; pattern++) {
 
-            penalty[pattern] = evaluate(local, size);
+            penalty[pattern] = evaluate(local, size, pattern, row_lines, col_lines);
 
             if (penalty[pattern] < penalty[best_pattern]) {
                 best_pattern = pattern;
@@ -1394,14 +1327,10 @@ static int apply_bitmask(unsigned char *grid, const int size, const int ecc_leve
 #endif
 
     /* Apply mask */
-    if (!user_mask && best_pattern == 7) { /* Reuse last */
-        memcpy(grid, local, size_squared);
-    } else {
-        bit = 1 << best_pattern;
-        for (y = 0; y < size_squared; y++) {
-            if (mask[y] & bit) {
-                grid[y] ^= 0x01;
-            }
+    bit = 1 << best_pattern;
+    for (y = 0; y < size_squared; y++) {
+        if (mask[y] & bit) {
+            grid[y] ^= 0x01;
         }
     }
 
@@ -1439,16 +1368,22 @@ static int blockLength(const int start, const char inputMode[], const int inputL
     return count;
 }
 
-static int getBinaryLength(const int version, char inputMode[], const unsigned int inputData[], const int inputLength,
-            const struct zint_structapp *p_structapp, const int gs1, const int eci, const int debug_print) {
-    /* Calculate the actual bitlength of the proposed binary string */
+STATIC_UNLESS_ZINT_TEST int getBinaryLength(const int version, char inputMode[], const unsigned int inputData[],
+            const int inputLength, const struct zint_structapp *p_structapp, const int gs1, const int eci,
+            unsigned int fast_sums[], const int debug_print) {
+    /* Calculate the actual bitlength of the proposed binary string (`fast_sums` is FAST_MODE work space of
+       `FAST_SUMS_SIZE(inputLength, QR_NUM_MODES)` entries, or NULL if not FAST_MODE) */
     int i, j;
     char currentMode;
     int count = 0;
     int alphalength;
     int blocklength;
 
-    qr_define_mode(inputMode, inputData, inputLength, gs1, version, debug_print);
+    if (fast_sums) {
+        qr_define_mode_fast(inputMode, inputData, inputLength, gs1, version, fast_sums, debug_print);
+    } else {
+        qr_define_mode(inputMode, inputData, inputLength, gs1, version, debug_print);
+    }
 
     currentMode = ' '; // Null
 
@@ -1539,29 +1474,100 @@ static int getBinaryLength(const int version, char inputMode[], const unsigned i
     return count;
 }
 
+/* Maximum number of distinct character count indicator classes of a symbology (rMQR has 14) */
+#define QR_MEMO_MAX 14
+
+/* Memo of the optimised modes and binary length per character count indicator (CCI) class. As
+   `getBinaryLength()` (and `qr_define_mode()`) only depend on the version through the mode and CCI bit widths, the
+   result for one version holds for all versions of the same class */
+struct qr_memo {
+    const unsigned int *jisdata;
+    int length;
+    const struct zint_structapp *p_structapp;
+    int gs1;
+    int eci;
+    unsigned int *fast_sums; /* FAST_MODE work space, NULL if not FAST_MODE */
+    int debug_print;
+    int size; /* Number of class slots in `modes` */
+    int count;
+    int keys[QR_MEMO_MAX];
+    int binlens[QR_MEMO_MAX];
+    char *modes; /* `size` blocks of `length` modes */
+};
+
+static void qr_memo_init(struct qr_memo *memo, char *modes, const int size, const unsigned int jisdata[],
+            const int length, const struct zint_structapp *p_structapp, const int gs1, const int eci,
+            unsigned int *fast_sums, const int debug_print) {
+    assert(size <= QR_MEMO_MAX);
+    memo->jisdata = jisdata;
+    memo->length = length;
+    memo->p_structapp = p_structapp;
+    memo->gs1 = gs1;
+    memo->eci = eci;
+    memo->fast_sums = fast_sums;
+    memo->debug_print = debug_print;
+    memo->size = size;
+    memo->count = 0;
+    memo->modes = modes;
+}
+
+/* Return key of the CCI class of `version`: type (QRCODE, RMQR or each MICROQR version) followed by the 5-bit CCI
+   widths of each mode */
+STATIC_UNLESS_ZINT_TEST int qr_cci_class(const int version) {
+    const int type = version < RMQR_VERSION ? 0 : version < MICROQR_VERSION ? 1 : 2 + version - MICROQR_VERSION;
+
+    return (type << 20) | (cci_bits(version, 'N') << 15) | (cci_bits(version, 'A') << 10)
+            | (cci_bits(version, 'B') << 5) | cci_bits(version, 'K');
+}
+
+/* Return the binary length for `version`, setting `p_mode` to its optimised modes, computing them only if not
+   already done for its CCI class */
+static int qr_memo_get(struct qr_memo *memo, const int version, const char **p_mode) {
+    const int key = qr_cci_class(version);
+    char *mode;
+    int i;
+
+    for (i = 0; i < memo->count; i++) {
+        if (memo->keys[i] == key) {
+            *p_mode = memo->modes + i * memo->length;
+            return memo->binlens[i];
+        }
+    }
+    assert(memo->count < memo->size);
+
+    mode = memo->modes + i * memo->length;
+    memo->keys[i] = key;
+    memo->binlens[i] = getBinaryLength(version, mode, memo->jisdata, memo->length, memo->p_structapp, memo->gs1,
+                                memo->eci, memo->fast_sums, memo->debug_print);
+    memo->count++;
+
+    *p_mode = mode;
+    return memo->binlens[i];
+}
+
 INTERNAL int qrcode(struct zint_symbol *symbol, unsigned char source[], int length) {
-    int i, j, est_binlen, prev_est_binlen;
-    int ecc_level, autosize, version, max_cw, target_codewords, blocks, size;
+    int i, j, est_binlen;
+    int ecc_level, autosize, version, target_codewords, blocks, size;
     int bitmask, gs1;
     int full_multibyte;
     int user_mask;
-    int canShrink;
     int size_squared;
+    const unsigned short int *data_codewords;
     const struct zint_structapp *p_structapp = NULL;
     const int debug_print = symbol->debug & ZINT_DEBUG_PRINT;
     const int eci_length = get_eci_length(symbol->eci, source, length);
+    struct qr_memo memo;
+    char *memo_modes;
+    unsigned int *fast_sums = NULL;
+    const char *mode;
 
 #ifndef _MSC_VER
     unsigned int jisdata[eci_length + 1];
-    char mode[eci_length];
-    char prev_mode[eci_length];
 #else
     unsigned char *datastream;
     unsigned char *fullstream;
     unsigned char *grid;
     unsigned int *jisdata = (unsigned int *) _alloca((eci_length + 1) * sizeof(unsigned int));
-    char *mode = (char *) _alloca(eci_length);
-    char *prev_mode = (char *) _alloca(eci_length);
 #endif
 
     gs1 = ((symbol->input_mode & 0x07) == GS1_MODE);
@@ -1627,105 +1633,59 @@ INTERNAL int qrcode(struct zint_symbol *symbol, unsigned char source[], int leng
         p_structapp = &symbol->structapp;
     }
 
-    est_binlen = getBinaryLength(40, mode, jisdata, length, p_structapp, gs1, symbol->eci, debug_print);
+    /* QR Code has 3 CCI classes: versions 1-9, 10-26 and 27-40 */
+    if (!(memo_modes = (char *) scratch_alloc(symbol, 3 * length))) {
+        return ZINT_ERROR_MEMORY;
+    }
+    if ((symbol->input_mode & FAST_MODE) && !(fast_sums = (unsigned int *) scratch_alloc(symbol,
+                                                    sizeof(unsigned int) * FAST_SUMS_SIZE(length, QR_NUM_MODES)))) {
+        return ZINT_ERROR_MEMORY;
+    }
+    qr_memo_init(&memo, memo_modes, 3, jisdata, length, p_structapp, gs1, symbol->eci, fast_sums, debug_print);
+
+    est_binlen = qr_memo_get(&memo, 40, &mode);
 
     ecc_level = LEVEL_L;
-    max_cw = 2956;
+    data_codewords = qr_data_codewords_L;
     if ((symbol->option_1 >= 1) && (symbol->option_1 <= 4)) {
         switch (symbol->option_1) {
             case 1:
                 break;
             case 2: ecc_level = LEVEL_M;
-                max_cw = 2334;
+                data_codewords = qr_data_codewords_M;
                 break;
             case 3: ecc_level = LEVEL_Q;
-                max_cw = 1666;
+                data_codewords = qr_data_codewords_Q;
                 break;
             case 4: ecc_level = LEVEL_H;
-                max_cw = 1276;
+                data_codewords = qr_data_codewords_H;
                 break;
         }
     }
 
-    if (est_binlen > (8 * max_cw)) {
+    if (est_binlen > (8 * data_codewords[39])) {
         strcpy(symbol->errtxt, "561: Input too long for selected error correction level");
         return ZINT_ERROR_TOO_LONG;
     }
 
-    autosize = 40;
-    for (i = 39; i >= 0; i--) {
-        switch (ecc_level) {
-            case LEVEL_L:
-                if ((8 * qr_data_codewords_L[i]) >= est_binlen) {
-                    autosize = i + 1;
-                }
-                break;
-            case LEVEL_M:
-                if ((8 * qr_data_codewords_M[i]) >= est_binlen) {
-                    autosize = i + 1;
-                }
-                break;
-            case LEVEL_Q:
-                if ((8 * qr_data_codewords_Q[i]) >= est_binlen) {
-                    autosize = i + 1;
-                }
-                break;
-            case LEVEL_H:
-                if ((8 * qr_data_codewords_H[i]) >= est_binlen) {
-                    autosize = i + 1;
-                }
-                break;
-        }
-    }
+    /* Smallest version that fits the version 40 estimate */
+    for (autosize = 1; (8 * data_codewords[autosize - 1]) < est_binlen; autosize++);
     if (autosize != 40) {
-        est_binlen = getBinaryLength(autosize, mode, jisdata, length, p_structapp, gs1, symbol->eci, debug_print);
+        est_binlen = qr_memo_get(&memo, autosize, &mode);
     }
 
     // Now see if the optimised binary will fit in a smaller symbol.
-    canShrink = 1;
-
-    do {
-        if (autosize == 1) {
-            canShrink = 0;
-        } else {
-            prev_est_binlen = est_binlen;
-            memcpy(prev_mode, mode, length);
-            est_binlen = getBinaryLength(autosize - 1, mode, jisdata, length, p_structapp, gs1, symbol->eci,
-                            debug_print);
-
-            switch (ecc_level) {
-                case LEVEL_L:
-                    if ((8 * qr_data_codewords_L[autosize - 2]) < est_binlen) {
-                        canShrink = 0;
-                    }
-                    break;
-                case LEVEL_M:
-                    if ((8 * qr_data_codewords_M[autosize - 2]) < est_binlen) {
-                        canShrink = 0;
-                    }
-                    break;
-                case LEVEL_Q:
-                    if ((8 * qr_data_codewords_Q[autosize - 2]) < est_binlen) {
-                        canShrink = 0;
-                    }
-                    break;
-                case LEVEL_H:
-                    if ((8 * qr_data_codewords_H[autosize - 2]) < est_binlen) {
-                        canShrink = 0;
-                    }
-                    break;
-            }
-
-            if (canShrink == 1) {
-                // Optimisation worked - data will fit in a smaller symbol
-                autosize--;
-            } else {
-                // Data did not fit in the smaller symbol, revert to original size
-                est_binlen = prev_est_binlen;
-                memcpy(mode, prev_mode, length);
-            }
+    while (autosize > 1) {
+        const char *smaller_mode;
+        const int smaller_binlen = qr_memo_get(&memo, autosize - 1, &smaller_mode);
+        if ((8 * data_codewords[autosize - 2]) < smaller_binlen) {
+            break; // Data did not fit in the smaller symbol, keep original size
         }
-    } while (canShrink == 1);
+        // Optimisation worked - data will fit in a smaller symbol
+        autosize--;
+        est_binlen = smaller_binlen;
+        mode = smaller_mode;
+    }
 
     version = autosize;
 
@@ -1736,8 +1696,7 @@ INTERNAL int qrcode(struct zint_symbol *symbol, unsigned char source[], int leng
          */
         if (symbol->option_2 > version) {
             version = symbol->option_2;
-            est_binlen = getBinaryLength(symbol->option_2, mode, jisdata, length, p_structapp, gs1, symbol->eci,
-                            debug_print);
+            est_binlen = qr_memo_get(&memo, symbol->option_2, &mode);
         }
 
         if (symbol->option_2 < version) {
@@ -1813,9 +1772,11 @@ INTERNAL int qrcode(struct zint_symbol *symbol, unsigned char source[], int leng
         add_version_info(grid, size, version);
     }
 
-    bitmask = apply_bitmask(grid, size, ecc_level, user_mask, debug_print);
+    if ((bitmask = apply_bitmask(symbol, grid, size, ecc_level, user_mask, debug_print)) < 0) {
+        return ZINT_ERROR_MEMORY;
+    }
 
-    add_format_info(grid, size, ecc_level, bitmask);
+    add_format_info(grid, size, ecc_level, bitmask, 0 /*shift*/);
 
     symbol->width = size;
     symbol->rows = size;
@@ -1834,8 +1795,8 @@ INTERNAL int qrcode(struct zint_symbol *symbol, unsigned char source[], int leng
     return 0;
 }
 
-static int micro_qr_m1(struct zint_symbol *symbol, char binary_data[], int bp) {
-    int i, j, latch;
+static int micro_qr_m1(struct zint_symbol *symbol, uint64_t binary_data[], int bp) {
+    int i, latch;
     int bits_total, bits_left;
     int data_codewords, ecc_codewords;
     unsigned char data_blocks[4], ecc_blocks[3];
@@ -1848,15 +1809,17 @@ static int micro_qr_m1(struct zint_symbol *symbol, char binary_data[], int bp) {
     bits_left = bits_total - bp;
     if (bits_left <= 3) {
         if (bits_left) {
-            bp = bin_append_posn(0, bits_left, binary_data, bp);
+            bp = bits_pad_posn(0, bits_left, binary_data, bp);
         }
         latch = 1;
     } else {
-        bp = bin_append_posn(0, 3, binary_data, bp);
+        bp = bits_pad_posn(0, 3, binary_data, bp);
     }
 
     if (symbol->debug & ZINT_DEBUG_PRINT) {
-        printf("M1 Terminated binary (%d): %.*s (bits_left %d)\n", bp, bp, binary_data, bits_left);
+        printf("M1 Terminated binary (%d): ", bp);
+        bits_print(binary_data, 0, bp);
+        printf(" (bits_left %d)\n", bits_left);
     }
 
     if (latch == 0) {
@@ -1864,7 +1827,7 @@ static int micro_qr_m1(struct zint_symbol *symbol, char binary_data[], int bp) {
         bits_left = bits_total - bp;
         if (bits_left <= 4) {
             if (bits_left) {
-                bp = bin_append_posn(0, bits_left, binary_data, bp);
+                bp = bits_pad_posn(0, bits_left, binary_data, bp);
             }
             latch = 1;
         }
@@ -1874,7 +1837,7 @@ static int micro_qr_m1(struct zint_symbol *symbol, char binary_data[], int bp) {
         /* Complete current byte */
         int remainder = 8 - (bp % 8);
         if (remainder != 8) {
-            bp = bin_append_posn(0, remainder, binary_data, bp);
+            bp = bits_pad_posn(0, remainder, binary_data, bp);
         }
 
         /* Add padding */
@@ -1882,10 +1845,10 @@ static int micro_qr_m1(struct zint_symbol *symbol, char binary_data[], int bp) {
         if (bits_left > 4) {
             remainder = (bits_left - 4) / 8;
             for (i = 0; i < remainder; i++) {
-                bp = bin_append_posn(i & 1 ? 0x11 : 0xEC, 8, binary_data, bp);
+                bp = bits_append_posn(i & 1 ? 0x11 : 0xEC, 8, binary_data, bp);
             }
         }
-        bp = bin_append_posn(0, 4, binary_data, bp);
+        bp = bits_pad_posn(0, 4, binary_data, bp);
     }
 
     data_codewords = 3;
@@ -1893,19 +1856,9 @@ static int micro_qr_m1(struct zint_symbol *symbol, char binary_data[], int bp) {
 
     /* Copy data into codewords */
     for (i = 0; i < (data_codewords - 1); i++) {
-        data_blocks[i] = 0;
-        for (j = 0; j < 8; j++) {
-            if (binary_data[(i * 8) + j] == '1') {
-                data_blocks[i] |= 0x80 >> j;
-            }
-        }
-    }
-    data_blocks[2] = 0;
-    for (j = 0; j < 4; j++) {
-        if (binary_data[16 + j] == '1') {
-            data_blocks[2] |= 0x80 >> j;
-        }
+        data_blocks[i] = (unsigned char) bits_peek(binary_data, i * 8, 8);
     }
+    data_blocks[2] = (unsigned char) (bits_peek(binary_data, 16, 4) << 4);
 #ifdef ZINT_TEST
     if (symbol->debug & ZINT_DEBUG_TEST) debug_test_codeword_dump(symbol, data_blocks, data_codewords);
 #endif
@@ -1917,14 +1870,14 @@ static int micro_qr_m1(struct zint_symbol *symbol, char binary_data[], int bp) {
 
     /* Add Reed-Solomon codewords to binary data */
     for (i = 0; i < ecc_codewords; i++) {
-        bp = bin_append_posn(ecc_blocks[ecc_codewords - i - 1], 8, binary_data, bp);
+        bp = bits_append_posn(ecc_blocks[ecc_codewords - i - 1], 8, binary_data, bp);
     }
 
     return bp;
 }
 
-static int micro_qr_m2(struct zint_symbol *symbol, char binary_data[], int bp, const int ecc_mode) {
-    int i, j, latch;
+static int micro_qr_m2(struct zint_symbol *symbol, uint64_t binary_data[], int bp, const int ecc_mode) {
+    int i, latch;
     int bits_total = 0, bits_left;
     int data_codewords = 0, ecc_codewords = 0;
     unsigned char data_blocks[6], ecc_blocks[7];
@@ -1944,29 +1897,31 @@ static int micro_qr_m2(struct zint_symbol *symbol, char binary_data[], int bp, c
     bits_left = bits_total - bp;
     if (bits_left <= 5) {
         if (bits_left) {
-            bp = bin_append_posn(0, bits_left, binary_data, bp);
+            bp = bits_pad_posn(0, bits_left, binary_data, bp);
         }
         latch = 1;
     } else {
-        bp = bin_append_posn(0, 5, binary_data, bp);
+        bp = bits_pad_posn(0, 5, binary_data, bp);
     }
 
     if (symbol->debug & ZINT_DEBUG_PRINT) {
-        printf("M2 Terminated binary (%d): %.*s (bits_left %d)\n", bp, bp, binary_data, bits_left);
+        printf("M2 Terminated binary (%d): ", bp);
+        bits_print(binary_data, 0, bp);
+        printf(" (bits_left %d)\n", bits_left);
     }
 
     if (latch == 0) {
         /* Complete current byte */
         int remainder = 8 - (bp % 8);
         if (remainder != 8) {
-            bp = bin_append_posn(0, remainder, binary_data, bp);
+            bp = bits_pad_posn(0, remainder, binary_data, bp);
         }
 
         /* Add padding */
         bits_left = bits_total - bp;
         remainder = bits_left / 8;
         for (i = 0; i < remainder; i++) {
-            bp = bin_append_posn(i & 1 ? 0x11 : 0xEC, 8, binary_data, bp);
+            bp = bits_append_posn(i & 1 ? 0x11 : 0xEC, 8, binary_data, bp);
         }
     }
 
@@ -1982,13 +1937,7 @@ static int micro_qr_m2(struct zint_symbol *symbol, char binary_data[], int bp, c
 
     /* Copy data into codewords */
     for (i = 0; i < data_codewords; i++) {
-        data_blocks[i] = 0;
-
-        for (j = 0; j < 8; j++) {
-            if (binary_data[(i * 8) + j] == '1') {
-                data_blocks[i] |= 0x80 >> j;
-            }
-        }
+        data_blocks[i] = (unsigned char) bits_peek(binary_data, i * 8, 8);
     }
 #ifdef ZINT_TEST
     if (symbol->debug & ZINT_DEBUG_TEST) debug_test_codeword_dump(symbol, data_blocks, data_codewords);
@@ -2001,14 +1950,14 @@ static int micro_qr_m2(struct zint_symbol *symbol, char binary_data[], int bp, c
 
     /* Add Reed-Solomon codewords to binary data */
     for (i = 0; i < ecc_codewords; i++) {
-        bp = bin_append_posn(ecc_blocks[ecc_codewords - i - 1], 8, binary_data, bp);
+        bp = bits_append_posn(ecc_blocks[ecc_codewords - i - 1], 8, binary_data, bp);
     }
 
     return bp;
 }
 
-static int micro_qr_m3(struct zint_symbol *symbol, char binary_data[], int bp, const int ecc_mode) {
-    int i, j, latch;
+static int micro_qr_m3(struct zint_symbol *symbol, uint64_t binary_data[], int bp, const int ecc_mode) {
+    int i, latch;
     int bits_total = 0, bits_left;
     int data_codewords = 0, ecc_codewords = 0;
     unsigned char data_blocks[12], ecc_blocks[9];
@@ -2028,15 +1977,17 @@ static int micro_qr_m3(struct zint_symbol *symbol, char binary_data[], int bp, c
     bits_left = bits_total - bp;
     if (bits_left <= 7) {
         if (bits_left) {
-            bp = bin_append_posn(0, bits_left, binary_data, bp);
+            bp = bits_pad_posn(0, bits_left, binary_data, bp);
         }
         latch = 1;
     } else {
-        bp = bin_append_posn(0, 7, binary_data, bp);
+        bp = bits_pad_posn(0, 7, binary_data, bp);
     }
 
     if (symbol->debug & ZINT_DEBUG_PRINT) {
-        printf("M3 Terminated binary (%d): %.*s (bits_left %d)\n", bp, bp, binary_data, bits_left);
+        printf("M3 Terminated binary (%d): ", bp);
+        bits_print(binary_data, 0, bp);
+        printf(" (bits_left %d)\n", bits_left);
     }
 
     if (latch == 0) {
@@ -2044,7 +1995,7 @@ static int micro_qr_m3(struct zint_symbol *symbol, char binary_data[], int bp, c
         bits_left = bits_total - bp;
         if (bits_left <= 4) {
             if (bits_left) {
-                bp = bin_append_posn(0, bits_left, binary_data, bp);
+                bp = bits_pad_posn(0, bits_left, binary_data, bp);
             }
             latch = 1;
         }
@@ -2054,7 +2005,7 @@ static int micro_qr_m3(struct zint_symbol *symbol, char binary_data[], int bp, c
         /* Complete current byte */
         int remainder = 8 - (bp % 8);
         if (remainder != 8) {
-            bp = bin_append_posn(0, remainder, binary_data, bp);
+            bp = bits_pad_posn(0, remainder, binary_data, bp);
         }
 
         /* Add padding */
@@ -2062,10 +2013,10 @@ static int micro_qr_m3(struct zint_symbol *symbol, char binary_data[], int bp, c
         if (bits_left > 4) {
             remainder = (bits_left - 4) / 8;
             for (i = 0; i < remainder; i++) {
-                bp = bin_append_posn(i & 1 ? 0x11 : 0xEC, 8, binary_data, bp);
+                bp = bits_append_posn(i & 1 ? 0x11 : 0xEC, 8, binary_data, bp);
             }
         }
-        bp = bin_append_posn(0, 4, binary_data, bp);
+        bp = bits_pad_posn(0, 4, binary_data, bp);
     }
 
     if (ecc_mode == LEVEL_L) {
@@ -2080,31 +2031,15 @@ static int micro_qr_m3(struct zint_symbol *symbol, char binary_data[], int bp, c
 
     /* Copy data into codewords */
     for (i = 0; i < (data_codewords - 1); i++) {
-        data_blocks[i] = 0;
-
-        for (j = 0; j < 8; j++) {
-            if (binary_data[(i * 8) + j] == '1') {
-                data_blocks[i] |= 0x80 >> j;
-            }
-        }
+        data_blocks[i] = (unsigned char) bits_peek(binary_data, i * 8, 8);
     }
 
     if (ecc_mode == LEVEL_L) {
-        data_blocks[10] = 0;
-        for (j = 0; j < 4; j++) {
-            if (binary_data[80 + j] == '1') {
-                data_blocks[10] |= 0x80 >> j;
-            }
-        }
+        data_blocks[10] = (unsigned char) (bits_peek(binary_data, 80, 4) << 4);
     }
 
     if (ecc_mode == LEVEL_M) {
-        data_blocks[8] = 0;
-        for (j = 0; j < 4; j++) {
-            if (binary_data[64 + j] == '1') {
-                data_blocks[8] |= 0x80 >> j;
-            }
-        }
+        data_blocks[8] = (unsigned char) (bits_peek(binary_data, 64, 4) << 4);
     }
 #ifdef ZINT_TEST
     if (symbol->debug & ZINT_DEBUG_TEST) debug_test_codeword_dump(symbol, data_blocks, data_codewords);
@@ -2117,14 +2052,14 @@ static int micro_qr_m3(struct zint_symbol *symbol, char binary_data[], int bp, c
 
     /* Add Reed-Solomon codewords to binary data */
     for (i = 0; i < ecc_codewords; i++) {
-        bp = bin_append_posn(ecc_blocks[ecc_codewords - i - 1], 8, binary_data, bp);
+        bp = bits_append_posn(ecc_blocks[ecc_codewords - i - 1], 8, binary_data, bp);
     }
 
     return bp;
 }
 
-static int micro_qr_m4(struct zint_symbol *symbol, char binary_data[], int bp, const int ecc_mode) {
-    int i, j, latch;
+static int micro_qr_m4(struct zint_symbol *symbol, uint64_t binary_data[], int bp, const int ecc_mode) {
+    int i, latch;
     int bits_total = 0, bits_left;
     int data_codewords = 0, ecc_codewords = 0;
     unsigned char data_blocks[17], ecc_blocks[15];
@@ -2147,29 +2082,31 @@ static int micro_qr_m4(struct zint_symbol *symbol, char binary_data[], int bp, c
     bits_left = bits_total - bp;
     if (bits_left <= 9) {
         if (bits_left) {
-            bp = bin_append_posn(0, bits_left, binary_data, bp);
+            bp = bits_pad_posn(0, bits_left, binary_data, bp);
         }
         latch = 1;
     } else {
-        bp = bin_append_posn(0, 9, binary_data, bp);
+        bp = bits_pad_posn(0, 9, binary_data, bp);
     }
 
     if (symbol->debug & ZINT_DEBUG_PRINT) {
-        printf("M4 Terminated binary (%d): %.*s (bits_left %d)\n", bp, bp, binary_data, bits_left);
+        printf("M4 Terminated binary (%d): ", bp);
+        bits_print(binary_data, 0, bp);
+        printf(" (bits_left %d)\n", bits_left);
     }
 
     if (latch == 0) {
         /* Complete current byte */
         int remainder = 8 - (bp % 8);
         if (remainder != 8) {
-            bp = bin_append_posn(0, remainder, binary_data, bp);
+            bp = bits_pad_posn(0, remainder, binary_data, bp);
         }
 
         /* Add padding */
         bits_left = bits_total - bp;
         remainder = bits_left / 8;
         for (i = 0; i < remainder; i++) {
-            bp = bin_append_posn(i & 1 ? 0x11 : 0xEC, 8, binary_data, bp);
+            bp = bits_append_posn(i & 1 ? 0x11 : 0xEC, 8, binary_data, bp);
         }
     }
 
@@ -2189,13 +2126,7 @@ static int micro_qr_m4(struct zint_symbol *symbol, char binary_data[], int bp, c
 
     /* Copy data into codewords */
     for (i = 0; i < data_codewords; i++) {
-        data_blocks[i] = 0;
-
-        for (j = 0; j < 8; j++) {
-            if (binary_data[(i * 8) + j] == '1') {
-                data_blocks[i] |= 0x80 >> j;
-            }
-        }
+        data_blocks[i] = (unsigned char) bits_peek(binary_data, i * 8, 8);
     }
 #ifdef ZINT_TEST
     if (symbol->debug & ZINT_DEBUG_TEST) debug_test_codeword_dump(symbol, data_blocks, data_codewords);
@@ -2208,7 +2139,7 @@ static int micro_qr_m4(struct zint_symbol *symbol, char binary_data[], int bp, c
 
     /* Add Reed-Solomon codewords to binary data */
     for (i = 0; i < ecc_codewords; i++) {
-        bp = bin_append_posn(ecc_blocks[ecc_codewords - i - 1], 8, binary_data, bp);
+        bp = bits_append_posn(ecc_blocks[ecc_codewords - i - 1], 8, binary_data, bp);
     }
 
     return bp;
@@ -2249,7 +2180,7 @@ static void micro_setup_grid(unsigned char *grid, const int size) {
     grid[(8 * size) + 8] |= 20;
 }
 
-static void micro_populate_grid(unsigned char *grid, const int size, const char full_stream[], int bp) {
+static void micro_populate_grid(unsigned char *grid, const int size, const uint64_t full_stream[], int bp) {
     int direction = 1; /* up */
     int row = 0; /* right hand side */
     int i;
@@ -2261,21 +2192,13 @@ static void micro_populate_grid(unsigned char *grid, const int size, const char
         int x = (size - 2) - (row * 2);
 
         if (!(grid[(y * size) + (x + 1)] & 0xf0)) {
-            if (full_stream[i] == '1') {
-                grid[(y * size) + (x + 1)] = 0x01;
-            } else {
-                grid[(y * size) + (x + 1)] = 0x00;
-            }
+            grid[(y * size) + (x + 1)] = (unsigned char) bits_is_set(full_stream, i);
             i++;
         }
 
         if (i < bp) {
             if (!(grid[(y * size) + x] & 0xf0)) {
-                if (full_stream[i] == '1') {
-                    grid[(y * size) + x] = 0x01;
-                } else {
-                    grid[(y * size) + x] = 0x00;
-                }
+                grid[(y * size) + x] = (unsigned char) bits_is_set(full_stream, i);
                 i++;
             }
         }
@@ -2300,27 +2223,19 @@ static void micro_populate_grid(unsigned char *grid, const int size, const char
     } while (i < bp);
 }
 
-static int micro_evaluate(const unsigned char *grid, const int size, const int pattern) {
-    int sum1, sum2, i, filter = 0, retval;
-
-    switch (pattern) {
-        case 0: filter = 0x01;
-            break;
-        case 1: filter = 0x02;
-            break;
-        case 2: filter = 0x04;
-            break;
-        case 3: filter = 0x08;
-            break;
-    }
+/* Evaluate Micro QR `pattern`, which only depends on the right and bottom edges, so done directly from `grid` and
+   the bitmask array `mask` */
+static int micro_evaluate(const unsigned char *grid, const unsigned char *mask, const int size, const int pattern) {
+    const int right = size - 1, bottom = (size - 1) * size;
+    int sum1, sum2, i, retval;
 
     sum1 = 0;
     sum2 = 0;
     for (i = 1; i < size; i++) {
-        if (grid[(i * size) + size - 1] & filter) {
+        if ((grid[(i * size) + right] ^ (mask[(i * size) + right] >> pattern)) & 0x01) {
             sum1++;
         }
-        if (grid[((size - 1) * size) + i] & filter) {
+        if ((grid[bottom + i] ^ (mask[bottom + i] >> pattern)) & 0x01) {
             sum2++;
         }
     }
@@ -2344,10 +2259,8 @@ static int micro_apply_bitmask(unsigned char *grid, const int size, const int us
 
 #ifndef _MSC_VER
     unsigned char mask[size_squared];
-    unsigned char eval[size_squared];
 #else
     unsigned char *mask = (unsigned char *) _alloca(size_squared);
-    unsigned char *eval = (unsigned char *) _alloca(size_squared);
 #endif
 
     /* Perform data masking */
@@ -2379,19 +2292,10 @@ static int micro_apply_bitmask(unsigned char *grid, const int size, const int us
     if (user_mask) {
         best_pattern = user_mask - 1;
     } else {
-        for (k = 0; k < size_squared; k++) {
-            if (grid[k] & 0x01) {
-                eval[k] = mask[k] ^ 0xff;
-            } else {
-                eval[k] = mask[k];
-            }
-        }
-
-
         /* Evaluate result */
         best_pattern = 0;
         for (pattern = 0; pattern < 4; pattern++) {
-            value[pattern] = micro_evaluate(eval, size, pattern);
+            value[pattern] = micro_evaluate(grid, mask, size, pattern);
             if (value[pattern] > value[best_pattern]) {
                 best_pattern = pattern;
             }
@@ -2423,13 +2327,16 @@ static int micro_apply_bitmask(unsigned char *grid, const int size, const int us
 
 INTERNAL int microqr(struct zint_symbol *symbol, unsigned char source[], int length) {
     int i, size, j;
-    char full_stream[200];
+    uint64_t full_stream[BITS_WORDS(200)];
     int bp;
     int full_multibyte;
     int user_mask;
 
     unsigned int jisdata[40];
-    char mode[40];
+    struct qr_memo memo;
+    char memo_modes[4 * 40];
+    unsigned int fast_sums[FAST_SUMS_SIZE(40, QR_NUM_MODES)];
+    const char *mode = NULL;
     int alpha_used = 0, byte_or_kanji_used = 0;
     int version_valid[4];
     int binary_count[4];
@@ -2519,11 +2426,12 @@ INTERNAL int microqr(struct zint_symbol *symbol, unsigned char source[], int len
         version_valid[0] = 0;
     }
 
-    /* Determine length of binary data */
+    /* Determine length of binary data (each version is its own CCI class) */
+    qr_memo_init(&memo, memo_modes, 4, jisdata, length, NULL /*p_structapp*/, 0 /*gs1*/, 0 /*eci*/,
+                symbol->input_mode & FAST_MODE ? fast_sums : NULL, debug_print);
     for (i = 0; i < 4; i++) {
         if (version_valid[i]) {
-            binary_count[i] = getBinaryLength(MICROQR_VERSION + i, mode, jisdata, length, NULL /*p_structapp*/,
-                                0 /*gs1*/, 0 /*eci*/, debug_print);
+            binary_count[i] = qr_memo_get(&memo, MICROQR_VERSION + i, &mode);
         } else {
             binary_count[i] = 128 + 1;
         }
@@ -2605,12 +2513,16 @@ INTERNAL int microqr(struct zint_symbol *symbol, unsigned char source[], int len
         }
     }
 
-    qr_define_mode(mode, jisdata, length, 0 /*gs1*/, MICROQR_VERSION + version, debug_print);
+    (void) qr_memo_get(&memo, MICROQR_VERSION + version, &mode);
 
     bp = qr_binary((unsigned char *) full_stream, MICROQR_VERSION + version, 0 /*target_codewords*/, mode, jisdata,
                     length, NULL /*p_structapp*/, 0 /*gs1*/, 0 /*eci*/, binary_count[version], debug_print);
 
-    if (debug_print) printf("Binary (%d): %.*s\n", bp, bp, full_stream);
+    if (debug_print) {
+        printf("Binary (%d): ", bp);
+        bits_print(full_stream, 0, bp);
+        putchar('\n');
+    }
 
     switch (version) {
         case 0: bp = micro_qr_m1(symbol, full_stream, bp);
@@ -2786,7 +2698,8 @@ INTERNAL int upnqr(struct zint_symbol *symbol, unsigned char source[], int lengt
             break;
     }
 
-    est_binlen = getBinaryLength(15, mode, jisdata, length, NULL /*p_structapp*/, 0, symbol->eci, debug_print);
+    est_binlen = getBinaryLength(15, mode, jisdata, length, NULL /*p_structapp*/, 0, symbol->eci, NULL /*fast_sums*/,
+                    debug_print);
 
     ecc_level = LEVEL_M;
 
@@ -2829,9 +2742,11 @@ INTERNAL int upnqr(struct zint_symbol *symbol, unsigned char source[], int lengt
 
     add_version_info(grid, size, version);
 
-    bitmask = apply_bitmask(grid, size, ecc_level, 0 /*user_mask*/, debug_print);
+    if ((bitmask = apply_bitmask(symbol, grid, size, ecc_level, 0 /*user_mask*/, debug_print)) < 0) {
+        return ZINT_ERROR_MEMORY;
+    }
 
-    add_format_info(grid, size, ecc_level, bitmask);
+    add_format_info(grid, size, ecc_level, bitmask, 0 /*shift*/);
 
     symbol->width = size;
     symbol->rows = size;
@@ -2967,23 +2882,26 @@ static void setup_rmqr_grid(unsigned char *grid, const int h_size, const int v_s
 /* rMQR according to 2018 draft standard */
 INTERNAL int rmqr(struct zint_symbol *symbol, unsigned char source[], int length) {
     int i, j, est_binlen;
-    int ecc_level, autosize, version, max_cw, target_codewords, blocks, h_size, v_size;
+    int ecc_level, autosize, version, target_codewords, blocks, h_size, v_size;
     int gs1;
     int full_multibyte;
     int footprint, best_footprint, format_data;
     unsigned int left_format_info, right_format_info;
     const int debug_print = symbol->debug & ZINT_DEBUG_PRINT;
     const int eci_length = get_eci_length(symbol->eci, source, length);
+    const unsigned short int *data_codewords;
+    struct qr_memo memo;
+    char *memo_modes;
+    unsigned int *fast_sums = NULL;
+    const char *mode;
 
 #ifndef _MSC_VER
     unsigned int jisdata[eci_length + 1];
-    char mode[eci_length + 1];
 #else
     unsigned char *datastream;
     unsigned char *fullstream;
     unsigned char *grid;
     unsigned int *jisdata = (unsigned int *) _alloca((eci_length + 1) * sizeof(unsigned int));
-    char *mode = (char *) _alloca(eci_length + 1);
 #endif
 
     gs1 = ((symbol->input_mode & 0x07) == GS1_MODE);
@@ -3013,11 +2931,21 @@ INTERNAL int rmqr(struct zint_symbol *symbol, unsigned char source[], int length
         }
     }
 
-    est_binlen = getBinaryLength(RMQR_VERSION + 31, mode, jisdata, length, NULL /*p_structapp*/, gs1, symbol->eci,
-                    debug_print);
+    /* The 32 rMQR versions fall into 14 CCI classes */
+    if (!(memo_modes = (char *) scratch_alloc(symbol, QR_MEMO_MAX * length))) {
+        return ZINT_ERROR_MEMORY;
+    }
+    if ((symbol->input_mode & FAST_MODE) && !(fast_sums = (unsigned int *) scratch_alloc(symbol,
+                                                    sizeof(unsigned int) * FAST_SUMS_SIZE(length, QR_NUM_MODES)))) {
+        return ZINT_ERROR_MEMORY;
+    }
+    qr_memo_init(&memo, memo_modes, QR_MEMO_MAX, jisdata, length, NULL /*p_structapp*/, gs1, symbol->eci,
+                fast_sums, debug_print);
+
+    est_binlen = qr_memo_get(&memo, RMQR_VERSION + 31, &mode);
 
     ecc_level = LEVEL_M;
-    max_cw = 152;
+    data_codewords = rmqr_data_codewords_M;
     if (symbol->option_1 == 1) {
         strcpy(symbol->errtxt, "576: Error correction level L not available in rMQR");
         return ZINT_ERROR_INVALID_OPTION;
@@ -3030,10 +2958,10 @@ INTERNAL int rmqr(struct zint_symbol *symbol, unsigned char source[], int length
 
     if (symbol->option_1 == 4) {
         ecc_level = LEVEL_H;
-        max_cw = 76;
+        data_codewords = rmqr_data_codewords_H;
     }
 
-    if (est_binlen > (8 * max_cw)) {
+    if (est_binlen > (8 * data_codewords[31])) {
         strcpy(symbol->errtxt, "578: Input too long for selected error correction level");
         return ZINT_ERROR_TOO_LONG;
     }
@@ -3050,55 +2978,32 @@ INTERNAL int rmqr(struct zint_symbol *symbol, unsigned char source[], int length
         autosize = 31;
         best_footprint = rmqr_height[31] * rmqr_width[31];
         for (version = 30; version >= 0; version--) {
-            est_binlen = getBinaryLength(RMQR_VERSION + version, mode, jisdata, length, NULL /*p_structapp*/, gs1,
-                            symbol->eci, debug_print);
             footprint = rmqr_height[version] * rmqr_width[version];
-            if (ecc_level == LEVEL_M) {
-                if (8 * rmqr_data_codewords_M[version] >= est_binlen) {
-                    if (footprint < best_footprint) {
-                        autosize = version;
-                        best_footprint = footprint;
-                    }
-                }
-            } else {
-                if (8 * rmqr_data_codewords_H[version] >= est_binlen) {
-                    if (footprint < best_footprint) {
-                        autosize = version;
-                        best_footprint = footprint;
-                    }
-                }
+            if (footprint < best_footprint
+                    && 8 * data_codewords[version] >= qr_memo_get(&memo, RMQR_VERSION + version, &mode)) {
+                autosize = version;
+                best_footprint = footprint;
             }
         }
         version = autosize;
-        est_binlen = getBinaryLength(RMQR_VERSION + version, mode, jisdata, length, NULL /*p_structapp*/, gs1,
-                        symbol->eci, debug_print);
+        est_binlen = qr_memo_get(&memo, RMQR_VERSION + version, &mode);
     }
 
     if ((symbol->option_2 >= 1) && (symbol->option_2 <= 32)) {
         // User specified symbol size
         version = symbol->option_2 - 1;
-        est_binlen = getBinaryLength(RMQR_VERSION + version, mode, jisdata, length, NULL /*p_structapp*/, gs1,
-                        symbol->eci, debug_print);
+        est_binlen = qr_memo_get(&memo, RMQR_VERSION + version, &mode);
     }
 
     if (symbol->option_2 >= 33) {
         // User has specified symbol height only
         version = rmqr_fixed_height_upper_bound[symbol->option_2 - 32];
         for (i = version - 1; i > rmqr_fixed_height_upper_bound[symbol->option_2 - 33]; i--) {
-            est_binlen = getBinaryLength(RMQR_VERSION + i, mode, jisdata, length, NULL /*p_structapp*/, gs1,
-                            symbol->eci, debug_print);
-            if (ecc_level == LEVEL_M) {
-                if (8 * rmqr_data_codewords_M[i] >= est_binlen) {
-                    version = i;
-                }
-            } else {
-                if (8 * rmqr_data_codewords_H[i] >= est_binlen) {
-                    version = i;
-                }
+            if (8 * data_codewords[i] >= qr_memo_get(&memo, RMQR_VERSION + i, &mode)) {
+                version = i;
             }
         }
-        est_binlen = getBinaryLength(RMQR_VERSION + version, mode, jisdata, length, NULL /*p_structapp*/, gs1,
-                        symbol->eci, debug_print);
+        est_binlen = qr_memo_get(&memo, RMQR_VERSION + version, &mode);
     }
 
     if (symbol->option_1 == -1) {
@@ -51,6 +51,8 @@
 
 #define UPCEAN_TEXT     1
 
+#define ROTATE_TILE     64 /* Tile size (pixels) for rotation */
+
 #ifndef NO_PNG
 INTERNAL int png_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf);
 #endif /* NO_PNG */
@@ -61,10 +63,9 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
 
 static const char ultra_colour[] = "0CBMRYGKW";
 
-static int buffer_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf) {
-    /* Place pixelbuffer into symbol */
-    int fgalpha, bgalpha;
-    unsigned char map[91][3] = {
+/* Set `map` to the RGB values of the pixel codes used in pixel buffers */
+static void buffer_colour_map(const struct zint_symbol *symbol, unsigned char map[91][3]) {
+    static const unsigned char colours[91][3] = {
         {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, /* 0x00-0F */
         {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, /* 0x10-1F */
         {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, {0}, /* 0x20-2F */
@@ -75,16 +76,94 @@ static int buffer_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf
         {0}, {0}, {0}, { 0xff, 0, 0 } /*Red*/, {0}, {0}, {0}, {0}, /* O-V */
         { 0xff, 0xff, 0xff } /*White*/, {0}, { 0xff, 0xff, 0 } /*Yellow*/, {0} /* W-Z */
     };
-    int row;
-    int plot_alpha = 0;
-    const size_t bm_bitmap_width = (size_t) symbol->bitmap_width * 3;
 
+    memcpy(map, colours, sizeof(colours));
     map[DEFAULT_INK][0] = (16 * ctoi(symbol->fgcolour[0])) + ctoi(symbol->fgcolour[1]);
     map[DEFAULT_INK][1] = (16 * ctoi(symbol->fgcolour[2])) + ctoi(symbol->fgcolour[3]);
     map[DEFAULT_INK][2] = (16 * ctoi(symbol->fgcolour[4])) + ctoi(symbol->fgcolour[5]);
     map[DEFAULT_PAPER][0] = (16 * ctoi(symbol->bgcolour[0])) + ctoi(symbol->bgcolour[1]);
     map[DEFAULT_PAPER][1] = (16 * ctoi(symbol->bgcolour[2])) + ctoi(symbol->bgcolour[3]);
     map[DEFAULT_PAPER][2] = (16 * ctoi(symbol->bgcolour[4])) + ctoi(symbol->bgcolour[5]);
+}
+
+/* Place pixelbuffer into symbol as 1 bit (OUT_BUFFER_1BPP) or 8-bit grayscale (OUT_BUFFER_8BPP) per pixel, with rows
+   padded with zeroes to a multiple of `symbol->bitmap_align` bytes */
+static int buffer_plot_packed(struct zint_symbol *symbol, const unsigned char *pixelbuf) {
+    const int is_1bpp = symbol->output_options & OUT_BUFFER_1BPP;
+    const int width = symbol->bitmap_width;
+    const size_t align = symbol->bitmap_align > 1 ? symbol->bitmap_align : 1;
+    const size_t row_len = is_1bpp ? (width + 7) / 8 : width;
+    const size_t stride = (row_len + align - 1) & ~(align - 1);
+    unsigned char rgb[91][3];
+    unsigned char map[91];
+    int row, i;
+
+    if (is_1bpp) {
+        /* Set for foreground, i.e. anything other than background or Ultracode white */
+        memset(map, 1, sizeof(map));
+        map[DEFAULT_PAPER] = map['W'] = 0;
+    } else {
+        /* ITU-R BT.601 luma */
+        buffer_colour_map(symbol, rgb);
+        for (i = 0; i < 91; i++) {
+            map[i] = (unsigned char) ((299 * rgb[i][0] + 587 * rgb[i][1] + 114 * rgb[i][2] + 500) / 1000);
+        }
+    }
+
+    /* Free any previous bitmap */
+    if (symbol->bitmap != NULL) {
+        z_free(symbol->bitmap);
+        symbol->bitmap = NULL;
+    }
+    if (symbol->alphamap != NULL) {
+        z_free(symbol->alphamap);
+        symbol->alphamap = NULL;
+    }
+
+    symbol->bitmap = (unsigned char *) z_calloc(stride, symbol->bitmap_height);
+    if (symbol->bitmap == NULL) {
+        strcpy(symbol->errtxt, "661: Insufficient memory for bitmap buffer");
+        return ZINT_ERROR_MEMORY;
+    }
+    symbol->bitmap_stride = (int) stride;
+
+    for (row = 0; row < symbol->bitmap_height; row++) {
+        const unsigned char *pb = pixelbuf + (size_t) width * row;
+        unsigned char *bitmap = symbol->bitmap + stride * row;
+        if (row && memcmp(pb, pb - width, width) == 0) {
+            memcpy(bitmap, bitmap - stride, row_len);
+        } else if (is_1bpp) {
+            const int full_len = width >> 3;
+            for (i = 0; i < full_len; i++, pb += 8) {
+                bitmap[i] = (map[pb[0]] << 7) | (map[pb[1]] << 6) | (map[pb[2]] << 5) | (map[pb[3]] << 4)
+                            | (map[pb[4]] << 3) | (map[pb[5]] << 2) | (map[pb[6]] << 1) | map[pb[7]];
+            }
+            for (i = 0; i < (width & 7); i++) {
+                bitmap[full_len] |= map[pb[i]] << (7 - i);
+            }
+        } else {
+            for (i = 0; i < width; i++) {
+                bitmap[i] = map[pb[i]];
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int buffer_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf) {
+    /* Place pixelbuffer into symbol */
+    int fgalpha, bgalpha;
+    unsigned char map[91][3];
+    int row;
+    int plot_alpha = 0;
+    const size_t bm_bitmap_width = (size_t) symbol->bitmap_width * 3;
+
+    if (symbol->output_options & (OUT_BUFFER_1BPP | OUT_BUFFER_8BPP)) {
+        return buffer_plot_packed(symbol, pixelbuf);
+    }
+
+    buffer_colour_map(symbol, map);
 
     if (strlen(symbol->fgcolour) > 6) {
         fgalpha = (16 * ctoi(symbol->fgcolour[6])) + ctoi(symbol->fgcolour[7]);
@@ -102,22 +181,23 @@ static int buffer_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf
 
     /* Free any previous bitmap */
     if (symbol->bitmap != NULL) {
-        free(symbol->bitmap);
+        z_free(symbol->bitmap);
         symbol->bitmap = NULL;
     }
     if (symbol->alphamap != NULL) {
-        free(symbol->alphamap);
+        z_free(symbol->alphamap);
         symbol->alphamap = NULL;
     }
 
-    symbol->bitmap = (unsigned char *) malloc(bm_bitmap_width * symbol->bitmap_height);
+    symbol->bitmap = (unsigned char *) z_malloc(bm_bitmap_width * symbol->bitmap_height);
     if (symbol->bitmap == NULL) {
         strcpy(symbol->errtxt, "661: Insufficient memory for bitmap buffer");
         return ZINT_ERROR_MEMORY;
     }
+    symbol->bitmap_stride = (int) bm_bitmap_width;
 
     if (plot_alpha) {
-        symbol->alphamap = (unsigned char *) malloc((size_t) symbol->bitmap_width * symbol->bitmap_height);
+        symbol->alphamap = (unsigned char *) z_malloc((size_t) symbol->bitmap_width * symbol->bitmap_height);
         if (symbol->alphamap == NULL) {
             strcpy(symbol->errtxt, "662: Insufficient memory for alphamap buffer");
             return ZINT_ERROR_MEMORY;
@@ -156,10 +236,53 @@ static int buffer_plot(struct zint_symbol *symbol, const unsigned char *pixelbuf
     return 0;
 }
 
+/* Rotate `pixelbuf` (`image_width` x `image_height`) clockwise by `rotate_angle` into `rotated_pixbuf`.
+   90/270 degrees are done in ROTATE_TILE-square tiles so that the source rows read stay in cache */
+static void rotate_pixbuf(const unsigned char *pixelbuf, unsigned char *rotated_pixbuf, const int image_width,
+            const int image_height, const int rotate_angle) {
+    const size_t stride = image_width;
+    int row, column, tile_row, tile_column;
+
+    switch (rotate_angle) {
+        case 90: /* Plot 90 degrees clockwise */
+        case 270: /* Plot 90 degrees anti-clockwise */
+            for (tile_row = 0; tile_row < image_width; tile_row += ROTATE_TILE) {
+                const int row_end = tile_row + ROTATE_TILE < image_width ? tile_row + ROTATE_TILE : image_width;
+                for (tile_column = 0; tile_column < image_height; tile_column += ROTATE_TILE) {
+                    const int column_end = tile_column + ROTATE_TILE < image_height ? tile_column + ROTATE_TILE
+                                            : image_height;
+                    for (row = tile_row; row < row_end; row++) {
+                        unsigned char *dst = rotated_pixbuf + (size_t) image_height * row;
+                        if (rotate_angle == 90) {
+                            const unsigned char *src = pixelbuf + stride * (image_height - 1) + row;
+                            for (column = tile_column; column < column_end; column++) {
+                                dst[column] = *(src - stride * column);
+                            }
+                        } else {
+                            const unsigned char *src = pixelbuf + stride - 1 - row;
+                            for (column = tile_column; column < column_end; column++) {
+                                dst[column] = src[stride * column];
+                            }
+                        }
+                    }
+                }
+            }
+            break;
+        case 180: /* Plot upside down */
+            for (row = 0; row < image_height; row++) {
+                const unsigned char *src = pixelbuf + stride * (image_height - row) - 1;
+                unsigned char *dst = rotated_pixbuf + stride * row;
+                for (column = 0; column < image_width; column++) {
+                    dst[column] = *(src - column);
+                }
+            }
+            break;
+    }
+}
+
 static int save_raster_image_to_file(struct zint_symbol *symbol, const int image_height, const int image_width,
             unsigned char *pixelbuf, int rotate_angle, const int file_type) {
     int error_number;
-    int row, column;
 
     unsigned char *rotated_pixbuf = pixelbuf;
 
@@ -179,55 +302,30 @@ static int save_raster_image_to_file(struct zint_symbol *symbol, const int image
     }
 
     if (rotate_angle) {
-        if (!(rotated_pixbuf = (unsigned char *) malloc((size_t) image_width * image_height))) {
+        if (!(rotated_pixbuf = (unsigned char *) z_malloc((size_t) image_width * image_height))) {
             strcpy(symbol->errtxt, "650: Insufficient memory for pixel buffer");
             return ZINT_ERROR_MEMORY;
         }
     }
 
     /* Rotate image before plotting */
-    switch (rotate_angle) {
-        case 0: /* Plot the right way up */
-            /* Nothing to do */
-            break;
-        case 90: /* Plot 90 degrees clockwise */
-            for (row = 0; row < image_width; row++) {
-                for (column = 0; column < image_height; column++) {
-                    rotated_pixbuf[(row * image_height) + column] =
-                            *(pixelbuf + (image_width * (image_height - column - 1)) + row);
-                }
-            }
-            break;
-        case 180: /* Plot upside down */
-            for (row = 0; row < image_height; row++) {
-                for (column = 0; column < image_width; column++) {
-                    rotated_pixbuf[(row * image_width) + column] =
-                            *(pixelbuf + (image_width * (image_height - row - 1)) + (image_width - column - 1));
-                }
-            }
-            break;
-        case 270: /* Plot 90 degrees anti-clockwise */
-            for (row = 0; row < image_width; row++) {
-                for (column = 0; column < image_height; column++) {
-                    rotated_pixbuf[(row * image_height) + column] =
-                            *(pixelbuf + (image_width * column) + (image_width - row - 1));
-                }
-            }
-            break;
+    if (rotate_angle) {
+        rotate_pixbuf(pixelbuf, rotated_pixbuf, image_width, image_height, rotate_angle);
     }
 
     switch (file_type) {
         case OUT_BUFFER:
             if (symbol->output_options & OUT_BUFFER_INTERMEDIATE) {
                 if (symbol->bitmap != NULL) {
-                    free(symbol->bitmap);
+                    z_free(symbol->bitmap);
                     symbol->bitmap = NULL;
                 }
                 if (symbol->alphamap != NULL) {
-                    free(symbol->alphamap);
+                    z_free(symbol->alphamap);
                     symbol->alphamap = NULL;
                 }
                 symbol->bitmap = rotated_pixbuf;
+                symbol->bitmap_stride = symbol->bitmap_width;
                 rotate_angle = 0; /* Suppress freeing buffer if rotated */
                 error_number = 0;
             } else {
@@ -239,7 +337,7 @@ static int save_raster_image_to_file(struct zint_symbol *symbol, const int image
             error_number = png_pixel_plot(symbol, rotated_pixbuf);
 #else
             if (rotate_angle) {
-                free(rotated_pixbuf);
+                z_free(rotated_pixbuf);
             }
             return ZINT_ERROR_INVALID_OPTION;
 #endif
@@ -259,7 +357,7 @@ static int save_raster_image_to_file(struct zint_symbol *symbol, const int image
     }
 
     if (rotate_angle) {
-        free(rotated_pixbuf);
+        z_free(rotated_pixbuf);
     }
     return error_number;
 }
@@ -466,21 +564,76 @@ static void draw_string(unsigned char *pixbuf, const unsigned char input_string[
     }
 }
 
-/* Draw disc using x² + y² <= r² */
-static void draw_circle(unsigned char *pixelbuf, const int image_width, const int image_height,
-            const int x0, const int y0, const float radius, const char fill) {
-    int x, y;
-    const int radius_i = (int) radius;
-    const int radius_squared = radius_i * radius_i;
-
-    for (y = -radius_i; y <= radius_i; y++) {
-        const int y_squared = y * y;
-        for (x = -radius_i; x <= radius_i; x++) {
-            if ((x * x) + y_squared <= radius_squared) {
-                draw_pt(pixelbuf, image_width, image_height, x0 + x, y0 + y, fill);
+/* Horizontal run of a sprite (dot or hexagon), relative to the sprite's origin */
+struct sprite_span {
+    int y;
+    int x;
+    int len;
+};
+
+/* Blit sprite `spans` at (`xposn`, `yposn`), clipping each span to the image */
+static void draw_sprite(unsigned char *pixelbuf, const int image_width, const int image_height,
+            const struct sprite_span *spans, const int span_count, const int xposn, const int yposn,
+            const char fill) {
+    int i;
+
+    for (i = 0; i < span_count; i++) {
+        const int y = yposn + spans[i].y;
+        int x = xposn + spans[i].x;
+        int xe = x + spans[i].len;
+        if (y < 0 || y >= image_height) {
+            continue;
+        }
+        if (x < 0) {
+            x = 0;
+        }
+        if (xe > image_width) {
+            xe = image_width;
+        }
+        if (x < xe) {
+            memset(pixelbuf + ((size_t) image_width * y) + x, fill, xe - x);
+        }
+    }
+}
+
+/* Set `spans` (2 * radius + 1 of them) to disc using x² + y² <= r², centred on the origin */
+static void plot_circle_spans(struct sprite_span *spans, const int radius) {
+    const int radius_squared = radius * radius;
+    int x = 0, y;
+
+    for (y = 0; y <= radius; y++) {
+        /* Widest x for row `radius - y`, which only increases going down to the centre */
+        const int y_squared = (radius - y) * (radius - y);
+        while ((x + 1) * (x + 1) + y_squared <= radius_squared) {
+            x++;
+        }
+        spans[y].y = y - radius;
+        spans[2 * radius - y].y = radius - y;
+        spans[y].x = spans[2 * radius - y].x = -x;
+        spans[y].len = spans[2 * radius - y].len = 2 * x + 1;
+    }
+}
+
+/* Set `spans` to the ink runs of `bitmap` - returns number of spans (at most `height` * ((`width` + 1) / 2)) */
+static int plot_bitmap_spans(struct sprite_span *spans, const unsigned char *bitmap, const int width,
+            const int height) {
+    int x, y, count = 0;
+
+    for (y = 0; y < height; y++, bitmap += width) {
+        for (x = 0; x < width; x++) {
+            if (bitmap[x] == DEFAULT_INK) {
+                const int start = x;
+                while (x + 1 < width && bitmap[x + 1] == DEFAULT_INK) {
+                    x++;
+                }
+                spans[count].y = y;
+                spans[count].x = start;
+                spans[count].len = x + 1 - start;
+                count++;
             }
         }
     }
+    return count;
 }
 
 /* Helper for `draw_mp_circle()` to draw horizontal filler lines within disc */
@@ -554,21 +707,6 @@ static void draw_bullseye(unsigned char *pixelbuf, const int image_width, const
     draw_mp_circle(pixelbuf, image_width, image_height, x, y, r1, DEFAULT_PAPER);
 }
 
-/* Put a hexagon into the pixel buffer */
-static void draw_hexagon(unsigned char *pixelbuf, const int image_width, const int image_height,
-            const unsigned char *scaled_hexagon, const int hex_width, const int hex_height,
-            const int xposn, const int yposn) {
-    int i, j;
-
-    for (i = 0; i < hex_height; i++) {
-        for (j = 0; j < hex_width; j++) {
-            if (scaled_hexagon[(i * hex_width) + j] == DEFAULT_INK) {
-                draw_pt(pixelbuf, image_width, image_height, xposn + j, yposn + i, DEFAULT_INK);
-            }
-        }
-    }
-}
-
 /* Bresenham's line algorithm https://en.wikipedia.org/wiki/Bresenham's_line_algorithm
  * Creative Commons Attribution-ShareAlike License
  * https://en.wikipedia.org/wiki/Wikipedia:Text_of_Creative_Commons_Attribution-ShareAlike_3.0_Unported_License */
@@ -712,6 +850,8 @@ static int plot_raster_maxicode(struct zint_symbol *symbol, const int rotate_ang
     float xoffset, yoffset, roffset, boffset;
     float scaler = symbol->scale;
     unsigned char *scaled_hexagon;
+    struct sprite_span *hex_spans;
+    int hex_span_count;
     int hex_width, hex_height;
     int hx_start, hy_start, hx_end, hy_end;
     int hex_image_width, hex_image_height;
@@ -752,21 +892,32 @@ static int plot_raster_maxicode(struct zint_symbol *symbol, const int rotate_ang
     image_width = (int) ceilf(hex_image_width + xoffset_si + roffset_si);
     image_height = (int) ceilf(hex_image_height + yoffset_si + boffset_si);
 
-    if (!(pixelbuf = (unsigned char *) malloc((size_t) image_width * image_height))) {
+    if (!(pixelbuf = (unsigned char *) z_malloc((size_t) image_width * image_height))) {
         strcpy(symbol->errtxt, "655: Insufficient memory for pixel buffer");
         return ZINT_ERROR_MEMORY;
     }
     memset(pixelbuf, DEFAULT_PAPER, (size_t) image_width * image_height);
 
-    if (!(scaled_hexagon = (unsigned char *) malloc((size_t) hex_width * hex_height))) {
+    if (!(scaled_hexagon = (unsigned char *) z_malloc((size_t) hex_width * hex_height))) {
         strcpy(symbol->errtxt, "656: Insufficient memory for pixel buffer");
-        free(pixelbuf);
+        z_free(pixelbuf);
         return ZINT_ERROR_MEMORY;
     }
     memset(scaled_hexagon, DEFAULT_PAPER, (size_t) hex_width * hex_height);
 
     plot_hexagon(scaled_hexagon, hex_width, hex_height, hx_start, hy_start, hx_end, hy_end);
 
+    /* Plot hexagons as spans of the rasterised hexagon */
+    if (!(hex_spans = (struct sprite_span *) z_malloc(sizeof(struct sprite_span) * hex_height
+                                                        * ((hex_width + 1) / 2)))) {
+        strcpy(symbol->errtxt, "665: Insufficient memory for hexagon spans");
+        z_free(scaled_hexagon);
+        z_free(pixelbuf);
+        return ZINT_ERROR_MEMORY;
+    }
+    hex_span_count = plot_bitmap_spans(hex_spans, scaled_hexagon, hex_width, hex_height);
+    z_free(scaled_hexagon);
+
     for (row = 0; row < symbol->rows; row++) {
         const int odd_row = row & 1; /* Odd (reduced) row, even (full) row */
         const int yposn = row * yposn_offset + yoffset_si - hy_start;
@@ -774,8 +925,8 @@ static int plot_raster_maxicode(struct zint_symbol *symbol, const int rotate_ang
         for (column = 0; column < symbol->width - odd_row; column++) {
             const int xposn = column * hex_width + xposn_offset;
             if (module_is_set(symbol, row, column)) {
-                draw_hexagon(pixelbuf, image_width, image_height, scaled_hexagon, hex_width, hex_height, xposn,
-                            yposn);
+                draw_sprite(pixelbuf, image_width, image_height, hex_spans, hex_span_count, xposn, yposn,
+                            DEFAULT_INK);
             }
         }
     }
@@ -786,10 +937,11 @@ static int plot_raster_maxicode(struct zint_symbol *symbol, const int rotate_ang
     draw_bind_box(symbol, pixelbuf, xoffset_si, yoffset_si, hex_image_height, 0 /*dot_overspill_si*/,
                 image_width, image_height, (int) scaler);
 
+    z_free(hex_spans);
+
     error_number = save_raster_image_to_file(symbol, image_height, image_width, pixelbuf, rotate_angle, file_type);
-    free(scaled_hexagon);
     if (rotate_angle || file_type != OUT_BUFFER || !(symbol->output_options & OUT_BUFFER_INTERMEDIATE)) {
-        free(pixelbuf);
+        z_free(pixelbuf);
     }
     if (error_number == 0) {
         /* Check whether size is compliant */
@@ -815,6 +967,7 @@ static int plot_raster_dotty(struct zint_symbol *symbol, const int rotate_angle,
     int dot_overspill_si;
     int xoffset_si, yoffset_si, roffset_si, boffset_si;
     int symbol_height_si;
+    struct sprite_span *dot_spans;
 
     if (scaler < 2.0f) {
         scaler = 2.0f;
@@ -843,23 +996,31 @@ static int plot_raster_dotty(struct zint_symbol *symbol, const int rotate_angle,
     scale_height = (int) (symbol_height_si + yoffset_si + boffset_si + dot_overspill_si);
 
     /* Apply scale options by creating another pixel buffer */
-    if (!(scaled_pixelbuf = (unsigned char *) malloc((size_t) scale_width * scale_height))) {
+    if (!(scaled_pixelbuf = (unsigned char *) z_malloc((size_t) scale_width * scale_height))) {
         strcpy(symbol->errtxt, "657: Insufficient memory for pixel buffer");
         return ZINT_ERROR_MEMORY;
     }
     memset(scaled_pixelbuf, DEFAULT_PAPER, (size_t) scale_width * scale_height);
 
+    /* Dots are all the same so compute their spans once */
+    if (!(dot_spans = (struct sprite_span *) z_malloc(sizeof(struct sprite_span) * (2 * dot_radius_si + 1)))) {
+        strcpy(symbol->errtxt, "666: Insufficient memory for dot spans");
+        z_free(scaled_pixelbuf);
+        return ZINT_ERROR_MEMORY;
+    }
+    plot_circle_spans(dot_spans, dot_radius_si);
+
     /* Plot the body of the symbol to the pixel buffer */
     for (r = 0; r < symbol->rows; r++) {
         int row_si = (int) (r * scaler + yoffset_si + dot_offset_s);
         for (i = 0; i < symbol->width; i++) {
             if (module_is_set(symbol, r, i)) {
-                draw_circle(scaled_pixelbuf, scale_width, scale_height,
-                            (int) (i * scaler + xoffset_si + dot_offset_s),
-                            row_si, dot_radius_si, DEFAULT_INK);
+                draw_sprite(scaled_pixelbuf, scale_width, scale_height, dot_spans, 2 * dot_radius_si + 1,
+                            (int) (i * scaler + xoffset_si + dot_offset_s), row_si, DEFAULT_INK);
             }
         }
     }
+    z_free(dot_spans);
 
     draw_bind_box(symbol, scaled_pixelbuf, xoffset_si, yoffset_si, symbol_height_si, dot_overspill_si,
                 scale_width, scale_height, (int) scaler);
@@ -867,7 +1028,7 @@ static int plot_raster_dotty(struct zint_symbol *symbol, const int rotate_angle,
     error_number = save_raster_image_to_file(symbol, scale_height, scale_width, scaled_pixelbuf, rotate_angle,
                                             file_type);
     if (rotate_angle || file_type != OUT_BUFFER || !(symbol->output_options & OUT_BUFFER_INTERMEDIATE)) {
-        free(scaled_pixelbuf);
+        z_free(scaled_pixelbuf);
     }
 
     return error_number;
@@ -997,7 +1158,7 @@ static int plot_raster_default(struct zint_symbol *symbol, const int rotate_angl
     image_width = symbol->width * si + xoffset_si + roffset_si;
     image_height = symbol_height_si + textoffset * si + yoffset_si + boffset_si;
 
-    if (!(pixelbuf = (unsigned char *) malloc((size_t) image_width * image_height))) {
+    if (!(pixelbuf = (unsigned char *) z_malloc((size_t) image_width * image_height))) {
         strcpy(symbol->errtxt, "658: Insufficient memory for pixel buffer");
         return ZINT_ERROR_MEMORY;
     }
@@ -1286,17 +1447,29 @@ static int plot_raster_default(struct zint_symbol *symbol, const int rotate_angl
     if (!half_int_scaling) {
         size_t prev_image_row;
         unsigned char *scaled_pixelbuf;
+        int *column_map;
         const int scale_width = (int) stripf(image_width * scaler);
         const int scale_height = (int) stripf(image_height * scaler);
 
         /* Apply scale options by creating another pixel buffer */
-        if (!(scaled_pixelbuf = (unsigned char *) malloc((size_t) scale_width * scale_height))) {
-            free(pixelbuf);
+        if (!(scaled_pixelbuf = (unsigned char *) z_malloc((size_t) scale_width * scale_height))) {
+            z_free(pixelbuf);
             strcpy(symbol->errtxt, "659: Insufficient memory for pixel buffer");
             return ZINT_ERROR_MEMORY;
         }
         memset(scaled_pixelbuf, DEFAULT_PAPER, (size_t) scale_width * scale_height);
 
+        /* Map each scaled column to its source column once, rather than per row */
+        if (!(column_map = (int *) z_malloc(sizeof(int) * scale_width))) {
+            z_free(scaled_pixelbuf);
+            z_free(pixelbuf);
+            strcpy(symbol->errtxt, "664: Insufficient memory for scaling map");
+            return ZINT_ERROR_MEMORY;
+        }
+        for (i = 0; i < scale_width; i++) {
+            column_map[i] = (int) stripf(i / scaler);
+        }
+
         /* Interpolate */
         for (r = 0; r < scale_height; r++) {
             size_t scaled_row = r * scale_width;
@@ -1305,24 +1478,27 @@ static int plot_raster_default(struct zint_symbol *symbol, const int rotate_angl
                     || memcmp(pixelbuf + image_row, pixelbuf + prev_image_row, image_width) == 0)) {
                 memcpy(scaled_pixelbuf + scaled_row, scaled_pixelbuf + scaled_row - scale_width, scale_width);
             } else {
+                const unsigned char *const image_line = pixelbuf + image_row;
+                unsigned char *const scaled_line = scaled_pixelbuf + scaled_row;
                 for (i = 0; i < scale_width; i++) {
-                    *(scaled_pixelbuf + scaled_row + i) = *(pixelbuf + image_row + (int) stripf(i / scaler));
+                    scaled_line[i] = image_line[column_map[i]];
                 }
             }
             prev_image_row = image_row;
         }
+        z_free(column_map);
 
         error_number = save_raster_image_to_file(symbol, scale_height, scale_width, scaled_pixelbuf, rotate_angle,
                                                 file_type);
         if (rotate_angle || file_type != OUT_BUFFER || !(symbol->output_options & OUT_BUFFER_INTERMEDIATE)) {
-            free(scaled_pixelbuf);
+            z_free(scaled_pixelbuf);
         }
-        free(pixelbuf);
+        z_free(pixelbuf);
     } else {
         error_number = save_raster_image_to_file(symbol, image_height, image_width, pixelbuf, rotate_angle,
                                                 file_type);
         if (rotate_angle || file_type != OUT_BUFFER || !(symbol->output_options & OUT_BUFFER_INTERMEDIATE)) {
-            free(pixelbuf);
+            z_free(pixelbuf);
         }
     }
     return error_number;
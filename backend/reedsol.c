@@ -49,6 +49,8 @@
 // malloc/free can be avoided by using static arrays of a suitable
 // size.
 // Note: use of statics has been done for (up to) 8-bit tables.
+// Generator polys, and the log tables of larger fields, are cached process-wide
+// (protected by `cache_lock()`) so are only generated once.
 
 #ifdef _MSC_VER
 #include <malloc.h>
@@ -57,6 +59,8 @@
 #include "reedsol.h"
 #include "reedsol_logs.h"
 
+#define RS_FIELDS 12 /* Size of field table in `rs_init_gf()` */
+
 // rs_init_gf(&rs, prime_poly) initialises the parameters for the Galois Field.
 // The symbol size is determined from the highest bit set in poly
 // This implementation will support sizes up to 8 bits (see rs_uint_init_gf()
@@ -74,7 +78,7 @@ INTERNAL void rs_init_gf(rs_t *rs, const unsigned int prime_poly) {
     /* To add a new prime poly of degree <= 8 add its details to this table and to the table in `test_generate()`
        in "backend/tests/test_reedsol.c" and regenerate the log tables by running
        "backend/tests/test_reedsol -f generate -g". Paste the result in "reedsol_logs.h" */
-    static const struct item data[] = {
+    static const struct item data[RS_FIELDS] = {
         { logt_0x13, alog_0x13 },   /* 0 000- */
         { logt_0x25, alog_0x25 },   /* 0 001- */
         { logt_0x43, alog_0x43 },   /* 0 010- */
@@ -95,6 +99,8 @@ INTERNAL void rs_init_gf(rs_t *rs, const unsigned int prime_poly) {
 
     rs->logt = data[hash].logt;
     rs->alog = data[hash].alog;
+    rs->field = (int) hash;
+    for (rs->size = 1; rs->size <= (int) (prime_poly >> 1); rs->size <<= 1);
 }
 
 // rs_init_code(&rs, nsym, index) initialises the Reed-Solomon encoder
@@ -104,14 +110,36 @@ INTERNAL void rs_init_gf(rs_t *rs, const unsigned int prime_poly) {
 // (x + 2**i)*(x + 2**(i+1))*...   [nsym terms]
 // For ECC200, index is 1.
 
+/* Process-wide cache of generator polys, indexed directly by field, `index` (0 or 1 only) and `nsym`, so no search
+ * needed. Slots are published with `cache_store_ptr()` and read with `cache_load_ptr()`, so lookups don't take
+ * `cache_lock()`. Entries are never freed */
+struct rs_poly_cache {
+    int zero;
+    unsigned char rspoly[256];
+    unsigned char log_rspoly[256];
+    void *tab; /* Products table, built by `rs_get_tab()` on first use and published with `cache_store_ptr()` */
+};
+static void *rs_poly_cache[RS_FIELDS][2][256];
+
 INTERNAL void rs_init_code(rs_t *rs, const int nsym, int index) {
     int i, k;
     const unsigned char *const logt = rs->logt;
     const unsigned char *const alog = rs->alog;
     unsigned char *rspoly = rs->rspoly;
     unsigned char *log_rspoly = rs->log_rspoly;
+    void **const slot = (index == 0 || index == 1) && nsym < 256 ? &rs_poly_cache[rs->field][index][nsym] : NULL;
+    struct rs_poly_cache *entry;
 
     rs->nsym = nsym;
+    rs->entry = NULL;
+
+    if (slot && (entry = (struct rs_poly_cache *) cache_load_ptr(slot))) {
+        memcpy(rspoly, entry->rspoly, nsym + 1);
+        memcpy(log_rspoly, entry->log_rspoly, nsym + 1);
+        rs->zero = entry->zero;
+        rs->entry = entry;
+        return;
+    }
 
     rspoly[0] = 1;
     for (i = 1; i <= nsym; i++) {
@@ -131,6 +159,96 @@ INTERNAL void rs_init_code(rs_t *rs, const int nsym, int index) {
         log_rspoly[i] = logt[rspoly[i]]; /* For simplicity allow log of 0 */
         rs->zero |= rspoly[i] == 0;
     }
+
+    /* Add to cache (unless another thread has beaten us to it) */
+    if (slot && (entry = (struct rs_poly_cache *) z_malloc(sizeof(struct rs_poly_cache)))) {
+        entry->zero = rs->zero;
+        memcpy(entry->rspoly, rspoly, nsym + 1);
+        memcpy(entry->log_rspoly, log_rspoly, nsym + 1);
+        entry->tab = NULL;
+        cache_lock();
+        if (*slot) {
+            z_free(entry);
+            entry = (struct rs_poly_cache *) *slot;
+        } else {
+            cache_store_ptr(slot, entry);
+        }
+        cache_unlock();
+        rs->entry = entry;
+    }
+}
+
+/* Return the products table of the (cached) generator poly, building it if not already done. The table has a row
+ * for each field element `m`, holding the products of the poly coeffs (in reverse order) with `m`. Returns NULL if
+ * poly not cached or on malloc() failure */
+static const unsigned char *rs_get_tab(const rs_t *rs) {
+    struct rs_poly_cache *const entry = rs->entry;
+    const unsigned char *const logt = rs->logt;
+    const unsigned char *const alog = rs->alog;
+    const unsigned char *const rspoly = rs->rspoly;
+    const unsigned char *const log_rspoly = rs->log_rspoly;
+    const int nsym = rs->nsym;
+    unsigned char *tab, *row;
+    int m, k;
+
+    if (!entry) {
+        return NULL;
+    }
+    if ((tab = (unsigned char *) cache_load_ptr(&entry->tab))) {
+        return tab;
+    }
+
+    if (!(tab = (unsigned char *) z_malloc((size_t) rs->size * nsym))) {
+        return NULL;
+    }
+    memset(tab, 0, nsym);
+    for (m = 1, row = tab + nsym; m < rs->size; m++, row += nsym) {
+        const unsigned int log_m = logt[m];
+        for (k = 0; k < nsym; k++) {
+            row[nsym - 1 - k] = rspoly[k] ? alog[log_m + log_rspoly[k]] : 0;
+        }
+    }
+
+    /* Another thread may have beaten us to it */
+    cache_lock();
+    if (entry->tab) {
+        z_free(tab);
+        tab = (unsigned char *) entry->tab;
+    } else {
+        cache_store_ptr(&entry->tab, tab);
+    }
+    cache_unlock();
+
+    return tab;
+}
+
+/* Minimum data length for which the products table is used, below which the log/alog loop is as quick */
+#define RS_TAB_MIN_DATALEN 64
+
+/* Run the LFSR using the products table, placing the remainder in `reg` in forward order. Using rows of products
+ * (rather than logs) and a forward shift leaves an inner loop of independent XORs, done a machine word at a time */
+static void rs_lfsr_tab(const rs_t *rs, const unsigned char *tab, const int datalen, const unsigned char *data,
+            const unsigned int *data_uint, unsigned char *reg) {
+    int i, k;
+    const int nsym = rs->nsym;
+    const int nsym_1 = nsym - 1;
+    const int nsym_words = nsym_1 - nsym_1 % (int) sizeof(size_t);
+
+    memset(reg, 0, nsym);
+    for (i = 0; i < datalen; i++) {
+        const unsigned char *const row = tab + (reg[0] ^ (data ? data[i] : data_uint[i])) * nsym;
+        for (k = 0; k < nsym_words; k += sizeof(size_t)) {
+            size_t r, w;
+            memcpy(&r, reg + k + 1, sizeof(size_t));
+            memcpy(&w, row + k, sizeof(size_t));
+            r ^= w;
+            memcpy(reg + k, &r, sizeof(size_t));
+        }
+        for (; k < nsym_1; k++) {
+            reg[k] = reg[k + 1] ^ row[k];
+        }
+        reg[nsym_1] = row[nsym_1];
+    }
 }
 
 /* rs_encode(&rs, datalen, data, res) generates nsym Reed-Solomon codes (nsym as given in rs_init_code())
@@ -142,6 +260,16 @@ INTERNAL void rs_encode(const rs_t *rs, const int datalen, const unsigned char *
     const unsigned char *const rspoly = rs->rspoly;
     const unsigned char *const log_rspoly = rs->log_rspoly;
     const int nsym = rs->nsym;
+    const unsigned char *tab;
+
+    if (datalen >= RS_TAB_MIN_DATALEN && (tab = rs_get_tab(rs))) {
+        unsigned char reg[256];
+        rs_lfsr_tab(rs, tab, datalen, data, NULL, reg);
+        for (k = 0; k < nsym; k++) {
+            res[k] = reg[nsym - 1 - k];
+        }
+        return;
+    }
 
     memset(res, 0, nsym);
     if (rs->zero) { /* Poly has a zero coeff so need to check in inner loop */
@@ -187,6 +315,16 @@ INTERNAL void rs_encode_uint(const rs_t *rs, const int datalen, const unsigned i
     const unsigned char *const rspoly = rs->rspoly;
     const unsigned char *const log_rspoly = rs->log_rspoly;
     const int nsym = rs->nsym;
+    const unsigned char *tab;
+
+    if (datalen >= RS_TAB_MIN_DATALEN && (tab = rs_get_tab(rs))) {
+        unsigned char reg[256];
+        rs_lfsr_tab(rs, tab, datalen, NULL, data, reg);
+        for (k = 0; k < nsym; k++) {
+            res[k] = reg[nsym - 1 - k];
+        }
+        return;
+    }
 
     memset(res, 0, sizeof(unsigned int) * nsym);
     if (rs->zero) { /* Poly has a zero coeff so need to check in inner loop */
@@ -229,23 +367,45 @@ INTERNAL void rs_encode_uint(const rs_t *rs, const int datalen, const unsigned i
 // First call rs_uint_init_gf(&rs_uint, prime_poly, logmod) to set up the Galois Field parameters.
 // Then  call rs_uint_init_code(&rs_uint, nsym, index) to set the encoding size
 // Then  call rs_uint_encode(&rs_uint, datalen, data, out) to encode the data.
-// Then  call rs_uint_free(&rs_uint) to free the log tables.
-
-/* `logmod` (field characteristic) will be 2**bitlength - 1, eg 1023 for bitlength 10, 4095 for bitlength 12 */
-INTERNAL int rs_uint_init_gf(rs_uint_t *rs_uint, const unsigned int prime_poly, const int logmod) {
+// Then  call rs_uint_free(&rs_uint) to free the log tables (if not cached).
+
+/* Process-wide cache of log tables, keyed by `prime_poly` and `logmod`. Entries are never freed */
+#define RS_UINT_GF_CACHE_SIZE 4
+struct rs_uint_gf_cache {
+    unsigned int prime_poly;
+    int logmod;
+    unsigned int *logt;
+    unsigned int *alog;
+};
+static struct rs_uint_gf_cache rs_uint_gf_cache[RS_UINT_GF_CACHE_SIZE];
+static int rs_uint_gf_cache_cnt = 0;
+
+/* Process-wide cache of generator polys, keyed by (cached) log table and `nsym`, `index`. Entries are never freed */
+#define RS_UINT_POLY_CACHE_SIZE 64
+struct rs_uint_poly_cache {
+    const unsigned int *logt;
+    int nsym;
+    int index;
+    int zero;
+    unsigned short *rspoly; /* Allocated with entry */
+    unsigned int *log_rspoly; /* Allocated with entry */
+};
+static struct rs_uint_poly_cache *rs_uint_poly_cache[RS_UINT_POLY_CACHE_SIZE];
+static int rs_uint_poly_cache_cnt = 0;
+
+/* Allocate and calculate log/alog tables. Returns 0 on malloc() failure */
+static int rs_uint_gen_gf(const unsigned int prime_poly, const int logmod, unsigned int **p_logt,
+            unsigned int **p_alog) {
     int b, p, v;
     unsigned int *logt, *alog;
 
     b = logmod + 1;
 
-    rs_uint->logt = NULL;
-    rs_uint->alog = NULL;
-
-    if (!(logt = (unsigned int *) calloc(b, sizeof(unsigned int)))) {
+    if (!(logt = (unsigned int *) z_calloc(b, sizeof(unsigned int)))) {
         return 0;
     }
-    if (!(alog = (unsigned int *) calloc(b * 2, sizeof(unsigned int)))) {
-        free(logt);
+    if (!(alog = (unsigned int *) z_calloc(b * 2, sizeof(unsigned int)))) {
+        z_free(logt);
         return 0;
     }
 
@@ -258,23 +418,82 @@ INTERNAL int rs_uint_init_gf(rs_uint_t *rs_uint, const unsigned int prime_poly,
         if (p & b) /* If overflow */
             p ^= prime_poly; /* Subtract prime poly */
     }
-    rs_uint->logt = logt;
-    rs_uint->alog = alog;
+    *p_logt = logt;
+    *p_alog = alog;
     return 1;
 }
 
+/* `logmod` (field characteristic) will be 2**bitlength - 1, eg 1023 for bitlength 10, 4095 for bitlength 12.
+ * The tables are taken from (or added to) a process-wide cache, so are only generated once per field unless the
+ * cache is full */
+INTERNAL int rs_uint_init_gf(rs_uint_t *rs_uint, const unsigned int prime_poly, const int logmod) {
+    int i;
+
+    rs_uint->logt = NULL;
+    rs_uint->alog = NULL;
+    rs_uint->cached = 0;
+
+    cache_lock();
+    for (i = 0; i < rs_uint_gf_cache_cnt; i++) {
+        if (rs_uint_gf_cache[i].prime_poly == prime_poly && rs_uint_gf_cache[i].logmod == logmod) {
+            rs_uint->logt = rs_uint_gf_cache[i].logt;
+            rs_uint->alog = rs_uint_gf_cache[i].alog;
+            rs_uint->cached = 1;
+            cache_unlock();
+            return 1;
+        }
+    }
+    if (rs_uint_gf_cache_cnt < RS_UINT_GF_CACHE_SIZE) {
+        struct rs_uint_gf_cache *entry = rs_uint_gf_cache + rs_uint_gf_cache_cnt;
+        if (!rs_uint_gen_gf(prime_poly, logmod, &entry->logt, &entry->alog)) {
+            cache_unlock();
+            return 0;
+        }
+        entry->prime_poly = prime_poly;
+        entry->logmod = logmod;
+        rs_uint_gf_cache_cnt++;
+        rs_uint->logt = entry->logt;
+        rs_uint->alog = entry->alog;
+        rs_uint->cached = 1;
+        cache_unlock();
+        return 1;
+    }
+    cache_unlock();
+
+    /* Cache full so generate own (freed by `rs_uint_free()`) */
+    return rs_uint_gen_gf(prime_poly, logmod, &rs_uint->logt, &rs_uint->alog);
+}
+
 INTERNAL void rs_uint_init_code(rs_uint_t *rs_uint, const int nsym, int index) {
     int i, k;
     const unsigned int *const logt = rs_uint->logt;
     const unsigned int *const alog = rs_uint->alog;
     unsigned short *rspoly = rs_uint->rspoly;
     unsigned int *log_rspoly = rs_uint->log_rspoly;
+    /* Only cache if log tables cached, as otherwise `logt` could be reused by a different field */
+    const int cacheable = rs_uint->cached && nsym < ARRAY_SIZE(rs_uint->rspoly);
+    const int first_index = index;
 
     if (logt == NULL || alog == NULL) {
         return;
     }
     rs_uint->nsym = nsym;
 
+    if (cacheable) {
+        cache_lock();
+        for (i = 0; i < rs_uint_poly_cache_cnt; i++) {
+            const struct rs_uint_poly_cache *entry = rs_uint_poly_cache[i];
+            if (entry->logt == logt && entry->nsym == nsym && entry->index == index) {
+                memcpy(rspoly, entry->rspoly, sizeof(unsigned short) * (nsym + 1));
+                memcpy(log_rspoly, entry->log_rspoly, sizeof(unsigned int) * (nsym + 1));
+                rs_uint->zero = entry->zero;
+                cache_unlock();
+                return;
+            }
+        }
+        cache_unlock();
+    }
+
     rspoly[0] = 1;
     for (i = 1; i <= nsym; i++) {
         rspoly[i] = 1;
@@ -293,6 +512,26 @@ INTERNAL void rs_uint_init_code(rs_uint_t *rs_uint, const int nsym, int index) {
         log_rspoly[i] = logt[rspoly[i]]; /* For simplicity allow log of 0 */
         rs_uint->zero |= rspoly[i] == 0;
     }
+
+    /* Add to cache if room (if another thread has added it meanwhile the duplicate is harmless) */
+    if (cacheable) {
+        struct rs_uint_poly_cache *entry;
+        cache_lock();
+        if (rs_uint_poly_cache_cnt < RS_UINT_POLY_CACHE_SIZE
+                && (entry = (struct rs_uint_poly_cache *) z_malloc(sizeof(struct rs_uint_poly_cache)
+                                + (sizeof(unsigned int) + sizeof(unsigned short)) * (nsym + 1)))) {
+            entry->logt = logt;
+            entry->nsym = nsym;
+            entry->index = first_index;
+            entry->zero = rs_uint->zero;
+            entry->log_rspoly = (unsigned int *) (entry + 1);
+            entry->rspoly = (unsigned short *) (entry->log_rspoly + nsym + 1);
+            memcpy(entry->rspoly, rspoly, sizeof(unsigned short) * (nsym + 1));
+            memcpy(entry->log_rspoly, log_rspoly, sizeof(unsigned int) * (nsym + 1));
+            rs_uint_poly_cache[rs_uint_poly_cache_cnt++] = entry;
+        }
+        cache_unlock();
+    }
 }
 
 INTERNAL void rs_uint_encode(const rs_uint_t *rs_uint, const int datalen, const unsigned int *data,
@@ -343,12 +582,18 @@ INTERNAL void rs_uint_encode(const rs_uint_t *rs_uint, const int datalen, const
 }
 
 INTERNAL void rs_uint_free(rs_uint_t *rs_uint) {
+    if (rs_uint->cached) { /* Owned by cache */
+        rs_uint->logt = NULL;
+        rs_uint->alog = NULL;
+        rs_uint->cached = 0;
+        return;
+    }
     if (rs_uint->logt) {
-        free(rs_uint->logt);
+        z_free(rs_uint->logt);
         rs_uint->logt = NULL;
     }
     if (rs_uint->alog) {
-        free(rs_uint->alog);
+        z_free(rs_uint->alog);
         rs_uint->alog = NULL;
     }
 }
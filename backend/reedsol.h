@@ -38,6 +38,8 @@
 extern "C" {
 #endif /* __cplusplus */
 
+struct rs_poly_cache;
+
 typedef struct {
     const unsigned char *logt; /* These are static */
     const unsigned char *alog;
@@ -45,15 +47,19 @@ typedef struct {
     unsigned char log_rspoly[256]; /* Logs of poly */
     int nsym; /* Degree of poly */
     int zero; /* Set if poly has a zero coeff */
+    int field; /* Index of field (hash of prime poly) */
+    int size; /* Number of field elements */
+    struct rs_poly_cache *entry; /* Cache entry for poly (owning its products table), NULL if not cached */
 } rs_t;
 
 typedef struct {
-    unsigned int *logt; /* These are malloced */
+    unsigned int *logt; /* These are malloced (and owned by the cache if `cached` set) */
     unsigned int *alog;
     unsigned short rspoly[4096]; /* Generated poly, 12-bit max - needs to be enlarged if > 12-bit used */
     unsigned int log_rspoly[4096]; /* Logs of poly */
     int nsym; /* Degree of poly */
     int zero; /* Set if poly has a zero coeff */
+    int cached; /* Set if `logt` and `alog` owned by the process-wide cache */
 } rs_uint_t;
 
 INTERNAL void rs_init_gf(rs_t *rs, const unsigned int prime_poly);
@@ -63,11 +63,13 @@
  * RSS Expanded Stacked > GS1 DataBar Expanded Stacked Omnidirectional
  */
 
+#include <assert.h>
 #include <stdio.h>
 #ifdef _MSC_VER
 #include <malloc.h>
 #endif
 #include "common.h"
+#include "bitstream.h"
 #include "large.h"
 #include "rss.h"
 #include "gs1.h"
@@ -117,7 +119,8 @@ static int rss_combins(const int n, const int r) {
  * noNarrow = 0 will skip patterns without a one module wide element
  *
  **********************************************************************/
-static void getRSSwidths(int widths[], int val, int n, const int elements, const int maxWidth, const int noNarrow) {
+STATIC_UNLESS_ZINT_TEST void getRSSwidths(int widths[], int val, int n, const int elements, const int maxWidth,
+            const int noNarrow) {
     int bar;
     int elmWidth;
     int mxwElement;
@@ -157,6 +160,122 @@ static void getRSSwidths(int widths[], int val, int n, const int elements, const
     return;
 }
 
+/* Tables of the element widths of every value of each character set (odd or even elements of a group), packed
+   4 bits per element (first element lowest), in value order, with the number of values in entry 0. The tables for
+   each symbol type are built together on first use and then shared (protected by `cache_lock()`) */
+#define DBAR_OMN            0   /* Symbol types */
+#define DBAR_LTD            1
+#define DBAR_EXP            2
+
+#define DBAR_OMN_ODD        0   /* Sets of DBAR_OMN tables indexed by group 0-8 */
+#define DBAR_OMN_EVEN       9
+#define DBAR_LTD_ODD        0   /* DBAR_LTD groups 0-6 */
+#define DBAR_LTD_EVEN       7
+#define DBAR_EXP_ODD        0   /* DBAR_EXP groups 1-5 (indexed 0-4) */
+#define DBAR_EXP_EVEN       5
+
+static const unsigned int *dbar_omn_widths[18];
+static const unsigned int *dbar_ltd_widths[14];
+static const unsigned int *dbar_exp_widths[10];
+static int dbar_widths_built[3];
+
+/* Enumerate in increasing value order (i.e. lexicographically, as `getRSSwidths()` counts) the width sets of the
+   remaining `elements - bar` elements totalling `n` modules, storing in `table` (if non-NULL) from `count`.
+   Returns the new count */
+static int dbar_widths_enum(unsigned int *table, int count, const int n, const int elements, const int maxWidth,
+            const int noNarrow, const int bar, const unsigned int packed, const int narrow) {
+    int w;
+
+    if (bar == elements - 1) {
+        if (n <= maxWidth && (noNarrow || narrow || n == 1)) {
+            if (table) {
+                table[count] = packed | (n << (bar * 4));
+            }
+            count++;
+        }
+        return count;
+    }
+    for (w = 1; w <= maxWidth && w <= n - (elements - bar - 1); w++) {
+        count = dbar_widths_enum(table, count, n - w, elements, maxWidth, noNarrow, bar + 1,
+                                    packed | (w << (bar * 4)), narrow || w == 1);
+    }
+    return count;
+}
+
+/* Build widths table for a character set as above - returns NULL on malloc() failure */
+static unsigned int *dbar_widths_build(const int n, const int elements, const int maxWidth, const int noNarrow) {
+    const int count = dbar_widths_enum(NULL, 0, n, elements, maxWidth, noNarrow, 0, 0, 0);
+    unsigned int *table = (unsigned int *) z_malloc(sizeof(unsigned int) * (count + 1));
+
+    if (table) {
+        table[0] = count;
+        (void) dbar_widths_enum(table + 1, 0, n, elements, maxWidth, noNarrow, 0, 0, 0);
+    }
+    return table;
+}
+
+/* Get widths tables for symbol type `type` (`DBAR_OMN`, `DBAR_LTD` or `DBAR_EXP`), indexed by `DBAR_XXX_ODD/EVEN`
+   + group index, building them if not cached - returns NULL on malloc() failure */
+STATIC_UNLESS_ZINT_TEST const unsigned int *const *dbar_widths_tables(const int type) {
+    const unsigned int **tables = type == DBAR_OMN ? dbar_omn_widths : type == DBAR_LTD ? dbar_ltd_widths
+                                    : dbar_exp_widths;
+    const int groups = type == DBAR_OMN ? 9 : type == DBAR_LTD ? 7 : 5;
+    int g, built;
+
+    cache_lock(); /* Held while building as any other thread would only be building the same */
+    if (!dbar_widths_built[type]) {
+        unsigned int *odd = NULL, *even = NULL;
+        for (g = 0; g < groups; g++) {
+            if (type == DBAR_OMN) {
+                /* Outer characters (groups 0-4) have odd widths with a narrow element, inner even */
+                odd = dbar_widths_build(modules_odd[g], 4, widest_odd[g], g < 5);
+                even = dbar_widths_build(modules_even[g], 4, widest_even[g], g >= 5);
+            } else if (type == DBAR_LTD) {
+                odd = dbar_widths_build(modules_odd_ltd[g], 7, widest_odd_ltd[g], 1);
+                even = dbar_widths_build(modules_even_ltd[g], 7, widest_even_ltd[g], 0);
+            } else {
+                odd = dbar_widths_build(modules_odd_exp[g], 4, widest_odd_exp[g], 0);
+                even = dbar_widths_build(modules_even_exp[g], 4, widest_even_exp[g], 1);
+            }
+            if (!odd || !even) {
+                break;
+            }
+            z_free((void *) tables[g]); /* In case left by previous failed build */
+            z_free((void *) tables[groups + g]);
+            tables[g] = odd;
+            tables[groups + g] = even;
+        }
+        if (g == groups) {
+            dbar_widths_built[type] = 1;
+        } else {
+            z_free(odd);
+            z_free(even);
+        }
+    }
+    built = dbar_widths_built[type];
+    cache_unlock();
+
+    return built ? tables : NULL;
+}
+
+/* Same as `getRSSwidths()` but looked up in `tables` (as returned by `dbar_widths_tables()`, or if NULL calculated
+   as before) for character set `set` */
+STATIC_UNLESS_ZINT_TEST void dbar_widths(int widths[], const unsigned int *const *tables, const int set,
+            const int val, const int n, const int elements, const int maxWidth, const int noNarrow) {
+    int i;
+
+    if (tables) {
+        unsigned int packed;
+        assert(val >= 0 && val < (int) tables[set][0]);
+        packed = tables[set][val + 1];
+        for (i = 0; i < elements; i++, packed >>= 4) {
+            widths[i] = packed & 0xF;
+        }
+    } else {
+        getRSSwidths(widths, val, n, elements, maxWidth, noNarrow); /* Only if malloc() failed */
+    }
+}
+
 /* Set GTIN-14 human readable text */
 static void dbar_set_gtin14_hrt(struct zint_symbol *symbol, const unsigned char *source, const int src_len) {
     int i;
@@ -299,6 +418,7 @@ INTERNAL int dbar_omn_cc(struct zint_symbol *symbol, unsigned char source[], int
     int latch;
     int separator_row;
     int widths[4];
+    const unsigned int *const *tables;
 
     separator_row = 0;
 
@@ -407,25 +527,30 @@ INTERNAL int dbar_omn_cc(struct zint_symbol *symbol, unsigned char source[], int
     v_even[2] = (data_character[2] - g_sum_table[data_group[2]]) % t_table[data_group[2]];
 
     /* Use DataBar subset width algorithm */
+    tables = dbar_widths_tables(DBAR_OMN);
     for (i = 0; i < 4; i++) {
         if ((i == 0) || (i == 2)) {
-            getRSSwidths(widths, v_odd[i], modules_odd[data_group[i]], 4, widest_odd[data_group[i]], 1);
+            dbar_widths(widths, tables, DBAR_OMN_ODD + data_group[i], v_odd[i], modules_odd[data_group[i]], 4,
+                        widest_odd[data_group[i]], 1);
             data_widths[0][i] = widths[0];
             data_widths[2][i] = widths[1];
             data_widths[4][i] = widths[2];
             data_widths[6][i] = widths[3];
-            getRSSwidths(widths, v_even[i], modules_even[data_group[i]], 4, widest_even[data_group[i]], 0);
+            dbar_widths(widths, tables, DBAR_OMN_EVEN + data_group[i], v_even[i], modules_even[data_group[i]], 4,
+                        widest_even[data_group[i]], 0);
             data_widths[1][i] = widths[0];
             data_widths[3][i] = widths[1];
             data_widths[5][i] = widths[2];
             data_widths[7][i] = widths[3];
         } else {
-            getRSSwidths(widths, v_odd[i], modules_odd[data_group[i]], 4, widest_odd[data_group[i]], 0);
+            dbar_widths(widths, tables, DBAR_OMN_ODD + data_group[i], v_odd[i], modules_odd[data_group[i]], 4,
+                        widest_odd[data_group[i]], 0);
             data_widths[0][i] = widths[0];
             data_widths[2][i] = widths[1];
             data_widths[4][i] = widths[2];
             data_widths[6][i] = widths[3];
-            getRSSwidths(widths, v_even[i], modules_even[data_group[i]], 4, widest_even[data_group[i]], 1);
+            dbar_widths(widths, tables, DBAR_OMN_EVEN + data_group[i], v_even[i], modules_even[data_group[i]], 4,
+                        widest_even[data_group[i]], 1);
             data_widths[1][i] = widths[0];
             data_widths[3][i] = widths[1];
             data_widths[5][i] = widths[2];
@@ -636,6 +761,7 @@ INTERNAL int dbar_ltd_cc(struct zint_symbol *symbol, unsigned char source[], int
     int latch;
     int separator_row;
     int widths[7];
+    const unsigned int *const *tables;
 
     separator_row = 0;
 
@@ -732,19 +858,24 @@ INTERNAL int dbar_ltd_cc(struct zint_symbol *symbol, unsigned char source[], int
     right_odd = (int) (right_character / t_even_ltd[right_group]);
     right_even = (int) (right_character % t_even_ltd[right_group]);
 
-    getRSSwidths(widths, left_odd, modules_odd_ltd[left_group], 7, widest_odd_ltd[left_group], 1);
+    tables = dbar_widths_tables(DBAR_LTD);
+    dbar_widths(widths, tables, DBAR_LTD_ODD + left_group, left_odd, modules_odd_ltd[left_group], 7,
+                widest_odd_ltd[left_group], 1);
     for (i = 0; i <= 6; i++) {
         left_widths[i * 2] = widths[i];
     }
-    getRSSwidths(widths, left_even, modules_even_ltd[left_group], 7, widest_even_ltd[left_group], 0);
+    dbar_widths(widths, tables, DBAR_LTD_EVEN + left_group, left_even, modules_even_ltd[left_group], 7,
+                widest_even_ltd[left_group], 0);
     for (i = 0; i <= 6; i++) {
         left_widths[i * 2 + 1] = widths[i];
     }
-    getRSSwidths(widths, right_odd, modules_odd_ltd[right_group], 7, widest_odd_ltd[right_group], 1);
+    dbar_widths(widths, tables, DBAR_LTD_ODD + right_group, right_odd, modules_odd_ltd[right_group], 7,
+                widest_odd_ltd[right_group], 1);
     for (i = 0; i <= 6; i++) {
         right_widths[i * 2] = widths[i];
     }
-    getRSSwidths(widths, right_even, modules_even_ltd[right_group], 7, widest_even_ltd[right_group], 0);
+    dbar_widths(widths, tables, DBAR_LTD_EVEN + right_group, right_even, modules_even_ltd[right_group], 7,
+                widest_even_ltd[right_group], 0);
     for (i = 0; i <= 6; i++) {
         right_widths[i * 2 + 1] = widths[i];
     }
@@ -831,8 +962,8 @@ INTERNAL int dbar_date(const unsigned char source[], const int src_posn) {
 }
 
 /* Handles all data encodation from section 7.2.5 of ISO/IEC 24724 */
-static int dbar_exp_binary_string(struct zint_symbol *symbol, const unsigned char source[], char binary_string[],
-            int *p_cols_per_row, const int max_rows, int *p_bp) {
+static int dbar_exp_binary_string(struct zint_symbol *symbol, const unsigned char source[],
+            uint64_t binary_string[], int *p_cols_per_row, const int max_rows, int *p_bp) {
     int encoding_method, i, j, read_posn, mode = NUMERIC;
     char last_digit = '\0';
     int symbol_characters, characters_per_row = *p_cols_per_row * 2;
@@ -942,29 +1073,33 @@ static int dbar_exp_binary_string(struct zint_symbol *symbol, const unsigned cha
     }
 
     switch (encoding_method) { /* Encoding method - Table 10 */
-        case 1: bp = bin_append_posn(4, 3, binary_string, bp); /* "1XX" */
+        case 1: bp = bits_append_posn(4, 3, binary_string, bp); /* "1XX" */
             read_posn = 16;
             break;
-        case 2: bp = bin_append_posn(0, 4, binary_string, bp); /* "00XX" */
+        case 2: bp = bits_append_posn(0, 4, binary_string, bp); /* "00XX" */
             read_posn = 0;
             break;
         case 3: // 0100
         case 4: // 0101
-            bp = bin_append_posn(4 + (encoding_method - 3), 4, binary_string, bp);
+            bp = bits_append_posn(4 + (encoding_method - 3), 4, binary_string, bp);
             read_posn = 26;
             break;
-        case 5: bp = bin_append_posn(0x30, 7, binary_string, bp); /* "01100XX" */
+        case 5: bp = bits_append_posn(0x30, 7, binary_string, bp); /* "01100XX" */
             read_posn = 20;
             break;
-        case 6: bp = bin_append_posn(0x34, 7, binary_string, bp); /* "01101XX" */
+        case 6: bp = bits_append_posn(0x34, 7, binary_string, bp); /* "01101XX" */
             read_posn = 23;
             break;
         default: /* modes 7 to 14 */
-            bp = bin_append_posn(56 + (encoding_method - 7), 7, binary_string, bp);
+            bp = bits_append_posn(56 + (encoding_method - 7), 7, binary_string, bp);
             read_posn = length; /* 34 or 26 */
             break;
     }
-    if (debug_print) printf("Setting binary = %.*s\n", bp, binary_string);
+    if (debug_print) {
+        printf("Setting binary = ");
+        bits_print(binary_string, 0, bp);
+        printf("\n");
+    }
 
     /* Variable length symbol bit field is just given a place holder (XX)
     for the time being */
@@ -989,10 +1124,10 @@ static int dbar_exp_binary_string(struct zint_symbol *symbol, const unsigned cha
     if (encoding_method == 1) {
         /* Encoding method field "1" - general item identification data */
 
-        bp = bin_append_posn(ctoi(source[2]), 4, binary_string, bp); /* Leading digit after stripped "01" */
+        bp = bits_append_posn(ctoi(source[2]), 4, binary_string, bp); /* Leading digit after stripped "01" */
 
         for (i = 3; i < 15; i += 3) { /* Next 12 digits, excluding final check digit */
-            bp = bin_append_posn(to_int(source + i, 3), 10, binary_string, bp);
+            bp = bits_append_posn(to_int(source + i, 3), 10, binary_string, bp);
         }
 
     } else if ((encoding_method == 3) || (encoding_method == 4)) {
@@ -1002,13 +1137,13 @@ static int dbar_exp_binary_string(struct zint_symbol *symbol, const unsigned cha
         0,001 pound increment) */
 
         for (i = 3; i < 15; i += 3) { /* Leading "019" stripped, and final check digit excluded */
-            bp = bin_append_posn(to_int(source + i, 3), 10, binary_string, bp);
+            bp = bits_append_posn(to_int(source + i, 3), 10, binary_string, bp);
         }
 
         if ((encoding_method == 4) && (source[19] == '3')) {
-            bp = bin_append_posn(to_int(source + 20, 6) + 10000, 15, binary_string, bp);
+            bp = bits_append_posn(to_int(source + 20, 6) + 10000, 15, binary_string, bp);
         } else {
-            bp = bin_append_posn(to_int(source + 20, 6), 15, binary_string, bp);
+            bp = bits_append_posn(to_int(source + 20, 6), 15, binary_string, bp);
         }
 
     } else if ((encoding_method == 5) || (encoding_method == 6)) {
@@ -1017,13 +1152,13 @@ static int dbar_exp_binary_string(struct zint_symbol *symbol, const unsigned cha
         Currency Code */
 
         for (i = 3; i < 15; i += 3) { /* Leading "019" stripped, and final check digit excluded */
-            bp = bin_append_posn(to_int(source + i, 3), 10, binary_string, bp);
+            bp = bits_append_posn(to_int(source + i, 3), 10, binary_string, bp);
         }
 
-        bp = bin_append_posn(source[19] - '0', 2, binary_string, bp); /* 0-3 x of 392x/393x */
+        bp = bits_append_posn(source[19] - '0', 2, binary_string, bp); /* 0-3 x of 392x/393x */
 
         if (encoding_method == 6) {
-            bp = bin_append_posn(to_int(source + 20, 3), 10, binary_string, bp); /* 3-digit currency */
+            bp = bits_append_posn(to_int(source + 20, 3), 10, binary_string, bp); /* 3-digit currency */
         }
 
     } else if ((encoding_method >= 7) && (encoding_method <= 14)) {
@@ -1033,7 +1168,7 @@ static int dbar_exp_binary_string(struct zint_symbol *symbol, const unsigned cha
         char weight_str[8];
 
         for (i = 3; i < 15; i += 3) { /* Leading "019" stripped, and final check digit excluded */
-            bp = bin_append_posn(to_int(source + i, 3), 10, binary_string, bp);
+            bp = bits_append_posn(to_int(source + i, 3), 10, binary_string, bp);
         }
 
         weight_str[0] = source[19]; /* 0-9 x of 310x/320x */
@@ -1043,7 +1178,7 @@ static int dbar_exp_binary_string(struct zint_symbol *symbol, const unsigned cha
         }
         weight_str[6] = '\0';
 
-        bp = bin_append_posn(atoi(weight_str), 20, binary_string, bp);
+        bp = bits_append_posn(atoi(weight_str), 20, binary_string, bp);
 
         if (length == 34) {
             /* Date information is included */
@@ -1052,12 +1187,13 @@ static int dbar_exp_binary_string(struct zint_symbol *symbol, const unsigned cha
             group_val = 38400;
         }
 
-        bp = bin_append_posn((int) group_val, 16, binary_string, bp);
+        bp = bits_append_posn((int) group_val, 16, binary_string, bp);
     }
 
     if (debug_print && bp > cdf_bp_start) {
-        printf("Compressed data field (%d) = %.*s\n", bp - cdf_bp_start, bp - cdf_bp_start,
-            binary_string + cdf_bp_start);
+        printf("Compressed data field (%d) = ", bp - cdf_bp_start);
+        bits_print(binary_string, cdf_bp_start, bp - cdf_bp_start);
+        printf("\n");
     }
 
     /* The compressed data field has been processed if appropriate - the
@@ -1080,7 +1216,11 @@ static int dbar_exp_binary_string(struct zint_symbol *symbol, const unsigned cha
         }
     }
 
-    if (debug_print) printf("Resultant binary (%d): %.*s\n", bp, bp, binary_string);
+    if (debug_print) {
+        printf("Resultant binary (%d): ", bp);
+        bits_print(binary_string, 0, bp);
+        printf("\n");
+    }
 
     remainder = 12 - (bp % 12);
     if (remainder == 12) {
@@ -1110,12 +1250,12 @@ static int dbar_exp_binary_string(struct zint_symbol *symbol, const unsigned cha
         if (debug_print) printf("Adding extra (odd) numeric digit\n");
 
         if ((remainder >= 4) && (remainder <= 6)) {
-            bp = bin_append_posn(ctoi(last_digit) + 1, 4, binary_string, bp);
+            bp = bits_append_posn(ctoi(last_digit) + 1, 4, binary_string, bp);
         } else {
             d1 = ctoi(last_digit);
             d2 = 10;
 
-            bp = bin_append_posn((11 * d1) + d2 + 8, 7, binary_string, bp);
+            bp = bits_append_posn((11 * d1) + d2 + 8, 7, binary_string, bp);
         }
 
         remainder = 12 - (bp % 12);
@@ -1141,7 +1281,11 @@ static int dbar_exp_binary_string(struct zint_symbol *symbol, const unsigned cha
 
         remainder = (12 * (symbol_characters - 1)) - bp;
 
-        if (debug_print) printf(" Expanded binary (%d): %.*s\n", bp, bp, binary_string);
+        if (debug_print) {
+            printf(" Expanded binary (%d): ", bp);
+            bits_print(binary_string, 0, bp);
+            printf("\n");
+        }
     }
 
     if (bp > 252) { /* 252 = (21 * 12) */
@@ -1156,11 +1300,11 @@ static int dbar_exp_binary_string(struct zint_symbol *symbol, const unsigned cha
     /* Now add padding to binary string (7.2.5.5.4) */
     i = remainder;
     if (mode == NUMERIC) {
-        bp = bin_append_posn(0, 4, binary_string, bp); /* "0000" */
+        bp = bits_append_posn(0, 4, binary_string, bp); /* "0000" */
         i -= 4;
     }
     for (; i > 0; i -= 5) {
-        bp = bin_append_posn(4, 5, binary_string, bp); /* "00100" */
+        bp = bits_append_posn(4, 5, binary_string, bp); /* "00100" */
     }
 
     /* Patch variable length symbol bit field */
@@ -1173,18 +1317,16 @@ static int dbar_exp_binary_string(struct zint_symbol *symbol, const unsigned cha
     }
 
     if (encoding_method == 1) {
-        binary_string[2] = d1 ? '1' : '0';
-        binary_string[3] = d2 ? '1' : '0';
+        bits_append_posn((d1 << 1) | d2, 2, binary_string, 2);
     } else if (encoding_method == 2) {
-        binary_string[3] = d1 ? '1' : '0';
-        binary_string[4] = d2 ? '1' : '0';
+        bits_append_posn((d1 << 1) | d2, 2, binary_string, 3);
     } else if ((encoding_method == 5) || (encoding_method == 6)) {
-        binary_string[6] = d1 ? '1' : '0';
-        binary_string[7] = d2 ? '1' : '0';
+        bits_append_posn((d1 << 1) | d2, 2, binary_string, 6);
     }
     if (debug_print) {
-        printf("    Final binary (%d): %.*s\n    Symbol chars: %d, Remainder: %d\n",
-                bp, bp, binary_string, symbol_characters, remainder);
+        printf("    Final binary (%d): ", bp);
+        bits_print(binary_string, 0, bp);
+        printf("\n    Symbol chars: %d, Remainder: %d\n", symbol_characters, remainder);
     }
 
     *p_bp = bp;
@@ -1270,6 +1412,7 @@ INTERNAL int dbar_exp_cc(struct zint_symbol *symbol, unsigned char source[], int
     /* Allow for 8 bits + 5-bit latch per char + 200 bits overhead/padding */
     unsigned int bin_len = 13 * src_len + 200 + 1;
     int widths[4];
+    const unsigned int *const *tables;
     int bp = 0;
     int cols_per_row = 0;
     int max_rows = 0;
@@ -1277,10 +1420,10 @@ INTERNAL int dbar_exp_cc(struct zint_symbol *symbol, unsigned char source[], int
     const int debug_print = (symbol->debug & ZINT_DEBUG_PRINT);
 #ifndef _MSC_VER
     unsigned char reduced[src_len + 1];
-    char binary_string[bin_len];
+    uint64_t binary_string[BITS_WORDS(bin_len)];
 #else
     unsigned char *reduced = (unsigned char *) _alloca(src_len + 1);
-    char *binary_string = (char *) _alloca(bin_len);
+    uint64_t *binary_string = (uint64_t *) _alloca(sizeof(uint64_t) * BITS_WORDS(bin_len));
 #endif
 
     separator_row = 0;
@@ -1302,11 +1445,7 @@ INTERNAL int dbar_exp_cc(struct zint_symbol *symbol, unsigned char source[], int
         symbol->rows += 1;
     }
 
-    if (cc_rows) { /* The "component linkage" flag */
-        binary_string[bp++] = '1';
-    } else {
-        binary_string[bp++] = '0';
-    }
+    bp = bits_append_posn(cc_rows ? 1 : 0, 1, binary_string, bp); /* The "component linkage" flag */
 
     if ((symbol->symbology == BARCODE_DBAR_EXPSTK) || (symbol->symbology == BARCODE_DBAR_EXPSTK_CC)) {
         cols_per_row = 2; /* Default */
@@ -1330,15 +1469,11 @@ INTERNAL int dbar_exp_cc(struct zint_symbol *symbol, unsigned char source[], int
 
     data_chars = bp / 12;
 
+    tables = dbar_widths_tables(DBAR_EXP);
+
     if (debug_print) printf("Data:");
     for (i = 0; i < data_chars; i++) {
-        k = i * 12;
-        vs = 0;
-        for (j = 0; j < 12; j++) {
-            if (binary_string[k + j] == '1') {
-                vs |= (0x800 >> j);
-            }
-        }
+        vs = (int) bits_peek(binary_string, i * 12, 12);
 
         if (vs <= 347) {
             group = 1;
@@ -1355,12 +1490,14 @@ INTERNAL int dbar_exp_cc(struct zint_symbol *symbol, unsigned char source[], int
         v_even = (vs - g_sum_exp[group - 1]) % t_even_exp[group - 1];
         if (debug_print) printf("%s%d", i == 0 || (i & 1) ? " " : ",", vs);
 
-        getRSSwidths(widths, v_odd, modules_odd_exp[group - 1], 4, widest_odd_exp[group - 1], 0);
+        dbar_widths(widths, tables, DBAR_EXP_ODD + group - 1, v_odd, modules_odd_exp[group - 1], 4,
+                    widest_odd_exp[group - 1], 0);
         char_widths[i][0] = widths[0];
         char_widths[i][2] = widths[1];
         char_widths[i][4] = widths[2];
         char_widths[i][6] = widths[3];
-        getRSSwidths(widths, v_even, modules_even_exp[group - 1], 4, widest_even_exp[group - 1], 1);
+        dbar_widths(widths, tables, DBAR_EXP_EVEN + group - 1, v_even, modules_even_exp[group - 1], 4,
+                    widest_even_exp[group - 1], 1);
         char_widths[i][1] = widths[0];
         char_widths[i][3] = widths[1];
         char_widths[i][5] = widths[2];
@@ -1401,12 +1538,14 @@ INTERNAL int dbar_exp_cc(struct zint_symbol *symbol, unsigned char source[], int
     c_odd = (check_char - g_sum_exp[c_group - 1]) / t_even_exp[c_group - 1];
     c_even = (check_char - g_sum_exp[c_group - 1]) % t_even_exp[c_group - 1];
 
-    getRSSwidths(widths, c_odd, modules_odd_exp[c_group - 1], 4, widest_odd_exp[c_group - 1], 0);
+    dbar_widths(widths, tables, DBAR_EXP_ODD + c_group - 1, c_odd, modules_odd_exp[c_group - 1], 4,
+                widest_odd_exp[c_group - 1], 0);
     check_widths[0] = widths[0];
     check_widths[2] = widths[1];
     check_widths[4] = widths[2];
     check_widths[6] = widths[3];
-    getRSSwidths(widths, c_even, modules_even_exp[c_group - 1], 4, widest_even_exp[c_group - 1], 1);
+    dbar_widths(widths, tables, DBAR_EXP_EVEN + c_group - 1, c_even, modules_even_exp[c_group - 1], 4,
+                widest_even_exp[c_group - 1], 1);
     check_widths[1] = widths[0];
     check_widths[3] = widths[1];
     check_widths[5] = widths[2];
@@ -32,7 +32,6 @@
 /* vim: set ts=4 sw=4 et : */
 
 #include <errno.h>
-#include <locale.h>
 #include <stdio.h>
 #include <math.h>
 #ifdef _MSC_VER
@@ -40,6 +39,7 @@
 #endif
 
 #include "common.h"
+#include "filemem.h"
 
 static void pick_colour(int colour, char colour_code[]) {
     switch (colour) {
@@ -115,10 +115,40 @@ static void make_html_friendly(unsigned char *string, char *html_version) {
     }
 }
 
+/* Output opacity attribute */
+static void svg_put_opacity(struct fm_textbuf *const tbp, const float opacity) {
+    fm_tb_putsf(tbp, " opacity=\"", 3, opacity);
+    fm_tb_puts(tbp, "\"");
+}
+
+/* Output fill (or stroke) colour attribute */
+static void svg_put_colour(struct fm_textbuf *const tbp, const char *attrib, const char *colour_code) {
+    fm_tb_puts(tbp, attrib);
+    fm_tb_puts(tbp, "=\"#");
+    fm_tb_puts(tbp, colour_code);
+    fm_tb_puts(tbp, "\"");
+}
+
+/* Estimated output size, for pre-sizing the text buffer (it will grow if exceeded) */
+static size_t svg_size_estimate(const struct zint_vector *vector, const int html_len) {
+    /* Co-ordinates within the symbol, so max digits for sign + integer part + point + 2 decimals */
+    const float extent = vector->width > vector->height ? vector->width : vector->height;
+    size_t num_len = 4;
+    float f;
+
+    for (f = 10.0f; f <= extent; f *= 10.0f) {
+        num_len++;
+    }
+    return 1024 + vector->rectangle_count * (5 * num_len + 6) + vector->hexagon_count * (12 * num_len + 8)
+            + vector->circle_count * (7 * num_len + 24) + vector->string_count * (3 * num_len + 160 + html_len);
+}
+
 INTERNAL int svg_plot(struct zint_symbol *symbol) {
-    FILE *fsvg;
+    struct filemem fm;
+    struct filemem *const fmp = &fm;
+    struct fm_textbuf tb;
+    struct fm_textbuf *const tbp = &tb;
     int error_number = 0;
-    const char *locale = NULL;
     float ax, ay, bx, by, cx, cy, dx, dy, ex, ey, fx, fy;
     float previous_diameter;
     float radius, half_radius, half_sqrt3_radius;
@@ -130,7 +160,11 @@ INTERNAL int svg_plot(struct zint_symbol *symbol) {
     float fg_alpha_opacity = 0.0f, bg_alpha_opacity = 0.0f;
     const char font_family[] = "Helvetica, sans-serif";
     int bold;
+    int colours_used = 0;
+    int in_path;
+    int circle_colour = 0;
 
+    struct zint_vector *vector;
     struct zint_vector_rect *rect;
     struct zint_vector_hexagon *hex;
     struct zint_vector_circle *circle;
@@ -190,55 +224,77 @@ INTERNAL int svg_plot(struct zint_symbol *symbol) {
         strcpy(symbol->errtxt, "681: Vector header NULL");
         return ZINT_ERROR_INVALID_DATA;
     }
-    if (symbol->output_options & BARCODE_STDOUT) {
-        fsvg = stdout;
-    } else {
-        if (!(fsvg = fopen(symbol->outfile, "w"))) {
-            sprintf(symbol->errtxt, "680: Could not open output file (%d: %.30s)", errno, strerror(errno));
-            return ZINT_ERROR_FILE_ACCESS;
-        }
-    }
+    vector = symbol->vector;
 
-    locale = setlocale(LC_ALL, "C");
+    /* Format everything into one buffer, then write it in one go */
+    if (!fm_tb_init(tbp, svg_size_estimate(vector, html_len))) {
+        strcpy(symbol->errtxt, "683: Insufficient memory for SVG output buffer");
+        return ZINT_ERROR_MEMORY;
+    }
 
     /* Start writing the header */
-    fprintf(fsvg, "<?xml version=\"1.0\" standalone=\"no\"?>\n");
-    fprintf(fsvg, "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\"\n");
-    fprintf(fsvg, "   \"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n");
-    fprintf(fsvg, "<svg width=\"%d\" height=\"%d\" version=\"1.1\"\n",
-            (int) ceilf(symbol->vector->width), (int) ceilf(symbol->vector->height));
-    fprintf(fsvg, "   xmlns=\"http://www.w3.org/2000/svg\">\n");
-    fprintf(fsvg, "   <desc>Zint Generated Symbol\n");
-    fprintf(fsvg, "   </desc>\n");
-    fprintf(fsvg, "\n   <g id=\"barcode\" fill=\"#%s\">\n", fgcolour_string);
+    fm_tb_puts(tbp, "<?xml version=\"1.0\" standalone=\"no\"?>\n"
+                    "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\"\n"
+                    "   \"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n");
+    fm_tb_putsf(tbp, "<svg width=\"", 0, ceilf(vector->width));
+    fm_tb_putsf(tbp, "\" height=\"", 0, ceilf(vector->height));
+    fm_tb_puts(tbp, "\" version=\"1.1\"\n"
+                    "   xmlns=\"http://www.w3.org/2000/svg\">\n"
+                    "   <desc>Zint Generated Symbol\n"
+                    "   </desc>\n"
+                    "\n   <g id=\"barcode\"");
+    svg_put_colour(tbp, " fill", fgcolour_string);
+    fm_tb_puts(tbp, ">\n");
 
     if (bg_alpha != 0) {
-        fprintf(fsvg, "      <rect x=\"0\" y=\"0\" width=\"%d\" height=\"%d\" fill=\"#%s\"",
-                (int) ceilf(symbol->vector->width), (int) ceilf(symbol->vector->height), bgcolour_string);
+        fm_tb_putsf(tbp, "      <rect x=\"0\" y=\"0\" width=\"", 0, ceilf(vector->width));
+        fm_tb_putsf(tbp, "\" height=\"", 0, ceilf(vector->height));
+        fm_tb_puts(tbp, "\"");
+        svg_put_colour(tbp, " fill", bgcolour_string);
         if (bg_alpha != 0xff) {
-            fprintf(fsvg, " opacity=\"%.3f\"", bg_alpha_opacity);
+            svg_put_opacity(tbp, bg_alpha_opacity);
         }
-        fprintf(fsvg, " />\n");
+        fm_tb_puts(tbp, " />\n");
     }
 
-    rect = symbol->vector->rectangles;
-    while (rect) {
-        fprintf(fsvg, "      <rect x=\"%.2f\" y=\"%.2f\" width=\"%.2f\" height=\"%.2f\"",
-                rect->x, rect->y, rect->width, rect->height);
-        if (rect->colour != -1) {
-            pick_colour(rect->colour, colour_code);
-            fprintf(fsvg, " fill=\"#%s\"", colour_code);
+    /* Rectangles, as a single path of relative moves per colour (foreground first), which is much more compact than
+       a `<rect>` element each */
+    for (rect = vector->rectangles; rect; rect = rect->next) {
+        colours_used |= 1 << (rect->colour == -1 ? 0 : rect->colour);
+    }
+    for (i = 0; i <= 8; i++) {
+        const int colour = i ? i : -1;
+        if (!(colours_used & (1 << i))) {
+            continue;
+        }
+        fm_tb_puts(tbp, "      <path d=\"");
+        for (rect = vector->rectangles; rect; rect = rect->next) {
+            if (rect->colour == colour) {
+                fm_tb_putsf(tbp, "M", -2, rect->x);
+                fm_tb_putsf(tbp, " ", -2, rect->y);
+                fm_tb_putsf(tbp, "h", -2, rect->width);
+                fm_tb_putsf(tbp, "v", -2, rect->height);
+                fm_tb_putsf(tbp, "h", -2, -rect->width);
+                fm_tb_puts(tbp, "Z");
+            }
+        }
+        fm_tb_puts(tbp, "\"");
+        if (colour != -1) {
+            pick_colour(colour, colour_code);
+            svg_put_colour(tbp, " fill", colour_code);
         }
         if (fg_alpha != 0xff) {
-            fprintf(fsvg, " opacity=\"%.3f\"", fg_alpha_opacity);
+            svg_put_opacity(tbp, fg_alpha_opacity);
         }
-        fprintf(fsvg, " />\n");
-        rect = rect->next;
+        fm_tb_puts(tbp, " />\n");
     }
 
+    /* Hexagons, as a single path */
+    if (vector->hexagons) {
+        fm_tb_puts(tbp, "      <path d=\"");
+    }
     previous_diameter = radius = half_radius = half_sqrt3_radius = 0.0f;
-    hex = symbol->vector->hexagons;
-    while (hex) {
+    for (hex = vector->hexagons; hex; hex = hex->next) {
         if (previous_diameter != hex->diameter) {
             previous_diameter = hex->diameter;
             radius = (float) (0.5 * previous_diameter);
@@ -272,81 +328,140 @@ INTERNAL int svg_plot(struct zint_symbol *symbol) {
             ex = hex->x + half_radius;
             fx = hex->x - half_radius;
         }
-        fprintf(fsvg, "      <path d=\"M %.2f %.2f L %.2f %.2f L %.2f %.2f L %.2f %.2f L %.2f %.2f L %.2f %.2f Z\"",
-                ax, ay, bx, by, cx, cy, dx, dy, ex, ey, fx, fy);
+        fm_tb_putsf(tbp, "M", -2, ax);
+        fm_tb_putsf(tbp, " ", -2, ay);
+        fm_tb_putsf(tbp, "L", -2, bx);
+        fm_tb_putsf(tbp, " ", -2, by);
+        fm_tb_putsf(tbp, "L", -2, cx);
+        fm_tb_putsf(tbp, " ", -2, cy);
+        fm_tb_putsf(tbp, "L", -2, dx);
+        fm_tb_putsf(tbp, " ", -2, dy);
+        fm_tb_putsf(tbp, "L", -2, ex);
+        fm_tb_putsf(tbp, " ", -2, ey);
+        fm_tb_putsf(tbp, "L", -2, fx);
+        fm_tb_putsf(tbp, " ", -2, fy);
+        fm_tb_puts(tbp, "Z");
+    }
+    if (vector->hexagons) {
+        fm_tb_puts(tbp, "\"");
         if (fg_alpha != 0xff) {
-            fprintf(fsvg, " opacity=\"%.3f\"", fg_alpha_opacity);
+            svg_put_opacity(tbp, fg_alpha_opacity);
         }
-        fprintf(fsvg, " />\n");
-        hex = hex->next;
+        fm_tb_puts(tbp, " />\n");
     }
 
+    /* Circles - runs of discs of the same colour as a single path of arc pairs (keeping paint order), and circles
+       with width (MaxiCode bullseye rings) as `<circle>` elements */
     previous_diameter = radius = 0.0f;
-    circle = symbol->vector->circles;
-    while (circle) {
+    in_path = 0;
+    for (circle = vector->circles; circle; circle = circle->next) {
         if (previous_diameter != circle->diameter) {
             previous_diameter = circle->diameter;
             radius = (float) (0.5 * previous_diameter);
         }
-        fprintf(fsvg, "      <circle cx=\"%.2f\" cy=\"%.2f\" r=\"%.*f\"",
-                circle->x, circle->y, circle->width ? 3 : 2, radius);
-
-        if (circle->colour) {
-            if (circle->width) {
-                fprintf(fsvg, " stroke=\"#%s\" stroke-width=\"%.3f\" fill=\"none\"", bgcolour_string, circle->width);
-            } else {
-                fprintf(fsvg, " fill=\"#%s\"", bgcolour_string);
+        if (in_path && (circle->width || circle->colour != circle_colour)) {
+            fm_tb_puts(tbp, "\"");
+            if (circle_colour) {
+                svg_put_colour(tbp, " fill", bgcolour_string);
             }
-            if (bg_alpha != 0xff) {
-                // This doesn't work how the user is likely to expect - more work needed!
-                fprintf(fsvg, " opacity=\"%.3f\"", bg_alpha_opacity);
+            if (circle_colour ? bg_alpha != 0xff : fg_alpha != 0xff) {
+                svg_put_opacity(tbp, circle_colour ? bg_alpha_opacity : fg_alpha_opacity);
             }
-        } else {
-            if (circle->width) {
-                fprintf(fsvg, " stroke=\"#%s\" stroke-width=\"%.3f\" fill=\"none\"", fgcolour_string, circle->width);
-            }
-            if (fg_alpha != 0xff) {
-                fprintf(fsvg, " opacity=\"%.3f\"", fg_alpha_opacity);
+            fm_tb_puts(tbp, " />\n");
+            in_path = 0;
+        }
+        if (!circle->width) {
+            if (!in_path) {
+                fm_tb_puts(tbp, "      <path d=\"");
+                circle_colour = circle->colour;
+                in_path = 1;
             }
+            fm_tb_putsf(tbp, "M", -2, circle->x - radius);
+            fm_tb_putsf(tbp, " ", -2, circle->y);
+            fm_tb_putsf(tbp, "a", -2, radius);
+            fm_tb_putsf(tbp, " ", -2, radius);
+            fm_tb_putsf(tbp, " 0 1 0 ", -2, radius * 2.0f);
+            fm_tb_putsf(tbp, " 0a", -2, radius);
+            fm_tb_putsf(tbp, " ", -2, radius);
+            fm_tb_putsf(tbp, " 0 1 0 ", -2, -radius * 2.0f);
+            fm_tb_puts(tbp, " 0Z");
+            continue;
+        }
+        fm_tb_putsf(tbp, "      <circle cx=\"", 2, circle->x);
+        fm_tb_putsf(tbp, "\" cy=\"", 2, circle->y);
+        fm_tb_putsf(tbp, "\" r=\"", 3, radius);
+        fm_tb_puts(tbp, "\"");
+        svg_put_colour(tbp, " stroke", circle->colour ? bgcolour_string : fgcolour_string);
+        fm_tb_putsf(tbp, " stroke-width=\"", 3, circle->width);
+        fm_tb_puts(tbp, "\" fill=\"none\"");
+        if (circle->colour ? bg_alpha != 0xff : fg_alpha != 0xff) {
+            // This doesn't work how the user is likely to expect (for background colour) - more work needed!
+            svg_put_opacity(tbp, circle->colour ? bg_alpha_opacity : fg_alpha_opacity);
         }
-        fprintf(fsvg, " />\n");
-        circle = circle->next;
+        fm_tb_puts(tbp, " />\n");
+    }
+    if (in_path) {
+        fm_tb_puts(tbp, "\"");
+        if (circle_colour) {
+            svg_put_colour(tbp, " fill", bgcolour_string);
+        }
+        if (circle_colour ? bg_alpha != 0xff : fg_alpha != 0xff) {
+            svg_put_opacity(tbp, circle_colour ? bg_alpha_opacity : fg_alpha_opacity);
+        }
+        fm_tb_puts(tbp, " />\n");
     }
 
     bold = (symbol->output_options & BOLD_TEXT)
             && (!is_extendable(symbol->symbology) || (symbol->output_options & SMALL_TEXT));
-    string = symbol->vector->strings;
-    while (string) {
+    for (string = vector->strings; string; string = string->next) {
         const char *const halign = string->halign == 2 ? "end" : string->halign == 1 ? "start" : "middle";
-        fprintf(fsvg, "      <text x=\"%.2f\" y=\"%.2f\" text-anchor=\"%s\"\n", string->x, string->y, halign);
-        fprintf(fsvg, "         font-family=\"%s\" font-size=\"%.1f\"", font_family, string->fsize);
+        fm_tb_putsf(tbp, "      <text x=\"", 2, string->x);
+        fm_tb_putsf(tbp, "\" y=\"", 2, string->y);
+        fm_tb_puts(tbp, "\" text-anchor=\"");
+        fm_tb_puts(tbp, halign);
+        fm_tb_puts(tbp, "\"\n         font-family=\"");
+        fm_tb_puts(tbp, font_family);
+        fm_tb_putsf(tbp, "\" font-size=\"", 1, string->fsize);
+        fm_tb_puts(tbp, "\"");
         if (bold) {
-            fprintf(fsvg, " font-weight=\"bold\"");
+            fm_tb_puts(tbp, " font-weight=\"bold\"");
         }
         if (fg_alpha != 0xff) {
-            fprintf(fsvg, " opacity=\"%.3f\"", fg_alpha_opacity);
+            svg_put_opacity(tbp, fg_alpha_opacity);
         }
         if (string->rotation != 0) {
-            fprintf(fsvg, " transform=\"rotate(%d,%.2f,%.2f)\"", string->rotation, string->x, string->y);
+            fm_tb_putsf(tbp, " transform=\"rotate(", 0, (float) string->rotation);
+            fm_tb_putsf(tbp, ",", 2, string->x);
+            fm_tb_putsf(tbp, ",", 2, string->y);
+            fm_tb_puts(tbp, ")\"");
         }
-        fprintf(fsvg, " >\n");
+        fm_tb_puts(tbp, " >\n         ");
         make_html_friendly(string->text, html_string);
-        fprintf(fsvg, "         %s\n", html_string);
-        fprintf(fsvg, "      </text>\n");
-        string = string->next;
+        fm_tb_puts(tbp, html_string);
+        fm_tb_puts(tbp, "\n      </text>\n");
     }
 
-    fprintf(fsvg, "   </g>\n");
-    fprintf(fsvg, "</svg>\n");
+    fm_tb_puts(tbp, "   </g>\n"
+                    "</svg>\n");
 
-    if (symbol->output_options & BARCODE_STDOUT) {
-        fflush(fsvg);
-    } else {
-        fclose(fsvg);
+    if (tbp->err) {
+        fm_tb_free(tbp);
+        strcpy(symbol->errtxt, "684: Insufficient memory for SVG output buffer");
+        return ZINT_ERROR_MEMORY;
     }
 
-    if (locale)
-        setlocale(LC_ALL, locale);
+    if (!fm_open(fmp, symbol, "w")) {
+        fm_tb_free(tbp);
+        sprintf(symbol->errtxt, "680: Could not open output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_ACCESS;
+    }
+
+    fm_tb_flush(tbp, fmp);
+
+    if (!fm_close(fmp, symbol)) {
+        sprintf(symbol->errtxt, "682: Failure on closing output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_WRITE;
+    }
 
     return error_number;
 }
@@ -0,0 +1,244 @@
+/*
+    libzint - the open source barcode library
+    Copyright (C) 2026 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+/* vim: set ts=4 sw=4 et : */
+
+#include "testcommon.h"
+
+/* Allocator hooks can only be set before Zint allocates any memory, so these tests have their own process */
+
+#define ALLOC_MAX_LIVE 4096
+
+static int alloc_mallocs = 0;
+static int alloc_frees = 0;
+static int alloc_foreign_frees = 0; /* Frees of memory not allocated by `alloc_malloc()`/`alloc_realloc()` */
+static void *alloc_live[ALLOC_MAX_LIVE];
+static int alloc_live_cnt = 0;
+
+static void alloc_add_live(void *ptr) {
+    if (ptr && alloc_live_cnt < ALLOC_MAX_LIVE) {
+        alloc_live[alloc_live_cnt++] = ptr;
+    }
+}
+
+/* Returns 1 if `ptr` was live (and removes it), 0 if not */
+static int alloc_remove_live(void *ptr) {
+    int i;
+    for (i = 0; i < alloc_live_cnt; i++) {
+        if (alloc_live[i] == ptr) {
+            alloc_live[i] = alloc_live[--alloc_live_cnt];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void *alloc_malloc(size_t size) {
+    void *ptr = malloc(size);
+    alloc_mallocs++;
+    alloc_add_live(ptr);
+    return ptr;
+}
+
+static void *alloc_realloc(void *ptr, size_t size) {
+    void *new_ptr;
+    if (!ptr) {
+        alloc_mallocs++;
+    } else if (!alloc_remove_live(ptr)) {
+        alloc_foreign_frees++;
+    }
+    if (!(new_ptr = realloc(ptr, size))) {
+        alloc_add_live(ptr);
+    } else {
+        alloc_add_live(new_ptr);
+    }
+    return new_ptr;
+}
+
+static void alloc_free(void *ptr) {
+    alloc_frees++;
+    if (!alloc_remove_live(ptr)) {
+        alloc_foreign_frees++;
+    }
+    free(ptr);
+}
+
+/* Set the counting allocator (setting it again is allowed, as unchanged) */
+static int set_allocator(void) {
+    return ZBarcode_SetAllocator(alloc_malloc, alloc_realloc, alloc_free);
+}
+
+static void test_set_allocator(void) {
+
+    static const int symbologies[] = { BARCODE_QRCODE, BARCODE_DOTCODE, BARCODE_CODE128 };
+    int i, j, ret;
+    int mallocs;
+    struct zint_symbol *symbol;
+
+    testStart("test_set_allocator");
+
+    ret = ZBarcode_SetAllocator(alloc_malloc, NULL, alloc_free);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_SetAllocator(partial) ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+
+    ret = set_allocator();
+    assert_zero(ret, "ZBarcode_SetAllocator ret %d != 0\n", ret);
+
+    for (i = 0; i < ARRAY_SIZE(symbologies); i++) {
+        /* Warm up any process-wide caches (which are never freed) */
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "i:%d Symbol not created\n", i);
+        symbol->symbology = symbologies[i];
+        (void) ZBarcode_Encode(symbol, (const unsigned char *) "1234567890ABCDEFGHIJ1234567890ABCDEFGHIJ", 0);
+        ZBarcode_Delete(symbol);
+
+        alloc_mallocs = alloc_frees = 0;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "i:%d Symbol not created\n", i);
+        assert_equal(alloc_mallocs, 1, "i:%d alloc_mallocs %d != 1\n", i, alloc_mallocs);
+
+        for (j = 0; j < 4; j++) {
+            mallocs = alloc_mallocs;
+            symbol->symbology = symbologies[i];
+            ret = ZBarcode_Encode(symbol, (const unsigned char *) "1234567890ABCDEFGHIJ1234567890ABCDEFGHIJ", 0);
+            assert_zero(ret, "i:%d j:%d ZBarcode_Encode ret %d != 0 (%s)\n", i, j, ret, symbol->errtxt);
+            if (j > 0) {
+                /* Steady state - scratch memory reused, no heap calls */
+                assert_equal(alloc_mallocs, mallocs, "i:%d j:%d alloc_mallocs %d != %d\n", i, j, alloc_mallocs, mallocs);
+            }
+            ZBarcode_Clear(symbol);
+        }
+
+        ret = ZBarcode_Buffer(symbol, 0);
+        assert_zero(ret, "i:%d ZBarcode_Buffer ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+        assert_nonzero(alloc_mallocs > mallocs, "i:%d alloc_mallocs %d <= %d\n", i, alloc_mallocs, mallocs);
+
+        ZBarcode_Delete(symbol);
+        assert_equal(alloc_frees, alloc_mallocs, "i:%d alloc_frees %d != alloc_mallocs %d\n", i, alloc_frees, alloc_mallocs);
+    }
+
+    /* Unchanged allowed */
+    ret = set_allocator();
+    assert_zero(ret, "ZBarcode_SetAllocator(same) ret %d != 0\n", ret);
+
+    /* Can't change now memory allocated, including back to the defaults */
+    ret = ZBarcode_SetAllocator(NULL, NULL, NULL);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_SetAllocator(NULL) ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+    ret = ZBarcode_SetAllocator(malloc, realloc, free);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_SetAllocator(malloc) ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+
+    alloc_mallocs = 0;
+    symbol = ZBarcode_Create();
+    assert_nonnull(symbol, "Symbol not created\n");
+    assert_equal(alloc_mallocs, 1, "alloc_mallocs %d != 1 after failed reset\n", alloc_mallocs);
+    ZBarcode_Delete(symbol);
+
+    assert_zero(alloc_foreign_frees, "alloc_foreign_frees %d != 0\n", alloc_foreign_frees);
+
+    testFinish();
+}
+
+static void test_encode_cache(void) {
+
+    static const int symbologies[] = {
+        BARCODE_QRCODE, BARCODE_DATAMATRIX, BARCODE_AZTEC, BARCODE_DBAR_EXP, BARCODE_ULTRA, BARCODE_GS1_128
+    };
+    static const char data[] = "[01]12345678901231[10]ABC123";
+    struct zint_symbol *symbols[2][ARRAY_SIZE(symbologies)];
+    struct zint_cache_stats stats;
+    int i, j, ret;
+    int live_cnt;
+
+    testStart("test_encode_cache");
+
+    ret = set_allocator();
+    assert_zero(ret, "ZBarcode_SetAllocator ret %d != 0\n", ret);
+
+    /* Warm up any process-wide caches (which are never freed) */
+    for (i = 0; i < ARRAY_SIZE(symbologies); i++) {
+        symbols[0][i] = ZBarcode_Create();
+        assert_nonnull(symbols[0][i], "i:%d Symbol not created\n", i);
+        symbols[0][i]->symbology = symbologies[i];
+        symbols[0][i]->input_mode = GS1_MODE;
+        ret = ZBarcode_Encode(symbols[0][i], (const unsigned char *) data, 0);
+        assert_zero(ret, "i:%d ZBarcode_Encode ret %d != 0 (%s)\n", i, ret, symbols[0][i]->errtxt);
+        ZBarcode_Delete(symbols[0][i]);
+    }
+    live_cnt = alloc_live_cnt;
+
+    ret = ZBarcode_SetCacheSize(ARRAY_SIZE(symbologies));
+    assert_zero(ret, "ZBarcode_SetCacheSize ret %d != 0\n", ret);
+
+    /* First encode adds, second restores (symbols kept until after the cache is cleared) */
+    for (j = 0; j < 2; j++) {
+        for (i = 0; i < ARRAY_SIZE(symbologies); i++) {
+            symbols[j][i] = ZBarcode_Create();
+            assert_nonnull(symbols[j][i], "i:%d j:%d Symbol not created\n", i, j);
+            symbols[j][i]->symbology = symbologies[i];
+            symbols[j][i]->input_mode = GS1_MODE;
+            ret = ZBarcode_Encode(symbols[j][i], (const unsigned char *) data, 0);
+            assert_zero(ret, "i:%d j:%d ZBarcode_Encode ret %d != 0 (%s)\n", i, j, ret, symbols[j][i]->errtxt);
+        }
+    }
+    ZBarcode_CacheStats(&stats);
+    assert_equal(stats.entries, ARRAY_SIZE(symbologies), "stats.entries %d != %d\n", stats.entries, ARRAY_SIZE(symbologies));
+    assert_equal((int) stats.hits, ARRAY_SIZE(symbologies), "stats.hits %d != %d\n", (int) stats.hits, ARRAY_SIZE(symbologies));
+
+    /* Restoring the defaults refused while memory allocated */
+    ret = ZBarcode_SetAllocator(NULL, NULL, NULL);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_SetAllocator(NULL) ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+
+    ret = ZBarcode_SetCacheSize(0);
+    assert_zero(ret, "ZBarcode_SetCacheSize(0) ret %d != 0\n", ret);
+    for (j = 0; j < 2; j++) {
+        for (i = 0; i < ARRAY_SIZE(symbologies); i++) {
+            ZBarcode_Delete(symbols[j][i]);
+        }
+    }
+
+    /* Everything allocated since the warm-up freed, and only by the allocator that made it */
+    assert_equal(alloc_live_cnt, live_cnt, "alloc_live_cnt %d != %d\n", alloc_live_cnt, live_cnt);
+    assert_zero(alloc_foreign_frees, "alloc_foreign_frees %d != 0\n", alloc_foreign_frees);
+
+    testFinish();
+}
+
+int main(int argc, char *argv[]) {
+
+    testFunction funcs[] = { /* name, func, has_index, has_generate, has_debug */
+        { "test_set_allocator", test_set_allocator, 0, 0, 0 },
+        { "test_encode_cache", test_encode_cache, 0, 0, 0 },
+    };
+
+    testRun(argc, argv, funcs, ARRAY_SIZE(funcs));
+
+    testReport();
+
+    return 0;
+}
@@ -2385,6 +2385,90 @@ static void test_encode(int index, int generate, int debug) {
                     "01111111111"
                     "00111111100"
                 },
+        /* 63*/ { BARCODE_AZTEC, UNICODE_MODE | FAST_MODE, -1, -1, -1, -1, "Ab. Cd, Ef\r\nGh: ij\rK", -1, 0, 19, 19, 0, "FAST_MODE CR, '. ', ', ' and SP in U/L context; BWIPP different encodation",
+                    "0010101100000100111"
+                    "0110100110100011000"
+                    "0111010001001110101"
+                    "1110100100110000100"
+                    "0001110101011011100"
+                    "0000111111111111100"
+                    "0100110000000100001"
+                    "1010110111110100100"
+                    "0010110100010100010"
+                    "0001010101010110100"
+                    "0010110100010111001"
+                    "0100110111110101000"
+                    "1111010000000101001"
+                    "1110011111111111011"
+                    "1011001110101000001"
+                    "0000101111010110100"
+                    "0011100011000011000"
+                    "0011001001100101100"
+                    "1000000010100100100"
+                },
+        /* 64*/ { BARCODE_AZTEC, UNICODE_MODE | FAST_MODE, -1, -1, -1, -1, "12. 34, 56\r78 90. 1", -1, 0, 19, 19, 0, "FAST_MODE CR, '. ', ', ' and SP in D context; BWIPP different encodation",
+                    "1111110100101111100"
+                    "1111001010010010110"
+                    "0011101111010101001"
+                    "0100101110011110110"
+                    "1000110100111011110"
+                    "1011111111111111011"
+                    "0011110000000111011"
+                    "0001010111110100110"
+                    "0101110100010100101"
+                    "0011010101010111110"
+                    "0101010100010101100"
+                    "1001110111110111010"
+                    "1001110000000110100"
+                    "1000011111111111000"
+                    "1101001101000001010"
+                    "0001110000111100101"
+                    "0010111100100110010"
+                    "1000110001001011011"
+                    "0010110000001010000"
+                },
+        /* 65*/ { BARCODE_AZTEC, UNICODE_MODE | FAST_MODE, -1, -1, -1, -1, "@\\. ^, _\r| ~. `", -1, 0, 19, 19, 0, "FAST_MODE CR, '. ', ', ' and SP in M context; BWIPP different encodation",
+                    "1111101000011000110"
+                    "1001000101101011001"
+                    "1100101000001110011"
+                    "0111001100000000001"
+                    "0010110100110010001"
+                    "1001111111111111011"
+                    "1010110000000110001"
+                    "1011110111110101100"
+                    "0001110100010111010"
+                    "0011010101010110101"
+                    "0011010100010111101"
+                    "0101110111110100010"
+                    "1111010000000110000"
+                    "1011011111111111011"
+                    "1111001100100000111"
+                    "0001110010001000000"
+                    "0011101010100101100"
+                    "1010010101000111010"
+                    "0000111111010010000"
+                },
+        /* 66*/ { BARCODE_AZTEC, UNICODE_MODE | FAST_MODE, -1, -1, -1, -1, "![. ], {\r} ?, #", -1, 0, 19, 19, 0, "FAST_MODE CR, '. ', ', ' and SP in P context; BWIPP different encodation",
+                    "1101110100010100001"
+                    "1010010001110011001"
+                    "1110000000000011001"
+                    "1110111110101011100"
+                    "1010110100111011010"
+                    "0010111111111110001"
+                    "1111010000000100001"
+                    "0111010111110110100"
+                    "1000110100010101011"
+                    "1100010101010100111"
+                    "0000010100010110010"
+                    "0100010111110110000"
+                    "1101110000000100010"
+                    "1100011111111110000"
+                    "0000001110000000010"
+                    "0000110000101110000"
+                    "1001111010110000010"
+                    "1110011011001101111"
+                    "0100011111100111101"
+                },
     };
     int data_size = ARRAY_SIZE(data);
     int i, length, ret;
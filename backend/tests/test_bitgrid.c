@@ -0,0 +1,238 @@
+/*
+    libzint - the open source barcode library
+    Copyright (C) 2021 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+/* vim: set ts=4 sw=4 et : */
+
+#include "testcommon.h"
+#include "../bitgrid.h"
+
+#define TEST_MAX_LEN 200
+
+/* Pack string of '0's and '1's as a single row line */
+static void pack_line(const char *data, uint64_t row_line[], const int lane) {
+    unsigned char grid[TEST_MAX_LEN] = {0};
+    uint64_t col_lines[TEST_MAX_LEN * BITGRID_LINE_WORDS(1)];
+    int length = (int) strlen(data);
+    int i;
+
+    for (i = 0; i < length; i++) {
+        grid[i] = (unsigned char) (data[i] == '1' ? 1 << lane : 0xFF ^ (1 << lane)); /* Other lanes set contrariwise */
+    }
+    bitgrid_pack(grid, 1, length, lane, row_line, col_lines);
+
+    for (i = 0; i < length; i++) { /* Check column lines */
+        assert_equal((int) col_lines[i * BITGRID_LINE_WORDS(1) + 1], data[i] == '1', "col %d %d != %d\n",
+                    i, (int) col_lines[i * BITGRID_LINE_WORDS(1) + 1], data[i] == '1');
+    }
+}
+
+static void test_count(int index) {
+
+    struct item {
+        char *data;
+        int expected;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { "0", 0 },
+        /*  1*/ { "1", 1 },
+        /*  2*/ { "1011101", 5 },
+        /*  3*/ { "1111111111111111111111111111111111111111111111111111111111111111", 64 },
+        /*  4*/ { "11111111111111111111111111111111111111111111111111111111111111111", 65 },
+        /*  5*/ { "10000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001", 2 },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, ret;
+
+    uint64_t line[BITGRID_LINE_WORDS(TEST_MAX_LEN)];
+
+    testStart("test_count");
+
+    for (i = 0; i < data_size; i++) {
+        int length = (int) strlen(data[i].data);
+
+        if (index != -1 && i != index) continue;
+
+        pack_line(data[i].data, line, i & 7);
+
+        ret = bitgrid_count(line, length);
+        assert_equal(ret, data[i].expected, "i:%d ret %d != %d\n", i, ret, data[i].expected);
+    }
+
+    testFinish();
+}
+
+static void test_runs(int index) {
+
+    struct item {
+        char *data;
+        int min_run;
+        int expected;
+        int expected_runs;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { "0000", 5, 0, 0 },
+        /*  1*/ { "00000", 5, 1, 1 },
+        /*  2*/ { "000001111", 5, 1, 1 },
+        /*  3*/ { "0000011111", 5, 2, 2 },
+        /*  4*/ { "1111111", 5, 3, 1 },
+        /*  5*/ { "10101011111110", 5, 3, 1 },
+        /*  6*/ { "110", 3, 0, 0 },
+        /*  7*/ { "1110001101111", 3, 4, 3 },
+        /*  8*/ { "0000000000000000000000000000000000000000000000000000000000000000000000", 5, 66, 1 }, /* Spans words */
+        /*  9*/ { "0000000000000000000000000000000000000000000000000000000000000011111111", 5, 62, 2 }, /* Run starts in next word */
+        /* 10*/ { "1010101010101010101010101010101010101010101010101010101010101111101010", 5, 1, 1 },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, ret, runs;
+
+    uint64_t line[BITGRID_LINE_WORDS(TEST_MAX_LEN)];
+
+    testStart("test_runs");
+
+    for (i = 0; i < data_size; i++) {
+        int length = (int) strlen(data[i].data);
+
+        if (index != -1 && i != index) continue;
+
+        pack_line(data[i].data, line, i & 7);
+
+        ret = bitgrid_runs(line, length, data[i].min_run, &runs);
+        assert_equal(ret, data[i].expected, "i:%d ret %d != %d\n", i, ret, data[i].expected);
+        assert_equal(runs, data[i].expected_runs, "i:%d runs %d != %d\n", i, runs, data[i].expected_runs);
+    }
+
+    testFinish();
+}
+
+static void test_blocks(int index) {
+
+    struct item {
+        char *data_a;
+        char *data_b;
+        int expected;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { "0", "0", 0 },
+        /*  1*/ { "00", "00", 1 },
+        /*  2*/ { "11", "11", 1 },
+        /*  3*/ { "10", "10", 0 },
+        /*  4*/ { "111", "111", 2 },
+        /*  5*/ { "1100110", "1100111", 3 },
+        /*  6*/ { "0000000000000000000000000000000000000000000000000000000000000000000000", "0000000000000000000000000000000000000000000000000000000000000000000000", 69 },
+        /*  7*/ { "1010101010101010101010101010101010101010101010101010101010101010110101", "1010101010101010101010101010101010101010101010101010101010101010110101", 1 },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, ret;
+
+    uint64_t line_a[BITGRID_LINE_WORDS(TEST_MAX_LEN)];
+    uint64_t line_b[BITGRID_LINE_WORDS(TEST_MAX_LEN)];
+
+    testStart("test_blocks");
+
+    for (i = 0; i < data_size; i++) {
+        int length = (int) strlen(data[i].data_a);
+
+        if (index != -1 && i != index) continue;
+
+        assert_equal(length, (int) strlen(data[i].data_b), "i:%d length %d != %d\n", i, length, (int) strlen(data[i].data_b));
+
+        pack_line(data[i].data_a, line_a, i & 7);
+        pack_line(data[i].data_b, line_b, i & 7);
+
+        ret = bitgrid_blocks(line_a, line_b, length);
+        assert_equal(ret, data[i].expected, "i:%d ret %d != %d\n", i, ret, data[i].expected);
+    }
+
+    testFinish();
+}
+
+static void test_patterns(int index) {
+
+    struct item {
+        char *data;
+        unsigned int pattern;
+        int pattern_len;
+        int light;
+        int expected;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { "1011101", 0x5D, 7, 4, 1 }, /* Edges count as light */
+        /*  1*/ { "11011101", 0x5D, 7, 4, 1 }, /* End edge */
+        /*  2*/ { "110111011", 0x5D, 7, 4, 0 },
+        /*  3*/ { "1000010111011", 0x5D, 7, 4, 1 }, /* Before */
+        /*  4*/ { "1000110111010001", 0x5D, 7, 4, 0 },
+        /*  5*/ { "1000110111010000", 0x5D, 7, 4, 1 }, /* After */
+        /*  6*/ { "1011101011101", 0x5D, 7, 4, 2 },
+        /*  7*/ { "101110", 0x5D, 7, 4, 0 }, /* Too short */
+        /*  8*/ { "11010111", 0x57, 7, 3, 1 },
+        /*  9*/ { "1110101011", 0x75, 7, 3, 1 },
+        /* 10*/ { "1110101011", 0x57, 7, 3, 0 },
+        /* 11*/ { "1111111111111111111111111111111111111111111111111111111111100001011101", 0x5D, 7, 4, 1 }, /* Spans words */
+        /* 12*/ { "1111111111111111111111111111111111111111111111111111111111101110100001", 0x5D, 7, 4, 1 }, /* Spans words */
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, ret;
+
+    uint64_t line[BITGRID_LINE_WORDS(TEST_MAX_LEN)];
+
+    testStart("test_patterns");
+
+    for (i = 0; i < data_size; i++) {
+        int length = (int) strlen(data[i].data);
+
+        if (index != -1 && i != index) continue;
+
+        pack_line(data[i].data, line, i & 7);
+
+        ret = bitgrid_patterns(line, length, data[i].pattern, data[i].pattern_len, data[i].light);
+        assert_equal(ret, data[i].expected, "i:%d ret %d != %d\n", i, ret, data[i].expected);
+    }
+
+    testFinish();
+}
+
+int main(int argc, char *argv[]) {
+
+    testFunction funcs[] = { /* name, func, has_index, has_generate, has_debug */
+        { "test_count", test_count, 1, 0, 0 },
+        { "test_runs", test_runs, 1, 0, 0 },
+        { "test_blocks", test_blocks, 1, 0, 0 },
+        { "test_patterns", test_patterns, 1, 0, 0 },
+    };
+
+    testRun(argc, argv, funcs, ARRAY_SIZE(funcs));
+
+    testReport();
+
+    return 0;
+}
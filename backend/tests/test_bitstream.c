@@ -0,0 +1,224 @@
+/*
+    libzint - the open source barcode library
+    Copyright (C) 2021 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+/* vim: set ts=4 sw=4 et : */
+
+#include "testcommon.h"
+#include "../bitstream.h"
+
+#define TEST_MAX_BITS 192
+
+/* Set bitstream from string of '0's and '1's, other bits set to `fill` */
+static void set_bits(uint64_t bits[], const char *data, const int fill) {
+    const int length = (int) strlen(data);
+    int i;
+
+    (void) bits_pad_posn(fill, TEST_MAX_BITS, bits, 0);
+    for (i = 0; i < length; i++) {
+        (void) bits_pad_posn(data[i] == '1', 1, bits, i);
+    }
+}
+
+/* Compare bitstream with string of '0's and '1's, returning index of first mismatch or -1 if none */
+static int cmp_bits(const uint64_t bits[], const char *expected) {
+    int i;
+    for (i = 0; expected[i]; i++) {
+        if (bits_is_set(bits, i) != (expected[i] == '1')) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void test_append_posn(int index) {
+
+    struct item {
+        char *init;
+        unsigned int arg;
+        int length;
+        int bit_posn;
+
+        int ret;
+        char *expected;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { "", 1, 1, 0, 1, "10000000" },
+        /*  1*/ { "", 0x5, 3, 5, 8, "00000101" },
+        /*  2*/ { "", 0x3FF, 10, 3, 13, "0001111111111000" },
+        /*  3*/ { "", 0xABCDEF12, 32, 4, 36, "0000101010111100110111101111000100100000" },
+        /*  4*/ { "1111111111111111", 0, 9, 2, 11, "1100000000011111" },
+        /*  5*/ { "1111111111111111", 0x2, 2, 7, 9, "1111111101111111" },
+        /*  6*/ { "10101010", 0x1F, 0, 3, 3, "10101010" },
+        /*  7*/ { "", 0x3FFFF, 7, 8, 15, "0000000011111110" },
+        /*  8*/ { "", 0xABCDEF12, 32, 48, 80, "000000000000000000000000000000000000000000000000101010111100110111101111000100100000" },
+        /*  9*/ { "", 0xFFFFFFFF, 32, 60, 92, "00000000000000000000000000000000000000000000000000000000000011111111111111111111111111111111000" },
+        /* 10*/ { "1111111111111111111111111111111111111111111111111111111111111111111111111111111111111111111111111111", 0, 20, 54, 74, "1111111111111111111111111111111111111111111111111111110000000000000000000011111111111111111111111111" },
+        /* 11*/ { "", 0x2, 2, 63, 65, "000000000000000000000000000000000000000000000000000000000000000100" },
+        /* 12*/ { "", 0x1, 1, 64, 65, "000000000000000000000000000000000000000000000000000000000000000010" },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, ret;
+
+    uint64_t bits[BITS_WORDS(TEST_MAX_BITS)];
+
+    testStart("test_append_posn");
+
+    for (i = 0; i < data_size; i++) {
+        int fill;
+
+        if (index != -1 && i != index) continue;
+
+        for (fill = 0; fill < 2; fill++) {
+            set_bits(bits, data[i].init, *data[i].init ? 0 : fill);
+
+            ret = bits_append_posn(data[i].arg, data[i].length, bits, data[i].bit_posn);
+            assert_equal(ret, data[i].ret, "i:%d ret %d != %d\n", i, ret, data[i].ret);
+            if (!*data[i].init && fill) {
+                /* Bits outside the field preserved */
+                if (data[i].bit_posn) {
+                    assert_equal(bits_is_set(bits, data[i].bit_posn - 1), 1, "i:%d fill before not set\n", i);
+                }
+                assert_equal(bits_is_set(bits, data[i].ret), 1, "i:%d fill after not set\n", i);
+            } else {
+                ret = cmp_bits(bits, data[i].expected);
+                assert_equal(ret, -1, "i:%d bits mismatch at %d\n", i, ret);
+            }
+            if (data[i].length) {
+                unsigned int mask = data[i].length == 32 ? 0xFFFFFFFF : (1U << data[i].length) - 1;
+                unsigned int val = bits_peek(bits, data[i].bit_posn, data[i].length);
+                assert_equal(val, data[i].arg & mask, "i:%d bits_peek %X != %X\n", i, val, data[i].arg & mask);
+            }
+        }
+    }
+
+    testFinish();
+}
+
+static void test_peek(int index) {
+
+    struct item {
+        char *data;
+        int bit_posn;
+        int length;
+
+        unsigned int expected;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { "1", 0, 1, 1 },
+        /*  1*/ { "10110", 0, 5, 0x16 },
+        /*  2*/ { "10110", 3, 0, 0 },
+        /*  3*/ { "0000000000000000000000000000000000000000000000000000000000000110110", 61, 6, 0x36 },
+        /*  4*/ { "00000000000000000000000000000000000000000000000000000000000000001011", 64, 4, 0xB },
+        /*  5*/ { "0000000000000000000000000000000011111111111111111111111111111111", 32, 32, 0xFFFFFFFF },
+        /*  6*/ { "000000000000000000000000000000000000000000000000101010111100110111101111000100100000", 48, 32, 0xABCDEF12 },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i;
+    unsigned int val;
+
+    uint64_t bits[BITS_WORDS(TEST_MAX_BITS)];
+
+    testStart("test_peek");
+
+    for (i = 0; i < data_size; i++) {
+
+        if (index != -1 && i != index) continue;
+
+        set_bits(bits, data[i].data, 0);
+
+        val = bits_peek(bits, data[i].bit_posn, data[i].length);
+        assert_equal(val, data[i].expected, "i:%d bits_peek %X != %X\n", i, val, data[i].expected);
+    }
+
+    testFinish();
+}
+
+static void test_pad_posn(int index) {
+
+    struct item {
+        int value;
+        int length;
+        int bit_posn;
+
+        int ret;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { 1, 0, 5, 5 },
+        /*  1*/ { 1, 3, 5, 8 },
+        /*  2*/ { 0, 3, 5, 8 },
+        /*  3*/ { 1, 64, 0, 64 },
+        /*  4*/ { 1, 70, 60, 130 },
+        /*  5*/ { 0, 150, 1, 151 },
+        /*  6*/ { 1, 1, 191, 192 },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, j, ret;
+
+    uint64_t bits[BITS_WORDS(TEST_MAX_BITS)];
+
+    testStart("test_pad_posn");
+
+    for (i = 0; i < data_size; i++) {
+        int fill;
+
+        if (index != -1 && i != index) continue;
+
+        for (fill = 0; fill < 2; fill++) {
+            set_bits(bits, "", fill);
+
+            ret = bits_pad_posn(data[i].value, data[i].length, bits, data[i].bit_posn);
+            assert_equal(ret, data[i].ret, "i:%d fill:%d ret %d != %d\n", i, fill, ret, data[i].ret);
+            for (j = 0; j < TEST_MAX_BITS; j++) {
+                const int expected = j >= data[i].bit_posn && j < data[i].ret ? data[i].value : fill;
+                assert_equal(bits_is_set(bits, j), expected, "i:%d fill:%d bit %d %d != %d\n",
+                            i, fill, j, bits_is_set(bits, j), expected);
+            }
+        }
+    }
+
+    testFinish();
+}
+
+int main(int argc, char *argv[]) {
+
+    testFunction funcs[] = { /* name, func, has_index, has_generate, has_debug */
+        { "test_append_posn", test_append_posn, 1, 0, 0 },
+        { "test_peek", test_peek, 1, 0, 0 },
+        { "test_pad_posn", test_pad_posn, 1, 0, 0 },
+    };
+
+    testRun(argc, argv, funcs, ARRAY_SIZE(funcs));
+
+    testReport();
+
+    return 0;
+}
@@ -399,6 +399,40 @@ static void test_debug_test_codeword_dump_int(int index, int debug) {
     testFinish();
 }
 
+static void test_scratch(void) {
+
+    int i, j;
+    struct zint_symbol symbol = {0};
+    unsigned char *ptrs[20];
+    size_t sizes[20];
+
+    testStart("test_scratch");
+
+    for (j = 0; j < 3; j++) { /* Repeat to check reuse after reset */
+        for (i = 0; i < ARRAY_SIZE(ptrs); i++) {
+            sizes[i] = (size_t) (i * 997 % 5000) + (i == 10 ? 100000 : 0); /* Including zero and one large */
+            ptrs[i] = (unsigned char *) scratch_alloc(&symbol, sizes[i]);
+            assert_nonnull(ptrs[i], "j:%d i:%d scratch_alloc(%d) NULL\n", j, i, (int) sizes[i]);
+            assert_zero((size_t) ptrs[i] % 16, "j:%d i:%d ptr %p not aligned\n", j, i, (void *) ptrs[i]);
+            memset(ptrs[i], i, sizes[i]);
+        }
+        /* Check no overlaps (later allocations would have overwritten) */
+        for (i = 0; i < ARRAY_SIZE(ptrs); i++) {
+            if (sizes[i]) {
+                assert_equal(ptrs[i][0], i, "j:%d i:%d ptrs[i][0] %d != %d\n", j, i, ptrs[i][0], i);
+                assert_equal(ptrs[i][sizes[i] - 1], i, "j:%d i:%d ptrs[i][%d] %d != %d\n", j, i, (int) sizes[i] - 1, ptrs[i][sizes[i] - 1], i);
+            }
+        }
+        scratch_reset(&symbol);
+        assert_nonnull(symbol.scratch, "j:%d symbol.scratch NULL after reset\n", j);
+    }
+
+    scratch_free(&symbol);
+    assert_null(symbol.scratch, "symbol.scratch not NULL after free\n");
+
+    testFinish();
+}
+
 int main(int argc, char *argv[]) {
 
     testFunction funcs[] = { /* name, func, has_index, has_generate, has_debug */
@@ -408,6 +442,7 @@ int main(int argc, char *argv[]) {
         { "test_utf8_to_unicode", test_utf8_to_unicode, 1, 0, 1 },
         { "test_set_height", test_set_height, 1, 0, 1 },
         { "test_debug_test_codeword_dump_int", test_debug_test_codeword_dump_int, 1, 0, 1 },
+        { "test_scratch", test_scratch, 0, 0, 0 },
     };
 
     testRun(argc, argv, funcs, ARRAY_SIZE(funcs));
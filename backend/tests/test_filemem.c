@@ -0,0 +1,208 @@
+/*
+    libzint - the open source barcode library
+    Copyright (C) 2021 Robin Stuart <rstuart114@gmail.com>
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the project nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+ */
+/* vim: set ts=4 sw=4 et : */
+
+#include "testcommon.h"
+#include "../filemem.h"
+
+static void test_putsf(int index, int debug) {
+
+    struct item {
+        const char *prefix;
+        int dp;
+        float arg;
+        const char *expected;
+    };
+    struct item data[] = {
+        /*  0*/ { "", 2, 0.0f, "0.00" },
+        /*  1*/ { NULL, 2, 1.0f, "1.00" },
+        /*  2*/ { "x=", 2, 1.5f, "x=1.50" },
+        /*  3*/ { "", 2, -0.0f, "-0.00" },
+        /*  4*/ { "", 2, -0.001f, "-0.00" },
+        /*  5*/ { "", 2, 0.125f, "0.12" }, /* Half to even */
+        /*  6*/ { "", 2, 0.375f, "0.38" }, /* Half to even */
+        /*  7*/ { "", 2, 0.005f, "0.00" }, /* Not exactly half (0.00499999989...) */
+        /*  8*/ { "", 2, 2.675f, "2.67" }, /* Not exactly half (2.67499995...) */
+        /*  9*/ { "", 0, 0.5f, "0" },
+        /* 10*/ { "", 0, 1.5f, "2" },
+        /* 11*/ { "", 0, 2.5f, "2" },
+        /* 12*/ { "", 1, 9.96f, "10.0" },
+        /* 13*/ { "", 3, 0.99950f, "0.999" }, /* 0.999499976... */
+        /* 14*/ { "", 3, 123.4567f, "123.457" },
+        /* 15*/ { "", 6, 0.1f, "0.100000" },
+        /* 16*/ { "", 2, -1234.5678f, "-1234.57" },
+        /* 17*/ { "", 2, 16777216.0f, "16777216.00" },
+        /* 18*/ { "", 2, 1e20f, "100000002004087734272.00" }, /* > 2^64 after scaling, falls back to `printf()` */
+        /* 19*/ { "", -2, 2.5f, "2.5" }, /* Compact */
+        /* 20*/ { "", -2, 2.0f, "2" },
+        /* 21*/ { "", -2, 0.004f, "0" },
+        /* 22*/ { "", -2, -0.0f, "-0" },
+        /* 23*/ { "", -3, 10.1f, "10.1" },
+        /* 24*/ { "", -2, -1234.5678f, "-1234.57" },
+        /* 25*/ { "", -2, 1e20f, "100000002004087734272" },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, ret;
+    struct zint_symbol symbol = {0};
+    struct filemem fm;
+    struct filemem *const fmp = &fm;
+
+    testStart("test_putsf");
+
+    symbol.output_options = BARCODE_MEMORY_FILE;
+
+    for (i = 0; i < data_size; i++) {
+        int expected_len;
+
+        if (index != -1 && i != index) continue;
+        if ((debug & ZINT_DEBUG_TEST_PRINT) && !(debug & ZINT_DEBUG_TEST_LESS_NOISY)) printf("i:%d\n", i);
+
+        ret = fm_open(fmp, &symbol, "w");
+        assert_equal(ret, 1, "i:%d fm_open ret %d != 1\n", i, ret);
+
+        ret = fm_putsf(data[i].prefix, data[i].dp, data[i].arg, fmp);
+        assert_equal(ret, 1, "i:%d fm_putsf ret %d != 1\n", i, ret);
+
+        ret = fm_close(fmp, &symbol);
+        assert_equal(ret, 1, "i:%d fm_close ret %d != 1\n", i, ret);
+
+        expected_len = (int) strlen(data[i].expected);
+        assert_equal(symbol.memfile_size, expected_len, "i:%d memfile_size %d != %d\n", i, symbol.memfile_size, expected_len);
+        assert_zero(memcmp(symbol.memfile, data[i].expected, expected_len), "i:%d memcmp(%.*s, %s) != 0\n", i, symbol.memfile_size, symbol.memfile, data[i].expected);
+    }
+
+    free(symbol.memfile);
+
+    testFinish();
+}
+
+/* Check `fm_putsf()` against `sprintf()` (in the "C" locale) for a spread of values */
+static void test_putsf_printf(void) {
+
+    int i, j, ret;
+    struct zint_symbol symbol = {0};
+    struct filemem fm;
+    struct filemem *const fmp = &fm;
+    char expected[8192];
+    char *e;
+    unsigned int seed = 1;
+    float arg;
+
+    testStart("test_putsf_printf");
+
+    symbol.output_options = BARCODE_MEMORY_FILE;
+
+    for (i = 0; i < 1000; i++) {
+        ret = fm_open(fmp, &symbol, "w");
+        assert_equal(ret, 1, "i:%d fm_open ret %d != 1\n", i, ret);
+        e = expected;
+
+        for (j = 0; j < 64; j++) {
+            const int dp = j % 7;
+            seed = seed * 1103515245 + 12345;
+            switch (j & 3) {
+                case 0: arg = (float) (seed >> 8) / 1000.0f; break; /* Vector co-ordinates */
+                case 1: arg = -(float) (seed >> 16) / 8.0f; break; /* Exact halves/quarters/eighths */
+                case 2: arg = (float) (seed >> 20) / 100.0f + 0.005f; break; /* Near halves */
+                default: memcpy(&arg, &seed, sizeof(arg)); if (!(arg == arg) || arg > 1e12f || arg < -1e12f) arg = 0.5f; break;
+            }
+            ret = fm_putsf(" ", dp, arg, fmp);
+            assert_equal(ret, 1, "i:%d j:%d fm_putsf ret %d != 1\n", i, j, ret);
+            e += sprintf(e, " %.*f", dp, arg);
+        }
+
+        ret = fm_close(fmp, &symbol);
+        assert_equal(ret, 1, "i:%d fm_close ret %d != 1\n", i, ret);
+
+        assert_equal(symbol.memfile_size, (int) (e - expected), "i:%d memfile_size %d != %d\n", i, symbol.memfile_size, (int) (e - expected));
+        assert_zero(memcmp(symbol.memfile, expected, e - expected), "i:%d memcmp(%.*s, %s) != 0\n", i, symbol.memfile_size, symbol.memfile, expected);
+    }
+
+    free(symbol.memfile);
+
+    testFinish();
+}
+
+static void test_textbuf(void) {
+
+    int i, ret;
+    struct zint_symbol symbol = {0};
+    struct filemem fm;
+    struct filemem *const fmp = &fm;
+    struct fm_textbuf tb;
+    char expected[4096];
+    char *e = expected;
+
+    testStart("test_textbuf");
+
+    symbol.output_options = BARCODE_MEMORY_FILE;
+
+    ret = fm_tb_init(&tb, 1); /* Start tiny to force growth */
+    assert_equal(ret, 1, "fm_tb_init ret %d != 1\n", ret);
+
+    for (i = 0; i < 200; i++) {
+        fm_tb_puts(&tb, "<x>");
+        fm_tb_putsf(&tb, "M", -2, i * 0.25f);
+        fm_tb_putsf(&tb, NULL, 2, -i * 0.5f);
+        e += sprintf(e, "<x>M%g%.2f", i * 0.25, -i * 0.5);
+    }
+    assert_zero(tb.err, "tb.err %d != 0\n", tb.err);
+    assert_equal((int) (tb.p - tb.buf), (int) (e - expected), "len %d != %d\n", (int) (tb.p - tb.buf), (int) (e - expected));
+
+    ret = fm_open(fmp, &symbol, "w");
+    assert_equal(ret, 1, "fm_open ret %d != 1\n", ret);
+    ret = fm_tb_flush(&tb, fmp);
+    assert_equal(ret, 1, "fm_tb_flush ret %d != 1\n", ret);
+    assert_null(tb.buf, "tb.buf not NULL\n");
+    ret = fm_close(fmp, &symbol);
+    assert_equal(ret, 1, "fm_close ret %d != 1\n", ret);
+
+    assert_equal(symbol.memfile_size, (int) (e - expected), "memfile_size %d != %d\n", symbol.memfile_size, (int) (e - expected));
+    assert_zero(memcmp(symbol.memfile, expected, e - expected), "memcmp(%.*s, %s) != 0\n", symbol.memfile_size, symbol.memfile, expected);
+
+    free(symbol.memfile);
+
+    testFinish();
+}
+
+int main(int argc, char *argv[]) {
+
+    testFunction funcs[] = { /* name, func, has_index, has_generate, has_debug */
+        { "test_putsf", test_putsf, 1, 0, 1 },
+        { "test_putsf_printf", test_putsf_printf, 0, 0, 0 },
+        { "test_textbuf", test_textbuf, 0, 0, 0 },
+    };
+
+    testRun(argc, argv, funcs, ARRAY_SIZE(funcs));
+
+    testReport();
+
+    return 0;
+}
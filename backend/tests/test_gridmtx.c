@@ -304,6 +304,8 @@ static void test_input(int index, int generate, int debug) {
         /*113*/ { UNICODE_MODE, 0, -1, -1, { 2, 16, "" }, "12", 0, 0, "48 03 62 24 3C 3F 50", "FNC2 ID0 Cnt15 Ind1 N2" },
         /*114*/ { UNICODE_MODE, 0, READER_INIT, -1, { 2, 16, "" }, "12", 0, 0, "48 03 62 24 3C 3F 50", "FNC2 ID0 Cnt15 Ind1 N2 (FNC3 omitted)" },
         /*115*/ { UNICODE_MODE, 0, -1, -1, { 3, 3, "255" }, "12", 0, 0, "4F 7C 44 24 3C 3F 50", "FNC2 ID256 Cnt2 Ind2 N2" },
+        /*116*/ { UNICODE_MODE | FAST_MODE, 0, -1, -1, { 0, 0, "" }, "ABC12345 hello World", 0, 0, "29 22 66 01 04 0C 20 5F 55 68 5F 3F 17 68 19 35 5F 1F 78 00", "M20 (FAST_MODE)" },
+        /*117*/ { UNICODE_MODE | FAST_MODE, 0, -1, -1, { 0, 0, "" }, "一㈩é12345678", 0, 0, "0C 07 30 2B 42 53 3F 61 23 6D 64 30 67 7A", "H3 N8 (FAST_MODE)" },
     };
     int data_size = ARRAY_SIZE(data);
     int i, length, ret;
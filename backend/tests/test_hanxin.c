@@ -257,6 +257,10 @@ static void test_input(int index, int generate, int debug) {
         /* 78*/ { UNICODE_MODE, 900, -1, "é", -1, 0, 900, "88 38 43 00 16 1D 48 00 00", "ECI-900 B2 (no conversion)" },
         /* 79*/ { UNICODE_MODE, 16384, -1, "é", -1, 0, 16384, "8C 04 00 03 00 16 1D 48 00", "ECI-16384 B2 (no conversion)" },
         /* 80*/ { UNICODE_MODE, 3, -1, "β", -1, ZINT_ERROR_INVALID_DATA, 3, "Error 545: Invalid character in input data for ECI 3", "" },
+        /* 81*/ { UNICODE_MODE | FAST_MODE, 0, -1, "123", -1, 0, 0, "11 EF FF 00 00 00 00 00 00", "N3 (ASCII) (FAST_MODE)" },
+        /* 82*/ { UNICODE_MODE | FAST_MODE, 0, -1, "啊啊啊亍", -1, 0, 0, "64 68 48 D0 91 A1 40 F2 FF FE 00 00 00", "H(d)4 (FAST_MODE, same length as Region 1 -> Region 2)" },
+        /* 83*/ { UNICODE_MODE | FAST_MODE, 0, -1, "\302\200�", -1, 0, 0, "70 00 00 38 26 7E 40 00 00", "H(f)2 (GB 18030) (both 4-byte Region) (FAST_MODE)" },
+        /* 84*/ { UNICODE_MODE | FAST_MODE, 0, -1, "Summer Palace Ticket for 6 June 2015 13:00;2015年6月6日夜01時00分PM頤和園のチケット;2015년6월6일13시오후여름궁전티켓.2015年6月6号下午13:00的颐和园门票;", -1, 0, 0, "(189) 27 38 C3 0A 35 FC C0 C4 40 A0 C2 D8 C2 C6 CA 40 A8 D2 C6 D6 CA E8 40 CC DE E4 40 6C", "T6 B H(f) B (GB 18030) (FAST_MODE, same length)" },
     };
     int data_size = ARRAY_SIZE(data);
     int i, length, ret;
@@ -665,6 +665,8 @@ static void test_encode_file_unreadable(void) {
     symbol = ZBarcode_Create();
     assert_nonnull(symbol, "Symbol not created\n");
 
+    (void) remove(filename); // In case junk hanging around
+
     // Unreadable file
     fd = creat(filename, S_IWUSR);
     assert_notequal(fd, -1, "Unreadable input file (%s) not created == -1 (%d: %s)\n", filename, errno, strerror(errno));
@@ -674,11 +676,10 @@ static void test_encode_file_unreadable(void) {
     assert_zero(ret, "Unreadable close(%s) != 0(%d: %s)\n", filename, errno, strerror(errno));
 
     ret = ZBarcode_Encode_File(symbol, filename);
+    // Remove before checking so that a failure (e.g. when run as root) doesn't leave the file behind
+    (void) remove(filename);
     assert_equal(ret, ZINT_ERROR_INVALID_DATA, "ZBarcode_Encode_File unreadable ret %d != ZINT_ERROR_INVALID_DATA (%s)\n", ret, symbol->errtxt);
 
-    ret = remove(filename);
-    assert_zero(ret, "remove(%s) != 0 (%d: %s)\n", filename, errno, strerror(errno));
-
     ZBarcode_Delete(symbol);
 
     testFinish();
@@ -1031,6 +1032,540 @@ static void test_clear(void) {
     testFinish();
 }
 
+static void test_matrix(int index, int debug) {
+
+    struct item {
+        int symbology;
+        int option_2;
+        char *data;
+        int stacked;
+
+        int expected_rows;
+        int expected_width;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { BARCODE_EANX, -1, "123456789012", 0, 1, 95 },
+        /*  1*/ { BARCODE_QRCODE, 1, "1234", 0, 21, 21 },
+        /*  2*/ { BARCODE_DATAMATRIX, -1, "1234", 0, 10, 10 },
+        /*  3*/ { BARCODE_PDF417, -1, "1234", 0, 6, 103 },
+        /*  4*/ { BARCODE_ULTRA, -1, "1234", 0, 13, 15 },
+        /*  5*/ { BARCODE_MAXICODE, -1, "1234", 0, 33, 30 },
+        /*  6*/ { BARCODE_EANX_CC, -1, "[91]12", 0, 7, 99 },
+        /*  7*/ { BARCODE_CODE128, -1, "1234", 1, 2, 57 },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, j, length, ret;
+    struct zint_symbol *symbol, *expected_symbol;
+    unsigned char matrix[200 * 144 + 1];
+    char expected_errtxt[100];
+
+    testStart("test_matrix");
+
+    for (i = 0; i < data_size; i++) {
+        int stride, size, r, c;
+
+        if (index != -1 && i != index) continue;
+
+        expected_symbol = ZBarcode_Create();
+        assert_nonnull(expected_symbol, "Symbol not created\n");
+        length = testUtilSetSymbol(expected_symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/, data[i].option_2, -1, -1 /*output_options*/, data[i].data, -1, debug);
+        if (data[i].symbology == BARCODE_EANX_CC) {
+            strcpy(expected_symbol->primary, "123456789012");
+        }
+        for (j = 0; j <= data[i].stacked; j++) {
+            ret = ZBarcode_Encode(expected_symbol, (unsigned char *) data[i].data, length);
+            assert_zero(ret, "i:%d ZBarcode_Encode ret %d != 0 (%s)\n", i, ret, expected_symbol->errtxt);
+        }
+        assert_equal(expected_symbol->rows, data[i].expected_rows, "i:%d rows %d != %d\n", i, expected_symbol->rows, data[i].expected_rows);
+        assert_equal(expected_symbol->width, data[i].expected_width, "i:%d width %d != %d\n", i, expected_symbol->width, data[i].expected_width);
+        ret = ZBarcode_Buffer(expected_symbol, 0);
+        assert_zero(ret, "i:%d ZBarcode_Buffer ret %d != 0 (%s)\n", i, ret, expected_symbol->errtxt);
+
+        stride = data[i].symbology == BARCODE_ULTRA ? data[i].expected_width : (data[i].expected_width + 7) / 8;
+        size = data[i].expected_rows * stride;
+
+        /* Right-sized */
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+        length = testUtilSetSymbol(symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/, data[i].option_2, -1, -1 /*output_options*/, data[i].data, -1, debug);
+        if (data[i].symbology == BARCODE_EANX_CC) {
+            strcpy(symbol->primary, "123456789012");
+        }
+        memset(matrix, 0xA5, sizeof(matrix));
+        symbol->matrix = matrix;
+        symbol->matrix_size = size;
+        symbol->matrix_stride = stride;
+        for (j = 0; j <= data[i].stacked; j++) {
+            ret = ZBarcode_Encode(symbol, (unsigned char *) data[i].data, length);
+            assert_zero(ret, "i:%d j:%d ZBarcode_Encode ret %d != 0 (%s)\n", i, j, ret, symbol->errtxt);
+        }
+        assert_equal(symbol->rows, data[i].expected_rows, "i:%d rows %d != %d\n", i, symbol->rows, data[i].expected_rows);
+        assert_equal(symbol->width, data[i].expected_width, "i:%d width %d != %d\n", i, symbol->width, data[i].expected_width);
+        assert_equal(matrix[size], 0xA5, "i:%d matrix[%d] 0x%02X overwritten\n", i, size, matrix[size]);
+        for (r = 0; r < symbol->rows; r++) {
+            for (c = 0; c < symbol->width; c++) {
+                if (data[i].symbology == BARCODE_ULTRA) {
+                    assert_equal(matrix[r * stride + c], expected_symbol->encoded_data[r][c], "i:%d row %d column %d colour %d != %d\n", i, r, c, matrix[r * stride + c], expected_symbol->encoded_data[r][c]);
+                } else {
+                    int bit = (matrix[r * stride + (c >> 3)] >> (c & 0x07)) & 1;
+                    int expected_bit = (expected_symbol->encoded_data[r][c >> 3] >> (c & 0x07)) & 1;
+                    assert_equal(bit, expected_bit, "i:%d row %d column %d bit %d != %d\n", i, r, c, bit, expected_bit);
+                }
+            }
+            assert_zero(symbol->encoded_data[r][0], "i:%d encoded_data[%d][0] 0x%02X != 0\n", i, r, symbol->encoded_data[r][0]);
+        }
+        ret = ZBarcode_Buffer(symbol, 0);
+        assert_zero(ret, "i:%d ZBarcode_Buffer ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+        assert_equal(symbol->bitmap_width, expected_symbol->bitmap_width, "i:%d bitmap_width %d != %d\n", i, symbol->bitmap_width, expected_symbol->bitmap_width);
+        assert_equal(symbol->bitmap_height, expected_symbol->bitmap_height, "i:%d bitmap_height %d != %d\n", i, symbol->bitmap_height, expected_symbol->bitmap_height);
+        assert_zero(memcmp(symbol->bitmap, expected_symbol->bitmap, symbol->bitmap_width * symbol->bitmap_height * 3), "i:%d bitmap mismatch\n", i);
+
+        ZBarcode_Clear(symbol);
+        assert_zero(matrix[0], "i:%d ZBarcode_Clear() matrix[0] 0x%02X != 0\n", i, matrix[0]);
+        assert_equal(matrix[size], 0xA5, "i:%d ZBarcode_Clear() matrix[%d] 0x%02X overwritten\n", i, size, matrix[size]);
+
+        /* Too few rows */
+        sprintf(expected_errtxt, "Error 772: Matrix buffer too small for symbol (%d rows of %d bytes required)", data[i].expected_rows, stride);
+        symbol->matrix_size = size - stride;
+        if (symbol->matrix_size >= stride) {
+            memset(matrix, 0xA5, sizeof(matrix));
+            for (j = 0; j <= data[i].stacked; j++) {
+                ret = ZBarcode_Encode(symbol, (unsigned char *) data[i].data, length);
+            }
+            assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "i:%d small ZBarcode_Encode ret %d != ZINT_ERROR_INVALID_OPTION\n", i, ret);
+            assert_zero(strcmp(symbol->errtxt, expected_errtxt), "i:%d small errtxt %s != %s\n", i, symbol->errtxt, expected_errtxt);
+            assert_equal(matrix[size - stride], 0xA5, "i:%d small matrix[%d] 0x%02X overwritten\n", i, size - stride, matrix[size - stride]);
+            ZBarcode_Clear(symbol);
+        }
+
+        /* Too narrow */
+        if (stride > 1) {
+            symbol->matrix_size = size;
+            symbol->matrix_stride = stride - 1;
+            for (j = 0; j <= data[i].stacked; j++) {
+                ret = ZBarcode_Encode(symbol, (unsigned char *) data[i].data, length);
+            }
+            assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "i:%d narrow ZBarcode_Encode ret %d != ZINT_ERROR_INVALID_OPTION\n", i, ret);
+            assert_zero(strcmp(symbol->errtxt, expected_errtxt), "i:%d narrow errtxt %s != %s\n", i, symbol->errtxt, expected_errtxt);
+            ZBarcode_Clear(symbol);
+        }
+
+        /* Restored from encode result cache */
+        if (!data[i].stacked) {
+            unsigned char expected_matrix[200 * 144];
+            ret = ZBarcode_SetCacheSize(4);
+            assert_zero(ret, "i:%d ZBarcode_SetCacheSize(4) ret %d != 0\n", i, ret);
+            symbol->matrix_size = size;
+            symbol->matrix_stride = stride;
+            for (j = 0; j < 2; j++) {
+                memset(matrix, 0xA5, sizeof(matrix));
+                ret = ZBarcode_Encode(symbol, (unsigned char *) data[i].data, length);
+                assert_zero(ret, "i:%d j:%d cache ZBarcode_Encode ret %d != 0 (%s)\n", i, j, ret, symbol->errtxt);
+                if (j == 0) {
+                    memcpy(expected_matrix, matrix, size);
+                } else {
+                    assert_zero(memcmp(matrix, expected_matrix, size), "i:%d cache matrix mismatch\n", i);
+                    assert_equal(matrix[size], 0xA5, "i:%d cache matrix[%d] 0x%02X overwritten\n", i, size, matrix[size]);
+                }
+                ZBarcode_Clear(symbol);
+            }
+            ret = ZBarcode_SetCacheSize(0);
+            assert_zero(ret, "i:%d ZBarcode_SetCacheSize(0) ret %d != 0\n", i, ret);
+        }
+
+        /* Invalid */
+        symbol->matrix_size = stride - 1;
+        symbol->matrix_stride = stride;
+        ret = ZBarcode_Encode(symbol, (unsigned char *) data[i].data, length);
+        assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "i:%d invalid ZBarcode_Encode ret %d != ZINT_ERROR_INVALID_OPTION\n", i, ret);
+        assert_zero(strcmp(symbol->errtxt, "Error 771: Invalid matrix size or stride"), "i:%d invalid errtxt %s\n", i, symbol->errtxt);
+
+        ZBarcode_Delete(symbol);
+        ZBarcode_Delete(expected_symbol);
+    }
+
+    testFinish();
+}
+
+static void test_memfile(int index, int debug) {
+
+    struct item {
+        int symbology;
+        int output_options;
+        char *data;
+        char *outfile;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, -1, "1234", "test_memfile.png" },
+        /*  1*/ { BARCODE_QRCODE, -1, "1234", "test_memfile.gif" },
+        /*  2*/ { BARCODE_DATAMATRIX, -1, "1234", "test_memfile.bmp" },
+        /*  3*/ { BARCODE_PDF417, -1, "1234", "test_memfile.pcx" },
+        /*  4*/ { BARCODE_AZTEC, -1, "1234", "test_memfile.tif" },
+        /*  5*/ { BARCODE_ULTRA, CMYK_COLOUR, "1234", "test_memfile.tif" },
+        /*  6*/ { BARCODE_MAXICODE, -1, "1234", "test_memfile.svg" },
+        /*  7*/ { BARCODE_EANX, -1, "123456789012+12", "test_memfile.eps" },
+        /*  8*/ { BARCODE_DOTCODE, -1, "1234", "test_memfile.emf" },
+        /*  9*/ { BARCODE_ULTRA, -1, "1234", "test_memfile.txt" },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    struct zint_symbol *symbol;
+
+    testStart("test_memfile");
+
+    for (i = 0; i < data_size; i++) {
+        FILE *fp;
+        long file_size;
+        unsigned char *file_buf;
+
+        if (index != -1 && i != index) continue;
+#ifdef NO_PNG
+        if (strstr(data[i].outfile, ".png")) continue;
+#endif
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/, -1, -1, data[i].output_options, data[i].data, -1, debug);
+        strcpy(symbol->outfile, data[i].outfile);
+
+        ret = ZBarcode_Encode(symbol, (unsigned char *) data[i].data, length);
+        assert_zero(ret, "i:%d ZBarcode_Encode ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+
+        /* Write to file first, to compare against */
+        ret = ZBarcode_Print(symbol, 0);
+        assert_zero(ret, "i:%d ZBarcode_Print(%s) ret %d != 0 (%s)\n", i, symbol->outfile, ret, symbol->errtxt);
+        assert_null(symbol->memfile, "i:%d memfile non-NULL\n", i);
+        assert_zero(symbol->memfile_size, "i:%d memfile_size %d non-zero\n", i, symbol->memfile_size);
+
+        fp = fopen(symbol->outfile, "rb");
+        assert_nonnull(fp, "i:%d fopen(%s) failed (%d: %s)\n", i, symbol->outfile, errno, strerror(errno));
+        assert_zero(fseek(fp, 0, SEEK_END), "i:%d fseek(%s) failed\n", i, symbol->outfile);
+        file_size = ftell(fp);
+        assert_nonzero(file_size > 0, "i:%d ftell(%s) %ld <= 0\n", i, symbol->outfile, file_size);
+        rewind(fp);
+        file_buf = (unsigned char *) malloc(file_size);
+        assert_nonnull(file_buf, "i:%d malloc(%ld) failed\n", i, file_size);
+        assert_equal((long) fread(file_buf, 1, file_size, fp), file_size, "i:%d fread(%s) failed\n", i, symbol->outfile);
+        fclose(fp);
+        assert_zero(remove(symbol->outfile), "i:%d remove(%s) != 0\n", i, symbol->outfile);
+
+        /* Memory file, which takes precedence over stdout */
+        symbol->output_options |= BARCODE_MEMORY_FILE | BARCODE_STDOUT;
+        ret = ZBarcode_Print(symbol, 0);
+        assert_zero(ret, "i:%d ZBarcode_Print(%s) memfile ret %d != 0 (%s)\n", i, symbol->outfile, ret, symbol->errtxt);
+        assert_zero(testUtilExists(symbol->outfile), "i:%d testUtilExists(%s) != 0\n", i, symbol->outfile);
+        assert_nonnull(symbol->memfile, "i:%d memfile NULL\n", i);
+        assert_equal(symbol->memfile_size, file_size, "i:%d memfile_size %d != %ld\n", i, symbol->memfile_size, file_size);
+        assert_zero(memcmp(symbol->memfile, file_buf, file_size), "i:%d memcmp(memfile, %s) != 0\n", i, symbol->outfile);
+
+        /* Print again, replacing previous */
+        ret = ZBarcode_Print(symbol, 0);
+        assert_zero(ret, "i:%d ZBarcode_Print(%s) memfile 2nd ret %d != 0 (%s)\n", i, symbol->outfile, ret, symbol->errtxt);
+        assert_equal(symbol->memfile_size, file_size, "i:%d 2nd memfile_size %d != %ld\n", i, symbol->memfile_size, file_size);
+        assert_zero(memcmp(symbol->memfile, file_buf, file_size), "i:%d 2nd memcmp(memfile, %s) != 0\n", i, symbol->outfile);
+
+        ZBarcode_Clear(symbol);
+        assert_null(symbol->memfile, "i:%d ZBarcode_Clear() memfile non-NULL\n", i);
+        assert_zero(symbol->memfile_size, "i:%d ZBarcode_Clear() memfile_size %d non-zero\n", i, symbol->memfile_size);
+
+        free(file_buf);
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
+struct batch_result {
+    int called;
+    int error_number;
+    int rows;
+    int width;
+    char errtxt[100];
+    unsigned char matrix[200 * 144];
+};
+
+struct batch_user_data {
+    struct batch_result *results;
+    int abort_index;
+};
+
+static int batch_callback(struct zint_symbol *symbol, int index, int error_number, void *user_data) {
+    struct batch_user_data *ud = (struct batch_user_data *) user_data;
+    struct batch_result *result = &ud->results[index];
+
+    result->called++;
+    result->error_number = error_number;
+    result->rows = symbol->rows;
+    result->width = symbol->width;
+    strcpy(result->errtxt, symbol->errtxt);
+    if (error_number < ZINT_ERROR) {
+        memcpy(result->matrix, symbol->encoded_data, sizeof(result->matrix));
+    }
+    return index == ud->abort_index;
+}
+
+static void test_encode_batch(int index, int debug) {
+
+    struct item {
+        int symbology;
+        int count;
+        int threads;
+        int with_lengths;
+        int abort_index;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, 1, 1, 0, -1 },
+        /*  1*/ { BARCODE_CODE128, 50, 1, 1, -1 },
+        /*  2*/ { BARCODE_QRCODE, 50, 4, 0, -1 },
+        /*  3*/ { BARCODE_DATAMATRIX, 50, 4, 1, -1 },
+        /*  4*/ { BARCODE_EANX, 50, 8, 0, -1 }, /* Some inputs invalid */
+        /*  5*/ { BARCODE_AZTEC, 3, 8, 0, -1 }, /* Threads > count */
+        /*  6*/ { BARCODE_PDF417, 50, 0, 0, -1 }, /* Threads < 1 */
+        /*  7*/ { BARCODE_CODE128, 50, 1, 0, 9 }, /* Abort */
+        /*  8*/ { BARCODE_CODE128, 0, 4, 0, -1 },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, j, ret;
+    struct zint_symbol *symbol;
+    struct zint_symbol *expected_symbol;
+
+    char inputs[50][20];
+    const unsigned char *sources[50];
+    int lengths[50];
+    struct batch_result *results;
+    struct batch_user_data user_data;
+
+    testStart("test_encode_batch");
+
+    results = (struct batch_result *) malloc(sizeof(struct batch_result) * ARRAY_SIZE(inputs));
+    assert_nonnull(results, "results malloc failed\n");
+
+    for (j = 0; j < ARRAY_SIZE(inputs); j++) {
+        sprintf(inputs[j], "%d%s", 1000 * (j + 1), j % 7 == 6 ? "A" : ""); /* Every 7th invalid for EANX */
+        sources[j] = (const unsigned char *) inputs[j];
+        lengths[j] = (int) strlen(inputs[j]);
+    }
+
+    for (i = 0; i < data_size; i++) {
+
+        if (index != -1 && i != index) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        (void) testUtilSetSymbol(symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/, -1, -1, -1 /*output_options*/, inputs[0], -1, debug);
+
+        memset(results, 0, sizeof(struct batch_result) * ARRAY_SIZE(inputs));
+        user_data.results = results;
+        user_data.abort_index = data[i].abort_index;
+
+        ret = ZBarcode_Encode_Batch(symbol, sources, data[i].with_lengths ? lengths : NULL, data[i].count, data[i].threads, batch_callback, &user_data);
+        assert_zero(ret, "i:%d ZBarcode_Encode_Batch ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+        assert_zero(symbol->rows, "i:%d template symbol->rows %d != 0\n", i, symbol->rows);
+
+        for (j = 0; j < data[i].count; j++) {
+            if (data[i].abort_index != -1 && j > data[i].abort_index) {
+                assert_zero(results[j].called, "i:%d j:%d called %d after abort\n", i, j, results[j].called);
+                continue;
+            }
+            assert_equal(results[j].called, 1, "i:%d j:%d called %d != 1\n", i, j, results[j].called);
+
+            /* Compare with serial encode */
+            expected_symbol = ZBarcode_Create();
+            assert_nonnull(expected_symbol, "Symbol not created\n");
+            expected_symbol->symbology = data[i].symbology;
+            expected_symbol->debug = debug;
+
+            ret = ZBarcode_Encode(expected_symbol, sources[j], lengths[j]);
+            assert_equal(results[j].error_number, ret, "i:%d j:%d error_number %d != %d\n", i, j, results[j].error_number, ret);
+            assert_zero(strcmp(results[j].errtxt, expected_symbol->errtxt), "i:%d j:%d errtxt %s != %s\n", i, j, results[j].errtxt, expected_symbol->errtxt);
+            if (ret < ZINT_ERROR) {
+                assert_equal(results[j].rows, expected_symbol->rows, "i:%d j:%d rows %d != %d\n", i, j, results[j].rows, expected_symbol->rows);
+                assert_equal(results[j].width, expected_symbol->width, "i:%d j:%d width %d != %d\n", i, j, results[j].width, expected_symbol->width);
+                assert_zero(memcmp(results[j].matrix, expected_symbol->encoded_data, sizeof(results[j].matrix)), "i:%d j:%d matrix mismatch\n", i, j);
+            }
+
+            ZBarcode_Delete(expected_symbol);
+        }
+
+        ZBarcode_Delete(symbol);
+    }
+
+    /* Bad args */
+    symbol = ZBarcode_Create();
+    assert_nonnull(symbol, "Symbol not created\n");
+
+    ret = ZBarcode_Encode_Batch(NULL, sources, NULL, 1, 1, batch_callback, &user_data);
+    assert_equal(ret, ZINT_ERROR_INVALID_DATA, "ZBarcode_Encode_Batch(NULL) ret %d != ZINT_ERROR_INVALID_DATA\n", ret);
+
+    ret = ZBarcode_Encode_Batch(symbol, NULL, NULL, 1, 1, batch_callback, &user_data);
+    assert_equal(ret, ZINT_ERROR_INVALID_DATA, "ZBarcode_Encode_Batch(sources NULL) ret %d != ZINT_ERROR_INVALID_DATA\n", ret);
+    assert_zero(strcmp(symbol->errtxt, "Error 237: Invalid batch sources or count"), "ZBarcode_Encode_Batch(sources NULL) errtxt %s\n", symbol->errtxt);
+
+    ret = ZBarcode_Encode_Batch(symbol, sources, NULL, -1, 1, batch_callback, &user_data);
+    assert_equal(ret, ZINT_ERROR_INVALID_DATA, "ZBarcode_Encode_Batch(count -1) ret %d != ZINT_ERROR_INVALID_DATA\n", ret);
+
+    ret = ZBarcode_Encode_Batch(symbol, sources, NULL, 1, 1, NULL, &user_data);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_Encode_Batch(callback NULL) ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+    assert_zero(strcmp(symbol->errtxt, "Error 238: Batch callback NULL"), "ZBarcode_Encode_Batch(callback NULL) errtxt %s\n", symbol->errtxt);
+
+    ZBarcode_Delete(symbol);
+
+    free(results);
+
+    testFinish();
+}
+
+static void test_encode_cache(int index) {
+
+    struct item {
+        int symbology;
+        int input_mode;
+        int eci;
+        int option_1;
+        int option_2;
+        int output_options;
+        char *data;
+        int ret;
+        int expected_hits;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, -1, -1, -1, -1, -1, "1234", 0, 1 },
+        /*  1*/ { BARCODE_CODE128, -1, -1, -1, -1, BARCODE_BIND, "1234", 0, 1 },
+        /*  2*/ { BARCODE_DATAMATRIX, UNICODE_MODE, -1, -1, -1, -1, "Ж", ZINT_WARN_USES_ECI, 1 }, /* ECI set by encode */
+        /*  3*/ { BARCODE_QRCODE, UNICODE_MODE, 7, 2, 3, -1, "Ж", 0, 1 },
+        /*  4*/ { BARCODE_DATAMATRIX, GS1_MODE, -1, -1, -1, -1, "[01]12345678901231", 0, 1 },
+        /*  5*/ { BARCODE_EANX, -1, -1, -1, -1, -1, "12345678901", 0, 1 },
+        /*  6*/ { BARCODE_EANX, -1, -1, -1, -1, -1, "A", ZINT_ERROR_INVALID_DATA, 0 }, /* Errors not cached */
+        /*  7*/ { 5, -1, -1, -1, -1, -1, "1234", 0, 1 }, /* Legacy symbology changed by encode */
+        /*  8*/ { BARCODE_PDF417, -1, -1, 1, 5, -1, "ABCDEFGHIJKLMNOPQRSTUVWXYZ", 0, 1 },
+        /*  9*/ { BARCODE_MAXICODE, -1, -1, -1, -1, -1, "1234", 0, 1 },
+        /* 10*/ { BARCODE_ULTRA, -1, -1, -1, -1, -1, "ABCDEFGHIJKLMNOPQRSTUVWXYZ", 0, 1 }, /* Colour rows byte per module */
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, j, k, ret;
+    struct zint_symbol *symbol, *expected_symbol;
+    struct zint_cache_stats stats;
+
+    testStart("test_encode_cache");
+
+    ret = ZBarcode_SetCacheSize(-1);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_SetCacheSize(-1) ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+    ret = ZBarcode_SetCacheSize(1000001);
+    assert_equal(ret, ZINT_ERROR_INVALID_OPTION, "ZBarcode_SetCacheSize(1000001) ret %d != ZINT_ERROR_INVALID_OPTION\n", ret);
+
+    for (i = 0; i < data_size; i++) {
+
+        if (index != -1 && i != index) continue;
+
+        /* Uncached */
+        ret = ZBarcode_SetCacheSize(0);
+        assert_zero(ret, "i:%d ZBarcode_SetCacheSize(0) ret %d != 0\n", i, ret);
+
+        expected_symbol = ZBarcode_Create();
+        assert_nonnull(expected_symbol, "Symbol not created\n");
+        (void) testUtilSetSymbol(expected_symbol, data[i].symbology, data[i].input_mode, data[i].eci, data[i].option_1, data[i].option_2, -1, data[i].output_options, data[i].data, -1, 0 /*debug*/);
+        ret = ZBarcode_Encode(expected_symbol, (const unsigned char *) data[i].data, -1);
+        assert_equal(ret, data[i].ret, "i:%d ZBarcode_Encode ret %d != %d (%s)\n", i, ret, data[i].ret, expected_symbol->errtxt);
+
+        ret = ZBarcode_SetCacheSize(4);
+        assert_zero(ret, "i:%d ZBarcode_SetCacheSize(4) ret %d != 0\n", i, ret);
+
+        /* First encode adds, second restores */
+        for (j = 0; j < 2; j++) {
+            symbol = ZBarcode_Create();
+            assert_nonnull(symbol, "Symbol not created\n");
+            (void) testUtilSetSymbol(symbol, data[i].symbology, data[i].input_mode, data[i].eci, data[i].option_1, data[i].option_2, -1, data[i].output_options, data[i].data, -1, 0 /*debug*/);
+            ret = ZBarcode_Encode(symbol, (const unsigned char *) data[i].data, -1);
+            assert_equal(ret, data[i].ret, "i:%d j:%d ZBarcode_Encode ret %d != %d (%s)\n", i, j, ret, data[i].ret, symbol->errtxt);
+            assert_zero(strcmp(symbol->errtxt, expected_symbol->errtxt), "i:%d j:%d errtxt %s != %s\n", i, j, symbol->errtxt, expected_symbol->errtxt);
+            assert_equal(symbol->symbology, expected_symbol->symbology, "i:%d j:%d symbology %d != %d\n", i, j, symbol->symbology, expected_symbol->symbology);
+            assert_equal(symbol->eci, expected_symbol->eci, "i:%d j:%d eci %d != %d\n", i, j, symbol->eci, expected_symbol->eci);
+            assert_equal(symbol->option_2, expected_symbol->option_2, "i:%d j:%d option_2 %d != %d\n", i, j, symbol->option_2, expected_symbol->option_2);
+            assert_equal(symbol->height, expected_symbol->height, "i:%d j:%d height %g != %g\n", i, j, symbol->height, expected_symbol->height);
+            assert_equal(symbol->rows, expected_symbol->rows, "i:%d j:%d rows %d != %d\n", i, j, symbol->rows, expected_symbol->rows);
+            assert_equal(symbol->width, expected_symbol->width, "i:%d j:%d width %d != %d\n", i, j, symbol->width, expected_symbol->width);
+            assert_zero(strcmp((const char *) symbol->text, (const char *) expected_symbol->text), "i:%d j:%d text %s != %s\n", i, j, symbol->text, expected_symbol->text);
+            for (k = 0; k < symbol->rows; k++) {
+                assert_equal(symbol->row_height[k], expected_symbol->row_height[k], "i:%d j:%d row_height[%d] %g != %g\n", i, j, k, symbol->row_height[k], expected_symbol->row_height[k]);
+            }
+            if (ret < ZINT_ERROR) {
+                assert_zero(memcmp(symbol->encoded_data, expected_symbol->encoded_data, sizeof(symbol->encoded_data)), "i:%d j:%d encoded_data mismatch\n", i, j);
+                ret = ZBarcode_Buffer(symbol, 0);
+                assert_zero(ret, "i:%d j:%d ZBarcode_Buffer ret %d != 0 (%s)\n", i, j, ret, symbol->errtxt);
+            }
+            ZBarcode_Delete(symbol);
+        }
+
+        ZBarcode_CacheStats(&stats);
+        assert_equal(stats.max_entries, 4, "i:%d max_entries %d != 4\n", i, stats.max_entries);
+        assert_equal(stats.entries, data[i].expected_hits, "i:%d entries %d != %d\n", i, stats.entries, data[i].expected_hits);
+        assert_equal((int) stats.hits, data[i].expected_hits, "i:%d hits %d != %d\n", i, (int) stats.hits, data[i].expected_hits);
+        assert_equal((int) stats.misses, 2 - data[i].expected_hits, "i:%d misses %d != %d\n", i, (int) stats.misses, 2 - data[i].expected_hits);
+        assert_zero(stats.evictions, "i:%d evictions %d != 0\n", i, (int) stats.evictions);
+
+        ZBarcode_Delete(expected_symbol);
+    }
+
+    /* Eviction of least recently used */
+    ret = ZBarcode_SetCacheSize(2);
+    assert_zero(ret, "ZBarcode_SetCacheSize(2) ret %d != 0\n", ret);
+    {
+        static const char *const inputs[] = { "1", "2", "1", "3", "1", "2" };
+        static const int expected_hits[] = { 0, 0, 1, 1, 2, 2 };
+        for (j = 0; j < ARRAY_SIZE(inputs); j++) {
+            symbol = ZBarcode_Create();
+            assert_nonnull(symbol, "Symbol not created\n");
+            symbol->symbology = BARCODE_CODE128;
+            ret = ZBarcode_Encode(symbol, (const unsigned char *) inputs[j], -1);
+            assert_zero(ret, "j:%d ZBarcode_Encode ret %d != 0 (%s)\n", j, ret, symbol->errtxt);
+            ZBarcode_CacheStats(&stats);
+            assert_equal((int) stats.hits, expected_hits[j], "j:%d hits %d != %d\n", j, (int) stats.hits, expected_hits[j]);
+            ZBarcode_Delete(symbol);
+        }
+        /* "3" evicted "2" (as "1" more recently used), then "2" evicted "3" */
+        assert_equal(stats.entries, 2, "entries %d != 2\n", stats.entries);
+        assert_equal((int) stats.misses, 4, "misses %d != 4\n", (int) stats.misses);
+        assert_equal((int) stats.evictions, 2, "evictions %d != 2\n", (int) stats.evictions);
+    }
+
+    /* Not cached if stacking or debugging */
+    symbol = ZBarcode_Create();
+    assert_nonnull(symbol, "Symbol not created\n");
+    symbol->symbology = BARCODE_CODE128;
+    symbol->rows = 1;
+    ret = ZBarcode_Encode(symbol, (const unsigned char *) "1", -1);
+    assert_zero(ret, "ZBarcode_Encode ret %d != 0 (%s)\n", ret, symbol->errtxt);
+    assert_equal(symbol->rows, 2, "rows %d != 2\n", symbol->rows);
+    ZBarcode_Delete(symbol);
+
+    symbol = ZBarcode_Create();
+    assert_nonnull(symbol, "Symbol not created\n");
+    symbol->symbology = BARCODE_CODE128;
+    symbol->debug = ZINT_DEBUG_TEST;
+    ret = ZBarcode_Encode(symbol, (const unsigned char *) "1", -1);
+    assert_zero(ret, "ZBarcode_Encode ret %d != 0 (%s)\n", ret, symbol->errtxt);
+    ZBarcode_Delete(symbol);
+
+    ZBarcode_CacheStats(&stats);
+    assert_equal((int) stats.hits, 2, "hits %d != 2\n", (int) stats.hits);
+    assert_equal((int) stats.misses, 4, "misses %d != 4\n", (int) stats.misses);
+
+    ret = ZBarcode_SetCacheSize(0);
+    assert_zero(ret, "ZBarcode_SetCacheSize(0) ret %d != 0\n", ret);
+    ZBarcode_CacheStats(&stats);
+    assert_zero(stats.max_entries, "max_entries %d != 0\n", stats.max_entries);
+    assert_zero(stats.entries, "entries %d != 0\n", stats.entries);
+    assert_zero(stats.hits, "hits %d != 0\n", (int) stats.hits);
+
+    testFinish();
+}
+
 int main(int argc, char *argv[]) {
 
     testFunction funcs[] = { /* name, func, has_index, has_generate, has_debug */
@@ -1050,6 +1585,10 @@ int main(int argc, char *argv[]) {
         { "test_strip_bom", test_strip_bom, 0, 0, 0 },
         { "test_zero_outfile", test_zero_outfile, 0, 0, 0 },
         { "test_clear", test_clear, 0, 0, 0 },
+        { "test_matrix", test_matrix, 1, 0, 1 },
+        { "test_memfile", test_memfile, 1, 0, 1 },
+        { "test_encode_batch", test_encode_batch, 1, 0, 1 },
+        { "test_encode_cache", test_encode_cache, 1, 0, 0 },
     };
 
     testRun(argc, argv, funcs, ARRAY_SIZE(funcs));
@@ -285,6 +285,7 @@ static void test_qr_input(int index, int generate, int debug) {
         /*124*/ { DATA_MODE, 899, -1, "\200", 0, 899, "78 38 34 01 80 00 EC 11 EC", "ECI-899 B1 (8-bit binary)" },
         /*125*/ { UNICODE_MODE, 900, -1, "é", 0, 900, "78 38 44 02 C3 A9 00 EC 11", "ECI-900 B2 (no conversion)" },
         /*126*/ { UNICODE_MODE, 16384, -1, "é", 0, 16384, "7C 04 00 04 02 C3 A9 00 EC", "ECI-16384 B2 (no conversion)" },
+        /*127*/ { UNICODE_MODE | FAST_MODE, 0, -1, "ABCDEFG1234567890abcdefβ", 0, 0, "20 39 CD 45 2A 15 01 02 87 B7 23 15 04 08 61 62 63 64 65 66 83 C0", "A7 N10 B7 (FAST_MODE)" },
     };
     int data_size = ARRAY_SIZE(data);
     int i, length, ret;
@@ -1833,6 +1834,7 @@ static void test_microqr_input(int index, int generate, int debug) {
         /* 38*/ { DATA_MODE, ZINT_FULL_MULTIBYTE, "ÁȁȁȁȁȂ¢", 0, "41 C3 6C 08 80 44 02 20 11 00 88 0A 12 0D 10 00", "B1 K6 B1 (UTF-8) (full multibyte)" },
         /* 39*/ { UNICODE_MODE, -1, "áA", 0, "8B 85 04 00 EC 11 EC 11 00", "B2 (ISO 8859-1)" },
         /* 40*/ { UNICODE_MODE, ZINT_FULL_MULTIBYTE, "áA", 0, "CE 00 40 00 EC 11 EC 11 00", "K1 (ISO 8859-1) (full multibyte)" },
+        /* 41*/ { UNICODE_MODE | FAST_MODE, -1, "12345ABC", 0, "0A 3D AD 4C E6 98 00 EC 00", "N5 A3 (FAST_MODE)" },
     };
     int data_size = ARRAY_SIZE(data);
     int i, length, ret;
@@ -3506,6 +3508,94 @@ static void test_rmqr_encode(int index, int generate, int debug) {
     testFinish();
 }
 
+STATIC_UNLESS_ZINT_TEST int getBinaryLength(const int version, char inputMode[], const unsigned int inputData[],
+            const int inputLength, const struct zint_structapp *p_structapp, const int gs1, const int eci,
+            unsigned int fast_sums[], const int debug_print);
+STATIC_UNLESS_ZINT_TEST int qr_cci_class(const int version);
+
+/* Check that versions of the same character count indicator class give the same modes and binary length, as
+   assumed by the mode memo */
+static void test_cci_class(int index, int debug) {
+
+    struct item {
+        int first_version; /* Internal version, i.e. RMQR_VERSION (41) and MICROQR_VERSION (73) based */
+        int last_version;
+        int gs1;
+        int eci;
+        int fast;
+        char *data;
+        int expected_classes;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { 1, 40, 0, 0, 0, "1", 3 }, // QR Code
+        /*  1*/ { 1, 40, 0, 0, 0, "HELLO WORLD 1234567890", 3 },
+        /*  2*/ { 1, 40, 0, 26, 0, "12345678AB12345678abcdefgh12345678ABCDEFGH\201\202", 3 },
+        /*  3*/ { 1, 40, 1, 0, 0, "0112345678901231%10ABC%%123", 3 },
+        /*  4*/ { 41, 72, 0, 0, 0, "1", 14 }, // rMQR
+        /*  5*/ { 41, 72, 0, 0, 0, "HELLO WORLD 1234567890", 14 },
+        /*  6*/ { 41, 72, 0, 0, 0, "12345678AB12345678abcdefgh12345678ABCDEFGH\201\202", 14 },
+        /*  7*/ { 41, 72, 1, 0, 0, "0112345678901231%10ABC%%123", 14 },
+        /*  8*/ { 73, 76, 0, 0, 0, "12345", 4 }, // Micro QR
+        /*  9*/ { 73, 76, 0, 0, 0, "123ABC45", 4 },
+        /* 10*/ { 73, 76, 0, 0, 0, "12345678ab", 4 },
+        /* 11*/ { 1, 40, 0, 0, 1, "HELLO WORLD 1234567890", 3 }, // FAST_MODE
+        /* 12*/ { 1, 40, 0, 26, 1, "12345678AB12345678abcdefgh12345678ABCDEFGH\201\202", 3 },
+        /* 13*/ { 1, 40, 1, 0, 1, "0112345678901231%10ABC%%123", 3 },
+        /* 14*/ { 41, 72, 0, 0, 1, "HELLO WORLD 1234567890", 14 },
+        /* 15*/ { 41, 72, 0, 0, 1, "12345678AB12345678abcdefgh12345678ABCDEFGH\201\202", 14 },
+        /* 16*/ { 41, 72, 1, 0, 1, "0112345678901231%10ABC%%123", 14 },
+        /* 17*/ { 73, 76, 0, 0, 1, "12345", 4 },
+        /* 18*/ { 73, 76, 0, 0, 1, "123ABC45", 4 },
+        /* 19*/ { 73, 76, 0, 0, 1, "12345678ab", 4 },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, j, k, length, version, binlen;
+
+    unsigned int jisdata[128];
+    char mode[128];
+    int keys[16];
+    int binlens[16];
+    char modes[16][128];
+    unsigned int fast_sums[FAST_SUMS_SIZE(128, 4)];
+    int count;
+
+    testStart("test_cci_class");
+
+    for (i = 0; i < data_size; i++) {
+
+        if (index != -1 && i != index) continue;
+        if (debug & ZINT_DEBUG_TEST_PRINT) printf("i:%d\n", i);
+
+        length = (int) strlen(data[i].data);
+        assert_nonzero(length <= ARRAY_SIZE(jisdata), "i:%d length %d > %d\n", i, length, ARRAY_SIZE(jisdata));
+        for (j = 0; j < length; j++) {
+            jisdata[j] = (unsigned char) data[i].data[j];
+        }
+
+        count = 0;
+        for (version = data[i].first_version; version <= data[i].last_version; version++) {
+            const int key = qr_cci_class(version);
+            binlen = getBinaryLength(version, mode, jisdata, length, NULL /*p_structapp*/, data[i].gs1, data[i].eci,
+                        data[i].fast ? fast_sums : NULL, 0 /*debug_print*/);
+            for (k = 0; k < count && keys[k] != key; k++);
+            if (k == count) {
+                assert_nonzero(count < ARRAY_SIZE(keys), "i:%d version %d count %d >= %d\n", i, version, count, ARRAY_SIZE(keys));
+                keys[count] = key;
+                binlens[count] = binlen;
+                memcpy(modes[count], mode, length);
+                count++;
+            } else {
+                assert_equal(binlen, binlens[k], "i:%d version %d binlen %d != %d\n", i, version, binlen, binlens[k]);
+                assert_zero(memcmp(mode, modes[k], length), "i:%d version %d mode %.*s != %.*s\n", i, version, length, mode, length, modes[k]);
+            }
+        }
+        assert_equal(count, data[i].expected_classes, "i:%d count %d != %d\n", i, count, data[i].expected_classes);
+    }
+
+    testFinish();
+}
+
 int main(int argc, char *argv[]) {
 
     testFunction funcs[] = { /* name, func, has_index, has_generate, has_debug */
@@ -3531,6 +3621,8 @@ int main(int argc, char *argv[]) {
         { "test_rmqr_gs1", test_rmqr_gs1, 1, 1, 1 },
         { "test_rmqr_optimize", test_rmqr_optimize, 1, 1, 1 },
         { "test_rmqr_encode", test_rmqr_encode, 1, 1, 1 },
+
+        { "test_cci_class", test_cci_class, 1, 0, 1 },
     };
 
     testRun(argc, argv, funcs, ARRAY_SIZE(funcs));
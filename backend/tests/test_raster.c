@@ -105,6 +105,83 @@ static void test_options(int index, int debug) {
     testFinish();
 }
 
+static void test_rotate(int index, int debug) {
+
+    struct item {
+        int symbology;
+        float scale;
+        char *data;
+        int expected_bitmap_width;
+        int expected_bitmap_height;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, 1, "A", 92, 116 },
+        /*  1*/ { BARCODE_QRCODE, 3.5, "1234567890ABCDEFGHIJKLMNOPQRSTUVWXYZ", 175, 175 }, /* Fractional scale, multiple tiles */
+        /*  2*/ { BARCODE_PDF417, 1.3, "1234567890ABCDEFGHIJKLMNOPQRSTUVWXYZ", 312, 78 }, /* Non-square, partial tiles */
+        /*  3*/ { BARCODE_MAXICODE, 1, "1234567890", 299, 298 },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    int angle, row, column;
+    struct zint_symbol *symbol, *rotated;
+
+    testStart("test_rotate");
+
+    for (i = 0; i < data_size; i++) {
+
+        if (index != -1 && i != index) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/, -1, -1, OUT_BUFFER_INTERMEDIATE, data[i].data, -1, debug);
+        symbol->scale = data[i].scale;
+
+        ret = ZBarcode_Encode_and_Buffer(symbol, (unsigned char *) data[i].data, length, 0);
+        assert_zero(ret, "i:%d ZBarcode_Encode_and_Buffer ret %d != 0 (%s)\n", i, ret, symbol->errtxt);
+        assert_equal(symbol->bitmap_width, data[i].expected_bitmap_width, "i:%d symbol->bitmap_width %d != %d\n", i, symbol->bitmap_width, data[i].expected_bitmap_width);
+        assert_equal(symbol->bitmap_height, data[i].expected_bitmap_height, "i:%d symbol->bitmap_height %d != %d\n", i, symbol->bitmap_height, data[i].expected_bitmap_height);
+
+        for (angle = 90; angle < 360; angle += 90) {
+            const int width = symbol->bitmap_width;
+            const int height = symbol->bitmap_height;
+
+            rotated = ZBarcode_Create();
+            assert_nonnull(rotated, "Symbol not created\n");
+
+            (void) testUtilSetSymbol(rotated, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/, -1, -1, OUT_BUFFER_INTERMEDIATE, data[i].data, -1, debug);
+            rotated->scale = data[i].scale;
+
+            ret = ZBarcode_Encode_and_Buffer(rotated, (unsigned char *) data[i].data, length, angle);
+            assert_zero(ret, "i:%d angle %d ZBarcode_Encode_and_Buffer ret %d != 0 (%s)\n", i, angle, ret, rotated->errtxt);
+            assert_equal(rotated->bitmap_width, angle == 180 ? width : height, "i:%d angle %d rotated->bitmap_width %d != %d\n", i, angle, rotated->bitmap_width, angle == 180 ? width : height);
+            assert_equal(rotated->bitmap_height, angle == 180 ? height : width, "i:%d angle %d rotated->bitmap_height %d != %d\n", i, angle, rotated->bitmap_height, angle == 180 ? height : width);
+
+            for (row = 0; row < height; row++) {
+                for (column = 0; column < width; column++) {
+                    const unsigned char pixel = symbol->bitmap[row * width + column];
+                    unsigned char rotated_pixel;
+                    if (angle == 90) {
+                        rotated_pixel = rotated->bitmap[column * height + (height - 1 - row)];
+                    } else if (angle == 180) {
+                        rotated_pixel = rotated->bitmap[(height - 1 - row) * width + (width - 1 - column)];
+                    } else {
+                        rotated_pixel = rotated->bitmap[(width - 1 - column) * height + row];
+                    }
+                    assert_equal(rotated_pixel, pixel, "i:%d angle %d row %d column %d rotated pixel %c != %c\n", i, angle, row, column, rotated_pixel, pixel);
+                }
+            }
+
+            ZBarcode_Delete(rotated);
+        }
+
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
 static void test_buffer(int index, int generate, int debug) {
 
     struct item {
@@ -431,6 +508,123 @@ static void test_buffer(int index, int generate, int debug) {
     testFinish();
 }
 
+static void test_buffer_packed(int index, int debug) {
+
+    struct item {
+        int symbology;
+        int output_options;
+        int bitmap_align;
+        char *fgcolour;
+        char *bgcolour;
+        int rotate_angle;
+        char *data;
+        int ret;
+        int expected_bitmap_stride;
+        char *expected_errtxt;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, OUT_BUFFER_1BPP, 0, NULL, NULL, 0, "A", 0, 12, "" }, /* Width 92 */
+        /*  1*/ { BARCODE_CODE128, OUT_BUFFER_1BPP, 1, NULL, NULL, 0, "A", 0, 12, "" },
+        /*  2*/ { BARCODE_CODE128, OUT_BUFFER_1BPP, 4, NULL, NULL, 0, "A", 0, 12, "" },
+        /*  3*/ { BARCODE_CODE128, OUT_BUFFER_1BPP, 8, NULL, NULL, 0, "A", 0, 16, "" },
+        /*  4*/ { BARCODE_CODE128, OUT_BUFFER_1BPP, 64, NULL, NULL, 0, "A", 0, 64, "" },
+        /*  5*/ { BARCODE_CODE128, OUT_BUFFER_1BPP, 0, NULL, NULL, 90, "A", 0, 15, "" }, /* Width 116 */
+        /*  6*/ { BARCODE_CODE128, OUT_BUFFER_1BPP, 0, "FFFFFF", "000000", 0, "A", 0, 12, "" }, /* Colours ignored */
+        /*  7*/ { BARCODE_CODE128, OUT_BUFFER_8BPP, 0, NULL, NULL, 0, "A", 0, 92, "" },
+        /*  8*/ { BARCODE_CODE128, OUT_BUFFER_8BPP, 16, NULL, NULL, 0, "A", 0, 96, "" },
+        /*  9*/ { BARCODE_CODE128, OUT_BUFFER_8BPP, 0, "FF0000", "FFFF0080", 270, "A", 0, 116, "" },
+        /* 10*/ { BARCODE_QRCODE, OUT_BUFFER_1BPP, 2, NULL, NULL, 0, "1234567890", 0, 6, "" }, /* Width 42 */
+        /* 11*/ { BARCODE_MAXICODE, OUT_BUFFER_1BPP, 0, NULL, NULL, 180, "1234567890", 0, 38, "" }, /* Width 299 */
+        /* 12*/ { BARCODE_MAXICODE, OUT_BUFFER_8BPP, 0, "112233", "AABBCC", 0, "1234567890", 0, 299, "" },
+        /* 13*/ { BARCODE_ULTRA, OUT_BUFFER_1BPP, 0, NULL, NULL, 0, "1234567890", 0, 5, "" }, /* Width 36 */
+        /* 14*/ { BARCODE_ULTRA, OUT_BUFFER_8BPP, 0, NULL, NULL, 0, "1234567890", 0, 36, "" },
+        /* 15*/ { BARCODE_DOTCODE, OUT_BUFFER_1BPP, 0, NULL, NULL, 0, "1234567890", 0, 5, "" }, /* Width 39 */
+        /* 16*/ { BARCODE_CODE128, OUT_BUFFER_1BPP | OUT_BUFFER_8BPP, 0, NULL, NULL, 0, "A", ZINT_ERROR_INVALID_OPTION, 0, "Error 264: Conflicting buffer output options (more than one of INTERMEDIATE, 1BPP, 8BPP)" },
+        /* 17*/ { BARCODE_CODE128, OUT_BUFFER_1BPP | OUT_BUFFER_INTERMEDIATE, 0, NULL, NULL, 0, "A", ZINT_ERROR_INVALID_OPTION, 0, "Error 264: Conflicting buffer output options (more than one of INTERMEDIATE, 1BPP, 8BPP)" },
+        /* 18*/ { BARCODE_CODE128, OUT_BUFFER_8BPP, 3, NULL, NULL, 0, "A", ZINT_ERROR_INVALID_OPTION, 0, "Error 265: Invalid bitmap alignment (powers of 2 from 1 to 64 only)" },
+        /* 19*/ { BARCODE_CODE128, OUT_BUFFER_8BPP, 128, NULL, NULL, 0, "A", ZINT_ERROR_INVALID_OPTION, 0, "Error 265: Invalid bitmap alignment (powers of 2 from 1 to 64 only)" },
+        /* 20*/ { BARCODE_CODE128, OUT_BUFFER_8BPP, -1, NULL, NULL, 0, "A", ZINT_ERROR_INVALID_OPTION, 0, "Error 265: Invalid bitmap alignment (powers of 2 from 1 to 64 only)" },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    int row, column;
+    struct zint_symbol *symbol, *reference;
+
+    testStart("test_buffer_packed");
+
+    for (i = 0; i < data_size; i++) {
+
+        if (index != -1 && i != index) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/, -1, -1, data[i].output_options, data[i].data, -1, debug);
+        symbol->bitmap_align = data[i].bitmap_align;
+        if (data[i].fgcolour) {
+            strcpy(symbol->fgcolour, data[i].fgcolour);
+        }
+        if (data[i].bgcolour) {
+            strcpy(symbol->bgcolour, data[i].bgcolour);
+        }
+
+        ret = ZBarcode_Encode_and_Buffer(symbol, (unsigned char *) data[i].data, length, data[i].rotate_angle);
+        assert_equal(ret, data[i].ret, "i:%d ZBarcode_Encode_and_Buffer ret %d != %d (%s)\n", i, ret, data[i].ret, symbol->errtxt);
+        assert_zero(strcmp(symbol->errtxt, data[i].expected_errtxt), "i:%d strcmp(%s, %s) != 0\n", i, symbol->errtxt, data[i].expected_errtxt);
+
+        if (ret < ZINT_ERROR) {
+            const int is_1bpp = data[i].output_options & OUT_BUFFER_1BPP;
+
+            assert_nonnull(symbol->bitmap, "i:%d symbol->bitmap NULL\n", i);
+            assert_null(symbol->alphamap, "i:%d symbol->alphamap not NULL\n", i);
+            assert_equal(symbol->bitmap_stride, data[i].expected_bitmap_stride, "i:%d symbol->bitmap_stride %d != %d\n", i, symbol->bitmap_stride, data[i].expected_bitmap_stride);
+
+            /* Compare against RGB buffer */
+            reference = ZBarcode_Create();
+            assert_nonnull(reference, "Symbol not created\n");
+
+            (void) testUtilSetSymbol(reference, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/, -1, -1, is_1bpp ? OUT_BUFFER_INTERMEDIATE : -1, data[i].data, -1, debug);
+            strcpy(reference->fgcolour, symbol->fgcolour);
+            strcpy(reference->bgcolour, symbol->bgcolour);
+
+            ret = ZBarcode_Encode_and_Buffer(reference, (unsigned char *) data[i].data, length, data[i].rotate_angle);
+            assert_zero(ret, "i:%d reference ZBarcode_Encode_and_Buffer ret %d != 0 (%s)\n", i, ret, reference->errtxt);
+            assert_equal(symbol->bitmap_width, reference->bitmap_width, "i:%d symbol->bitmap_width %d != %d\n", i, symbol->bitmap_width, reference->bitmap_width);
+            assert_equal(symbol->bitmap_height, reference->bitmap_height, "i:%d symbol->bitmap_height %d != %d\n", i, symbol->bitmap_height, reference->bitmap_height);
+            assert_equal(reference->bitmap_stride, reference->bitmap_width * (is_1bpp ? 1 : 3), "i:%d reference->bitmap_stride %d != %d\n", i, reference->bitmap_stride, reference->bitmap_width * (is_1bpp ? 1 : 3));
+
+            for (row = 0; row < symbol->bitmap_height; row++) {
+                const unsigned char *bitmap = symbol->bitmap + row * symbol->bitmap_stride;
+                const unsigned char *ref = reference->bitmap + row * reference->bitmap_stride;
+                for (column = 0; column < symbol->bitmap_width; column++) {
+                    int expected, actual;
+                    if (is_1bpp) {
+                        expected = ref[column] != '0' && ref[column] != 'W';
+                        actual = (bitmap[column >> 3] >> (7 - (column & 7))) & 1;
+                    } else {
+                        const unsigned char *rgb = ref + column * 3;
+                        expected = (299 * rgb[0] + 587 * rgb[1] + 114 * rgb[2] + 500) / 1000;
+                        actual = bitmap[column];
+                    }
+                    assert_equal(actual, expected, "i:%d row %d column %d pixel %d != %d\n", i, row, column, actual, expected);
+                }
+                /* Padding zeroed */
+                for (column = is_1bpp ? symbol->bitmap_width : symbol->bitmap_width * 8; column < symbol->bitmap_stride * 8; column++) {
+                    const int bit = (bitmap[column >> 3] >> (7 - (column & 7))) & 1;
+                    assert_zero(bit, "i:%d row %d padding bit %d set\n", i, row, column);
+                }
+            }
+
+            ZBarcode_Delete(reference);
+        }
+
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
 static void test_upcean_hrt(int index, int debug) {
 
     struct item {
@@ -2915,7 +3109,9 @@ int main(int argc, char *argv[]) {
 
     testFunction funcs[] = { /* name, func, has_index, has_generate, has_debug */
         { "test_options", test_options, 1, 0, 1 },
+        { "test_rotate", test_rotate, 1, 0, 1 },
         { "test_buffer", test_buffer, 1, 1, 1 },
+        { "test_buffer_packed", test_buffer_packed, 1, 0, 1 },
         { "test_upcean_hrt", test_upcean_hrt, 1, 0, 1 },
         { "test_row_separator", test_row_separator, 1, 0, 1 },
         { "test_stacking", test_stacking, 1, 0, 1 },
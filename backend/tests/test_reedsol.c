@@ -279,12 +279,18 @@ static void test_uint_encoding(int index, int debug) {
             assert_equal(res[k], data[i].expected[j], "i:%d res[%d] %d != expected[%d] %d\n", i, k, (int) res[k], j, (int) data[i].expected[j]);
         }
 
-        /* Simulate rs_uint_init_gf() malloc() failure and rs_uint_init_gf()'s return val not being checked */
+        /* Log tables and poly should now be cached, so same result */
         assert_nonzero(rs_uint_init_gf(&rs_uint, data[i].prime_poly, data[i].logmod), "i:%d rs_uint_init_gf() == 0\n", i);
-        free(rs_uint.logt);
-        rs_uint.logt = NULL;
-        free(rs_uint.alog);
-        rs_uint.alog = NULL;
+        assert_nonzero(rs_uint.cached, "i:%d rs_uint.cached zero\n", i);
+        rs_uint_init_code(&rs_uint, data[i].nsym, data[i].index);
+        rs_uint_encode(&rs_uint, data[i].datalen, data[i].data, res);
+        for (j = 0; j < data[i].nsym; j++) {
+            int k = data[i].nsym - 1 - j;
+            assert_equal(res[k], data[i].expected[j], "i:%d cached res[%d] %d != expected[%d] %d\n", i, k, (int) res[k], j, (int) data[i].expected[j]);
+        }
+
+        /* Simulate rs_uint_init_gf() malloc() failure and rs_uint_init_gf()'s return val not being checked */
+        rs_uint_free(&rs_uint);
 
         rs_uint_init_code(&rs_uint, data[i].nsym, data[i].index);
         rs_uint_encode(&rs_uint, data[i].datalen, data[i].data, res);
@@ -299,12 +305,92 @@ static void test_uint_encoding(int index, int debug) {
     testFinish();
 }
 
+/* Check that codewords of data long enough to use products table have generator poly roots as roots */
+static void test_encoding_long(int index, int debug) {
+
+    struct item {
+        unsigned int prime_poly;
+        int logmod;
+        int nsym;
+        int index;
+        int datalen;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { 0x43, 63, 20, 1, 63 }, // MAXICODE-like, below table threshold
+        /*  1*/ { 0x89, 127, 25, 1, 100 }, // GRIDMATRIX-like
+        /*  2*/ { 0x11d, 255, 30, 0, 122 }, // QRCODE version 40-L block
+        /*  3*/ { 0x11d, 255, 7, 0, 64 },
+        /*  4*/ { 0x12d, 255, 62, 1, 156 }, // DATAMATRIX 144x144 block
+        /*  5*/ { 0x12d, 255, 68, 1, 175 }, // DATAMATRIX 132x132 block
+        /*  6*/ { 0x163, 255, 24, 1, 200 }, // HANXIN
+        /*  7*/ { 0x163, 255, 1, 1, 254 },
+        /*  8*/ { 0x12d, 255, 9, 1, 246 },
+        /*  9*/ { 0x11d, 255, 191, 0, 64 },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i;
+
+    testStart("test_encoding_long");
+
+    for (i = 0; i < data_size; i++) {
+        int j, r;
+        rs_t rs;
+        unsigned char cw_data[256], res[256];
+        unsigned int cw_data_uint[256], res_uint[256];
+
+        if (index != -1 && i != index) continue;
+
+        for (j = 0; j < data[i].datalen; j++) {
+            cw_data[j] = (unsigned char) ((j * 7 + 3 + i) & data[i].logmod);
+            cw_data_uint[j] = cw_data[j];
+        }
+
+        rs_init_gf(&rs, data[i].prime_poly);
+        rs_init_code(&rs, data[i].nsym, data[i].index);
+        rs_encode(&rs, data[i].datalen, cw_data, res);
+        rs_encode_uint(&rs, data[i].datalen, cw_data_uint, res_uint);
+
+        for (j = 0; j < data[i].nsym; j++) {
+            assert_equal(res[j], res_uint[j], "i:%d res[%d] %d != res_uint[%d] %d\n", i, j, res[j], j, res_uint[j]);
+        }
+
+        /* Generator poly should now be cached, so same result */
+        rs_init_gf(&rs, data[i].prime_poly);
+        rs_init_code(&rs, data[i].nsym, data[i].index);
+        rs_encode_uint(&rs, data[i].datalen, cw_data_uint, res_uint);
+        for (j = 0; j < data[i].nsym; j++) {
+            assert_equal(res[j], res_uint[j], "i:%d res[%d] %d != cached res_uint[%d] %d\n", i, j, res[j], j, res_uint[j]);
+        }
+
+        /* Evaluate codeword poly (data followed by ECC) at each root 2**index ... 2**(index + nsym - 1) */
+        for (r = data[i].index; r < data[i].index + data[i].nsym; r++) {
+            unsigned int s = 0;
+            const int log_root = r % data[i].logmod;
+            for (j = 0; j < data[i].datalen + data[i].nsym; j++) {
+                const unsigned int c = j < data[i].datalen ? cw_data[j] : res[data[i].nsym - 1 - (j - data[i].datalen)];
+                if (s) {
+                    s = rs.alog[rs.logt[s] + log_root];
+                }
+                s ^= c;
+            }
+            if (debug & ZINT_DEBUG_TEST_PRINT) {
+                printf("i:%d root 2**%d syndrome %d\n", i, r, (int) s);
+            }
+            assert_zero(s, "i:%d root 2**%d syndrome %d != 0\n", i, r, (int) s);
+        }
+    }
+
+    testFinish();
+}
+
 int main(int argc, char *argv[]) {
 
     testFunction funcs[] = { /* name, func, has_index, has_generate, has_debug */
         { "test_generate", test_generate, 0, 1, 0 },
         { "test_encoding", test_encoding, 1, 0, 1 },
         { "test_encoding_uint", test_encoding_uint, 1, 0, 1 },
+        { "test_encoding_long", test_encoding_long, 1, 0, 1 },
         { "test_uint_encoding", test_uint_encoding, 1, 0, 1 },
     };
 
@@ -1493,6 +1493,97 @@ static void test_input(int index, int debug) {
     testFinish();
 }
 
+STATIC_UNLESS_ZINT_TEST void getRSSwidths(int widths[], int val, int n, const int elements, const int maxWidth,
+            const int noNarrow);
+STATIC_UNLESS_ZINT_TEST const unsigned int *const *dbar_widths_tables(const int type);
+STATIC_UNLESS_ZINT_TEST void dbar_widths(int widths[], const unsigned int *const *tables, const int set,
+            const int val, const int n, const int elements, const int maxWidth, const int noNarrow);
+
+static void test_widths(int index, int debug) {
+
+    struct item {
+        int type;
+        int set;
+        int n;
+        int elements;
+        int maxWidth;
+        int noNarrow;
+        int expected_count;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { 0, 0, 12, 4, 8, 1, 161 }, // DataBar Omni outer odd
+        /*  1*/ { 0, 1, 10, 4, 6, 1, 80 },
+        /*  2*/ { 0, 2, 8, 4, 4, 1, 31 },
+        /*  3*/ { 0, 3, 6, 4, 3, 1, 10 },
+        /*  4*/ { 0, 4, 4, 4, 1, 1, 1 },
+        /*  5*/ { 0, 5, 5, 4, 2, 0, 4 }, // Inner odd
+        /*  6*/ { 0, 6, 7, 4, 4, 0, 20 },
+        /*  7*/ { 0, 7, 9, 4, 6, 0, 48 },
+        /*  8*/ { 0, 8, 11, 4, 8, 0, 81 },
+        /*  9*/ { 0, 9, 4, 4, 1, 0, 1 }, // Outer even
+        /* 10*/ { 0, 10, 6, 4, 3, 0, 10 },
+        /* 11*/ { 0, 11, 8, 4, 5, 0, 34 },
+        /* 12*/ { 0, 12, 10, 4, 6, 0, 70 },
+        /* 13*/ { 0, 13, 12, 4, 8, 0, 126 },
+        /* 14*/ { 0, 14, 10, 4, 7, 1, 84 }, // Inner even
+        /* 15*/ { 0, 15, 8, 4, 5, 1, 35 },
+        /* 16*/ { 0, 16, 6, 4, 3, 1, 10 },
+        /* 17*/ { 0, 17, 4, 4, 1, 1, 1 },
+        /* 18*/ { 1, 0, 17, 7, 6, 1, 6538 }, // DataBar Limited odd
+        /* 19*/ { 1, 1, 13, 7, 5, 1, 875 },
+        /* 20*/ { 1, 2, 9, 7, 3, 1, 28 },
+        /* 21*/ { 1, 3, 15, 7, 5, 1, 2415 },
+        /* 22*/ { 1, 4, 11, 7, 4, 1, 203 },
+        /* 23*/ { 1, 5, 19, 7, 8, 1, 17094 },
+        /* 24*/ { 1, 6, 7, 7, 1, 1, 1 },
+        /* 25*/ { 1, 7, 9, 7, 3, 0, 28 }, // Limited even
+        /* 26*/ { 1, 8, 13, 7, 4, 0, 728 },
+        /* 27*/ { 1, 9, 17, 7, 6, 0, 6454 },
+        /* 28*/ { 1, 10, 11, 7, 4, 0, 203 },
+        /* 29*/ { 1, 11, 15, 7, 5, 0, 2408 },
+        /* 30*/ { 1, 12, 7, 7, 1, 0, 1 },
+        /* 31*/ { 1, 13, 19, 7, 8, 0, 16632 },
+        /* 32*/ { 2, 0, 12, 4, 7, 0, 87 }, // DataBar Expanded odd
+        /* 33*/ { 2, 1, 10, 4, 5, 0, 52 },
+        /* 34*/ { 2, 2, 8, 4, 4, 0, 30 },
+        /* 35*/ { 2, 3, 6, 4, 3, 0, 10 },
+        /* 36*/ { 2, 4, 4, 4, 1, 0, 1 },
+        /* 37*/ { 2, 5, 5, 4, 2, 1, 4 }, // Expanded even
+        /* 38*/ { 2, 6, 7, 4, 4, 1, 20 },
+        /* 39*/ { 2, 7, 9, 4, 5, 1, 52 },
+        /* 40*/ { 2, 8, 11, 4, 6, 1, 104 },
+        /* 41*/ { 2, 9, 13, 4, 8, 1, 204 },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, val, j;
+    const unsigned int *const *tables;
+    int widths[7], expected_widths[7];
+
+    testStart("test_widths");
+
+    for (i = 0; i < data_size; i++) {
+
+        if (index != -1 && i != index) continue;
+        if (debug & ZINT_DEBUG_TEST_PRINT) printf("i:%d\n", i);
+
+        tables = dbar_widths_tables(data[i].type);
+        assert_nonnull(tables, "i:%d dbar_widths_tables NULL\n", i);
+        /* May enumerate more width sets than are in the value range (these are never used) */
+        assert_nonzero((int) tables[data[i].set][0] >= data[i].expected_count, "i:%d count %d < %d\n", i, (int) tables[data[i].set][0], data[i].expected_count);
+
+        for (val = 0; val < data[i].expected_count; val++) {
+            getRSSwidths(expected_widths, val, data[i].n, data[i].elements, data[i].maxWidth, data[i].noNarrow);
+            dbar_widths(widths, tables, data[i].set, val, data[i].n, data[i].elements, data[i].maxWidth, data[i].noNarrow);
+            for (j = 0; j < data[i].elements; j++) {
+                assert_equal(widths[j], expected_widths[j], "i:%d val %d widths[%d] %d != %d\n", i, val, j, widths[j], expected_widths[j]);
+            }
+        }
+    }
+
+    testFinish();
+}
+
 int main(int argc, char *argv[]) {
 
     testFunction funcs[] = { /* name, func, has_index, has_generate, has_debug */
@@ -1502,6 +1593,7 @@ int main(int argc, char *argv[]) {
         { "test_binary_buffer_size", test_binary_buffer_size, 1, 1, 1 },
         { "test_hrt", test_hrt, 1, 0, 1 },
         { "test_input", test_input, 1, 0, 1 },
+        { "test_widths", test_widths, 1, 0, 1 },
     };
 
     testRun(argc, argv, funcs, ARRAY_SIZE(funcs));
@@ -199,6 +199,14 @@ static void test_print(int index, int generate, int debug) {
         /* 18*/ { BARCODE_AZTEC, -1, -1, -1, -1, -1, -1, -1, 32, 0, 0, "4BE055", "", "1", "", "aztec_v32_fg.tif", "" },
         /* 19*/ { BARCODE_DAFT, -1, -1, -1, -1, -1, -1, -1, -1, 8, 0.5f, "", "", "F", "", "daft_height8_scale0.5.tif", "" },
         /* 20*/ { BARCODE_DAFT, -1, -1, -1, -1, -1, -1, -1, -1, 1, 0.5f, "", "", "DAFT", "", "daft_height1_scale0.5.tif", "" },
+        /* 21*/ { BARCODE_CODE128, -1, -1, TIF_COMPRESS_G4, 1, -1, -1, -1, -1, 0, 0, "", "", "A", "", "code128_g4.tif", "" },
+        /* 22*/ { BARCODE_CODE128, -1, -1, TIF_COMPRESS_G4, 1, -1, -1, -1, -1, 0, 0, "FFFFFF", "000000", "A", "", "code128_reverse_g4.tif", "BLACKISZERO" },
+        /* 23*/ { BARCODE_CODE128, -1, -1, TIF_COMPRESS_G4, 1, -1, -1, -1, -1, 0, 0, "112233", "EEDDCC", "A", "", "code128_fgbg.tif", "Not bilevel so LZW" },
+        /* 24*/ { BARCODE_CODE128, -1, -1, TIF_COMPRESS_PACKBITS, 1, -1, -1, -1, -1, 0, 0, "", "", "A", "", "code128_packbits.tif", "" },
+        /* 25*/ { BARCODE_QRCODE, -1, -1, TIF_COMPRESS_G4, -1, -1, -1, -1, -1, 0, 2, "", "", "1234", "", "qr_g4_scale2.tif", "" },
+        /* 26*/ { BARCODE_MAXICODE, -1, -1, TIF_COMPRESS_G4, -1, -1, -1, -1, -1, 0, 0, "", "", "1234", "", "maxicode_g4.tif", "" },
+        /* 27*/ { BARCODE_AZTEC, -1, -1, TIF_COMPRESS_PACKBITS, -1, -1, -1, -1, 32, 0, 0, "4BE055", "", "1", "", "aztec_v32_fg_packbits.tif", "" },
+        /* 28*/ { BARCODE_ULTRA, -1, -1, CMYK_COLOUR | TIF_COMPRESS_PACKBITS, 1, -1, -1, -1, -1, 0, 0, "C00000", "FEDCBACC", "1234", "", "ultra_cmyk_bgalpha_packbits.tif", "" },
     };
     int data_size = ARRAY_SIZE(data);
     int i, length, ret;
@@ -305,6 +313,174 @@ static void test_print(int index, int generate, int debug) {
     testFinish();
 }
 
+/* Get value (or offset if more than 1) and count of `tag` in little-endian TIF `buf` (-1 if not found) */
+static int get_tag(const unsigned char *buf, const int size, const int tag, int *p_count) {
+    const int ifd = buf[4] | (buf[5] << 8) | (buf[6] << 16) | (buf[7] << 24);
+    int entries, i;
+
+    if (ifd + 2 > size) {
+        return -1;
+    }
+    entries = buf[ifd] | (buf[ifd + 1] << 8);
+    for (i = 0; i < entries && ifd + 2 + (i + 1) * 12 <= size; i++) {
+        const unsigned char *entry = buf + ifd + 2 + i * 12;
+        if ((entry[0] | (entry[1] << 8)) == tag) {
+            const int type = entry[2] | (entry[3] << 8);
+            *p_count = entry[4] | (entry[5] << 8) | (entry[6] << 16) | (entry[7] << 24);
+            if (type == 3 && *p_count == 1) { /* SHORT */
+                return entry[8] | (entry[9] << 8);
+            }
+            return entry[8] | (entry[9] << 8) | (entry[10] << 16) | (entry[11] << 24);
+        }
+    }
+    return -1;
+}
+
+static void test_compression(int index, int debug) {
+
+    struct item {
+        int output_options;
+        int tif_rows_per_strip;
+        char *fgcolour;
+        int width;
+        int height;
+        char *pattern;
+        int repeat;
+        int ret;
+        int expected_compression;
+        int expected_strips;
+        char *expected_errtxt;
+    };
+    // s/\/\*[ 0-9]*\*\//\=printf("\/*%3d*\/", line(".") - line("'<"))
+    struct item data[] = {
+        /*  0*/ { TIF_COMPRESS_PACKBITS | TIF_COMPRESS_G4, 0, "", 1, 1, "1", 0, ZINT_ERROR_INVALID_OPTION, 0, 0, "676: Conflicting TIF compression options (only one of PACKBITS and G4 allowed)" },
+        /*  1*/ { 0, -1, "", 1, 1, "1", 0, ZINT_ERROR_INVALID_OPTION, 0, 0, "677: Invalid TIF rows per strip (cannot be negative)" },
+        /*  2*/ { 0, 0, "", 1, 1, "1", 0, 0, 5, 1, "" },
+        /*  3*/ { TIF_COMPRESS_PACKBITS, 0, "", 1, 1, "1", 0, 0, 32773, 1, "" },
+        /*  4*/ { TIF_COMPRESS_G4, 0, "", 1, 1, "1", 0, 0, 4, 1, "" },
+        /*  5*/ { TIF_COMPRESS_G4, 0, "", 3, 3, "101010101", 0, 0, 4, 1, "" },
+        /*  6*/ { TIF_COMPRESS_G4, 0, "", 10, 2, "01100000000000000000", 0, 0, 4, 1, "" }, // Pass mode
+        /*  7*/ { TIF_COMPRESS_G4, 0, "", 20, 3, "000000000000000000001111111111000000000000000000000011111111", 0, 0, 4, 1, "" },
+        /*  8*/ { TIF_COMPRESS_G4, 0, "", 6000, 3, "1", 1, 0, 4, 1, "" }, // Extended make-up codes
+        /*  9*/ { TIF_COMPRESS_G4, 0, "", 6000, 3, "0", 1, 0, 4, 1, "" },
+        /* 10*/ { TIF_COMPRESS_G4, 0, "", 2700, 2, "10", 1, 0, 4, 1, "" },
+        /* 11*/ { TIF_COMPRESS_G4, 0, "", 65, 65, "10", 1, 0, 4, 1, "" },
+        /* 12*/ { TIF_COMPRESS_G4, 1, "", 65, 65, "10", 1, 0, 4, 65, "" },
+        /* 13*/ { TIF_COMPRESS_G4, 10, "", 65, 65, "10", 1, 0, 4, 7, "" },
+        /* 14*/ { TIF_COMPRESS_G4, 100, "", 65, 65, "10", 1, 0, 4, 1, "" },
+        /* 15*/ { TIF_COMPRESS_G4, 0, "112233", 65, 65, "10", 1, 0, 5, 1, "" }, // Not bilevel so LZW
+        /* 16*/ { TIF_COMPRESS_PACKBITS, 0, "", 3, 3, "101010101", 0, 0, 32773, 1, "" },
+        /* 17*/ { TIF_COMPRESS_PACKBITS, 0, "", 2048, 3, "1", 1, 0, 32773, 1, "" }, // Runs > 128
+        /* 18*/ { TIF_COMPRESS_PACKBITS, 0, "", 2048, 3, "10", 1, 0, 32773, 1, "" },
+        /* 19*/ { TIF_COMPRESS_PACKBITS, 0, "", 2048, 3, "1000000010", 1, 0, 32773, 1, "" }, // Mixed runs and literals
+        /* 20*/ { TIF_COMPRESS_PACKBITS, 0, "", 2048, 3, "100000001000000001101100011100", 1, 0, 32773, 1, "" },
+        /* 21*/ { TIF_COMPRESS_PACKBITS, 3, "", 100, 100, "1000000001101", 1, 0, 32773, 34, "" },
+        /* 22*/ { TIF_COMPRESS_PACKBITS, 0, "112233", 100, 100, "1000000001101", 1, 0, 32773, 1, "" }, // 4-bit palette
+        /* 23*/ { 0, 1, "", 3, 7, "10", 1, 0, 5, 7, "" },
+        /* 24*/ { 0, 2, "", 3, 7, "10", 1, 0, 5, 4, "" },
+        /* 25*/ { 0, 7, "", 3, 7, "10", 1, 0, 5, 1, "" },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, ret;
+    struct zint_symbol *symbol;
+
+    char data_buf[6000 * 3 + 1];
+    unsigned char unpacked[(6000 + 7) / 8 * 3 + 1];
+
+    testStart("test_compression");
+
+    for (i = 0; i < data_size; i++) {
+        int size, count, value;
+
+        if (index != -1 && i != index) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        symbol->symbology = BARCODE_CODE128;
+        symbol->output_options = data[i].output_options | BARCODE_MEMORY_FILE;
+        symbol->tif_rows_per_strip = data[i].tif_rows_per_strip;
+        if (*data[i].fgcolour) {
+            strcpy(symbol->fgcolour, data[i].fgcolour);
+        }
+        strcpy(symbol->outfile, "mem.tif");
+        symbol->bitmap_width = data[i].width;
+        symbol->bitmap_height = data[i].height;
+        symbol->debug |= debug;
+
+        size = data[i].width * data[i].height;
+        assert_nonzero(size < (int) sizeof(data_buf), "i:%d size %d >= sizeof(data_buf) %d\n", i, size, (int) sizeof(data_buf));
+
+        if (data[i].repeat) {
+            testUtilStrCpyRepeat(data_buf, data[i].pattern, size);
+        } else {
+            strcpy(data_buf, data[i].pattern);
+        }
+        assert_equal(size, (int) strlen(data_buf), "i:%d size %d != strlen(data_buf) %d\n", i, size, (int) strlen(data_buf));
+
+        ret = tif_pixel_plot(symbol, (unsigned char *) data_buf);
+        assert_equal(ret, data[i].ret, "i:%d tif_pixel_plot ret %d != %d (%s)\n", i, ret, data[i].ret, symbol->errtxt);
+        assert_zero(strcmp(symbol->errtxt, data[i].expected_errtxt), "i:%d errtxt %s != %s\n", i, symbol->errtxt, data[i].expected_errtxt);
+
+        if (ret < ZINT_ERROR) {
+            assert_nonnull(symbol->memfile, "i:%d memfile NULL\n", i);
+            assert_nonzero(symbol->memfile[0] == 'I', "i:%d not little-endian\n", i); /* Tests assume */
+
+            value = get_tag(symbol->memfile, symbol->memfile_size, 0x0103, &count); /* Compression */
+            assert_equal(value, data[i].expected_compression, "i:%d compression %d != %d\n", i, value, data[i].expected_compression);
+
+            value = get_tag(symbol->memfile, symbol->memfile_size, 0x0111, &count); /* StripOffsets */
+            assert_equal(count, data[i].expected_strips, "i:%d strips %d != %d\n", i, count, data[i].expected_strips);
+
+            if (data[i].expected_compression == 32773 && !*data[i].fgcolour) {
+                /* Unpack all strips and check against bilevel pixels */
+                const unsigned char *offsets = symbol->memfile + (count == 1 ? 0 : value);
+                const int row_bytes = (data[i].width + 7) / 8;
+                int strip_bytes_count;
+                int bytes_value = get_tag(symbol->memfile, symbol->memfile_size, 0x0117, &strip_bytes_count);
+                const unsigned char *lengths = symbol->memfile + (count == 1 ? 0 : bytes_value);
+                int strip, j, k, unpacked_len = 0;
+
+                for (strip = 0; strip < count; strip++) {
+                    int offset, length, end;
+                    if (count == 1) {
+                        offset = value;
+                        length = bytes_value;
+                    } else {
+                        offset = offsets[strip * 4] | (offsets[strip * 4 + 1] << 8) | (offsets[strip * 4 + 2] << 16);
+                        length = lengths[strip * 4] | (lengths[strip * 4 + 1] << 8) | (lengths[strip * 4 + 2] << 16);
+                    }
+                    assert_nonzero(offset + length <= symbol->memfile_size, "i:%d strip %d offset %d + length %d > memfile_size %d\n", i, strip, offset, length, symbol->memfile_size);
+                    for (j = offset, end = offset + length; j < end;) {
+                        const int n = symbol->memfile[j++];
+                        if (n < 128) {
+                            assert_nonzero(unpacked_len + n + 1 <= (int) sizeof(unpacked), "i:%d unpacked overflow\n", i);
+                            memcpy(unpacked + unpacked_len, symbol->memfile + j, n + 1);
+                            unpacked_len += n + 1;
+                            j += n + 1;
+                        } else {
+                            assert_nonzero(unpacked_len + 257 - n <= (int) sizeof(unpacked), "i:%d unpacked overflow\n", i);
+                            memset(unpacked + unpacked_len, symbol->memfile[j++], 257 - n);
+                            unpacked_len += 257 - n;
+                        }
+                    }
+                }
+                assert_equal(unpacked_len, row_bytes * data[i].height, "i:%d unpacked_len %d != %d\n", i, unpacked_len, row_bytes * data[i].height);
+                for (j = 0; j < data[i].height; j++) {
+                    for (k = 0; k < data[i].width; k++) {
+                        const int bit = (unpacked[j * row_bytes + (k >> 3)] >> (7 - (k & 7))) & 1;
+                        assert_equal(bit, data_buf[j * data[i].width + k] == '1', "i:%d pixel (%d, %d) %d != %c\n", i, k, j, bit, data_buf[j * data[i].width + k]);
+                    }
+                }
+            }
+        }
+
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
 static void test_outfile(void) {
     int ret;
     struct zint_symbol symbol = {0};
@@ -335,6 +511,7 @@ int main(int argc, char *argv[]) {
     testFunction funcs[] = { /* name, func, has_index, has_generate, has_debug */
         { "test_pixel_plot", test_pixel_plot, 1, 0, 1 },
         { "test_print", test_print, 1, 1, 1 },
+        { "test_compression", test_compression, 1, 0, 1 },
         { "test_outfile", test_outfile, 0, 0, 0 },
     };
 
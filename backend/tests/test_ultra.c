@@ -261,6 +261,8 @@ static void test_input(int index, int generate, int debug) {
         /* 64*/ { UNICODE_MODE, 0, -1, -1, -1, { 8, 8, "A" }, "A", ZINT_ERROR_INVALID_OPTION, "Error 728: Invalid Structured Append ID (digits only)", "" },
         /* 65*/ { UNICODE_MODE, 0, -1, -1, -1, { 8, 8, "80089" }, "A", ZINT_ERROR_INVALID_OPTION, "Error 729: Structured Append ID '80089' out of range (1-80088)", "" },
         /* 66*/ { UNICODE_MODE, 0, -1, 3, -1, { 0, 0, "" }, "A", ZINT_ERROR_INVALID_OPTION, "Error 592: Revision must be 1 or 2", "" },
+        /* 67*/ { UNICODE_MODE | FAST_MODE, 0, -1, -1, ULTRA_COMPRESSION, { 0, 0, "" }, "http://url.com", 0, "(6) 281 262 133 216 269 251", "FAST_MODE Mode: ccccccc (7)" },
+        /* 68*/ { UNICODE_MODE | FAST_MODE, 0, -1, -1, ULTRA_COMPRESSION, { 0, 0, "" }, "ABC123456789é", 0, "(11) 257 258 0 45 181 114 201 153 221 192 233", "FAST_MODE Mode: cccccccccccc8 (13)" },
     };
     int data_size = ARRAY_SIZE(data);
     int i, length, ret;
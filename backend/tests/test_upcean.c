@@ -778,9 +778,7 @@ static void test_vector_same(int index, int debug) {
         }
 
         for (j = 0; j < vectors_size; j++) {
-            struct zint_symbol symbol_vector;
-            symbol_vector.vector = vectors[j];
-            vector_free(&symbol_vector);
+            testUtilVectorFree(vectors[j]);
         }
     }
 
@@ -2297,6 +2297,163 @@ static void test_height_per_row(int index, int generate, int debug) {
     testFinish();
 }
 
+static void test_reduce_rectangles(int index, int generate, int debug) {
+
+    struct item {
+        int symbology;
+        int option_1;
+        int option_2;
+        char *data;
+        int ret;
+
+        int expected_rows;
+        int expected_width;
+        int expected_rects;
+        const char *comment;
+    };
+    struct item data[] = {
+        /*  0*/ { BARCODE_CODE128, -1, -1, "A", 0, 1, 46, 13, "Bars only, nothing to merge" },
+        /*  1*/ { BARCODE_CODE16K, -1, -1, "1234567890", 0, 2, 70, 39, "Rows with separators" },
+        /*  2*/ { BARCODE_PDF417, -1, -1, "1234567890", 0, 7, 103, 102, "Row start/stop patterns merge vertically" },
+        /*  3*/ { BARCODE_DATAMATRIX, -1, -1, "1234567890", 0, 12, 12, 37, "" },
+        /*  4*/ { BARCODE_QRCODE, 1, 40, "1234567890", 0, 177, 177, 7215, "Large grid" },
+        /*  5*/ { BARCODE_HANXIN, -1, 84, "1234567890", 0, 189, 189, 16047, "Large grid" },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, length, ret;
+    struct zint_symbol *symbol;
+
+    testStart("test_reduce_rectangles");
+
+    for (i = 0; i < data_size; i++) {
+        struct zint_vector_rect *rect, *target;
+        int rects;
+
+        if (index != -1 && i != index) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, data[i].option_1, data[i].option_2, -1, -1 /*output_options*/, data[i].data, -1, debug);
+
+        ret = ZBarcode_Encode(symbol, (unsigned char *) data[i].data, length);
+        assert_equal(ret, data[i].ret, "i:%d ZBarcode_Encode(%s) ret %d != %d (%s)\n", i, testUtilBarcodeName(data[i].symbology), ret, data[i].ret, symbol->errtxt);
+
+        ret = ZBarcode_Buffer_Vector(symbol, 0);
+        assert_zero(ret, "i:%d ZBarcode_Buffer_Vector(%s) ret %d != 0 (%s)\n", i, testUtilBarcodeName(data[i].symbology), ret, symbol->errtxt);
+        assert_nonnull(symbol->vector, "i:%d ZBarcode_Buffer_Vector(%s) vector NULL\n", i, testUtilBarcodeName(data[i].symbology));
+
+        rects = 0;
+        for (rect = symbol->vector->rectangles; rect; rect = rect->next) {
+            rects++;
+        }
+
+        if (generate) {
+            printf("        /*%3d*/ { %s, %d, %d, \"%s\", %s, %d, %d, %d, \"%s\" },\n",
+                    i, testUtilBarcodeName(data[i].symbology), data[i].option_1, data[i].option_2, data[i].data,
+                    testUtilErrorName(data[i].ret), symbol->rows, symbol->width, rects, data[i].comment);
+        } else {
+            assert_equal(symbol->rows, data[i].expected_rows, "i:%d (%s) symbol->rows %d != %d\n", i, testUtilBarcodeName(data[i].symbology), symbol->rows, data[i].expected_rows);
+            assert_equal(symbol->width, data[i].expected_width, "i:%d (%s) symbol->width %d != %d\n", i, testUtilBarcodeName(data[i].symbology), symbol->width, data[i].expected_width);
+            assert_equal(rects, data[i].expected_rects, "i:%d (%s) rects %d != %d\n", i, testUtilBarcodeName(data[i].symbology), rects, data[i].expected_rects);
+
+            /* No rectangle should be left that could have been merged with another below it */
+            for (rect = symbol->vector->rectangles; rect; rect = rect->next) {
+                for (target = symbol->vector->rectangles; target; target = target->next) {
+                    if (target != rect && rect->x == target->x && rect->width == target->width
+                            && stripf(rect->y + rect->height) == target->y && rect->colour == target->colour) {
+                        break;
+                    }
+                }
+                assert_null(target, "i:%d (%s) unmerged rect x %g, y %g, width %g, height %g\n", i, testUtilBarcodeName(data[i].symbology), rect->x, rect->y, rect->width, rect->height);
+            }
+        }
+
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
+static void test_arrays(int index, int debug) {
+
+    struct item {
+        int symbology;
+        int output_options;
+        char *data;
+
+        int expected_rectangles;
+        int expected_hexagons;
+        int expected_strings;
+        int expected_circles;
+    };
+    struct item data[] = {
+        /*  0*/ { BARCODE_EANX, -1, "123456789012+12", 37, 0, 4, 0 },
+        /*  1*/ { BARCODE_MAXICODE, -1, "1234567890", 0, 368, 0, 3 },
+        /*  2*/ { BARCODE_DATAMATRIX, BARCODE_DOTTY_MODE, "1234567890", 0, 0, 0, 83 },
+        /*  3*/ { BARCODE_QRCODE, BARCODE_BOX, "1234567890", 81, 0, 0, 0 },
+        /*  4*/ { BARCODE_CODE128, -1, "", 0, 0, 0, 0 },
+    };
+    int data_size = ARRAY_SIZE(data);
+    int i, j, length, ret;
+    struct zint_symbol *symbol;
+
+    testStart("test_arrays");
+
+    for (i = 0; i < data_size; i++) {
+        struct zint_vector *vector;
+        struct zint_vector_rect *rect;
+        struct zint_vector_hexagon *hexagon;
+        struct zint_vector_string *string;
+        struct zint_vector_circle *circle;
+
+        if (index != -1 && i != index) continue;
+
+        symbol = ZBarcode_Create();
+        assert_nonnull(symbol, "Symbol not created\n");
+
+        length = testUtilSetSymbol(symbol, data[i].symbology, -1 /*input_mode*/, -1 /*eci*/, -1 /*option_1*/, -1, -1, data[i].output_options, data[i].data, -1, debug);
+
+        ret = ZBarcode_Encode_and_Buffer_Vector(symbol, (unsigned char *) data[i].data, length, 0);
+        assert_equal(ret, data[i].symbology == BARCODE_CODE128 ? ZINT_ERROR_INVALID_DATA : 0, "i:%d ZBarcode_Encode_and_Buffer_Vector ret %d (%s)\n", i, ret, symbol->errtxt);
+        if (ret) {
+            assert_null(symbol->vector, "i:%d vector not NULL\n", i);
+            ZBarcode_Delete(symbol);
+            continue;
+        }
+        vector = symbol->vector;
+        assert_nonnull(vector, "i:%d vector NULL\n", i);
+
+        assert_equal(vector->rectangle_count, data[i].expected_rectangles, "i:%d rectangle_count %d != %d\n", i, vector->rectangle_count, data[i].expected_rectangles);
+        assert_equal(vector->hexagon_count, data[i].expected_hexagons, "i:%d hexagon_count %d != %d\n", i, vector->hexagon_count, data[i].expected_hexagons);
+        assert_equal(vector->string_count, data[i].expected_strings, "i:%d string_count %d != %d\n", i, vector->string_count, data[i].expected_strings);
+        assert_equal(vector->circle_count, data[i].expected_circles, "i:%d circle_count %d != %d\n", i, vector->circle_count, data[i].expected_circles);
+
+        /* Lists must traverse the arrays in order */
+        for (j = 0, rect = vector->rectangles; rect; rect = rect->next, j++) {
+            assert_equal(rect, vector->rectangles + j, "i:%d rect %d not contiguous\n", i, j);
+        }
+        assert_equal(j, vector->rectangle_count, "i:%d rects %d != rectangle_count %d\n", i, j, vector->rectangle_count);
+        for (j = 0, hexagon = vector->hexagons; hexagon; hexagon = hexagon->next, j++) {
+            assert_equal(hexagon, vector->hexagons + j, "i:%d hexagon %d not contiguous\n", i, j);
+        }
+        assert_equal(j, vector->hexagon_count, "i:%d hexagons %d != hexagon_count %d\n", i, j, vector->hexagon_count);
+        for (j = 0, string = vector->strings; string; string = string->next, j++) {
+            assert_equal(string, vector->strings + j, "i:%d string %d not contiguous\n", i, j);
+            assert_equal(string->length, (int) ustrlen(string->text), "i:%d string %d length %d != %d\n", i, j, string->length, (int) ustrlen(string->text));
+        }
+        assert_equal(j, vector->string_count, "i:%d strings %d != string_count %d\n", i, j, vector->string_count);
+        for (j = 0, circle = vector->circles; circle; circle = circle->next, j++) {
+            assert_equal(circle, vector->circles + j, "i:%d circle %d not contiguous\n", i, j);
+        }
+        assert_equal(j, vector->circle_count, "i:%d circles %d != circle_count %d\n", i, j, vector->circle_count);
+
+        ZBarcode_Delete(symbol);
+    }
+
+    testFinish();
+}
+
 int main(int argc, char *argv[]) {
 
     testFunction funcs[] = { /* name, func, has_index, has_generate, has_debug */
@@ -2313,6 +2470,8 @@ int main(int argc, char *argv[]) {
         { "test_quiet_zones", test_quiet_zones, 1, 0, 1 },
         { "test_height", test_height, 1, 1, 1 },
         { "test_height_per_row", test_height_per_row, 1, 1, 1 },
+        { "test_reduce_rectangles", test_reduce_rectangles, 1, 1, 1 },
+        { "test_arrays", test_arrays, 1, 0, 1 },
     };
 
     testRun(argc, argv, funcs, ARRAY_SIZE(funcs));
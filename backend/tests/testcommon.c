@@ -494,6 +494,11 @@ const char *testUtilOutputOptionsName(int output_options) {
         { "BARCODE_QUIET_ZONES", BARCODE_QUIET_ZONES, 2048 },
         { "BARCODE_NO_QUIET_ZONES", BARCODE_NO_QUIET_ZONES, 4096 },
         { "COMPLIANT_HEIGHT", COMPLIANT_HEIGHT, 0x2000 },
+        { "BARCODE_MEMORY_FILE", BARCODE_MEMORY_FILE, 0x4000 },
+        { "OUT_BUFFER_1BPP", OUT_BUFFER_1BPP, 0x8000 },
+        { "OUT_BUFFER_8BPP", OUT_BUFFER_8BPP, 0x10000 },
+        { "TIF_COMPRESS_PACKBITS", TIF_COMPRESS_PACKBITS, 0x20000 },
+        { "TIF_COMPRESS_G4", TIF_COMPRESS_G4, 0x40000 },
     };
     static int const data_size = ARRAY_SIZE(data);
     int set = 0;
@@ -712,6 +717,10 @@ struct zint_vector *testUtilVectorCpy(const struct zint_vector *in) {
     out->strings = NULL;
     out->circles = NULL;
     out->hexagons = NULL;
+    out->rectangle_count = in->rectangle_count;
+    out->hexagon_count = in->hexagon_count;
+    out->string_count = in->string_count;
+    out->circle_count = in->circle_count;
 
     // Copy rectangles
     rect = in->rectangles;
@@ -767,6 +776,32 @@ struct zint_vector *testUtilVectorCpy(const struct zint_vector *in) {
     return out;
 }
 
+/* Free a vector structure copied by `testUtilVectorCpy()` */
+void testUtilVectorFree(struct zint_vector *vector) {
+    while (vector->rectangles) {
+        struct zint_vector_rect *rect = vector->rectangles;
+        vector->rectangles = rect->next;
+        free(rect);
+    }
+    while (vector->strings) {
+        struct zint_vector_string *string = vector->strings;
+        vector->strings = string->next;
+        free(string->text);
+        free(string);
+    }
+    while (vector->circles) {
+        struct zint_vector_circle *circle = vector->circles;
+        vector->circles = circle->next;
+        free(circle);
+    }
+    while (vector->hexagons) {
+        struct zint_vector_hexagon *hexagon = vector->hexagons;
+        vector->hexagons = hexagon->next;
+        free(hexagon);
+    }
+    free(vector);
+}
+
 /* Compare 2 full vector structures */
 int testUtilVectorCmp(const struct zint_vector *a, const struct zint_vector *b) {
     struct zint_vector_rect *arect;
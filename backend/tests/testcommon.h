@@ -131,6 +131,7 @@ void testUtilStrCpyRepeat(char *buffer, const char *repeat, const int size);
 
 int testUtilSymbolCmp(const struct zint_symbol *a, const struct zint_symbol *b);
 struct zint_vector *testUtilVectorCpy(const struct zint_vector *in);
+void testUtilVectorFree(struct zint_vector *vector);
 int testUtilVectorCmp(const struct zint_vector *a, const struct zint_vector *b);
 
 int testUtilModulesDump(const struct zint_symbol *symbol, char dump[], int dump_size);
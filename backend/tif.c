@@ -38,6 +38,7 @@
 #include <assert.h>
 #include <limits.h>
 #include "common.h"
+#include "filemem.h"
 #include "tif.h"
 #include "tif_lzw.h"
 #ifdef _MSC_VER
@@ -55,7 +56,9 @@
 
 /* Compression */
 #define TIF_NO_COMPRESSION      1
+#define TIF_CCITT_T6            4 /* CCITT Group 4 fax */
 #define TIF_LZW                 5
+#define TIF_PACKBITS            32773
 
 static void to_color_map(const unsigned char rgb[4], tiff_color_t *color_map_entry) {
     color_map_entry->red = (rgb[0] << 8) | rgb[0];
@@ -83,13 +86,173 @@ static int is_big_endian(void) {
     return (*((const uint16_t *)"\x11\x22") == 0x1122);
 }
 
+/* PackBits encode a row (TIFF Rev 6 Section 9), which must be packed separately from other rows */
+static void tif_packbits_row(struct filemem *fmp, const unsigned char *row, const int length) {
+    int i = 0;
+
+    while (i < length) {
+        int run = 1;
+        while (i + run < length && run < 128 && row[i + run] == row[i]) {
+            run++;
+        }
+        if (run > 1) {
+            fm_putc(257 - run, fmp); /* -(run - 1) */
+            fm_putc(row[i], fmp);
+        } else {
+            /* Literal until a run of 3 or more starts (shorter runs are cheaper left in a literal) */
+            while (i + run < length && run < 128
+                    && (i + run + 2 >= length || row[i + run] != row[i + run + 1]
+                        || row[i + run] != row[i + run + 2])) {
+                run++;
+            }
+            fm_putc(run - 1, fmp);
+            fm_write(row + i, 1, run, fmp);
+        }
+        i += run;
+    }
+}
+
+/* CCITT T.4 modified Huffman codes (code, bit length) indexed by run length 0-63, then by 63 + run length / 64 for
+   make-up codes 64-1728, followed by the extended make-up codes 1792-2560 common to both colours */
+static const unsigned short tif_g4_white[104][2] = {
+    { 0x35, 8 }, { 0x7, 6 }, { 0x7, 4 }, { 0x8, 4 }, { 0xB, 4 }, { 0xC, 4 }, { 0xE, 4 }, { 0xF, 4 },
+    { 0x13, 5 }, { 0x14, 5 }, { 0x7, 5 }, { 0x8, 5 }, { 0x8, 6 }, { 0x3, 6 }, { 0x34, 6 }, { 0x35, 6 },
+    { 0x2A, 6 }, { 0x2B, 6 }, { 0x27, 7 }, { 0xC, 7 }, { 0x8, 7 }, { 0x17, 7 }, { 0x3, 7 }, { 0x4, 7 },
+    { 0x28, 7 }, { 0x2B, 7 }, { 0x13, 7 }, { 0x24, 7 }, { 0x18, 7 }, { 0x2, 8 }, { 0x3, 8 }, { 0x1A, 8 },
+    { 0x1B, 8 }, { 0x12, 8 }, { 0x13, 8 }, { 0x14, 8 }, { 0x15, 8 }, { 0x16, 8 }, { 0x17, 8 }, { 0x28, 8 },
+    { 0x29, 8 }, { 0x2A, 8 }, { 0x2B, 8 }, { 0x2C, 8 }, { 0x2D, 8 }, { 0x4, 8 }, { 0x5, 8 }, { 0xA, 8 },
+    { 0xB, 8 }, { 0x52, 8 }, { 0x53, 8 }, { 0x54, 8 }, { 0x55, 8 }, { 0x24, 8 }, { 0x25, 8 }, { 0x58, 8 },
+    { 0x59, 8 }, { 0x5A, 8 }, { 0x5B, 8 }, { 0x4A, 8 }, { 0x4B, 8 }, { 0x32, 8 }, { 0x33, 8 }, { 0x34, 8 },
+    { 0x1B, 5 }, { 0x12, 5 }, { 0x17, 6 }, { 0x37, 7 }, { 0x36, 8 }, { 0x37, 8 }, { 0x64, 8 }, { 0x65, 8 },
+    { 0x68, 8 }, { 0x67, 8 }, { 0xCC, 9 }, { 0xCD, 9 }, { 0xD2, 9 }, { 0xD3, 9 }, { 0xD4, 9 }, { 0xD5, 9 },
+    { 0xD6, 9 }, { 0xD7, 9 }, { 0xD8, 9 }, { 0xD9, 9 }, { 0xDA, 9 }, { 0xDB, 9 }, { 0x98, 9 }, { 0x99, 9 },
+    { 0x9A, 9 }, { 0x18, 6 }, { 0x9B, 9 }, { 0x8, 11 }, { 0xC, 11 }, { 0xD, 11 }, { 0x12, 12 }, { 0x13, 12 },
+    { 0x14, 12 }, { 0x15, 12 }, { 0x16, 12 }, { 0x17, 12 }, { 0x1C, 12 }, { 0x1D, 12 }, { 0x1E, 12 }, { 0x1F, 12 },
+};
+static const unsigned short tif_g4_black[104][2] = {
+    { 0x37, 10 }, { 0x2, 3 }, { 0x3, 2 }, { 0x2, 2 }, { 0x3, 3 }, { 0x3, 4 }, { 0x2, 4 }, { 0x3, 5 },
+    { 0x5, 6 }, { 0x4, 6 }, { 0x4, 7 }, { 0x5, 7 }, { 0x7, 7 }, { 0x4, 8 }, { 0x7, 8 }, { 0x18, 9 },
+    { 0x17, 10 }, { 0x18, 10 }, { 0x8, 10 }, { 0x67, 11 }, { 0x68, 11 }, { 0x6C, 11 }, { 0x37, 11 }, { 0x28, 11 },
+    { 0x17, 11 }, { 0x18, 11 }, { 0xCA, 12 }, { 0xCB, 12 }, { 0xCC, 12 }, { 0xCD, 12 }, { 0x68, 12 }, { 0x69, 12 },
+    { 0x6A, 12 }, { 0x6B, 12 }, { 0xD2, 12 }, { 0xD3, 12 }, { 0xD4, 12 }, { 0xD5, 12 }, { 0xD6, 12 }, { 0xD7, 12 },
+    { 0x6C, 12 }, { 0x6D, 12 }, { 0xDA, 12 }, { 0xDB, 12 }, { 0x54, 12 }, { 0x55, 12 }, { 0x56, 12 }, { 0x57, 12 },
+    { 0x64, 12 }, { 0x65, 12 }, { 0x52, 12 }, { 0x53, 12 }, { 0x24, 12 }, { 0x37, 12 }, { 0x38, 12 }, { 0x27, 12 },
+    { 0x28, 12 }, { 0x58, 12 }, { 0x59, 12 }, { 0x2B, 12 }, { 0x2C, 12 }, { 0x5A, 12 }, { 0x66, 12 }, { 0x67, 12 },
+    { 0xF, 10 }, { 0xC8, 12 }, { 0xC9, 12 }, { 0x5B, 12 }, { 0x33, 12 }, { 0x34, 12 }, { 0x35, 12 }, { 0x6C, 13 },
+    { 0x6D, 13 }, { 0x4A, 13 }, { 0x4B, 13 }, { 0x4C, 13 }, { 0x4D, 13 }, { 0x72, 13 }, { 0x73, 13 }, { 0x74, 13 },
+    { 0x75, 13 }, { 0x76, 13 }, { 0x77, 13 }, { 0x52, 13 }, { 0x53, 13 }, { 0x54, 13 }, { 0x55, 13 }, { 0x5A, 13 },
+    { 0x5B, 13 }, { 0x64, 13 }, { 0x65, 13 }, { 0x8, 11 }, { 0xC, 11 }, { 0xD, 11 }, { 0x12, 12 }, { 0x13, 12 },
+    { 0x14, 12 }, { 0x15, 12 }, { 0x16, 12 }, { 0x17, 12 }, { 0x1C, 12 }, { 0x1D, 12 }, { 0x1E, 12 }, { 0x1F, 12 },
+};
+
+/* Bit writer for CCITT Group 4 strips */
+struct tif_g4_state {
+    unsigned int bits;
+    int bit_count;
+};
+
+static void tif_g4_put(struct tif_g4_state *g4, struct filemem *fmp, const unsigned int code, const int length) {
+    g4->bits = (g4->bits << length) | code;
+    g4->bit_count += length;
+    while (g4->bit_count >= 8) {
+        g4->bit_count -= 8;
+        fm_putc((g4->bits >> g4->bit_count) & 0xff, fmp);
+    }
+}
+
+/* Put the make-up code(s), if any, and the terminating code for `run` pixels of a colour */
+static void tif_g4_put_run(struct tif_g4_state *g4, struct filemem *fmp, int run, const unsigned short codes[][2]) {
+    while (run >= 2560 + 64) {
+        tif_g4_put(g4, fmp, codes[63 + 40][0], codes[63 + 40][1]); /* 2560 */
+        run -= 2560;
+    }
+    if (run >= 64) {
+        tif_g4_put(g4, fmp, codes[63 + (run >> 6)][0], codes[63 + (run >> 6)][1]);
+        run &= 63;
+    }
+    tif_g4_put(g4, fmp, codes[run][0], codes[run][1]);
+}
+
+#define TIF_G4_PIXEL(row, pos) (((row)[(pos) >> 3] >> (7 - ((pos) & 7))) & 1)
+
+/* Return position of first pixel at or after `pos` that is not `colour`, or `width` if none */
+static int tif_g4_find_diff(const unsigned char *row, int pos, const int width, const int colour) {
+    const unsigned char same = colour ? 0xff : 0;
+
+    while (pos < width) {
+        if ((pos & 7) == 0 && row[pos >> 3] == same) {
+            pos += 8;
+        } else if (TIF_G4_PIXEL(row, pos) != colour) {
+            return pos;
+        } else {
+            pos++;
+        }
+    }
+    return width;
+}
+
+/* CCITT T.6 (Group 4) 2-dimensionally encode 1-bit `row` against reference row `ref` (the previous row, or all
+   white at the start of a strip), where 0 is white, as per `Fax3Encode2DRow()` in libtiff/tif_fax3.c */
+static void tif_g4_row(struct tif_g4_state *g4, struct filemem *fmp, const unsigned char *row,
+            const unsigned char *ref, const int width) {
+    /* Vertical mode codes for b1 - a1 = -3 to 3 */
+    static const unsigned char vcodes[7][2] = { { 0x3, 7 }, { 0x3, 6 }, { 0x3, 3 }, { 0x1, 1 }, { 0x2, 3 },
+                                                 { 0x2, 6 }, { 0x2, 7 } };
+    int a0 = 0;
+    int a1 = TIF_G4_PIXEL(row, 0) ? 0 : tif_g4_find_diff(row, 0, width, 0);
+    int b1 = TIF_G4_PIXEL(ref, 0) ? 0 : tif_g4_find_diff(ref, 0, width, 0);
+    int a2, b2;
+
+    for (;;) {
+        b2 = b1 < width ? tif_g4_find_diff(ref, b1, width, TIF_G4_PIXEL(ref, b1)) : width;
+        if (b2 >= a1) {
+            const int d = b1 - a1;
+            if (d < -3 || d > 3) { /* Horizontal mode */
+                a2 = a1 < width ? tif_g4_find_diff(row, a1, width, TIF_G4_PIXEL(row, a1)) : width;
+                tif_g4_put(g4, fmp, 0x1, 3);
+                if (a0 + a1 == 0 || TIF_G4_PIXEL(row, a0) == 0) {
+                    tif_g4_put_run(g4, fmp, a1 - a0, tif_g4_white);
+                    tif_g4_put_run(g4, fmp, a2 - a1, tif_g4_black);
+                } else {
+                    tif_g4_put_run(g4, fmp, a1 - a0, tif_g4_black);
+                    tif_g4_put_run(g4, fmp, a2 - a1, tif_g4_white);
+                }
+                a0 = a2;
+            } else { /* Vertical mode */
+                tif_g4_put(g4, fmp, vcodes[d + 3][0], vcodes[d + 3][1]);
+                a0 = a1;
+            }
+        } else { /* Pass mode */
+            tif_g4_put(g4, fmp, 0x1, 4);
+            a0 = b2;
+        }
+        if (a0 >= width) {
+            break;
+        }
+        a1 = tif_g4_find_diff(row, a0, width, TIF_G4_PIXEL(row, a0));
+        b1 = tif_g4_find_diff(ref, a0, width, !TIF_G4_PIXEL(row, a0));
+        b1 = tif_g4_find_diff(ref, b1, width, TIF_G4_PIXEL(row, a0));
+    }
+}
+
+/* Finish a Group 4 strip with EOFB (2 EOLs), padding to byte boundary */
+static void tif_g4_post(struct tif_g4_state *g4, struct filemem *fmp) {
+    tif_g4_put(g4, fmp, 0x001, 12);
+    tif_g4_put(g4, fmp, 0x001, 12);
+    if (g4->bit_count) {
+        fm_putc((g4->bits << (8 - g4->bit_count)) & 0xff, fmp);
+    }
+    g4->bits = 0;
+    g4->bit_count = 0;
+}
+
 INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf) {
     unsigned char fg[4], bg[4];
     int i;
     int pmi; /* PhotometricInterpretation */
     int rows_per_strip, strip_count;
     int rows_last_strip;
-    int bytes_per_strip;
+    int row_bytes;
     uint16_t bits_per_sample;
     int samples_per_pixel;
     int pixels_per_sample;
@@ -103,16 +266,20 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     int strip_row;
     unsigned int bytes_put;
     long total_bytes_put;
-    FILE *tif_file;
+    struct filemem fm;
+    struct filemem *const fmp = &fm;
     unsigned char *pb;
     int compression = TIF_NO_COMPRESSION;
     tif_lzw_state lzw_state;
-    long file_pos;
-    const int output_to_stdout = symbol->output_options & BARCODE_STDOUT;
+    struct tif_g4_state g4_state = {0};
+    long file_pos = 0;
+    uint32_t *strip_offset;
+    uint32_t *strip_bytes;
+    unsigned char *row_buf, *ref_buf;
+    /* Memory file takes precedence over stdout */
+    const int output_to_stdout = (symbol->output_options & (BARCODE_STDOUT | BARCODE_MEMORY_FILE)) == BARCODE_STDOUT;
 #ifdef _MSC_VER
-    uint32_t* strip_offset;
-    uint32_t* strip_bytes;
-    unsigned char *strip_buf;
+    unsigned char *row_bufs;
 #endif
 
     tiff_header_t header;
@@ -124,6 +291,16 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     int ifd_size;
     uint32_t temp32;
 
+    if ((symbol->output_options & (TIF_COMPRESS_PACKBITS | TIF_COMPRESS_G4))
+            == (TIF_COMPRESS_PACKBITS | TIF_COMPRESS_G4)) {
+        strcpy(symbol->errtxt, "676: Conflicting TIF compression options (only one of PACKBITS and G4 allowed)");
+        return ZINT_ERROR_INVALID_OPTION;
+    }
+    if (symbol->tif_rows_per_strip < 0) {
+        strcpy(symbol->errtxt, "677: Invalid TIF rows per strip (cannot be negative)");
+        return ZINT_ERROR_INVALID_OPTION;
+    }
+
     fg[0] = (16 * ctoi(symbol->fgcolour[0])) + ctoi(symbol->fgcolour[1]);
     fg[1] = (16 * ctoi(symbol->fgcolour[2])) + ctoi(symbol->fgcolour[3]);
     fg[2] = (16 * ctoi(symbol->fgcolour[4])) + ctoi(symbol->fgcolour[5]);
@@ -262,12 +439,28 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
         }
     }
 
-    /* TIFF Rev 6 Section 7 p.27 "Set RowsPerStrip such that the size of each strip is about 8K bytes...
-     * Note that extremely wide high resolution images may have rows larger than 8K bytes; in this case,
-     * RowsPerStrip should be 1, and the strip will be larger than 8K." */
-    rows_per_strip = (8192 * pixels_per_sample) / (symbol->bitmap_width * samples_per_pixel);
-    if (rows_per_strip == 0) {
-        rows_per_strip = 1;
+    if (!output_to_stdout) { /* Files and memory are seekable, allowing compressed strip sizes to be fixed up */
+        if ((symbol->output_options & TIF_COMPRESS_G4) && samples_per_pixel == 1 && bits_per_sample == 1) {
+            compression = TIF_CCITT_T6;
+        } else if (symbol->output_options & TIF_COMPRESS_PACKBITS) {
+            compression = TIF_PACKBITS;
+        } else {
+            compression = TIF_LZW;
+        }
+    }
+
+    row_bytes = ((symbol->bitmap_width + pixels_per_sample - 1) / pixels_per_sample) * samples_per_pixel;
+
+    if (symbol->tif_rows_per_strip) {
+        rows_per_strip = symbol->tif_rows_per_strip;
+    } else {
+        /* TIFF Rev 6 Section 7 p.27 "Set RowsPerStrip such that the size of each strip is about 8K bytes...
+         * Note that extremely wide high resolution images may have rows larger than 8K bytes; in this case,
+         * RowsPerStrip should be 1, and the strip will be larger than 8K." */
+        rows_per_strip = (8192 * pixels_per_sample) / (symbol->bitmap_width * samples_per_pixel);
+        if (rows_per_strip == 0) {
+            rows_per_strip = 1;
+        }
     }
 
     /* Suppresses clang-tidy clang-analyzer-core.VLASize warning */
@@ -289,37 +482,40 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     assert(strip_count > 0); /* Suppress clang-analyzer-core.UndefinedBinaryOperatorResult */
 
     if (symbol->debug & ZINT_DEBUG_PRINT) {
-        printf("TIFF (%dx%d) Strip Count %d, Rows Per Strip %d, Pixels Per Sample %d, Samples Per Pixel %d, PMI %d\n",
+        printf("TIFF (%dx%d) Strip Count %d, Rows Per Strip %d, Pixels Per Sample %d, Samples Per Pixel %d, PMI %d,"
+                " Compression %d\n",
             symbol->bitmap_width, symbol->bitmap_height, strip_count, rows_per_strip, pixels_per_sample,
-            samples_per_pixel, pmi);
+            samples_per_pixel, pmi, compression);
     }
 
-    bytes_per_strip = rows_per_strip * ((symbol->bitmap_width + pixels_per_sample - 1) / pixels_per_sample)
-                        * samples_per_pixel;
+    /* Suppresses clang-tidy clang-analyzer-core.VLASize warning */
+    assert(row_bytes > 0);
 
+    /* Only a row (2 rows for Group 4, which codes against the previous row) is buffered, each being passed on to the
+       strip encoder as it's done */
 #ifndef _MSC_VER
-    uint32_t strip_offset[strip_count];
-    uint32_t strip_bytes[strip_count];
-    unsigned char strip_buf[bytes_per_strip + 1];
+    unsigned char row_bufs[compression == TIF_CCITT_T6 ? row_bytes * 2 : row_bytes];
 #else
-    strip_offset = (uint32_t *) _alloca(strip_count * sizeof(uint32_t));
-    strip_bytes = (uint32_t *) _alloca(strip_count * sizeof(uint32_t));
-    strip_buf = (unsigned char *) _alloca(bytes_per_strip + 1);
+    row_bufs = (unsigned char *) _alloca(compression == TIF_CCITT_T6 ? row_bytes * 2 : row_bytes);
 #endif
+    row_buf = row_bufs;
+    ref_buf = row_bufs + row_bytes; /* Only used by Group 4 */
+
+    /* May be as many strips as rows if `tif_rows_per_strip` set, so not on stack */
+    if (!(strip_offset = (uint32_t *) z_malloc(sizeof(uint32_t) * strip_count * 2))) {
+        strcpy(symbol->errtxt, "678: Insufficient memory for TIF strip tables");
+        return ZINT_ERROR_MEMORY;
+    }
+    strip_bytes = strip_offset + strip_count;
+
     free_memory = sizeof(tiff_header_t);
 
     for (i = 0; i < strip_count; i++) {
         strip_offset[i] = free_memory;
-        if (i != (strip_count - 1)) {
-            strip_bytes[i] = bytes_per_strip;
+        if (i != (strip_count - 1) || !rows_last_strip) {
+            strip_bytes[i] = rows_per_strip * row_bytes;
         } else {
-            if (rows_last_strip) {
-                strip_bytes[i] = rows_last_strip
-                                    * ((symbol->bitmap_width + pixels_per_sample - 1) / pixels_per_sample)
-                                    * samples_per_pixel;
-            } else {
-                strip_bytes[i] = bytes_per_strip;
-            }
+            strip_bytes[i] = rows_last_strip * row_bytes;
         }
         free_memory += strip_bytes[i];
     }
@@ -328,6 +524,7 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     }
 
     if (free_memory > 0xffff0000) {
+        z_free(strip_offset);
         strcpy(symbol->errtxt, "670: Output file size too big");
         return ZINT_ERROR_MEMORY;
     }
@@ -336,19 +533,18 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     if (output_to_stdout) {
 #ifdef _MSC_VER
         if (-1 == _setmode(_fileno(stdout), _O_BINARY)) {
+            z_free(strip_offset);
             sprintf(symbol->errtxt, "671: Could not set stdout to binary (%d: %.30s)", errno, strerror(errno));
             return ZINT_ERROR_FILE_ACCESS;
         }
 #endif
-        tif_file = stdout;
-    } else {
-        if (!(tif_file = fopen(symbol->outfile, "wb+"))) { /* '+' as use fseek/ftell() */
-            sprintf(symbol->errtxt, "672: Could not open output file (%d: %.30s)", errno, strerror(errno));
-            return ZINT_ERROR_FILE_ACCESS;
-        }
-        compression = TIF_LZW;
-        tif_lzw_init(&lzw_state);
     }
+    if (!fm_open(fmp, symbol, "wb+")) { /* '+' as use fseek/ftell() */
+        z_free(strip_offset);
+        sprintf(symbol->errtxt, "672: Could not open output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_ACCESS;
+    }
+    tif_lzw_init(&lzw_state);
 
     /* Header */
     if (is_big_endian()) {
@@ -359,15 +555,32 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     header.identity = 42;
     header.offset = free_memory;
 
-    fwrite(&header, sizeof(tiff_header_t), 1, tif_file);
+    fm_write(&header, sizeof(tiff_header_t), 1, fmp);
     total_bytes_put = sizeof(tiff_header_t);
 
     /* Pixel data */
     pb = pixelbuf;
     strip = 0;
     strip_row = 0;
-    bytes_put = 0;
     for (row = 0; row < symbol->bitmap_height; row++) {
+        if (strip_row == 0) { /* Start of strip */
+            if (compression != TIF_NO_COMPRESSION) {
+                file_pos = fm_tell(fmp);
+            }
+            if (compression == TIF_LZW) {
+                if (!tif_lzw_pre_encode(&lzw_state)) { /* Only fails if can't malloc */
+                    tif_lzw_cleanup(&lzw_state);
+                    (void) fm_close(fmp, symbol);
+                    z_free(strip_offset);
+                    strcpy(symbol->errtxt, "673: Failed to malloc LZW hash table");
+                    return ZINT_ERROR_MEMORY;
+                }
+            } else if (compression == TIF_CCITT_T6) {
+                memset(ref_buf, 0, row_bytes); /* Imaginary all white reference row */
+            }
+        }
+
+        bytes_put = 0;
         if (samples_per_pixel == 1) {
             if (bits_per_sample == 1) { /* WHITEISZERO or BLACKISZERO */
                 for (column = 0; column < symbol->bitmap_width; column += 8) {
@@ -375,7 +588,7 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
                     for (i = 0; i < 8 && column + i < symbol->bitmap_width; i++, pb++) {
                         byte |= map[*pb] << (7 - i);
                     }
-                    strip_buf[bytes_put++] = byte;
+                    row_buf[bytes_put++] = byte;
                 }
             } else { /* bits_per_sample == 4, PALETTE_COLOR with no alpha */
                 for (column = 0; column < symbol->bitmap_width; column += 2) {
@@ -383,36 +596,47 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
                     if (column + 1 < symbol->bitmap_width) {
                         byte |= map[*pb++];
                     }
-                    strip_buf[bytes_put++] = byte;
+                    row_buf[bytes_put++] = byte;
                 }
             }
         } else if (samples_per_pixel == 2) { /* PALETTE_COLOR with alpha */
             for (column = 0; column < symbol->bitmap_width; column++) {
                 const int idx = map[*pb++];
-                strip_buf[bytes_put++] = idx;
-                strip_buf[bytes_put++] = palette[idx][3];
+                row_buf[bytes_put++] = idx;
+                row_buf[bytes_put++] = palette[idx][3];
             }
         } else { /* samples_per_pixel >= 4, RGB with alpha (4) or CMYK with (5) or without (4) alpha */
             for (column = 0; column < symbol->bitmap_width; column++) {
                 const int idx = map[*pb++];
-                memcpy(&strip_buf[bytes_put], &palette[idx], samples_per_pixel);
+                memcpy(&row_buf[bytes_put], &palette[idx], samples_per_pixel);
                 bytes_put += samples_per_pixel;
             }
         }
 
+        if (compression == TIF_LZW) {
+            tif_lzw_encode(&lzw_state, fmp, row_buf, row_bytes);
+        } else if (compression == TIF_PACKBITS) {
+            tif_packbits_row(fmp, row_buf, row_bytes);
+        } else if (compression == TIF_CCITT_T6) {
+            unsigned char *const tmp = ref_buf;
+            tif_g4_row(&g4_state, fmp, row_buf, ref_buf, symbol->bitmap_width);
+            ref_buf = row_buf; /* This row becomes the reference for the next */
+            row_buf = tmp;
+        } else {
+            fm_write(row_buf, 1, row_bytes, fmp);
+        }
+
         strip_row++;
 
         if (strip_row == rows_per_strip || (strip == strip_count - 1 && strip_row == rows_last_strip)) {
             // End of strip
-            if (compression == TIF_LZW) {
-                file_pos = ftell(tif_file);
-                if (!tif_lzw_encode(&lzw_state, tif_file, strip_buf, bytes_put)) { /* Only fails if can't malloc */
-                    tif_lzw_cleanup(&lzw_state);
-                    fclose(tif_file); /* Only use LZW if not STDOUT, so ok to close */
-                    strcpy(symbol->errtxt, "673: Failed to malloc LZW hash table");
-                    return ZINT_ERROR_MEMORY;
+            if (compression != TIF_NO_COMPRESSION) {
+                if (compression == TIF_LZW) {
+                    tif_lzw_post_encode(&lzw_state, fmp);
+                } else if (compression == TIF_CCITT_T6) {
+                    tif_g4_post(&g4_state, fmp);
                 }
-                bytes_put = ftell(tif_file) - file_pos;
+                bytes_put = fm_tell(fmp) - file_pos;
                 if (bytes_put != strip_bytes[strip]) {
                     const int diff = bytes_put - strip_bytes[strip];
                     strip_bytes[strip] = bytes_put;
@@ -421,11 +645,10 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
                     }
                 }
             } else {
-                fwrite(strip_buf, 1, bytes_put, tif_file);
+                bytes_put = strip_bytes[strip];
             }
             strip++;
             total_bytes_put += bytes_put;
-            bytes_put = 0;
             strip_row = 0;
             /* Suppress clang-analyzer-core.UndefinedBinaryOperatorResult */
             assert(strip < strip_count || row + 1 == symbol->bitmap_height);
@@ -433,18 +656,20 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     }
 
     if (total_bytes_put & 1) {
-        putc(0, tif_file); // IFD must be on word boundary
+        fm_putc(0, fmp); // IFD must be on word boundary
         total_bytes_put++;
     }
 
-    if (compression == TIF_LZW) {
-        tif_lzw_cleanup(&lzw_state);
+    if (compression != TIF_NO_COMPRESSION) {
+        if (compression == TIF_LZW) {
+            tif_lzw_cleanup(&lzw_state);
+        }
 
-        file_pos = ftell(tif_file);
-        fseek(tif_file, 4, SEEK_SET);
+        file_pos = fm_tell(fmp);
+        fm_seek(fmp, 4, SEEK_SET);
         free_memory = file_pos;
-        fwrite(&free_memory, 4, 1, tif_file);
-        fseek(tif_file, file_pos, SEEK_SET);
+        fm_write(&free_memory, 4, 1, fmp);
+        fm_seek(fmp, file_pos, SEEK_SET);
     }
 
     /* Image File Directory */
@@ -557,14 +782,14 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
         tags[update_offsets[i]].offset += ifd_size;
     }
 
-    fwrite(&entries, sizeof(entries), 1, tif_file);
-    fwrite(&tags, sizeof(tiff_tag_t), entries, tif_file);
-    fwrite(&offset, sizeof(offset), 1, tif_file);
+    fm_write(&entries, sizeof(entries), 1, fmp);
+    fm_write(&tags, sizeof(tiff_tag_t), entries, fmp);
+    fm_write(&offset, sizeof(offset), 1, fmp);
     total_bytes_put += ifd_size;
 
     if (samples_per_pixel > 2) {
         for (i = 0; i < samples_per_pixel; i++) {
-            fwrite(&bits_per_sample, sizeof(bits_per_sample), 1, tif_file);
+            fm_write(&bits_per_sample, sizeof(bits_per_sample), 1, fmp);
         }
         total_bytes_put += sizeof(bits_per_sample) * samples_per_pixel;
     }
@@ -572,52 +797,54 @@ INTERNAL int tif_pixel_plot(struct zint_symbol *symbol, unsigned char *pixelbuf)
     if (strip_count != 1) {
         /* Strip offsets */
         for (i = 0; i < strip_count; i++) {
-            fwrite(&strip_offset[i], 4, 1, tif_file);
+            fm_write(&strip_offset[i], 4, 1, fmp);
         }
 
         /* Strip byte lengths */
         for (i = 0; i < strip_count; i++) {
-            fwrite(&strip_bytes[i], 4, 1, tif_file);
+            fm_write(&strip_bytes[i], 4, 1, fmp);
         }
         total_bytes_put += strip_count * 8;
     }
+    z_free(strip_offset);
 
     /* X Resolution */
     temp32 = 72;
-    fwrite(&temp32, 4, 1, tif_file);
+    fm_write(&temp32, 4, 1, fmp);
     temp32 = 1;
-    fwrite(&temp32, 4, 1, tif_file);
+    fm_write(&temp32, 4, 1, fmp);
     total_bytes_put += 8;
 
     /* Y Resolution */
     temp32 = 72;
-    fwrite(&temp32, 4, 1, tif_file);
+    fm_write(&temp32, 4, 1, fmp);
     temp32 = 1;
-    fwrite(&temp32, 4, 1, tif_file);
+    fm_write(&temp32, 4, 1, fmp);
     total_bytes_put += 8;
 
     if (color_map_size) {
         for (i = 0; i < color_map_size; i++) {
-            fwrite(&color_map[i].red, 2, 1, tif_file);
+            fm_write(&color_map[i].red, 2, 1, fmp);
         }
         for (i = 0; i < color_map_size; i++) {
-            fwrite(&color_map[i].green, 2, 1, tif_file);
+            fm_write(&color_map[i].green, 2, 1, fmp);
         }
         for (i = 0; i < color_map_size; i++) {
-            fwrite(&color_map[i].blue, 2, 1, tif_file);
+            fm_write(&color_map[i].blue, 2, 1, fmp);
         }
         total_bytes_put += 6 * color_map_size;
     }
 
-    if (output_to_stdout) {
-        fflush(tif_file);
-    } else {
-        if (ftell(tif_file) != total_bytes_put) {
-            fclose(tif_file);
+    if (!output_to_stdout) {
+        if (fm_tell(fmp) != total_bytes_put) {
+            (void) fm_close(fmp, symbol);
             strcpy(symbol->errtxt, "674: Failed to write all output");
             return ZINT_ERROR_FILE_WRITE;
         }
-        fclose(tif_file);
+    }
+    if (!fm_close(fmp, symbol)) {
+        sprintf(symbol->errtxt, "675: Failure on closing output file (%d: %.30s)", fmp->err, strerror(fmp->err));
+        return ZINT_ERROR_FILE_WRITE;
     }
 
     return 0;
@@ -121,6 +121,16 @@ typedef struct {
  */
 typedef struct {
     tif_lzw_hash *enc_hashtab;  /* kept separate for small machines */
+    int     nbits;              /* # of bits/code */
+    int     maxcode;            /* maximum code for nbits */
+    int     free_ent;           /* next free entry in hash table */
+    unsigned long nextdata;     /* next bits of i/o */
+    long    nextbits;           /* # of valid bits in nextdata */
+    tif_lzw_hcode oldcode;      /* last code encoded */
+    long    checkpoint;         /* point at which to clear table */
+    long    ratio;              /* current compression ratio */
+    long    incount;            /* (input) data bytes encoded */
+    long    outcount;           /* encoded (output) bytes */
 } tif_lzw_state;
 
 /*
@@ -161,18 +171,45 @@ static void tif_lzw_cl_hash(tif_lzw_state *sp) {
 }
 
 /* Explicit 0xff masking to make icc -check=conversions happy */
-#define PutNextCode(op_file, c) { \
+#define PutNextCode(op_fmp, c) { \
     nextdata = (nextdata << nbits) | c; \
     nextbits += nbits; \
-    putc((nextdata >> (nextbits - 8)) & 0xff, op_file); \
+    fm_putc((nextdata >> (nextbits - 8)) & 0xff, op_fmp); \
     nextbits -= 8; \
     if (nextbits >= 8) { \
-        putc((nextdata >> (nextbits - 8)) & 0xff, op_file); \
+        fm_putc((nextdata >> (nextbits - 8)) & 0xff, op_fmp); \
         nextbits -= 8; \
     } \
     outcount += nbits; \
 }
 
+/*
+ * Reset encoding state at the start of a strip.
+ */
+static int tif_lzw_pre_encode(tif_lzw_state *sp) {
+    if (sp->enc_hashtab == NULL) {
+        sp->enc_hashtab = (tif_lzw_hash *) z_malloc(HSIZE * sizeof(tif_lzw_hash));
+        if (sp->enc_hashtab == NULL) {
+            return 0;
+        }
+    }
+
+    tif_lzw_cl_hash(sp); /* clear hash table */
+
+    sp->nbits = BITS_MIN;
+    sp->maxcode = MAXCODE(BITS_MIN);
+    sp->free_ent = CODE_FIRST;
+    sp->nextdata = 0;
+    sp->nextbits = 0;
+    sp->checkpoint = CHECK_GAP;
+    sp->ratio = 0;
+    sp->incount = 0;
+    sp->outcount = 0;
+    sp->oldcode = (tif_lzw_hcode) -1; /* generates CODE_CLEAR in tif_lzw_encode() */
+
+    return 1;
+}
+
 /*
  * Encode a chunk of pixels.
  *
@@ -186,8 +223,11 @@ static void tif_lzw_cl_hash(tif_lzw_state *sp) {
  * but after the table fills.  The variable-length output codes
  * are re-sized at this point, and a CODE_CLEAR is generated
  * for the decoder.
+ *
+ * May be called repeatedly (e.g. once per row) between `tif_lzw_pre_encode()`
+ * and `tif_lzw_post_encode()`, the state being carried over in `sp`.
  */
-static int tif_lzw_encode(tif_lzw_state *sp, FILE *op_file, const unsigned char *bp, int cc) {
+static void tif_lzw_encode(tif_lzw_state *sp, struct filemem *op_fmp, const unsigned char *bp, int cc) {
     register long fcode;
     register tif_lzw_hash *hp;
     register int h, c;
@@ -205,31 +245,21 @@ static int tif_lzw_encode(tif_lzw_state *sp, FILE *op_file, const unsigned char
     long outcount;          /* encoded (output) bytes */
 
     /*
-     * Reset encoding state at the start of a strip.
+     * Load local state.
      */
-    if (sp->enc_hashtab == NULL) {
-        sp->enc_hashtab = (tif_lzw_hash *) malloc(HSIZE * sizeof(tif_lzw_hash));
-        if (sp->enc_hashtab == NULL) {
-            return 0;
-        }
-    }
-
-    tif_lzw_cl_hash(sp); /* clear hash table */
-
-    nbits = BITS_MIN;
-    maxcode = MAXCODE(BITS_MIN);
-    free_ent = CODE_FIRST;
-    nextdata = 0;
-    nextbits = 0;
-    checkpoint = CHECK_GAP;
-    ratio = 0;
-    incount = 0;
-    outcount = 0;
-
-    ent = (tif_lzw_hcode) -1;
+    incount = sp->incount;
+    outcount = sp->outcount;
+    checkpoint = sp->checkpoint;
+    ratio = sp->ratio;
+    nbits = sp->nbits;
+    maxcode = sp->maxcode;
+    free_ent = sp->free_ent;
+    nextdata = sp->nextdata;
+    nextbits = sp->nextbits;
+    ent = sp->oldcode;
 
-    if (cc > 0) {
-        PutNextCode(op_file, CODE_CLEAR);
+    if (ent == (tif_lzw_hcode) -1 && cc > 0) {
+        PutNextCode(op_fmp, CODE_CLEAR);
         ent = *bp++; cc--; incount++;
     }
     while (cc > 0) {
@@ -275,7 +305,7 @@ static int tif_lzw_encode(tif_lzw_state *sp, FILE *op_file, const unsigned char
         /*
          * New entry, emit code and add to table.
          */
-        PutNextCode(op_file, ent);
+        PutNextCode(op_fmp, ent);
         ent = (tif_lzw_hcode) c;
         hp->code = (tif_lzw_hcode) (free_ent++);
         hp->hash = fcode;
@@ -286,7 +316,7 @@ static int tif_lzw_encode(tif_lzw_state *sp, FILE *op_file, const unsigned char
             incount = 0;
             outcount = 0;
             free_ent = CODE_FIRST;
-            PutNextCode(op_file, CODE_CLEAR);
+            PutNextCode(op_fmp, CODE_CLEAR);
             nbits = BITS_MIN;
             maxcode = MAXCODE(BITS_MIN);
         } else {
@@ -314,7 +344,7 @@ static int tif_lzw_encode(tif_lzw_state *sp, FILE *op_file, const unsigned char
                     incount = 0;
                     outcount = 0;
                     free_ent = CODE_FIRST;
-                    PutNextCode(op_file, CODE_CLEAR);
+                    PutNextCode(op_fmp, CODE_CLEAR);
                     nbits = BITS_MIN;
                     maxcode = MAXCODE(BITS_MIN);
                 } else {
@@ -327,18 +357,42 @@ static int tif_lzw_encode(tif_lzw_state *sp, FILE *op_file, const unsigned char
     }
 
     /*
-     * Finish off an encoded strip by flushing the last
-     * string and tacking on an End Of Information code.
+     * Restore global state.
      */
-    if (ent != (tif_lzw_hcode) -1) {
+    sp->incount = incount;
+    sp->outcount = outcount;
+    sp->checkpoint = checkpoint;
+    sp->ratio = ratio;
+    sp->nbits = nbits;
+    sp->maxcode = maxcode;
+    sp->free_ent = free_ent;
+    sp->nextdata = nextdata;
+    sp->nextbits = nextbits;
+    sp->oldcode = ent;
+}
+
+/*
+ * Finish off an encoded strip by flushing the last
+ * string and tacking on an End Of Information code.
+ */
+static void tif_lzw_post_encode(tif_lzw_state *sp, struct filemem *op_fmp) {
+    int nbits = sp->nbits;
+    int free_ent = sp->free_ent;
+    unsigned long nextdata = sp->nextdata;
+    long nextbits = sp->nextbits;
+    long outcount = sp->outcount;
 
-        PutNextCode(op_file, ent);
+    if (sp->oldcode != (tif_lzw_hcode) -1) {
+        const int maxcode = sp->maxcode;
+        const tif_lzw_hcode ent = sp->oldcode;
+
+        PutNextCode(op_fmp, ent);
         free_ent++;
 
         if (free_ent == CODE_MAX - 1) {
             /* table is full, emit clear code and reset */
             outcount = 0;
-            PutNextCode(op_file, CODE_CLEAR);
+            PutNextCode(op_fmp, CODE_CLEAR);
             nbits = BITS_MIN;
         } else {
             /*
@@ -351,23 +405,22 @@ static int tif_lzw_encode(tif_lzw_state *sp, FILE *op_file, const unsigned char
             }
         }
     }
-    PutNextCode(op_file, CODE_EOI);
+    PutNextCode(op_fmp, CODE_EOI);
     /* Explicit 0xff masking to make icc -check=conversions happy */
     if (nextbits > 0) {
-        putc((nextdata << (8 - nextbits)) & 0xff, op_file);
+        fm_putc((nextdata << (8 - nextbits)) & 0xff, op_fmp);
     }
-
-    return 1;
+    (void) outcount;
 }
 
 static void tif_lzw_cleanup(tif_lzw_state *sp) {
     if (sp->enc_hashtab) {
-        free(sp->enc_hashtab);
+        z_free(sp->enc_hashtab);
     }
 }
 
 static void tif_lzw_init(tif_lzw_state *sp) {
-    sp->enc_hashtab = NULL;
+    memset(sp, 0, sizeof(*sp));
 }
 
 #endif   /* TIF_LZW_H */
@@ -617,7 +617,87 @@ static float look_ahead_c43(unsigned char source[], int in_length, int in_locn,
     return (float) letters_encoded / (float) codeword_count;
 }
 
-/* Produces a set of codewords which are "somewhat" optimised - this could be improved on */
+/* FAST_MODE modes: ASCII, 8-bit and C43 split into its 2 main subsets, so that latching between them is costed */
+#define ULTRA_FAST_NUM_MODES 4
+
+static const char ultra_fast_mode_types[] = { 'a', '8', 'c', 'c', '\0' };
+
+/* Decide modes in a single greedy pass (FAST_MODE) using `fast_define_mode()`, costing in sixths of a codeword (a C43
+ * subcodeword being 4). URL fragments and the padding of C43 subcodewords to a multiple of 3 aren't costed. Each run
+ * of characters of the same class can cost at most a latch from and back to C43 (2 or 3 codewords) more than the
+ * best encodation under these costs */
+static void ultra_define_mode_fast(char mode[], const unsigned char source[], const int length,
+            const char symbol_mode, const int gs1, unsigned int fast_sums[]) {
+    /* Costs of each class of character in each mode */
+    static const unsigned int char_costs[7 * ULTRA_FAST_NUM_MODES] = {
+    /*  A  8  C1 C2 */
+        3, 6, 4, 8, /* Digit: paired in ASCII, shifted in C2 */
+        6, 6, 4, 8, /* Other C43 set 1 */
+        6, 6, 4, 4, /* In both C43 sets 1 and 2 ('.' and ',') */
+        6, 6, 8, 4, /* Other C43 set 2 */
+        6, 6, 8, 8, /* C43 set 3: shifted */
+        6, 6, 0, 0, /* Other ASCII (and FNC1) */
+        0, 6, 0, 0, /* Extended ASCII */
+    };
+    /* Unlatching from C43 returns to the symbol's mode, so ASCII needs a further latch if that's 8-bit */
+    const unsigned int c43_to_ascii = symbol_mode == EIGHTBIT_MODE ? 12 : 6;
+    const unsigned int head_costs[ULTRA_FAST_NUM_MODES] = {
+        symbol_mode == ASCII_MODE ? 0 : 6, symbol_mode == EIGHTBIT_MODE ? 0 : 6, 6, 6
+    };
+    const unsigned int switch_costs[ULTRA_FAST_NUM_MODES][ULTRA_FAST_NUM_MODES] = {
+        /*      A             8  C1 C2 */
+        /*A*/ {            0, 6, 6, 6 },
+        /*8*/ {            6, 0, 6, 6 },
+        /*C1*/ { c43_to_ascii, 6, 0, 4 },
+        /*C2*/ { c43_to_ascii, 6, 4, 0 },
+    };
+    unsigned int costs[7 * ULTRA_FAST_NUM_MODES];
+    struct fast_modes modes;
+    int i;
+#ifndef _MSC_VER
+    unsigned char classes[length + 1];
+#else
+    unsigned char *classes = (unsigned char *) _alloca(length + 1);
+#endif
+
+    memcpy(costs, char_costs, sizeof(costs));
+    if (symbol_mode == ASCII_MODE) {
+        /* Stay out of 8-bit mode, as the non-FAST_MODE encodation does in practice */
+        for (i = 0; i < 7; i++) {
+            costs[i * ULTRA_FAST_NUM_MODES + 1] = 0;
+        }
+    }
+
+    for (i = 0; i < length; i++) {
+        const unsigned char ch = source[i];
+        if (ch >= 0x80) {
+            classes[i] = 6;
+        } else if (gs1 && ch == '[') {
+            classes[i] = 5;
+        } else if (ch >= '0' && ch <= '9') {
+            classes[i] = 0;
+        } else if (posn(ultra_c43_set1, ch) != -1) {
+            classes[i] = posn(ultra_c43_set2, ch) != -1 ? 2 : 1;
+        } else if (posn(ultra_c43_set2, ch) != -1) {
+            classes[i] = 3;
+        } else {
+            classes[i] = posn(ultra_c43_set3, ch) != -1 ? 4 : 5;
+        }
+    }
+
+    modes.num_modes = ULTRA_FAST_NUM_MODES;
+    modes.mode_types = ultra_fast_mode_types;
+    modes.head_costs = head_costs;
+    modes.switch_costs = switch_costs[0];
+    modes.char_costs = costs;
+    modes.units = NULL;
+    modes.sums = fast_sums;
+
+    fast_define_mode(mode, classes, length, &modes);
+}
+
+/* Produces a set of codewords which are "somewhat" optimised - this could be improved on. Returns -1 if
+   `scratch_alloc()` fails */
 static int ultra_generate_codewords(struct zint_symbol *symbol, const unsigned char source[], const int in_length,
             int codewords[]) {
     int i;
@@ -766,8 +846,16 @@ static int ultra_generate_codewords(struct zint_symbol *symbol, const unsigned c
         crop_source[crop_length] = '\0';
     }
 
+    if ((symbol->option_3 == ULTRA_COMPRESSION || gs1) && (symbol->input_mode & FAST_MODE)) {
+        unsigned int *fast_sums = (unsigned int *) scratch_alloc(symbol,
+                                            sizeof(unsigned int) * FAST_SUMS_SIZE(crop_length, ULTRA_FAST_NUM_MODES));
+        if (!fast_sums) {
+            return -1;
+        }
+        ultra_define_mode_fast(mode, crop_source, crop_length, symbol_mode, gs1, fast_sums);
+
     /* Attempt encoding in all three modes to see which offers best compaction and store results */
-    if (symbol->option_3 == ULTRA_COMPRESSION || gs1) {
+    } else if (symbol->option_3 == ULTRA_COMPRESSION || gs1) {
         current_mode = symbol_mode;
         input_locn = 0;
         do {
@@ -955,6 +1043,9 @@ INTERNAL int ultra(struct zint_symbol *symbol, unsigned char source[], int lengt
 #endif /* _MSC_VER */
 
     data_cw_count = ultra_generate_codewords(symbol, source, length, data_codewords);
+    if (data_cw_count < 0) {
+        return ZINT_ERROR_MEMORY; /* `scratch_alloc()` failure */
+    }
 
     if (symbol->debug & ZINT_DEBUG_PRINT) {
         printf("Codewords (%d):", data_cw_count);
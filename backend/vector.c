@@ -42,11 +42,66 @@ INTERNAL int ps_plot(struct zint_symbol *symbol);
 INTERNAL int svg_plot(struct zint_symbol *symbol);
 INTERNAL int emf_plot(struct zint_symbol *symbol, int rotate_angle);
 
+/* Primitives are bump-allocated from blocks chained off the vector header rather than individually, and on
+   completion are compacted by `vector_compact()` into contiguous arrays (see `struct zint_vector`) */
+struct vector_block {
+    struct vector_block *next;
+    size_t size;            /* Size of data following header */
+    size_t used;
+};
+
+/* Header size rounded up so that data is aligned */
+#define VECTOR_ALIGN(s)     (((s) + 7) & ~((size_t) 7))
+#define VECTOR_BLOCK_HDR    VECTOR_ALIGN(sizeof(struct vector_block))
+#define VECTOR_BLOCK_MIN    4096
+#define VECTOR_BLOCK_MAX    (256 * 1024)
+
+/* Allocated in place of a plain `struct zint_vector` */
+struct vector_arena {
+    struct zint_vector vector; /* Must be first */
+    struct vector_block *blocks; /* Most recent first */
+    size_t next_size;
+};
+
+/* Allocate `size` bytes from the arena, returning NULL if out of memory */
+static void *vector_alloc(struct zint_symbol *symbol, size_t size) {
+    struct vector_arena *arena = (struct vector_arena *) symbol->vector;
+    struct vector_block *block = arena->blocks;
+    void *ptr;
+
+    size = VECTOR_ALIGN(size);
+    if (!block || block->size - block->used < size) {
+        const size_t block_size = size > arena->next_size ? size : arena->next_size;
+        if (!(block = (struct vector_block *) z_malloc(VECTOR_BLOCK_HDR + block_size))) {
+            return NULL;
+        }
+        block->next = arena->blocks;
+        block->size = block_size;
+        block->used = 0;
+        arena->blocks = block;
+        if (arena->next_size < VECTOR_BLOCK_MAX) {
+            arena->next_size <<= 1;
+        }
+    }
+    ptr = (unsigned char *) block + VECTOR_BLOCK_HDR + block->used;
+    block->used += size;
+
+    return ptr;
+}
+
+static void vector_free_blocks(struct vector_block *block) {
+    while (block) {
+        struct vector_block *b = block;
+        block = block->next;
+        z_free(b);
+    }
+}
+
 static struct zint_vector_rect *vector_plot_create_rect(struct zint_symbol *symbol,
                                 const float x, const float y, const float width, const float height) {
     struct zint_vector_rect *rect;
 
-    rect = (struct zint_vector_rect *) malloc(sizeof(struct zint_vector_rect));
+    rect = (struct zint_vector_rect *) vector_alloc(symbol, sizeof(struct zint_vector_rect));
     if (!rect) {
         strcpy(symbol->errtxt, "691: Insufficient memory for vector rectangle");
         return NULL;
@@ -76,7 +131,7 @@ static struct zint_vector_hexagon *vector_plot_create_hexagon(struct zint_symbol
                                     const float x, const float y, const float diameter) {
     struct zint_vector_hexagon *hexagon;
 
-    hexagon = (struct zint_vector_hexagon *) malloc(sizeof(struct zint_vector_hexagon));
+    hexagon = (struct zint_vector_hexagon *) vector_alloc(symbol, sizeof(struct zint_vector_hexagon));
     if (!hexagon) {
         strcpy(symbol->errtxt, "692: Insufficient memory for vector hexagon");
         return NULL;
@@ -105,7 +160,7 @@ static struct zint_vector_circle *vector_plot_create_circle(struct zint_symbol *
                                     const int colour) {
     struct zint_vector_circle *circle;
 
-    circle = (struct zint_vector_circle *) malloc(sizeof(struct zint_vector_circle));
+    circle = (struct zint_vector_circle *) vector_alloc(symbol, sizeof(struct zint_vector_circle));
     if (!circle) {
         strcpy(symbol->errtxt, "693: Insufficient memory for vector circle");
         return NULL;
@@ -135,7 +190,7 @@ static int vector_plot_add_string(struct zint_symbol *symbol, const unsigned cha
             struct zint_vector_string **last_string) {
     struct zint_vector_string *string;
 
-    string = (struct zint_vector_string *) malloc(sizeof(struct zint_vector_string));
+    string = (struct zint_vector_string *) vector_alloc(symbol, sizeof(struct zint_vector_string));
     if (!string) {
         strcpy(symbol->errtxt, "694: Insufficient memory for vector string");
         return 0;
@@ -148,9 +203,8 @@ static int vector_plot_add_string(struct zint_symbol *symbol, const unsigned cha
     string->length = (int) ustrlen(text);
     string->rotation = 0;
     string->halign = halign;
-    string->text = (unsigned char *) malloc(string->length + 1);
+    string->text = (unsigned char *) vector_alloc(symbol, string->length + 1);
     if (!string->text) {
-        free(string);
         strcpy(symbol->errtxt, "695: Insufficient memory for vector string text");
         return 0;
     }
@@ -167,48 +221,105 @@ static int vector_plot_add_string(struct zint_symbol *symbol, const unsigned cha
 
 INTERNAL void vector_free(struct zint_symbol *symbol) {
     if (symbol->vector != NULL) {
-        struct zint_vector_rect *rect;
-        struct zint_vector_hexagon *hex;
-        struct zint_vector_circle *circle;
-        struct zint_vector_string *string;
-
-        // Free Rectangles
-        rect = symbol->vector->rectangles;
-        while (rect) {
-            struct zint_vector_rect *r = rect;
-            rect = rect->next;
-            free(r);
-        }
+        // All primitives (including string text) belong to the arena
+        vector_free_blocks(((struct vector_arena *) symbol->vector)->blocks);
 
-        // Free Hexagons
-        hex = symbol->vector->hexagons;
-        while (hex) {
-            struct zint_vector_hexagon *h = hex;
-            hex = hex->next;
-            free(h);
-        }
+        // Free vector
+        z_free(symbol->vector);
+        symbol->vector = NULL;
+    }
+}
 
-        // Free Circles
-        circle = symbol->vector->circles;
-        while (circle) {
-            struct zint_vector_circle *c = circle;
-            circle = circle->next;
-            free(c);
-        }
+/* Copy the primitives in list order into a single block, giving each type a contiguous array, and release the
+   building blocks (which may contain gaps left by merged rectangles) */
+static int vector_compact(struct zint_symbol *symbol) {
+    struct vector_arena *arena = (struct vector_arena *) symbol->vector;
+    struct zint_vector *vector = symbol->vector;
+    struct zint_vector_rect *rect, *rects;
+    struct zint_vector_hexagon *hex, *hexagons;
+    struct zint_vector_circle *circle, *circles;
+    struct zint_vector_string *string, *strings;
+    struct vector_block *block;
+    unsigned char *data, *text;
+    size_t size;
+    int rect_count = 0, hexagon_count = 0, circle_count = 0, string_count = 0, text_size = 0;
+    int i;
+
+    for (rect = vector->rectangles; rect; rect = rect->next, rect_count++);
+    for (hex = vector->hexagons; hex; hex = hex->next, hexagon_count++);
+    for (circle = vector->circles; circle; circle = circle->next, circle_count++);
+    for (string = vector->strings; string; string = string->next, string_count++) {
+        text_size += string->length + 1;
+    }
 
-        // Free Strings
-        string = symbol->vector->strings;
-        while (string) {
-            struct zint_vector_string *s = string;
-            string = string->next;
-            free(s->text);
-            free(s);
-        }
+    /* Structures all contain pointers so no padding needed between arrays (text last) */
+    size = sizeof(struct zint_vector_rect) * rect_count + sizeof(struct zint_vector_hexagon) * hexagon_count
+            + sizeof(struct zint_vector_circle) * circle_count + sizeof(struct zint_vector_string) * string_count
+            + text_size;
+    if (!(block = (struct vector_block *) z_malloc(VECTOR_BLOCK_HDR + size))) {
+        strcpy(symbol->errtxt, "697: Insufficient memory for vector arrays");
+        return ZINT_ERROR_MEMORY;
+    }
+    block->next = NULL;
+    block->size = block->used = size;
+    data = (unsigned char *) block + VECTOR_BLOCK_HDR;
+
+    rects = (struct zint_vector_rect *) data;
+    for (rect = vector->rectangles, i = 0; rect; rect = rect->next, i++) {
+        rects[i] = *rect;
+        rects[i].next = rects + i + 1;
+    }
+    data += sizeof(struct zint_vector_rect) * rect_count;
 
-        // Free vector
-        free(symbol->vector);
-        symbol->vector = NULL;
+    hexagons = (struct zint_vector_hexagon *) data;
+    for (hex = vector->hexagons, i = 0; hex; hex = hex->next, i++) {
+        hexagons[i] = *hex;
+        hexagons[i].next = hexagons + i + 1;
+    }
+    data += sizeof(struct zint_vector_hexagon) * hexagon_count;
+
+    circles = (struct zint_vector_circle *) data;
+    for (circle = vector->circles, i = 0; circle; circle = circle->next, i++) {
+        circles[i] = *circle;
+        circles[i].next = circles + i + 1;
+    }
+    data += sizeof(struct zint_vector_circle) * circle_count;
+
+    strings = (struct zint_vector_string *) data;
+    text = data + sizeof(struct zint_vector_string) * string_count;
+    for (string = vector->strings, i = 0; string; string = string->next, i++) {
+        strings[i] = *string;
+        strings[i].next = strings + i + 1;
+        strings[i].text = text;
+        memcpy(text, string->text, string->length + 1);
+        text += string->length + 1;
+    }
+
+    vector->rectangles = rect_count ? rects : NULL;
+    if (rect_count) {
+        rects[rect_count - 1].next = NULL;
+    }
+    vector->hexagons = hexagon_count ? hexagons : NULL;
+    if (hexagon_count) {
+        hexagons[hexagon_count - 1].next = NULL;
+    }
+    vector->circles = circle_count ? circles : NULL;
+    if (circle_count) {
+        circles[circle_count - 1].next = NULL;
+    }
+    vector->strings = string_count ? strings : NULL;
+    if (string_count) {
+        strings[string_count - 1].next = NULL;
     }
+    vector->rectangle_count = rect_count;
+    vector->hexagon_count = hexagon_count;
+    vector->circle_count = circle_count;
+    vector->string_count = string_count;
+
+    vector_free_blocks(arena->blocks);
+    arena->blocks = block;
+
+    return 0;
 }
 
 static void vector_scale(struct zint_symbol *symbol, const int file_type) {
@@ -366,8 +477,22 @@ static void vector_rotate(struct zint_symbol *symbol, const int rotate_angle) {
     }
 }
 
-static void vector_reduce_rectangles(struct zint_symbol *symbol) {
-    // Looks for vertically aligned rectangles and merges them together
+/* Hash of rectangle position/size/colour, with `y` its bottom (for matching rectangles below) or its top */
+static unsigned int vector_rect_hash(const struct zint_vector_rect *rect, const float y) {
+    const float vals[3] = { rect->x + 0.0f, rect->width + 0.0f, y + 0.0f }; /* Adding 0 normalizes -0 */
+    unsigned int hash = (unsigned int) rect->colour * 0x9E3779B1;
+    unsigned int val;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        memcpy(&val, &vals[i], sizeof(float)); /* Assumes `float` 32-bit */
+        hash = (hash ^ val) * 0x01000193;
+    }
+    return hash ^ (hash >> 15);
+}
+
+/* Looks for vertically aligned rectangles and merges them together (O(n^2) version, used if no memory for hash) */
+static void vector_reduce_rectangles_slow(struct zint_symbol *symbol) {
     struct zint_vector_rect *rect, *target, *prev;
 
     rect = symbol->vector->rectangles;
@@ -379,8 +504,7 @@ static void vector_reduce_rectangles(struct zint_symbol *symbol) {
             if ((rect->x == target->x) && (rect->width == target->width)
                     && (stripf(rect->y + rect->height) == target->y) && (rect->colour == target->colour)) {
                 rect->height += target->height;
-                prev->next = target->next;
-                free(target);
+                prev->next = target->next; /* Memory reclaimed by `vector_compact()` */
             } else {
                 prev = target;
             }
@@ -391,6 +515,77 @@ static void vector_reduce_rectangles(struct zint_symbol *symbol) {
     }
 }
 
+static void vector_reduce_rectangles(struct zint_symbol *symbol) {
+    /* Looks for vertically aligned rectangles and merges them together, in a single pass using a hash of the
+       rectangles seen so far keyed by their bottoms. An entry whose rectangle has since grown is stale and is
+       skipped over (it's re-entered under its new bottom) */
+    struct zint_vector_rect *rect, *prev, *next;
+    struct zint_vector_rect **table;
+    float *bottoms;
+    unsigned int size, mask, i;
+    int count = 0;
+
+    for (rect = symbol->vector->rectangles; rect; rect = rect->next) {
+        count++;
+    }
+    if (count < 2) {
+        return;
+    }
+    for (size = 4; size < (unsigned int) count * 2; size <<= 1);
+    mask = size - 1;
+
+    table = (struct zint_vector_rect **) z_calloc(size, sizeof(struct zint_vector_rect *));
+    bottoms = (float *) z_malloc(sizeof(float) * size);
+    if (!table || !bottoms) {
+        z_free(table);
+        z_free(bottoms);
+        vector_reduce_rectangles_slow(symbol);
+        return;
+    }
+
+    prev = NULL;
+    for (rect = symbol->vector->rectangles; rect; rect = next) {
+        struct zint_vector_rect *above = NULL;
+        float bottom;
+
+        next = rect->next;
+
+        /* Find an earlier rectangle whose bottom is this one's top */
+        for (i = vector_rect_hash(rect, rect->y) & mask; table[i]; i = (i + 1) & mask) {
+            const struct zint_vector_rect *entry = table[i];
+            if (bottoms[i] == rect->y && entry->x == rect->x && entry->width == rect->width
+                    && entry->colour == rect->colour && stripf(entry->y + entry->height) == bottoms[i]) {
+                above = table[i];
+                break;
+            }
+        }
+        if (above) {
+            above->height += rect->height;
+            prev->next = next; /* `prev` non-NULL as `above` earlier (memory reclaimed by `vector_compact()`) */
+            rect = above;
+        } else {
+            prev = rect;
+        }
+
+        /* (Re-)enter under its bottom, unless an earlier rectangle with the same bottom already entered */
+        bottom = stripf(rect->y + rect->height);
+        for (i = vector_rect_hash(rect, bottom) & mask; table[i]; i = (i + 1) & mask) {
+            const struct zint_vector_rect *entry = table[i];
+            if (bottoms[i] == bottom && entry->x == rect->x && entry->width == rect->width
+                    && entry->colour == rect->colour && stripf(entry->y + entry->height) == bottom) {
+                break;
+            }
+        }
+        if (!table[i]) {
+            table[i] = rect;
+            bottoms[i] = bottom;
+        }
+    }
+
+    z_free(table);
+    z_free(bottoms);
+}
+
 INTERNAL int plot_vector(struct zint_symbol *symbol, int rotate_angle, int file_type) {
     int error_number;
     int main_width;
@@ -435,11 +630,12 @@ INTERNAL int plot_vector(struct zint_symbol *symbol, int rotate_angle, int file_
     }
 
     // Allocate memory
-    vector = symbol->vector = (struct zint_vector *) malloc(sizeof(struct zint_vector));
+    vector = symbol->vector = (struct zint_vector *) z_calloc(1, sizeof(struct vector_arena));
     if (!vector) {
         strcpy(symbol->errtxt, "696: Insufficient memory for vector header");
         return ZINT_ERROR_MEMORY;
     }
+    ((struct vector_arena *) vector)->next_size = VECTOR_BLOCK_MIN;
     vector->rectangles = NULL;
     vector->hexagons = NULL;
     vector->circles = NULL;
@@ -929,6 +1125,10 @@ INTERNAL int plot_vector(struct zint_symbol *symbol, int rotate_angle, int file_
 
     vector_reduce_rectangles(symbol);
 
+    if ((error_number = vector_compact(symbol)) != 0) {
+        return error_number;
+    }
+
     vector_scale(symbol, file_type);
 
     if (file_type != OUT_EMF_FILE) {
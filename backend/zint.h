@@ -37,6 +37,8 @@
 #ifndef ZINT_H
 #define ZINT_H
 
+#include <stddef.h> /* For size_t */
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -79,6 +81,12 @@ extern "C" {
         struct zint_vector_hexagon *hexagons; /* Pointer to first hexagon */
         struct zint_vector_string *strings; /* Pointer to first string */
         struct zint_vector_circle *circles; /* Pointer to first circle */
+        /* Each type is stored contiguously in list order, so the above may also be indexed as arrays, e.g.
+           `rectangles[0]` to `rectangles[rectangle_count - 1]` */
+        int rectangle_count; /* Number of rectangles */
+        int hexagon_count;  /* Number of hexagons */
+        int string_count;   /* Number of strings */
+        int circle_count;   /* Number of circles */
     };
 
     /* Structured Append info - ignored unless `zint_structapp.count` is set to non-zero value */
@@ -127,6 +135,24 @@ extern "C" {
         unsigned char *alphamap; /* Array of alpha values used (raster output only) */
         unsigned int bitmap_byte_length; /* Size of BMP bitmap data (raster output only) */
         struct zint_vector *vector; /* Pointer to vector header (vector output only) */
+        unsigned char *memfile; /* Pointer to in-memory file buffer if BARCODE_MEMORY_FILE (output only) */
+        int memfile_size;   /* Length of in-memory file buffer (output only) */
+        int bitmap_align;   /* Row alignment in bytes of OUT_BUFFER_1BPP/OUT_BUFFER_8BPP bitmaps (1 to 64). Default 1 */
+        int bitmap_stride;  /* Number of bytes per row of bitmap image (raster output only) */
+        int tif_rows_per_strip; /* Rows per TIF strip. Default 0 (strips of about 8K bytes uncompressed) */
+        unsigned char *matrix; /* Caller-owned buffer to encode modules into instead of `encoded_data`, or NULL */
+        int matrix_size;    /* Size of `matrix` in bytes */
+        int matrix_stride;  /* Bytes per row of `matrix`, at least `(width + 7) / 8` (`width` for Ultracode) */
+        void *scratch;      /* Internal scratch memory, reused between encodes (internal use only) */
+    };
+
+    /* Encode result cache statistics (see `ZBarcode_CacheStats()`) */
+    struct zint_cache_stats {
+        int max_entries;    /* Maximum number of entries (0 if disabled) */
+        int entries;        /* Number of entries */
+        unsigned int hits;  /* Number of encodes restored from the cache */
+        unsigned int misses; /* Number of encodes not in the cache */
+        unsigned int evictions; /* Number of least recently used entries removed to make room for new ones */
     };
 
 /* Symbologies (`symbol->symbology`) */
@@ -272,6 +298,12 @@ extern "C" {
                                          */
 #define BARCODE_NO_QUIET_ZONES  0x1000  /* Disable quiet zones, notably those with defaults as listed above */
 #define COMPLIANT_HEIGHT        0x2000  /* Warn if height not compliant and use standard height (if any) as default */
+#define BARCODE_MEMORY_FILE     0x4000  /* Write output to in-memory buffer `memfile` instead of to `outfile` file */
+#define OUT_BUFFER_1BPP         0x8000  /* Return 1 bit per pixel (set if foreground), MSB first, in bitmap buffer
+                                           (OUT_BUFFER only) */
+#define OUT_BUFFER_8BPP         0x10000 /* Return 8-bit grayscale values in bitmap buffer (OUT_BUFFER only) */
+#define TIF_COMPRESS_PACKBITS   0x20000 /* Use PackBits compression for TIF instead of LZW */
+#define TIF_COMPRESS_G4         0x40000 /* Use CCITT Group 4 compression for bilevel TIF instead of LZW */
 
 /* Input data types (`symbol->input_mode`) */
 #define DATA_MODE               0       /* Binary */
@@ -403,6 +435,42 @@ extern "C" {
                         int rotate_angle);
 
 
+    /* Batch callback, called (possibly concurrently) from a worker thread of `ZBarcode_Encode_Batch()` after input
+       `index` has been encoded into the worker's `symbol` with result `error_number` (as `ZBarcode_Encode()`).
+       `symbol` may be output (e.g. with `ZBarcode_Print()` or `ZBarcode_Buffer()`) but is only valid until return.
+       Return non-zero to abort the batch */
+    typedef int (*zint_batch_callback)(struct zint_symbol *symbol, int index, int error_number, void *user_data);
+
+    /* Encode `count` inputs `sources[i]` of length `lengths[i]` (if `lengths` NULL or `lengths[i]` 0,
+       NUL-terminated) in parallel using up to `threads` threads, each with its own copy of the settings of
+       `symbol` (other than `matrix`, the copies using `encoded_data`), which itself is not changed other than
+       `errtxt`. `callback` is called for each in completion order.
+       Returns 0 unless the arguments are invalid or memory can't be allocated */
+    ZINT_EXTERN int ZBarcode_Encode_Batch(struct zint_symbol *symbol, const unsigned char *const sources[],
+                        const int lengths[], int count, int threads, zint_batch_callback callback,
+                        void *user_data);
+
+
+    /* Set the functions used for all heap memory allocated by Zint (the default, selected by passing all NULL, is
+       `malloc()`, `realloc()` and `free()`). Must be called before any other Zint function, as they can't be changed
+       once Zint has allocated memory, and buffers returned in a symbol (`bitmap`, `alphamap`, `vector`, `memfile`)
+       must then only be freed via `ZBarcode_Clear()` or `ZBarcode_Delete()`. Returns 0 on success, or
+       ZINT_ERROR_INVALID_OPTION if only some are NULL or if Zint has already allocated memory with other functions */
+    ZINT_EXTERN int ZBarcode_SetAllocator(void *(*malloc_func)(size_t size),
+                        void *(*realloc_func)(void *ptr, size_t size), void (*free_func)(void *ptr));
+
+
+    /* Set the maximum number of entries of the process-wide encode result cache, shared by all threads (0, the
+       default, to disable). While enabled, `ZBarcode_Encode()` of the same data with the same settings as a
+       previous successful encode restores that result instead of encoding again. Clears the cache and its
+       statistics. Returns 0 on success, ZINT_ERROR_INVALID_OPTION if `max_entries` out of range (0 to 1000000),
+       or ZINT_ERROR_MEMORY if it can't be allocated (the cache is then disabled) */
+    ZINT_EXTERN int ZBarcode_SetCacheSize(int max_entries);
+
+    /* Get the encode result cache statistics into `stats` */
+    ZINT_EXTERN void ZBarcode_CacheStats(struct zint_cache_stats *stats);
+
+
     /* Is `symbol_id` a recognized symbology? */
     ZINT_EXTERN int ZBarcode_ValidID(int symbol_id);
 
@@ -25,6 +25,7 @@ DEFINES += ZINT_VERSION="\\\"2.10.0.9\\\""
 }
 
 HEADERS +=  ../backend/aztec.h \
+            ../backend/batch.h \
             ../backend/big5.h \
             ../backend/bmp.h \
             ../backend/channel_precalcs.h \
@@ -38,6 +39,8 @@ HEADERS +=  ../backend/aztec.h \
             ../backend/eci.h \
             ../backend/eci_sb.h \
             ../backend/emf.h \
+            ../backend/encache.h \
+            ../backend/filemem.h \
             ../backend/font.h \
             ../backend/gb18030.h \
             ../backend/gb2312.h \
@@ -50,6 +53,8 @@ HEADERS +=  ../backend/aztec.h \
             ../backend/iso4217.h \
             ../backend/ksx1001.h \
             ../backend/large.h \
+            ../backend/bitgrid.h \
+            ../backend/bitstream.h \
             ../backend/maxicode.h \
             ../backend/ms_stdint.h \
             ../backend/output.h \
@@ -72,6 +77,7 @@ HEADERS +=  ../backend/aztec.h \
 SOURCES += ../backend/2of5.c \
            ../backend/auspost.c \
            ../backend/aztec.c \
+           ../backend/batch.c \
            ../backend/bmp.c \
            ../backend/codablock.c \
            ../backend/code.c \
@@ -85,6 +91,8 @@ SOURCES += ../backend/2of5.c \
            ../backend/dotcode.c \
            ../backend/eci.c \
            ../backend/emf.c \
+           ../backend/encache.c \
+           ../backend/filemem.c \
            ../backend/gb18030.c \
            ../backend/gb2312.c \
            ../backend/general_field.c \
@@ -94,6 +102,8 @@ SOURCES += ../backend/2of5.c \
            ../backend/hanxin.c \
            ../backend/imail.c \
            ../backend/large.c \
+           ../backend/bitgrid.c \
+           ../backend/bitstream.c \
            ../backend/library.c \
            ../backend/mailmark.c \
            ../backend/maxicode.c \
@@ -18,6 +18,7 @@ DEFINES +=  _CRT_SECURE_NO_WARNINGS _CRT_NONSTDC_NO_WARNINGS ZINT_VERSION=\\\"$$
 }
 
 HEADERS +=  ../backend/aztec.h \
+            ../backend/batch.h \
             ../backend/bmp.h \
             ../backend/channel_precalcs.h \
             ../backend/code1.h \
@@ -29,6 +30,8 @@ HEADERS +=  ../backend/aztec.h \
             ../backend/dmatrix_trace.h \
             ../backend/eci.h \
             ../backend/emf.h \
+            ../backend/encache.h \
+            ../backend/filemem.h \
             ../backend/font.h \
             ../backend/gb18030.h \
             ../backend/gb2312.h \
@@ -37,6 +40,8 @@ HEADERS +=  ../backend/aztec.h \
             ../backend/gs1.h \
             ../backend/hanxin.h \
             ../backend/large.h \
+            ../backend/bitgrid.h \
+            ../backend/bitstream.h \
             ../backend/maxicode.h \
             ../backend/ms_stdint.h \
             ../backend/output.h \
@@ -54,6 +59,7 @@ HEADERS +=  ../backend/aztec.h \
 SOURCES += ../backend/2of5.c \
            ../backend/auspost.c \
            ../backend/aztec.c \
+           ../backend/batch.c \
            ../backend/bmp.c \
            ../backend/codablock.c \
            ../backend/code.c \
@@ -67,6 +73,8 @@ SOURCES += ../backend/2of5.c \
            ../backend/dotcode.c \
            ../backend/eci.c \
            ../backend/emf.c \
+           ../backend/encache.c \
+           ../backend/filemem.c \
            ../backend/gb18030.c \
            ../backend/gb2312.c \
            ../backend/gridmtx.c \
@@ -76,6 +84,8 @@ SOURCES += ../backend/2of5.c \
            ../backend/hanxin.c \
            ../backend/imail.c \
            ../backend/large.c \
+           ../backend/bitgrid.c \
+           ../backend/bitstream.c \
            ../backend/library.c \
            ../backend/mailmark.c \
            ../backend/maxicode.c \
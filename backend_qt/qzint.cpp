@@ -658,10 +658,12 @@ namespace Zint {
 
     /* Note: legacy argument `mode` is not used */
     void QZint::render(QPainter& painter, const QRectF& paintRect, AspectRatioMode /*mode*/) {
-        struct zint_vector_rect *rect;
-        struct zint_vector_hexagon *hex;
-        struct zint_vector_circle *circle;
-        struct zint_vector_string *string;
+        const struct zint_vector *vector;
+        const struct zint_vector_rect *rect;
+        const struct zint_vector_hexagon *hex;
+        const struct zint_vector_circle *circle;
+        const struct zint_vector_string *string;
+        int i;
 
         encode();
 
@@ -715,27 +717,25 @@ namespace Zint {
         painter.fillRect(QRectF(0, 0, gwidth, gheight), bgBrush);
 
         // Plot rectangles
-        rect = m_zintSymbol->vector->rectangles;
-        if (rect) {
+        vector = m_zintSymbol->vector;
+        if (vector->rectangle_count) {
             QBrush brush(Qt::SolidPattern);
-            while (rect) {
+            for (i = 0, rect = vector->rectangles; i < vector->rectangle_count; i++, rect++) {
                 if (rect->colour == -1) {
                     brush.setColor(m_fgColor);
                 } else {
                     brush.setColor(colourToQtColor(rect->colour));
                 }
                 painter.fillRect(QRectF(rect->x, rect->y, rect->width, rect->height), brush);
-                rect = rect->next;
             }
         }
 
         // Plot hexagons
-        hex = m_zintSymbol->vector->hexagons;
-        if (hex) {
+        if (vector->hexagon_count) {
             painter.setRenderHint(QPainter::Antialiasing);
             QBrush fgBrush(m_fgColor);
             qreal previous_diameter = 0.0, radius = 0.0, half_radius = 0.0, half_sqrt3_radius = 0.0;
-            while (hex) {
+            for (i = 0, hex = vector->hexagons; i < vector->hexagon_count; i++, hex++) {
                 if (previous_diameter != hex->diameter) {
                     previous_diameter = hex->diameter;
                     radius = 0.5 * previous_diameter;
@@ -752,19 +752,16 @@ namespace Zint {
                 pt.lineTo(hex->x - half_sqrt3_radius, hex->y + half_radius);
                 pt.lineTo(hex->x, hex->y + radius);
                 painter.fillPath(pt, fgBrush);
-
-                hex = hex->next;
             }
         }
 
         // Plot dots (circles)
-        circle = m_zintSymbol->vector->circles;
-        if (circle) {
+        if (vector->circle_count) {
             painter.setRenderHint(QPainter::Antialiasing);
             QPen p;
             QBrush fgBrush(m_fgColor);
             qreal previous_diameter = 0.0, radius = 0.0;
-            while (circle) {
+            for (i = 0, circle = vector->circles; i < vector->circle_count; i++, circle++) {
                 if (previous_diameter != circle->diameter) {
                     previous_diameter = circle->diameter;
                     radius = 0.5 * previous_diameter;
@@ -781,13 +778,11 @@ namespace Zint {
                     painter.setBrush(circle->width ? Qt::NoBrush : fgBrush);
                 }
                 painter.drawEllipse(QPointF(circle->x, circle->y), radius, radius);
-                circle = circle->next;
             }
         }
 
         // Plot text
-        string = m_zintSymbol->vector->strings;
-        if (string) {
+        if (vector->string_count) {
             painter.setRenderHint(QPainter::Antialiasing);
             QPen p;
             p.setColor(m_fgColor);
@@ -795,7 +790,7 @@ namespace Zint {
             bool bold = (m_zintSymbol->output_options & BOLD_TEXT)
                             && (!isExtendable() || (m_zintSymbol->output_options & SMALL_TEXT));
             QFont font(fontStyle, -1 /*pointSize*/, bold ? QFont::Bold : -1);
-            while (string) {
+            for (i = 0, string = vector->strings; i < vector->string_count; i++, string++) {
                 font.setPixelSize(string->fsize);
                 painter.setFont(font);
                 QString content = QString::fromUtf8((const char *) string->text);
@@ -811,7 +806,6 @@ namespace Zint {
                         painter.drawText(QPointF(string->x - (width / 2.0), string->y), content);
                     }
                 }
-                string = string->next;
             }
         }
 
@@ -20,6 +20,7 @@
  */
 /* vim: set ts=4 sw=4 et : */
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,6 +30,8 @@
 #include <zint.h>
 #else
 #include <malloc.h>
+#include <io.h>
+#include <fcntl.h>
 #include "../getopt/getopt.h"
 #include "zint.h"
 #if _MSC_VER != 1200 /* VC6 */
@@ -137,7 +140,7 @@ static void usage(void) {
             "  -e, --ecinos          Display table of ECI character encodings\n"
             "  --eci=NUMBER          Set the ECI (Extended Channel Interpretation) code\n"
             "  --esc                 Process escape characters in input data\n"
-            "  --fast                Use faster encodation (Data Matrix)\n"
+            "  --fast                Use faster encodation or block analysis\n"
             "  --fg=COLOUR           Specify a foreground colour (in hex RGB/RGBA)\n"
             "  --filetype=TYPE       Set output file type BMP/EMF/EPS/GIF/PCX/PNG/SVG/TIF/TXT\n"
             "  --fullmultibyte       Use multibyte for binary/Latin (QR/Han Xin/Grid Matrix)\n"
@@ -171,6 +174,7 @@ static void usage(void) {
             "  --square              Force Data Matrix symbols to be square\n"
             "  --structapp=I,C[,ID]  Set Structured Append info (I index, C count)\n"
             "  -t, --types           Display table of barcode types\n"
+            "  --threads=NUMBER      Set number of threads to use in batch mode\n"
             "  --vers=NUMBER         Set symbol version (size, check digits, other options)\n"
             "  --vwhitesp=NUMBER     Set height of vertical whitespace in multiples of X-dim\n"
             "  -w, --whitesp=NUMBER  Set width of horizontal whitespace in multiples of X-dim\n"
@@ -557,19 +561,278 @@ int validate_structapp(const char *optarg, struct zint_structapp *structapp) {
     return 1;
 }
 
-/* Batch mode - output symbol for each line of text in `filename` */
+/* Batch mode - set `output_file` to name of output file for line `line_count` with data `buffer` */
+static void batch_outfile(const struct zint_symbol *symbol, const char *format_string, const int mirror_mode,
+            const unsigned char *buffer, const int buf_posn, const int line_count, const char *filetype,
+            char output_file[256]) {
+    char number[12], reverse_number[12];
+    int inpos, local_line_count;
+    char reversed_string[256], format_char;
+    int format_len, i, o;
+    char adjusted[2] = {0};
+
+    memset(output_file, 0, 256);
+
+    if (mirror_mode == 0) {
+        inpos = 0;
+        local_line_count = line_count;
+        memset(number, 0, sizeof(number));
+        memset(reverse_number, 0, sizeof(reverse_number));
+        memset(reversed_string, 0, sizeof(reversed_string));
+        do {
+            number[inpos] = itoc(local_line_count % 10);
+            local_line_count /= 10;
+            inpos++;
+        } while (local_line_count > 0);
+        number[inpos] = '\0';
+
+        for (i = 0; i < inpos; i++) {
+            reverse_number[i] = number[inpos - i - 1];
+        }
+
+        format_len = (int) strlen(format_string);
+        for (i = format_len; i > 0; i--) {
+            format_char = format_string[i - 1];
+
+            switch (format_char) {
+                case '#':
+                    if (inpos > 0) {
+                        adjusted[0] = reverse_number[inpos - 1];
+                        inpos--;
+                    } else {
+                        adjusted[0] = ' ';
+                    }
+                    break;
+                case '~':
+                    if (inpos > 0) {
+                        adjusted[0] = reverse_number[inpos - 1];
+                        inpos--;
+                    } else {
+                        adjusted[0] = '0';
+                    }
+                    break;
+                case '@':
+                    if (inpos > 0) {
+                        adjusted[0] = reverse_number[inpos - 1];
+                        inpos--;
+                    } else {
+                        adjusted[0] = '*';
+                    }
+                    break;
+                default:
+                    adjusted[0] = format_string[i - 1];
+                    break;
+            }
+            strcat(reversed_string, adjusted);
+        }
+
+        for (i = 0; i < format_len; i++) {
+            output_file[i] = reversed_string[format_len - i - 1];
+        }
+    } else {
+        /* Name the output file from the data being processed */
+        i = 0;
+        o = 0;
+        do {
+            if (buffer[i] < 0x20) {
+                output_file[o] = '_';
+            } else {
+                switch (buffer[i]) {
+                    case 0x21: // !
+                    case 0x22: // "
+                    case 0x2a: // *
+                    case 0x2f: // /
+                    case 0x3a: // :
+                    case 0x3c: // <
+                    case 0x3e: // >
+                    case 0x3f: // ?
+                    case 0x5c: // Backslash
+                    case 0x7c: // |
+                    case 0x7f: // DEL
+                        output_file[o] = '_';
+                        break;
+                    default:
+                        output_file[o] = buffer[i];
+                        break;
+                }
+            }
+
+            // Skip escape characters
+            if ((buffer[i] == 0x5c) && (symbol->input_mode & ESCAPE_MODE)) {
+                i++;
+                if (buffer[i] == 'x') {
+                    i += 2;
+                } else if (buffer[i] == 'u') {
+                    i += 4;
+                }
+            }
+            i++;
+            o++;
+        } while (i < buf_posn && o < 251);
+
+        /* Add file extension */
+        output_file[o] = '.';
+        output_file[o + 1] = '\0';
+
+        strncat(output_file, filetype, 3);
+    }
+}
+
+/* Number of lines read per thread before a multi-threaded batch is encoded */
+#define BATCH_LINES_PER_THREAD  64
+
+/* A line of input in a multi-threaded batch, along with its encoded output (in memory) */
+struct batch_line {
+    unsigned char *data;
+    int length;
+    int line_count;
+    char output_file[256];
+    int error_number;
+    char errtxt[100];
+    unsigned char *memfile;
+    int memfile_size;
+};
+
+/* Lines of input read so far in a multi-threaded batch */
+struct batch_chunk {
+    struct batch_line *lines;
+    const unsigned char **sources;
+    int *lengths;
+    int count;
+    int size;
+    int rotate_angle;
+};
+
+/* Multi-threaded batch callback - print symbol to memory and take a copy of the output (the symbol's buffer belongs
+   to the library's allocator, so is left for `ZBarcode_Clear()` to free) */
+static int batch_line_callback(struct zint_symbol *symbol, int index, int error_number, void *user_data) {
+    struct batch_chunk *chunk = (struct batch_chunk *) user_data;
+    struct batch_line *line = chunk->lines + index;
+
+    if (error_number < ZINT_ERROR) {
+        const int first_err = error_number;
+        strcpy(symbol->outfile, line->output_file);
+        symbol->output_options |= BARCODE_MEMORY_FILE;
+        error_number = ZBarcode_Print(symbol, chunk->rotate_angle);
+        if (error_number == 0) {
+            error_number = first_err;
+        }
+        if (symbol->memfile) {
+            if (!(line->memfile = (unsigned char *) malloc(symbol->memfile_size ? symbol->memfile_size : 1))) {
+                strcpy(symbol->errtxt, "Error 171: Insufficient memory for output buffer");
+                error_number = ZINT_ERROR_MEMORY;
+            } else {
+                memcpy(line->memfile, symbol->memfile, symbol->memfile_size);
+                line->memfile_size = symbol->memfile_size;
+            }
+        }
+    }
+    line->error_number = error_number;
+    strcpy(line->errtxt, symbol->errtxt);
+
+    return 0;
+}
+
+/* Multi-threaded batch - encode the lines of `chunk` using `threads` threads and write out their output in line
+   order. Returns the result of the last line, as with single-threaded batch processing */
+static int batch_flush(struct zint_symbol *symbol, struct batch_chunk *chunk, const char *filetype,
+            const int threads) {
+    static const char *text_filetypes[] = { "eps", "svg", "txt" };
+    char lc_filetype[4] = {0};
+    const char *mode = "wb";
+    int error_number;
+    int i;
+
+    if (chunk->count == 0) {
+        return -1;
+    }
+
+    strncpy(lc_filetype, filetype, 3);
+    to_lower(lc_filetype);
+    for (i = 0; i < ARRAY_SIZE(text_filetypes); i++) {
+        if (strcmp(lc_filetype, text_filetypes[i]) == 0) {
+            mode = "w";
+            break;
+        }
+    }
+
+    for (i = 0; i < chunk->count; i++) {
+        chunk->sources[i] = chunk->lines[i].data;
+        chunk->lengths[i] = chunk->lines[i].length;
+    }
+
+    error_number = ZBarcode_Encode_Batch(symbol, chunk->sources, chunk->lengths, chunk->count, threads,
+                                        batch_line_callback, chunk);
+
+    for (i = 0; i < chunk->count; i++) {
+        struct batch_line *line = chunk->lines + i;
+
+        if (line->error_number == -1) { /* Not reached by callback, so batch must have failed */
+            line->error_number = error_number ? error_number : ZINT_ERROR_MEMORY;
+            strcpy(line->errtxt, symbol->errtxt);
+        }
+
+        if (line->memfile) {
+            if (symbol->output_options & BARCODE_STDOUT) {
+#ifdef _MSC_VER
+                if (mode[1] == 'b') {
+                    (void) _setmode(_fileno(stdout), _O_BINARY);
+                }
+#endif
+                if (fwrite(line->memfile, 1, line->memfile_size, stdout) != (size_t) line->memfile_size) {
+                    sprintf(line->errtxt, "Error 166: Failure writing to output (%d: %.30s)", errno,
+                            strerror(errno));
+                    line->error_number = ZINT_ERROR_FILE_WRITE;
+                }
+                fflush(stdout);
+            } else {
+                FILE *outfile = fopen(line->output_file, mode);
+                if (!outfile) {
+                    sprintf(line->errtxt, "Error 167: Could not open output file (%d: %.30s)", errno,
+                            strerror(errno));
+                    line->error_number = ZINT_ERROR_FILE_ACCESS;
+                } else {
+                    if (fwrite(line->memfile, 1, line->memfile_size, outfile) != (size_t) line->memfile_size) {
+                        sprintf(line->errtxt, "Error 168: Incomplete write to output (%d: %.30s)", errno,
+                                strerror(errno));
+                        line->error_number = ZINT_ERROR_FILE_WRITE;
+                    }
+                    if (fclose(outfile) != 0 && line->error_number < ZINT_ERROR) {
+                        sprintf(line->errtxt, "Error 169: Failure on closing output file (%d: %.30s)", errno,
+                                strerror(errno));
+                        line->error_number = ZINT_ERROR_FILE_WRITE;
+                    }
+                }
+            }
+            free(line->memfile);
+            line->memfile = NULL;
+            line->memfile_size = 0;
+        }
+        if (line->error_number != 0) {
+            fprintf(stderr, "On line %d: %s\n", line->line_count, line->errtxt);
+            fflush(stderr);
+        }
+        error_number = line->error_number;
+        free(line->data);
+        line->data = NULL;
+    }
+    chunk->count = 0;
+
+    return error_number;
+}
+
+/* Batch mode - output symbol for each line of text in `filename`, using `threads` threads */
 static int batch_process(struct zint_symbol *symbol, const char *filename, const int mirror_mode,
-            const char *filetype, const int rotate_angle) {
+            const char *filetype, const int rotate_angle, const int threads) {
     FILE *file;
     unsigned char buffer[ZINT_MAX_DATA_LEN] = {0}; // Maximum HanXin input
     unsigned char character = 0;
     int buf_posn = 0, error_number = 0, line_count = 1;
     char output_file[256];
-    char number[12], reverse_number[12];
-    int inpos, local_line_count;
-    char format_string[256], reversed_string[256], format_char;
-    int format_len, i, o;
-    char adjusted[2] = {0};
+    char format_string[256];
+    struct batch_chunk chunk;
+
+    memset(&chunk, 0, sizeof(chunk));
 
     if (symbol->outfile[0] == '\0') {
         strcpy(format_string, "~~~~~.");
@@ -579,12 +842,30 @@ static int batch_process(struct zint_symbol *symbol, const char *filename, const
         set_extension(format_string, filetype);
     }
 
+    if (threads > 1) {
+        chunk.size = threads * BATCH_LINES_PER_THREAD;
+        chunk.lines = (struct batch_line *) calloc(chunk.size, sizeof(struct batch_line));
+        chunk.sources = (const unsigned char **) malloc(sizeof(unsigned char *) * chunk.size);
+        chunk.lengths = (int *) malloc(sizeof(int) * chunk.size);
+        if (!chunk.lines || !chunk.sources || !chunk.lengths) {
+            free(chunk.lines);
+            free((void *) chunk.sources);
+            free(chunk.lengths);
+            strcpy(symbol->errtxt, "Error 170: Insufficient memory for batch threads");
+            return ZINT_ERROR_MEMORY;
+        }
+        chunk.rotate_angle = rotate_angle;
+    }
+
     if (!strcmp(filename, "-")) {
         file = stdin;
     } else {
         file = fopen(filename, "rb");
         if (!file) {
             sprintf(symbol->errtxt, "102: Unable to read input file '%s'", filename);
+            free(chunk.lines);
+            free((void *) chunk.sources);
+            free(chunk.lengths);
             return ZINT_ERROR_INVALID_DATA;
         }
     }
@@ -603,118 +884,35 @@ static int batch_process(struct zint_symbol *symbol, const char *filename, const
                 buffer[buf_posn] = '\0';
             }
 
-            if (mirror_mode == 0) {
-                inpos = 0;
-                local_line_count = line_count;
-                memset(number, 0, sizeof(number));
-                memset(reverse_number, 0, sizeof(reverse_number));
-                memset(reversed_string, 0, sizeof(reversed_string));
-                memset(output_file, 0, sizeof(output_file));
-                do {
-                    number[inpos] = itoc(local_line_count % 10);
-                    local_line_count /= 10;
-                    inpos++;
-                } while (local_line_count > 0);
-                number[inpos] = '\0';
-
-                for (i = 0; i < inpos; i++) {
-                    reverse_number[i] = number[inpos - i - 1];
-                }
+            batch_outfile(symbol, format_string, mirror_mode, buffer, buf_posn, line_count, filetype, output_file);
 
-                format_len = (int) strlen(format_string);
-                for (i = format_len; i > 0; i--) {
-                    format_char = format_string[i - 1];
-
-                    switch (format_char) {
-                        case '#':
-                            if (inpos > 0) {
-                                adjusted[0] = reverse_number[inpos - 1];
-                                inpos--;
-                            } else {
-                                adjusted[0] = ' ';
-                            }
-                            break;
-                        case '~':
-                            if (inpos > 0) {
-                                adjusted[0] = reverse_number[inpos - 1];
-                                inpos--;
-                            } else {
-                                adjusted[0] = '0';
-                            }
-                            break;
-                        case '@':
-                            if (inpos > 0) {
-                                adjusted[0] = reverse_number[inpos - 1];
-                                inpos--;
-                            } else {
-                                adjusted[0] = '*';
-                            }
-                            break;
-                        default:
-                            adjusted[0] = format_string[i - 1];
-                            break;
+            if (chunk.lines) {
+                struct batch_line *line = chunk.lines + chunk.count;
+                if (!(line->data = (unsigned char *) malloc(buf_posn + 1))) {
+                    fprintf(stderr, "On line %d: Error 170: Insufficient memory for batch threads\n", line_count);
+                    fflush(stderr);
+                    error_number = ZINT_ERROR_MEMORY;
+                } else {
+                    memcpy(line->data, buffer, buf_posn);
+                    line->data[buf_posn] = '\0';
+                    line->length = buf_posn;
+                    line->line_count = line_count;
+                    strcpy(line->output_file, output_file);
+                    line->error_number = -1; /* Set by callback */
+                    line->errtxt[0] = '\0';
+                    if (++chunk.count == chunk.size) {
+                        error_number = batch_flush(symbol, &chunk, filetype, threads);
                     }
-                    strcat(reversed_string, adjusted);
-                }
-
-                for (i = 0; i < format_len; i++) {
-                    output_file[i] = reversed_string[format_len - i - 1];
                 }
             } else {
-                /* Name the output file from the data being processed */
-                i = 0;
-                o = 0;
-                do {
-                    if (buffer[i] < 0x20) {
-                        output_file[o] = '_';
-                    } else {
-                        switch (buffer[i]) {
-                            case 0x21: // !
-                            case 0x22: // "
-                            case 0x2a: // *
-                            case 0x2f: // /
-                            case 0x3a: // :
-                            case 0x3c: // <
-                            case 0x3e: // >
-                            case 0x3f: // ?
-                            case 0x5c: // Backslash
-                            case 0x7c: // |
-                            case 0x7f: // DEL
-                                output_file[o] = '_';
-                                break;
-                            default:
-                                output_file[o] = buffer[i];
-                                break;
-                        }
-                    }
-
-                    // Skip escape characters
-                    if ((buffer[i] == 0x5c) && (symbol->input_mode & ESCAPE_MODE)) {
-                        i++;
-                        if (buffer[i] == 'x') {
-                            i += 2;
-                        } else if (buffer[i] == 'u') {
-                            i += 4;
-                        }
-                    }
-                    i++;
-                    o++;
-                } while (i < buf_posn && o < 251);
-
-                /* Add file extension */
-                output_file[o] = '.';
-                output_file[o + 1] = '\0';
-
-                strncat(output_file, filetype, 3);
-            }
-
-            strcpy(symbol->outfile, output_file);
-            error_number = ZBarcode_Encode_and_Print(symbol, buffer, buf_posn, rotate_angle);
-            if (error_number != 0) {
-                fprintf(stderr, "On line %d: %s\n", line_count, symbol->errtxt);
-                fflush(stderr);
+                strcpy(symbol->outfile, output_file);
+                error_number = ZBarcode_Encode_and_Print(symbol, buffer, buf_posn, rotate_angle);
+                if (error_number != 0) {
+                    fprintf(stderr, "On line %d: %s\n", line_count, symbol->errtxt);
+                    fflush(stderr);
+                }
+                ZBarcode_Clear(symbol);
             }
-            ZBarcode_Clear(symbol);
             memset(buffer, 0, sizeof(buffer));
             buf_posn = 0;
             line_count++;
@@ -731,6 +929,16 @@ static int batch_process(struct zint_symbol *symbol, const char *filename, const
         }
     } while ((!feof(file)) && (line_count < 2000000000));
 
+    if (chunk.lines) {
+        const int last_error = batch_flush(symbol, &chunk, filetype, threads);
+        if (last_error != -1) {
+            error_number = last_error;
+        }
+        free(chunk.lines);
+        free((void *) chunk.sources);
+        free(chunk.lengths);
+    }
+
     if (character != '\n') {
         fprintf(stderr, "Warning 104: No newline at end of file\n");
         fflush(stderr);
@@ -827,6 +1035,7 @@ int main(int argc, char **argv) {
     int separator = 0;
     int addon_gap = 0;
     int rows = 0;
+    int threads = 1;
     char filetype[4] = {0};
     int no_png;
     int png_refused;
@@ -869,7 +1078,7 @@ int main(int argc, char **argv) {
             OPT_HEIGHT, OPT_HEIGHTPERROW, OPT_INIT, OPT_MIRROR, OPT_MASK, OPT_MODE,
             OPT_NOBACKGROUND, OPT_NOQUIETZONES, OPT_NOTEXT, OPT_PRIMARY, OPT_QUIETZONES,
             OPT_ROTATE, OPT_ROWS, OPT_SCALE, OPT_SCMVV,
-            OPT_SECURE, OPT_SEPARATOR, OPT_SMALL, OPT_SQUARE, OPT_STRUCTAPP,
+            OPT_SECURE, OPT_SEPARATOR, OPT_SMALL, OPT_SQUARE, OPT_STRUCTAPP, OPT_THREADS,
             OPT_VERBOSE, OPT_VERS, OPT_VWHITESP, OPT_WERROR,
         };
         int option_index = 0;
@@ -929,6 +1138,7 @@ int main(int argc, char **argv) {
             {"small", 0, NULL, OPT_SMALL},
             {"square", 0, NULL, OPT_SQUARE},
             {"structapp", 1, NULL, OPT_STRUCTAPP},
+            {"threads", 1, NULL, OPT_THREADS},
             {"types", 0, NULL, 't'},
             {"verbose", 0, NULL, OPT_VERBOSE}, // Currently undocumented, output some debug info
             {"vers", 1, NULL, OPT_VERS},
@@ -1262,6 +1472,18 @@ int main(int argc, char **argv) {
                     return do_exit(1);
                 }
                 break;
+            case OPT_THREADS:
+                if (!validate_int(optarg, &val)) {
+                    fprintf(stderr, "Error 164: Invalid number of threads value (digits only)\n");
+                    return do_exit(1);
+                }
+                if (val >= 1 && val <= 256) {
+                    threads = val;
+                } else {
+                    fprintf(stderr, "Warning 165: Number of threads out of range (1 to 256), ignoring\n");
+                    fflush(stderr);
+                }
+                break;
             case OPT_VERBOSE:
                 my_symbol->debug = 1;
                 break;
@@ -1430,7 +1652,7 @@ int main(int argc, char **argv) {
                     filetype);
                 fflush(stderr);
             }
-            error_number = batch_process(my_symbol, arg_opts[0].arg, mirror_mode, filetype, rotate_angle);
+            error_number = batch_process(my_symbol, arg_opts[0].arg, mirror_mode, filetype, rotate_angle, threads);
             if (error_number != 0) {
                 fprintf(stderr, "%s\n", my_symbol->errtxt);
                 fflush(stderr);
@@ -100,6 +100,10 @@ SOURCE=..\..\backend\aztec.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\backend\batch.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\backend\bmp.c
 # End Source File
 # Begin Source File
@@ -152,6 +156,14 @@ SOURCE=..\..\backend\emf.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\backend\encache.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\backend\filemem.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\backend\gb18030.c
 # End Source File
 # Begin Source File
@@ -196,6 +208,14 @@ SOURCE=..\..\backend\large.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\backend\bitgrid.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\backend\bitstream.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\backend\library.c
 # End Source File
 # Begin Source File